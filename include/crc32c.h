@@ -5,5 +5,14 @@
 #include <stdint.h>
 
 extern uint32_t crc32c(uint32_t crc, const void *buf, size_t size);
+extern const char *crc32c_name(void);
+extern void crc32c_multi(uint32_t *crcs, const void * const *bufs,
+			 const size_t *sizes, int count);
+extern uint32_t crc32c_combine(uint32_t crc_a, uint32_t crc_b,
+			       size_t len_b);
+
+/* lib/crc32c_file.c */
+extern int crc32c_file(int fd, off_t offset, off_t size, int threads,
+		       uint32_t *crc);
 
 #endif /* UL_NG_CRC32C_H */
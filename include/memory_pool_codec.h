@@ -0,0 +1,142 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * include/memory_pool_codec.h - lightweight encodings of portions.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#ifndef _MEMORY_POOL_CODEC_H
+#define _MEMORY_POOL_CODEC_H
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/*
+ * Layout of encoded portion (all fields are little-endian):
+ *
+ * +--------+----------+----------+-----+----------+----------+-----
+ * | header | column 0 | column 1 | ... | data 0   | data 1   | ...
+ * +--------+----------+----------+-----+----------+----------+-----
+ *
+ * Column N keeps item N of every record, so every column is
+ * encoded by its own method:
+ * (1) PLAIN - items as is;
+ * (2) FOR - frame of reference: (item - base) is packed by bits
+ *     in groups of MEMPOOL_CODEC_GROUP items;
+ * (3) DELTA - differences of non-decreasing items in varint form;
+ * (4) RLE - pairs of (run length, item) in varint form.
+ *
+ * Columns and encoded portions of container are aligned
+ * by MEMPOOL_CODEC_ALIGNMENT.
+ *
+ * FOR group keeps MEMPOOL_CODEC_LANES interleaved lanes of 32-bit
+ * words: item N belongs to lane (N % LANES), and word M of every lane
+ * is placed at (M * LANES + lane). Thus, one vector load provides
+ * the same bits of adjacent items.
+ */
+
+#define MEMPOOL_CODEC_MAGIC			(0x4243504D) /* MPCB */
+#define MEMPOOL_CODEC_LANES			(8)
+#define MEMPOOL_CODEC_GROUP			(256)
+#define MEMPOOL_CODEC_MAX_BITS			(32)
+#define MEMPOOL_CODEC_MAX_GRANULARITY		(8)
+#define MEMPOOL_CODEC_ALIGNMENT			(8)
+
+/*
+ * struct mempool_codec_header - header of encoded portion
+ * @magic: encoded portion magic
+ * @columns: number of columns (items in record)
+ * @granularity: size of item in bytes
+ * @records: number of encoded records
+ * @reserved: reserved field
+ */
+struct mempool_codec_header {
+	uint32_t magic;
+	uint16_t columns;
+	uint16_t granularity;
+	uint32_t records;
+	uint32_t reserved;
+};
+
+/*
+ * struct mempool_codec_column - descriptor of encoded column
+ * @encoding: encoding of column
+ * @bits: width of packed item in bits (FOR encoding)
+ * @base: minimal item of column
+ * @offset: offset of column's data from the header in bytes
+ * @bytes: size of column's data in bytes
+ */
+struct mempool_codec_column {
+	uint32_t encoding;
+	uint32_t bits;
+	uint64_t base;
+	uint64_t offset;
+	uint64_t bytes;
+};
+
+typedef void (*mempool_codec_unpack_fn)(const uint32_t *words, int bits,
+					uint32_t *items);
+
+/*
+ * struct mempool_codec_cursor - sequential reader of column
+ * @data: column's data
+ * @bytes: size of column's data in bytes
+ * @encoding: encoding of column
+ * @bits: width of packed item in bits (FOR encoding)
+ * @granularity: size of item in bytes
+ * @base: minimal item of column
+ * @records: number of items in column
+ * @position: index of the next item
+ * @offset: position in data (DELTA and RLE encodings)
+ * @value: previous item (DELTA) or item of run (RLE)
+ * @run: rest of items in the run (RLE encoding)
+ * @group: index of unpacked group (FOR encoding)
+ * @unpack: unpack method of FOR groups
+ * @items: unpacked group (FOR encoding)
+ */
+struct mempool_codec_cursor {
+	const uint8_t *data;
+	size_t bytes;
+	int encoding;
+	int bits;
+	int granularity;
+	unsigned long long base;
+	unsigned int records;
+	unsigned int position;
+	size_t offset;
+	unsigned long long value;
+	unsigned long long run;
+	long long group;
+	mempool_codec_unpack_fn unpack;
+	uint32_t items[MEMPOOL_CODEC_GROUP];
+};
+
+/* lib/codec.c */
+size_t mempool_codec_bound(int granularity, int record_capacity,
+			   unsigned int records);
+int mempool_codec_encode(const void *portion, unsigned int records,
+			 int granularity, int record_capacity,
+			 int encoding, void **block, size_t *bytes);
+int mempool_codec_check(const void *block, size_t bytes,
+			int granularity, int record_capacity,
+			unsigned int records);
+int mempool_codec_cursor_init(struct mempool_codec_cursor *cursor,
+			      const void *block, int column);
+int mempool_codec_cursor_seek(struct mempool_codec_cursor *cursor,
+			      unsigned int position);
+int mempool_codec_cursor_read(struct mempool_codec_cursor *cursor,
+			      unsigned long long *items, unsigned int count);
+int mempool_codec_decode(const void *block, void *portion,
+			 size_t portion_size);
+const char *mempool_codec_unpack_name(void);
+
+#endif /* _MEMORY_POOL_CODEC_H */
@@ -30,6 +30,9 @@ enum {
 	MEMPOOL_SORT_ALGORITHM,
 	MEMPOOL_SELECT_ALGORITHM,
 	MEMPOOL_TOTAL_ALGORITHM,
+	MEMPOOL_TOPK_ALGORITHM,
+	MEMPOOL_DISTINCT_ALGORITHM,
+	MEMPOOL_CONVERT_ALGORITHM,
 	MEMPOOOL_ALGORITHM_ID_MAX
 };
 
@@ -37,5 +40,142 @@ enum {
 #define MEMPOOL_SORT_ALGORITHM_STR		"SORT"
 #define MEMPOOL_SELECT_ALGORITHM_STR		"SELECT"
 #define MEMPOOL_TOTAL_ALGORITHM_STR		"TOTAL"
+#define MEMPOOL_TOPK_ALGORITHM_STR		"TOPK"
+#define MEMPOOL_DISTINCT_ALGORITHM_STR		"DISTINCT"
+#define MEMPOOL_CONVERT_ALGORITHM_STR		"CONVERT"
+
+/* order of keys */
+enum {
+	MEMPOOL_UNKNOWN_ORDER,
+	MEMPOOL_ASCENDING_ORDER,
+	MEMPOOL_DESCENDING_ORDER,
+	MEMPOOL_ORDER_MAX
+};
+
+#define MEMPOOL_ASCENDING_ORDER_STR		"asc"
+#define MEMPOOL_DESCENDING_ORDER_STR		"desc"
+
+/* output of DISTINCT algorithm */
+enum {
+	MEMPOOL_UNKNOWN_DISTINCT_OUTPUT,
+	MEMPOOL_DISTINCT_KEY_OUTPUT,
+	MEMPOOL_DISTINCT_FIRST_VALUE_OUTPUT,
+	MEMPOOL_DISTINCT_COUNT_OUTPUT,
+	MEMPOOL_DISTINCT_OUTPUT_MAX
+};
+
+#define MEMPOOL_DISTINCT_KEY_OUTPUT_STR		"key"
+#define MEMPOOL_DISTINCT_FIRST_VALUE_OUTPUT_STR	"first"
+#define MEMPOOL_DISTINCT_COUNT_OUTPUT_STR	"count"
+
+/* NUMA mode */
+enum {
+	MEMPOOL_UNKNOWN_NUMA_MODE,
+	MEMPOOL_NUMA_NONE_MODE,
+	MEMPOOL_NUMA_BIND_MODE,
+	MEMPOOL_NUMA_INTERLEAVE_MODE,
+	MEMPOOL_NUMA_MODE_MAX
+};
+
+#define MEMPOOL_NUMA_NONE_MODE_STR		"none"
+#define MEMPOOL_NUMA_BIND_MODE_STR		"bind"
+#define MEMPOOL_NUMA_INTERLEAVE_MODE_STR	"interleave"
+
+/* mapping of files */
+enum {
+	MEMPOOL_UNKNOWN_MAP_MODE,
+	MEMPOOL_MAP_POPULATE_MODE,
+	MEMPOOL_MAP_LAZY_MODE,
+	MEMPOOL_MAP_PREFAULT_MODE,
+	MEMPOOL_MAP_MODE_MAX
+};
+
+#define MEMPOOL_MAP_POPULATE_MODE_STR		"populate"
+#define MEMPOOL_MAP_LAZY_MODE_STR		"lazy"
+#define MEMPOOL_MAP_PREFAULT_MODE_STR		"prefault"
+
+/* huge pages */
+enum {
+	MEMPOOL_UNKNOWN_HUGE_PAGES_MODE,
+	MEMPOOL_HUGE_PAGES_NONE_MODE,
+	MEMPOOL_HUGE_PAGES_TRANSPARENT_MODE,
+	MEMPOOL_HUGE_PAGES_EXPLICIT_MODE,
+	MEMPOOL_HUGE_PAGES_MODE_MAX
+};
+
+#define MEMPOOL_HUGE_PAGES_NONE_MODE_STR		"none"
+#define MEMPOOL_HUGE_PAGES_TRANSPARENT_MODE_STR	"transparent"
+#define MEMPOOL_HUGE_PAGES_EXPLICIT_MODE_STR		"explicit"
+
+/* I/O backends of streaming mode */
+enum {
+	MEMPOOL_UNKNOWN_IO_BACKEND,
+	MEMPOOL_PREAD_IO_BACKEND,
+	MEMPOOL_URING_IO_BACKEND,
+	MEMPOOL_IO_BACKEND_MAX
+};
+
+#define MEMPOOL_PREAD_IO_BACKEND_STR		"pread"
+#define MEMPOOL_URING_IO_BACKEND_STR		"uring"
+
+#define MEMPOOL_DEFAULT_IO_DEPTH		(32)
+
+/* UART link */
+#define MEMPOOL_DEFAULT_LINK_WINDOW		(8)
+#define MEMPOOL_MAX_LINK_WINDOW			(1024)
+#define MEMPOOL_MAX_SESSION_JOBS		(1000000)
+#define MEMPOOL_MIN_LINK_FRAME			(64)
+
+enum {
+	MEMPOOL_UNKNOWN_FLOW_CONTROL,
+	MEMPOOL_NO_FLOW_CONTROL,
+	MEMPOOL_RTSCTS_FLOW_CONTROL,
+	MEMPOOL_FLOW_CONTROL_MAX
+};
+
+#define MEMPOOL_NO_FLOW_CONTROL_STR		"none"
+#define MEMPOOL_RTSCTS_FLOW_CONTROL_STR		"rtscts"
+
+/* manifest of checksums is kept next to output file */
+#define MEMPOOL_CHECKSUM_MANIFEST_SUFFIX	".crc"
+
+/* format of dataset files */
+enum {
+	MEMPOOL_UNKNOWN_FORMAT,
+	MEMPOOL_RAW_FORMAT,
+	MEMPOOL_CONTAINER_FORMAT,
+	MEMPOOL_FORMAT_MAX
+};
+
+#define MEMPOOL_RAW_FORMAT_STR			"raw"
+#define MEMPOOL_CONTAINER_FORMAT_STR		"container"
+
+/* encoding of portions */
+enum {
+	MEMPOOL_UNKNOWN_ENCODING,
+	MEMPOOL_PLAIN_ENCODING,
+	MEMPOOL_FOR_ENCODING,
+	MEMPOOL_DELTA_ENCODING,
+	MEMPOOL_RLE_ENCODING,
+	MEMPOOL_AUTO_ENCODING,
+	MEMPOOL_ENCODING_MAX
+};
+
+#define MEMPOOL_PLAIN_ENCODING_STR		"plain"
+#define MEMPOOL_FOR_ENCODING_STR		"for"
+#define MEMPOOL_DELTA_ENCODING_STR		"delta"
+#define MEMPOOL_RLE_ENCODING_STR		"rle"
+#define MEMPOOL_AUTO_ENCODING_STR		"auto"
+
+/* layout of records in portion */
+enum {
+	MEMPOOL_UNKNOWN_LAYOUT,
+	MEMPOOL_ROW_LAYOUT,
+	MEMPOOL_PAX_LAYOUT,
+	MEMPOOL_LAYOUT_MAX
+};
+
+#define MEMPOOL_ROW_LAYOUT_STR			"row"
+#define MEMPOOL_PAX_LAYOUT_STR			"pax"
 
 #endif /* _MEMPOOL_CONSTANTS_H */
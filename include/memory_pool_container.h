@@ -0,0 +1,211 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * include/memory_pool_container.h - container format of datasets.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#ifndef _MEMORY_POOL_CONTAINER_H
+#define _MEMORY_POOL_CONTAINER_H
+
+#include <sys/types.h>
+#include <stdint.h>
+
+/*
+ * Layout of container (all fields are little-endian):
+ *
+ * +--------+-----------+---------+-----------+-----------+-----
+ * | header | directory | padding | portion 0 | portion 1 | ...
+ * +--------+-----------+---------+-----------+-----------+-----
+ *
+ * Payload of every portion starts from aligned offset, so
+ * the payloads can be mapped or read by O_DIRECT. Encoded portions
+ * (see memory_pool_codec.h) are placed one after another, so
+ * the stride of such container is irregular.
+ *
+ * Records of portion are placed one after another (ROW layout) or
+ * item N of all records of portion is placed contiguously (PAX
+ * layout), i.e. item N of record R is placed at
+ * (N * records + R) * granularity, where records is the number
+ * of records in portion.
+ */
+
+#define MEMPOOL_CONTAINER_MAGIC			(0x4643504D) /* MPCF */
+#define MEMPOOL_CONTAINER_VERSION		(3)
+#define MEMPOOL_CONTAINER_ALIGNMENT		(4096)
+
+/* interpretation of key items */
+enum {
+	MEMPOOL_UNKNOWN_KEY_TYPE,
+	MEMPOOL_UNSIGNED_KEY_TYPE,
+	MEMPOOL_KEY_TYPE_MAX
+};
+
+/*
+ * struct mempool_container_header - on-disk header of container
+ * @magic: container magic
+ * @version: version of format
+ * @header_size: size of header in bytes
+ * @granularity: size of item in bytes
+ * @record_capacity: number of items in record
+ * @portion_capacity: maximum number of records in portion
+ * @portions_count: number of portions in directory
+ * @key_mask: bitmap of key items in record
+ * @value_mask: bitmap of value items in record
+ * @key_type: interpretation of key items
+ * @sort_order: order of records by key (MEMPOOL_UNKNOWN_ORDER - unsorted)
+ * @algorithm: algorithm that has produced the dataset (0 - raw data)
+ * @alignment: alignment of payloads in bytes
+ * @encoding: encoding of portions (MEMPOOL_PLAIN_ENCODING - records)
+ * @layout: layout of records in plain portions
+ * @directory_offset: offset of directory in bytes
+ * @payload_offset: offset of the first payload in bytes
+ * @directory_crc: crc32c of directory
+ * @header_crc: crc32c of header without this field
+ */
+struct mempool_container_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t header_size;
+	uint32_t granularity;
+	uint32_t record_capacity;
+	uint32_t portion_capacity;
+	uint32_t portions_count;
+	uint64_t key_mask;
+	uint64_t value_mask;
+	uint32_t key_type;
+	uint32_t sort_order;
+	uint32_t algorithm;
+	uint32_t alignment;
+	uint32_t encoding;
+	uint32_t layout;
+	uint64_t directory_offset;
+	uint64_t payload_offset;
+	uint32_t directory_crc;
+	uint32_t header_crc;
+};
+
+/*
+ * struct mempool_container_entry - on-disk descriptor of portion
+ * @offset: offset of payload in bytes
+ * @bytes: number of valid bytes in payload
+ * @records: number of records in payload
+ * @crc: crc32c of valid bytes
+ */
+struct mempool_container_entry {
+	uint64_t offset;
+	uint64_t bytes;
+	uint32_t records;
+	uint32_t crc;
+};
+
+/*
+ * struct mempool_container_portion - descriptor of portion
+ * @offset: offset of payload in bytes
+ * @bytes: number of valid bytes in payload
+ * @records: number of records in payload
+ * @crc: crc32c of valid bytes
+ */
+struct mempool_container_portion {
+	unsigned long long offset;
+	unsigned long long bytes;
+	unsigned int records;
+	unsigned int crc;
+};
+
+/*
+ * struct mempool_container - dataset container
+ * @granularity: size of item in bytes
+ * @record_capacity: number of items in record
+ * @portion_capacity: maximum number of records in portion
+ * @portions_count: number of portions
+ * @key_mask: bitmap of key items in record
+ * @value_mask: bitmap of value items in record
+ * @key_type: interpretation of key items
+ * @sort_order: order of records by key
+ * @algorithm: algorithm that has produced the dataset
+ * @encoding: encoding of portions
+ * @layout: layout of records in portions
+ * @payload_offset: offset of the first payload in bytes
+ * @stride: distance between payloads in bytes (0 - irregular)
+ * @portions: directory of portions
+ */
+struct mempool_container {
+	int granularity;
+	int record_capacity;
+	int portion_capacity;
+	int portions_count;
+	unsigned long long key_mask;
+	unsigned long long value_mask;
+	int key_type;
+	int sort_order;
+	int algorithm;
+	int encoding;
+	int layout;
+	unsigned long long payload_offset;
+	unsigned long long stride;
+	struct mempool_container_portion *portions;
+};
+
+struct mempool_test_environment;
+
+/* lib/container.c */
+uint32_t mempool_container_crc(const void *buf, size_t bytes);
+int mempool_container_create(struct mempool_container *container,
+			     int portions_count, size_t stride);
+int mempool_container_read(int fd, struct mempool_container *container);
+int mempool_container_write(int fd, struct mempool_container *container);
+void mempool_container_destroy(struct mempool_container *container);
+int mempool_container_check_portion(struct mempool_container *container,
+				    int index, const void *payload);
+int mempool_container_load_geometry(struct mempool_container *container,
+				    struct mempool_test_environment *env);
+void mempool_pax_to_rows(const void *pax, void *rows, unsigned int records,
+			 int granularity, int record_capacity);
+void mempool_rows_to_pax(const void *rows, void *pax, unsigned int records,
+			 int granularity, int record_capacity);
+
+static inline
+unsigned long long mempool_container_align(unsigned long long bytes)
+{
+	return (bytes + MEMPOOL_CONTAINER_ALIGNMENT - 1) &
+			~((unsigned long long)MEMPOOL_CONTAINER_ALIGNMENT - 1);
+}
+
+/*
+ * Size of container file: payloads are followed by the whole stride.
+ * Irregular container ends by the last payload.
+ */
+static inline
+unsigned long long
+mempool_container_file_size(struct mempool_container *container)
+{
+	unsigned long long size = container->payload_offset;
+	int i;
+
+	if (container->stride != 0) {
+		return container->payload_offset +
+			container->stride * container->portions_count;
+	}
+
+	for (i = 0; i < container->portions_count; i++) {
+		struct mempool_container_portion *portion;
+
+		portion = &container->portions[i];
+		if (portion->offset + portion->bytes > size)
+			size = portion->offset + portion->bytes;
+	}
+
+	return size;
+}
+
+#endif /* _MEMORY_POOL_CONTAINER_H */
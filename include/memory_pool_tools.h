@@ -69,7 +69,15 @@ struct mempool_file_descriptor {
  */
 struct mempool_threads_descriptor {
 	int count;
-	int portion_size;
+	long long portion_size;
+};
+
+/*
+ * struct mempool_workers_descriptor - workers descriptor
+ * @count: number of worker threads that process portions
+ */
+struct mempool_workers_descriptor {
+	int count;
 };
 
 /*
@@ -124,6 +132,124 @@ struct mempool_condition_descriptor {
 	unsigned long long max;
 };
 
+/*
+ * struct mempool_limit_descriptor - limit descriptor
+ * @count: number of records in result (K)
+ * @order: keep smallest (ascending) or largest (descending) keys
+ */
+struct mempool_limit_descriptor {
+	int count;
+	int order;
+};
+
+/*
+ * struct mempool_distinct_descriptor - DISTINCT descriptor
+ * @output: output of every unique key (key only, first value or count)
+ */
+struct mempool_distinct_descriptor {
+	int output;
+};
+
+/*
+ * struct mempool_numa_descriptor - NUMA descriptor
+ * @mode: placement of workers and memory (none, bind or interleave)
+ */
+struct mempool_numa_descriptor {
+	int mode;
+};
+
+/*
+ * struct mempool_map_descriptor - mapping descriptor
+ * @mode: strategy of mapping files (populate, lazy or prefault)
+ */
+struct mempool_map_descriptor {
+	int mode;
+};
+
+/*
+ * struct mempool_huge_pages_descriptor - huge pages descriptor
+ * @mode: backing of memory (none, transparent or explicit)
+ */
+struct mempool_huge_pages_descriptor {
+	int mode;
+};
+
+/*
+ * struct mempool_stream_descriptor - streaming descriptor
+ * @budget: memory budget of streaming buffers in bytes (0 - mapping)
+ * @backend: I/O backend (pread or uring)
+ * @depth: number of I/O requests in flight
+ * @direct: bypass page cache by O_DIRECT
+ */
+struct mempool_stream_descriptor {
+	long long budget;
+	int backend;
+	int depth;
+	int direct;
+};
+
+/*
+ * struct mempool_format_descriptor - format of files descriptor
+ * @input: format of input file (detected by header)
+ * @output: format of output file
+ */
+struct mempool_format_descriptor {
+	int input;
+	int output;
+};
+
+/*
+ * struct mempool_encoding_descriptor - encoding of portions descriptor
+ * @input: encoding of input portions (defined by container)
+ * @output: encoding of output portions
+ */
+struct mempool_encoding_descriptor {
+	int input;
+	int output;
+};
+
+/*
+ * struct mempool_layout_descriptor - layout of portions descriptor
+ * @input: layout of input portions (defined by container)
+ * @output: layout of output portions
+ */
+struct mempool_layout_descriptor {
+	int input;
+	int output;
+};
+
+/*
+ * struct mempool_checksum_descriptor - checksum of output descriptor
+ * @enabled: calculate crc32c of output portions and write manifest
+ */
+struct mempool_checksum_descriptor {
+	int enabled;
+};
+
+/*
+ * struct mempool_link_descriptor - UART link descriptor
+ * @window: number of frames in flight (0 - wait the end of every frame)
+ * @baud: baud rate of UART line
+ * @flow: flow control of UART line (none, rtscts)
+ * @frame: payload size of frame in bytes
+ * @calibrate: choose window and frame size by probing the link
+ */
+struct mempool_link_descriptor {
+	int window;
+	int baud;
+	int flow;
+	int frame;
+	int calibrate;
+};
+
+/*
+ * struct mempool_session_descriptor - UART session descriptor
+ * @jobs: number of jobs over one session (0 - channel per operation)
+ */
+struct mempool_session_descriptor {
+	int jobs;
+};
+
 /*
  * struct mempool_algorithm_descriptor - algorithm descriptor
  * @id: algorithm ID
@@ -138,12 +264,26 @@ struct mempool_algorithm_descriptor {
  * @output_file: output file
  * @uart_channel: UART channel
  * @threads: threads descriptor
+ * @workers: workers descriptor
  * @item: item descriptor
  * @record: record descriptor
  * @portion: portion descriptor
  * @key: key descriptor
  * @value: value descriptor
  * @condition: condition descriptor
+ * @limit: limit descriptor
+ * @distinct: DISTINCT descriptor
+ * @numa: NUMA descriptor
+ * @map: mapping descriptor
+ * @huge_pages: huge pages descriptor
+ * @stream: streaming descriptor
+ * @format: format of files descriptor
+ * @encoding: encoding of portions descriptor
+ * @layout: layout of portions descriptor
+ * @checksum: checksum of output descriptor
+ * @link: UART link descriptor
+ * @session: UART session descriptor
+ * @algorithm: algorithm descriptor
  * @show_debug: show debug messages
  */
 struct mempool_test_environment {
@@ -151,12 +291,25 @@ struct mempool_test_environment {
 	struct mempool_file_descriptor output_file;
 	struct mempool_file_descriptor uart_channel;
 	struct mempool_threads_descriptor threads;
+	struct mempool_workers_descriptor workers;
 	struct mempool_item_descriptor item;
 	struct mempool_record_descriptor record;
 	struct mempool_portion_descriptor portion;
 	struct mempool_key_descriptor key;
 	struct mempool_value_descriptor value;
 	struct mempool_condition_descriptor condition;
+	struct mempool_limit_descriptor limit;
+	struct mempool_distinct_descriptor distinct;
+	struct mempool_numa_descriptor numa;
+	struct mempool_map_descriptor map;
+	struct mempool_huge_pages_descriptor huge_pages;
+	struct mempool_stream_descriptor stream;
+	struct mempool_format_descriptor format;
+	struct mempool_encoding_descriptor encoding;
+	struct mempool_layout_descriptor layout;
+	struct mempool_checksum_descriptor checksum;
+	struct mempool_link_descriptor link;
+	struct mempool_session_descriptor session;
 	struct mempool_algorithm_descriptor algorithm;
 
 	int show_debug;
@@ -194,8 +347,153 @@ int convert_string2algorithm(const char *str)
 		return MEMPOOL_SELECT_ALGORITHM;
 	else if (strcmp(str, MEMPOOL_TOTAL_ALGORITHM_STR) == 0)
 		return MEMPOOL_TOTAL_ALGORITHM;
+	else if (strcmp(str, MEMPOOL_TOPK_ALGORITHM_STR) == 0)
+		return MEMPOOL_TOPK_ALGORITHM;
+	else if (strcmp(str, MEMPOOL_DISTINCT_ALGORITHM_STR) == 0)
+		return MEMPOOL_DISTINCT_ALGORITHM;
+	else if (strcmp(str, MEMPOOL_CONVERT_ALGORITHM_STR) == 0)
+		return MEMPOOL_CONVERT_ALGORITHM;
 	else
 		return MEMPOOL_UNKNOWN_ALGORITHM;
 }
 
+static inline
+int convert_string2order(const char *str)
+{
+	if (strcmp(str, MEMPOOL_ASCENDING_ORDER_STR) == 0)
+		return MEMPOOL_ASCENDING_ORDER;
+	else if (strcmp(str, MEMPOOL_DESCENDING_ORDER_STR) == 0)
+		return MEMPOOL_DESCENDING_ORDER;
+	else
+		return MEMPOOL_UNKNOWN_ORDER;
+}
+
+static inline
+int convert_string2distinct_output(const char *str)
+{
+	if (strcmp(str, MEMPOOL_DISTINCT_KEY_OUTPUT_STR) == 0)
+		return MEMPOOL_DISTINCT_KEY_OUTPUT;
+	else if (strcmp(str, MEMPOOL_DISTINCT_FIRST_VALUE_OUTPUT_STR) == 0)
+		return MEMPOOL_DISTINCT_FIRST_VALUE_OUTPUT;
+	else if (strcmp(str, MEMPOOL_DISTINCT_COUNT_OUTPUT_STR) == 0)
+		return MEMPOOL_DISTINCT_COUNT_OUTPUT;
+	else
+		return MEMPOOL_UNKNOWN_DISTINCT_OUTPUT;
+}
+
+static inline
+int convert_string2numa_mode(const char *str)
+{
+	if (strcmp(str, MEMPOOL_NUMA_NONE_MODE_STR) == 0)
+		return MEMPOOL_NUMA_NONE_MODE;
+	else if (strcmp(str, MEMPOOL_NUMA_BIND_MODE_STR) == 0)
+		return MEMPOOL_NUMA_BIND_MODE;
+	else if (strcmp(str, MEMPOOL_NUMA_INTERLEAVE_MODE_STR) == 0)
+		return MEMPOOL_NUMA_INTERLEAVE_MODE;
+	else
+		return MEMPOOL_UNKNOWN_NUMA_MODE;
+}
+
+static inline
+int convert_string2map_mode(const char *str)
+{
+	if (strcmp(str, MEMPOOL_MAP_POPULATE_MODE_STR) == 0)
+		return MEMPOOL_MAP_POPULATE_MODE;
+	else if (strcmp(str, MEMPOOL_MAP_LAZY_MODE_STR) == 0)
+		return MEMPOOL_MAP_LAZY_MODE;
+	else if (strcmp(str, MEMPOOL_MAP_PREFAULT_MODE_STR) == 0)
+		return MEMPOOL_MAP_PREFAULT_MODE;
+	else
+		return MEMPOOL_UNKNOWN_MAP_MODE;
+}
+
+static inline
+const char *convert_map_mode2string(int mode)
+{
+	switch (mode) {
+	case MEMPOOL_MAP_POPULATE_MODE:
+		return MEMPOOL_MAP_POPULATE_MODE_STR;
+	case MEMPOOL_MAP_LAZY_MODE:
+		return MEMPOOL_MAP_LAZY_MODE_STR;
+	case MEMPOOL_MAP_PREFAULT_MODE:
+		return MEMPOOL_MAP_PREFAULT_MODE_STR;
+	default:
+		return "unknown";
+	}
+}
+
+static inline
+int convert_string2io_backend(const char *str)
+{
+	if (strcmp(str, MEMPOOL_PREAD_IO_BACKEND_STR) == 0)
+		return MEMPOOL_PREAD_IO_BACKEND;
+	else if (strcmp(str, MEMPOOL_URING_IO_BACKEND_STR) == 0)
+		return MEMPOOL_URING_IO_BACKEND;
+	else
+		return MEMPOOL_UNKNOWN_IO_BACKEND;
+}
+
+static inline
+int convert_string2format(const char *str)
+{
+	if (strcmp(str, MEMPOOL_RAW_FORMAT_STR) == 0)
+		return MEMPOOL_RAW_FORMAT;
+	else if (strcmp(str, MEMPOOL_CONTAINER_FORMAT_STR) == 0)
+		return MEMPOOL_CONTAINER_FORMAT;
+	else
+		return MEMPOOL_UNKNOWN_FORMAT;
+}
+
+static inline
+int convert_string2encoding(const char *str)
+{
+	if (strcmp(str, MEMPOOL_PLAIN_ENCODING_STR) == 0)
+		return MEMPOOL_PLAIN_ENCODING;
+	else if (strcmp(str, MEMPOOL_FOR_ENCODING_STR) == 0)
+		return MEMPOOL_FOR_ENCODING;
+	else if (strcmp(str, MEMPOOL_DELTA_ENCODING_STR) == 0)
+		return MEMPOOL_DELTA_ENCODING;
+	else if (strcmp(str, MEMPOOL_RLE_ENCODING_STR) == 0)
+		return MEMPOOL_RLE_ENCODING;
+	else if (strcmp(str, MEMPOOL_AUTO_ENCODING_STR) == 0)
+		return MEMPOOL_AUTO_ENCODING;
+	else
+		return MEMPOOL_UNKNOWN_ENCODING;
+}
+
+static inline
+int convert_string2layout(const char *str)
+{
+	if (strcmp(str, MEMPOOL_ROW_LAYOUT_STR) == 0)
+		return MEMPOOL_ROW_LAYOUT;
+	else if (strcmp(str, MEMPOOL_PAX_LAYOUT_STR) == 0)
+		return MEMPOOL_PAX_LAYOUT;
+	else
+		return MEMPOOL_UNKNOWN_LAYOUT;
+}
+
+static inline
+int convert_string2flow_control(const char *str)
+{
+	if (strcmp(str, MEMPOOL_NO_FLOW_CONTROL_STR) == 0)
+		return MEMPOOL_NO_FLOW_CONTROL;
+	else if (strcmp(str, MEMPOOL_RTSCTS_FLOW_CONTROL_STR) == 0)
+		return MEMPOOL_RTSCTS_FLOW_CONTROL;
+	else
+		return MEMPOOL_UNKNOWN_FLOW_CONTROL;
+}
+
+static inline
+int convert_string2huge_pages_mode(const char *str)
+{
+	if (strcmp(str, MEMPOOL_HUGE_PAGES_NONE_MODE_STR) == 0)
+		return MEMPOOL_HUGE_PAGES_NONE_MODE;
+	else if (strcmp(str, MEMPOOL_HUGE_PAGES_TRANSPARENT_MODE_STR) == 0)
+		return MEMPOOL_HUGE_PAGES_TRANSPARENT_MODE;
+	else if (strcmp(str, MEMPOOL_HUGE_PAGES_EXPLICIT_MODE_STR) == 0)
+		return MEMPOOL_HUGE_PAGES_EXPLICIT_MODE;
+	else
+		return MEMPOOL_UNKNOWN_HUGE_PAGES_MODE;
+}
+
 #endif /* _MEMORY_POOL_TOOLS_H */
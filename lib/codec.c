@@ -0,0 +1,955 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * lib/codec.c - lightweight encodings of portions.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <sys/types.h>
+#include <endian.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <errno.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "memory_pool_tools.h"
+#include "memory_pool_codec.h"
+
+#define MEMPOOL_VARINT_MAX_BYTES		(10)
+
+/*
+ * struct mempool_codec_stats - statistics of column
+ * @min: minimal item
+ * @max: maximal item
+ * @sorted: items are non-decreasing
+ * @delta_bytes: size of DELTA encoding in bytes
+ * @rle_bytes: size of RLE encoding in bytes
+ */
+struct mempool_codec_stats {
+	unsigned long long min;
+	unsigned long long max;
+	int sorted;
+	size_t delta_bytes;
+	size_t rle_bytes;
+};
+
+static inline
+size_t mempool_codec_align(size_t bytes)
+{
+	return (bytes + MEMPOOL_CODEC_ALIGNMENT - 1) &
+			~((size_t)MEMPOOL_CODEC_ALIGNMENT - 1);
+}
+
+static inline
+unsigned long long mempool_codec_load(const uint8_t *ptr, int granularity)
+{
+	unsigned long long item = 0;
+
+	memcpy(&item, ptr, granularity);
+	return item;
+}
+
+static inline
+size_t mempool_varint_size(unsigned long long value)
+{
+	size_t bytes = 1;
+
+	while (value >= 0x80) {
+		value >>= 7;
+		bytes++;
+	}
+
+	return bytes;
+}
+
+static inline
+size_t mempool_varint_put(uint8_t *buf, unsigned long long value)
+{
+	size_t bytes = 0;
+
+	while (value >= 0x80) {
+		buf[bytes++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+
+	buf[bytes++] = (uint8_t)value;
+
+	return bytes;
+}
+
+static inline
+int mempool_varint_get(const uint8_t *buf, size_t bytes, size_t *offset,
+		       unsigned long long *value)
+{
+	unsigned long long result = 0;
+	int shift = 0;
+	int i;
+
+	for (i = 0; i < MEMPOOL_VARINT_MAX_BYTES; i++) {
+		uint8_t byte;
+
+		if (*offset >= bytes)
+			return -EBADMSG;
+
+		byte = buf[(*offset)++];
+		result |= (unsigned long long)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80)) {
+			*value = result;
+			return 0;
+		}
+
+		shift += 7;
+	}
+
+	return -EBADMSG;
+}
+
+static inline
+int mempool_codec_bits(unsigned long long range)
+{
+	int bits = 0;
+
+	while (range) {
+		range >>= 1;
+		bits++;
+	}
+
+	return bits;
+}
+
+static inline
+size_t mempool_codec_groups(unsigned int records)
+{
+	return ((size_t)records + MEMPOOL_CODEC_GROUP - 1) / MEMPOOL_CODEC_GROUP;
+}
+
+static inline
+size_t mempool_codec_for_bytes(unsigned int records, int bits)
+{
+	return mempool_codec_groups(records) *
+		MEMPOOL_CODEC_LANES * bits * sizeof(uint32_t);
+}
+
+static inline
+size_t mempool_codec_columns_offset(int record_capacity)
+{
+	return mempool_codec_align(sizeof(struct mempool_codec_header) +
+			(size_t)record_capacity *
+				sizeof(struct mempool_codec_column));
+}
+
+/*
+ * Maximal size of encoded portion: every column falls back
+ * to PLAIN encoding if other encodings are bigger.
+ */
+size_t mempool_codec_bound(int granularity, int record_capacity,
+			   unsigned int records)
+{
+	return mempool_codec_columns_offset(record_capacity) +
+		(size_t)record_capacity *
+			mempool_codec_align((size_t)records * granularity);
+}
+
+/*
+ * Unpack one group of FOR encoding. Word M of lane L keeps bits
+ * [M * 32, (M + 1) * 32) of the lane, so item of row R starts
+ * from the bit (R * bits) of its lane.
+ */
+static
+void mempool_codec_unpack_generic(const uint32_t *words, int bits,
+				  uint32_t *items)
+{
+	uint32_t mask = bits == 32 ? UINT32_MAX : (1U << bits) - 1;
+	int rows = MEMPOOL_CODEC_GROUP / MEMPOOL_CODEC_LANES;
+	int row, lane;
+
+	if (bits == 0) {
+		memset(items, 0, MEMPOOL_CODEC_GROUP * sizeof(uint32_t));
+		return;
+	}
+
+	for (row = 0; row < rows; row++) {
+		int bit = row * bits;
+		int word = bit / 32;
+		int shift = bit % 32;
+		const uint32_t *cur = &words[word * MEMPOOL_CODEC_LANES];
+		const uint32_t *next = cur + MEMPOOL_CODEC_LANES;
+
+		for (lane = 0; lane < MEMPOOL_CODEC_LANES; lane++) {
+			uint32_t item = cur[lane] >> shift;
+
+			if (shift + bits > 32)
+				item |= next[lane] << (32 - shift);
+
+			items[row * MEMPOOL_CODEC_LANES + lane] = item & mask;
+		}
+	}
+}
+
+#if defined(__x86_64__)
+/* SSE2 is a part of x86-64 */
+static
+void mempool_codec_unpack_sse2(const uint32_t *words, int bits,
+			       uint32_t *items)
+{
+	uint32_t mask = bits == 32 ? UINT32_MAX : (1U << bits) - 1;
+	int rows = MEMPOOL_CODEC_GROUP / MEMPOOL_CODEC_LANES;
+	__m128i vmask = _mm_set1_epi32((int)mask);
+	int row, half;
+
+	if (bits == 0) {
+		memset(items, 0, MEMPOOL_CODEC_GROUP * sizeof(uint32_t));
+		return;
+	}
+
+	for (row = 0; row < rows; row++) {
+		int bit = row * bits;
+		int word = bit / 32;
+		int shift = bit % 32;
+		__m128i right = _mm_cvtsi32_si128(shift);
+		__m128i left = _mm_cvtsi32_si128(32 - shift);
+
+		for (half = 0; half < MEMPOOL_CODEC_LANES; half += 4) {
+			const uint32_t *cur = &words[word * MEMPOOL_CODEC_LANES +
+						     half];
+			__m128i item;
+
+			item = _mm_srl_epi32(_mm_loadu_si128((const __m128i *)cur),
+					     right);
+
+			if (shift + bits > 32) {
+				__m128i next;
+
+				next = _mm_loadu_si128((const __m128i *)
+						(cur + MEMPOOL_CODEC_LANES));
+				item = _mm_or_si128(item,
+						    _mm_sll_epi32(next, left));
+			}
+
+			_mm_storeu_si128((__m128i *)&items[row *
+						MEMPOOL_CODEC_LANES + half],
+					 _mm_and_si128(item, vmask));
+		}
+	}
+}
+
+__attribute__((target("avx2")))
+static
+void mempool_codec_unpack_avx2(const uint32_t *words, int bits,
+			       uint32_t *items)
+{
+	uint32_t mask = bits == 32 ? UINT32_MAX : (1U << bits) - 1;
+	int rows = MEMPOOL_CODEC_GROUP / MEMPOOL_CODEC_LANES;
+	__m256i vmask = _mm256_set1_epi32((int)mask);
+	int row;
+
+	if (bits == 0) {
+		memset(items, 0, MEMPOOL_CODEC_GROUP * sizeof(uint32_t));
+		return;
+	}
+
+	for (row = 0; row < rows; row++) {
+		int bit = row * bits;
+		int word = bit / 32;
+		int shift = bit % 32;
+		const uint32_t *cur = &words[word * MEMPOOL_CODEC_LANES];
+		__m256i item;
+
+		item = _mm256_srl_epi32(_mm256_loadu_si256((const __m256i *)cur),
+					_mm_cvtsi32_si128(shift));
+
+		if (shift + bits > 32) {
+			__m256i next;
+
+			next = _mm256_loadu_si256((const __m256i *)
+						(cur + MEMPOOL_CODEC_LANES));
+			item = _mm256_or_si256(item,
+				_mm256_sll_epi32(next,
+						 _mm_cvtsi32_si128(32 - shift)));
+		}
+
+		_mm256_storeu_si256((__m256i *)&items[row * MEMPOOL_CODEC_LANES],
+				    _mm256_and_si256(item, vmask));
+	}
+}
+#endif /* __x86_64__ */
+
+/*
+ * Choose unpack method by features of CPU.
+ */
+static
+mempool_codec_unpack_fn mempool_codec_select_unpack(void)
+{
+#if defined(__x86_64__)
+	if (__builtin_cpu_supports("avx2"))
+		return mempool_codec_unpack_avx2;
+	else if (__builtin_cpu_supports("sse2"))
+		return mempool_codec_unpack_sse2;
+#endif
+
+	return mempool_codec_unpack_generic;
+}
+
+const char *mempool_codec_unpack_name(void)
+{
+	mempool_codec_unpack_fn unpack = mempool_codec_select_unpack();
+
+#if defined(__x86_64__)
+	if (unpack == mempool_codec_unpack_avx2)
+		return "avx2";
+	else if (unpack == mempool_codec_unpack_sse2)
+		return "sse2";
+#endif
+
+	return unpack == mempool_codec_unpack_generic ? "generic" : "unknown";
+}
+
+static
+void mempool_codec_pack_group(const unsigned long long *items, int count,
+			      unsigned long long base, int bits,
+			      uint32_t *words)
+{
+	int k;
+
+	for (k = 0; k < count; k++) {
+		uint32_t item = (uint32_t)(items[k] - base);
+		int lane = k % MEMPOOL_CODEC_LANES;
+		int bit = (k / MEMPOOL_CODEC_LANES) * bits;
+		int word = bit / 32;
+		int shift = bit % 32;
+
+		words[word * MEMPOOL_CODEC_LANES + lane] |= item << shift;
+
+		if (shift + bits > 32) {
+			words[(word + 1) * MEMPOOL_CODEC_LANES + lane] |=
+						item >> (32 - shift);
+		}
+	}
+}
+
+static
+void mempool_codec_column_stats(const uint8_t *portion, unsigned int records,
+				int granularity, int record_capacity,
+				int column, struct mempool_codec_stats *stats)
+{
+	size_t record_size = (size_t)granularity * record_capacity;
+	const uint8_t *ptr = portion + (size_t)column * granularity;
+	unsigned long long prev = 0;
+	unsigned long long run = 0;
+	unsigned long long item;
+	unsigned int i;
+
+	memset(stats, 0, sizeof(struct mempool_codec_stats));
+	stats->sorted = MEMPOOL_TRUE;
+
+	if (records == 0)
+		return;
+
+	stats->min = ULLONG_MAX;
+
+	for (i = 0; i < records; i++, ptr += record_size) {
+		item = mempool_codec_load(ptr, granularity);
+
+		/* DELTA starts from the minimum, i.e. the first item */
+		if (i == 0)
+			prev = item;
+
+		if (item < stats->min)
+			stats->min = item;
+		if (item > stats->max)
+			stats->max = item;
+		if (item < prev)
+			stats->sorted = MEMPOOL_FALSE;
+
+		if (stats->sorted)
+			stats->delta_bytes += mempool_varint_size(item - prev);
+
+		prev = item;
+	}
+
+	/* RLE keeps items relatively to the minimum */
+	ptr = portion + (size_t)column * granularity;
+	prev = mempool_codec_load(ptr, granularity);
+
+	for (i = 0; i < records; i++, ptr += record_size) {
+		item = mempool_codec_load(ptr, granularity);
+
+		if (item != prev) {
+			stats->rle_bytes += mempool_varint_size(run) +
+					mempool_varint_size(prev - stats->min);
+			run = 0;
+		}
+
+		prev = item;
+		run++;
+	}
+
+	stats->rle_bytes += mempool_varint_size(run) +
+				mempool_varint_size(prev - stats->min);
+}
+
+/*
+ * Requested encoding is used if it is applicable to the column.
+ * AUTO encoding chooses the smallest one. PLAIN encoding is
+ * the fallback for all cases.
+ */
+static
+void mempool_codec_choose(struct mempool_codec_stats *stats,
+			  unsigned int records, int granularity,
+			  int encoding, struct mempool_codec_column *column)
+{
+	size_t plain_bytes = (size_t)records * granularity;
+	unsigned long long range = stats->max - stats->min;
+	int bits = mempool_codec_bits(range);
+	size_t sizes[MEMPOOL_ENCODING_MAX];
+	int candidates[] = {
+		MEMPOOL_FOR_ENCODING,
+		MEMPOOL_DELTA_ENCODING,
+		MEMPOOL_RLE_ENCODING,
+	};
+	size_t i;
+
+	column->encoding = MEMPOOL_PLAIN_ENCODING;
+	column->bits = 0;
+	column->base = stats->min;
+	column->bytes = plain_bytes;
+
+	for (i = 0; i < MEMPOOL_ENCODING_MAX; i++)
+		sizes[i] = SIZE_MAX;
+
+	if (bits <= MEMPOOL_CODEC_MAX_BITS)
+		sizes[MEMPOOL_FOR_ENCODING] = mempool_codec_for_bytes(records,
+								      bits);
+	if (stats->sorted)
+		sizes[MEMPOOL_DELTA_ENCODING] = stats->delta_bytes;
+
+	sizes[MEMPOOL_RLE_ENCODING] = stats->rle_bytes;
+
+	for (i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+		int cur = candidates[i];
+
+		if (encoding != MEMPOOL_AUTO_ENCODING && encoding != cur)
+			continue;
+
+		if (sizes[cur] < column->bytes) {
+			column->encoding = cur;
+			column->bytes = sizes[cur];
+		}
+	}
+
+	if (column->encoding == MEMPOOL_FOR_ENCODING)
+		column->bits = bits;
+}
+
+static
+void mempool_codec_encode_column(const uint8_t *portion,
+				 unsigned int records,
+				 int granularity, int record_capacity,
+				 int index,
+				 struct mempool_codec_column *column,
+				 uint8_t *data)
+{
+	size_t record_size = (size_t)granularity * record_capacity;
+	const uint8_t *ptr = portion + (size_t)index * granularity;
+	unsigned long long items[MEMPOOL_CODEC_GROUP];
+	unsigned long long prev = column->base;
+	unsigned long long run = 0;
+	unsigned long long item;
+	size_t offset = 0;
+	unsigned int i;
+	int count = 0;
+
+	switch (column->encoding) {
+	case MEMPOOL_PLAIN_ENCODING:
+		for (i = 0; i < records; i++, ptr += record_size)
+			memcpy(data + (size_t)i * granularity, ptr, granularity);
+		break;
+
+	case MEMPOOL_FOR_ENCODING:
+		for (i = 0; i < records; i++, ptr += record_size) {
+			items[count++] = mempool_codec_load(ptr, granularity);
+
+			if (count == MEMPOOL_CODEC_GROUP || i == records - 1) {
+				mempool_codec_pack_group(items, count,
+							 column->base,
+							 column->bits,
+							 (uint32_t *)(data + offset));
+				offset += (size_t)MEMPOOL_CODEC_LANES *
+						column->bits * sizeof(uint32_t);
+				count = 0;
+			}
+		}
+		break;
+
+	case MEMPOOL_DELTA_ENCODING:
+		for (i = 0; i < records; i++, ptr += record_size) {
+			item = mempool_codec_load(ptr, granularity);
+			offset += mempool_varint_put(data + offset, item - prev);
+			prev = item;
+		}
+		break;
+
+	case MEMPOOL_RLE_ENCODING:
+		if (records == 0)
+			break;
+
+		prev = mempool_codec_load(ptr, granularity);
+
+		for (i = 0; i < records; i++, ptr += record_size) {
+			item = mempool_codec_load(ptr, granularity);
+
+			if (item != prev) {
+				offset += mempool_varint_put(data + offset, run);
+				offset += mempool_varint_put(data + offset,
+							     prev - column->base);
+				run = 0;
+			}
+
+			prev = item;
+			run++;
+		}
+
+		offset += mempool_varint_put(data + offset, run);
+		offset += mempool_varint_put(data + offset, prev - column->base);
+		break;
+	}
+}
+
+/*
+ * Encode @records records of @portion into new @block. Every column
+ * is encoded by @encoding if it makes the column smaller.
+ */
+int mempool_codec_encode(const void *portion, unsigned int records,
+			 int granularity, int record_capacity,
+			 int encoding, void **block, size_t *bytes)
+{
+	struct mempool_codec_column *columns;
+	struct mempool_codec_column *disk;
+	struct mempool_codec_header *header;
+	struct mempool_codec_stats stats;
+	uint8_t *buf;
+	size_t offset;
+	int i;
+
+	if (granularity <= 0 || granularity > MEMPOOL_CODEC_MAX_GRANULARITY ||
+	    record_capacity <= 0 || record_capacity > UINT16_MAX ||
+	    encoding <= MEMPOOL_UNKNOWN_ENCODING ||
+	    encoding >= MEMPOOL_ENCODING_MAX) {
+		MEMPOOL_ERR("unsupported encoding: "
+			    "granularity %d, record_capacity %d, "
+			    "encoding %d\n",
+			    granularity, record_capacity, encoding);
+		return -EOPNOTSUPP;
+	}
+
+	columns = calloc(record_capacity, sizeof(struct mempool_codec_column));
+	if (!columns) {
+		MEMPOOL_ERR("fail to allocate columns: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	offset = mempool_codec_columns_offset(record_capacity);
+
+	for (i = 0; i < record_capacity; i++) {
+		mempool_codec_column_stats(portion, records,
+					   granularity, record_capacity,
+					   i, &stats);
+		mempool_codec_choose(&stats, records, granularity,
+				     encoding, &columns[i]);
+
+		columns[i].offset = offset;
+		offset += mempool_codec_align(columns[i].bytes);
+	}
+
+	buf = calloc(1, offset);
+	if (!buf) {
+		MEMPOOL_ERR("fail to allocate encoded portion: "
+			    "bytes %zu, %s\n",
+			    offset, strerror(errno));
+		free(columns);
+		return -ENOMEM;
+	}
+
+	header = (struct mempool_codec_header *)buf;
+	header->magic = htole32(MEMPOOL_CODEC_MAGIC);
+	header->columns = htole16(record_capacity);
+	header->granularity = htole16(granularity);
+	header->records = htole32(records);
+
+	disk = (struct mempool_codec_column *)(header + 1);
+
+	for (i = 0; i < record_capacity; i++) {
+		mempool_codec_encode_column(portion, records,
+					    granularity, record_capacity,
+					    i, &columns[i],
+					    buf + columns[i].offset);
+
+		disk[i].encoding = htole32(columns[i].encoding);
+		disk[i].bits = htole32(columns[i].bits);
+		disk[i].base = htole64(columns[i].base);
+		disk[i].offset = htole64(columns[i].offset);
+		disk[i].bytes = htole64(columns[i].bytes);
+	}
+
+	free(columns);
+
+	*block = buf;
+	*bytes = offset;
+
+	return 0;
+}
+
+/*
+ * Check that encoded portion matches geometry and every column
+ * lies inside of @bytes. Varints are checked by reading.
+ */
+int mempool_codec_check(const void *block, size_t bytes,
+			int granularity, int record_capacity,
+			unsigned int records)
+{
+	const struct mempool_codec_header *header = block;
+	const struct mempool_codec_column *columns;
+	int i;
+
+	if (bytes < mempool_codec_columns_offset(record_capacity) ||
+	    le32toh(header->magic) != MEMPOOL_CODEC_MAGIC ||
+	    le16toh(header->columns) != record_capacity ||
+	    le16toh(header->granularity) != granularity ||
+	    le32toh(header->records) != records) {
+		MEMPOOL_ERR("invalid encoded portion: "
+			    "bytes %zu, columns %u, granularity %u, "
+			    "records %u\n",
+			    bytes, le16toh(header->columns),
+			    le16toh(header->granularity),
+			    le32toh(header->records));
+		return -EBADMSG;
+	}
+
+	columns = (const struct mempool_codec_column *)(header + 1);
+
+	for (i = 0; i < record_capacity; i++) {
+		unsigned long long offset = le64toh(columns[i].offset);
+		unsigned long long size = le64toh(columns[i].bytes);
+		unsigned int bits = le32toh(columns[i].bits);
+		int valid;
+
+		switch (le32toh(columns[i].encoding)) {
+		case MEMPOOL_PLAIN_ENCODING:
+			valid = size == (unsigned long long)records *
+								granularity;
+			break;
+
+		case MEMPOOL_FOR_ENCODING:
+			valid = bits <= MEMPOOL_CODEC_MAX_BITS &&
+				size == mempool_codec_for_bytes(records, bits);
+			break;
+
+		case MEMPOOL_DELTA_ENCODING:
+		case MEMPOOL_RLE_ENCODING:
+			valid = MEMPOOL_TRUE;
+			break;
+
+		default:
+			valid = MEMPOOL_FALSE;
+			break;
+		}
+
+		if (!valid || offset % MEMPOOL_CODEC_ALIGNMENT ||
+		    offset > bytes || size > bytes - offset) {
+			MEMPOOL_ERR("invalid column: "
+				    "column %d, encoding %u, bits %u, "
+				    "offset %llu, bytes %llu\n",
+				    i, le32toh(columns[i].encoding), bits,
+				    offset, size);
+			return -EBADMSG;
+		}
+	}
+
+	return 0;
+}
+
+int mempool_codec_cursor_init(struct mempool_codec_cursor *cursor,
+			      const void *block, int column)
+{
+	const struct mempool_codec_header *header = block;
+	const struct mempool_codec_column *desc;
+
+	if (column < 0 || column >= le16toh(header->columns))
+		return -ERANGE;
+
+	desc = (const struct mempool_codec_column *)(header + 1) + column;
+
+	cursor->data = (const uint8_t *)block + le64toh(desc->offset);
+	cursor->bytes = le64toh(desc->bytes);
+	cursor->encoding = le32toh(desc->encoding);
+	cursor->bits = le32toh(desc->bits);
+	cursor->granularity = le16toh(header->granularity);
+	cursor->base = le64toh(desc->base);
+	cursor->records = le32toh(header->records);
+	cursor->position = 0;
+	cursor->offset = 0;
+	cursor->value = cursor->base;
+	cursor->run = 0;
+	cursor->group = -1;
+	cursor->unpack = mempool_codec_select_unpack();
+
+	return 0;
+}
+
+static
+int mempool_codec_read_delta(struct mempool_codec_cursor *cursor,
+			     unsigned long long *items, unsigned int count)
+{
+	unsigned long long delta;
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < count; i++) {
+		err = mempool_varint_get(cursor->data, cursor->bytes,
+					 &cursor->offset, &delta);
+		if (err)
+			return err;
+
+		cursor->value += delta;
+		items[i] = cursor->value;
+	}
+
+	return 0;
+}
+
+static
+int mempool_codec_read_rle(struct mempool_codec_cursor *cursor,
+			   unsigned long long *items, unsigned int count)
+{
+	unsigned long long item;
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < count; i++) {
+		if (cursor->run == 0) {
+			err = mempool_varint_get(cursor->data, cursor->bytes,
+						 &cursor->offset,
+						 &cursor->run);
+			if (!err) {
+				err = mempool_varint_get(cursor->data,
+							 cursor->bytes,
+							 &cursor->offset,
+							 &item);
+			}
+
+			if (err || cursor->run == 0)
+				return -EBADMSG;
+
+			cursor->value = cursor->base + item;
+		}
+
+		items[i] = cursor->value;
+		cursor->run--;
+	}
+
+	return 0;
+}
+
+static
+void mempool_codec_read_for(struct mempool_codec_cursor *cursor,
+			    unsigned long long *items, unsigned int count)
+{
+	size_t group_words = (size_t)MEMPOOL_CODEC_LANES * cursor->bits;
+	unsigned int position = cursor->position;
+	unsigned int i = 0;
+
+	while (i < count) {
+		long long group = position / MEMPOOL_CODEC_GROUP;
+		unsigned int index = position % MEMPOOL_CODEC_GROUP;
+		unsigned int n = MEMPOOL_CODEC_GROUP - index;
+		unsigned int j;
+
+		if (n > count - i)
+			n = count - i;
+
+		if (group != cursor->group) {
+			cursor->unpack((const uint32_t *)cursor->data +
+						group * group_words,
+				       cursor->bits, cursor->items);
+			cursor->group = group;
+		}
+
+		for (j = 0; j < n; j++)
+			items[i + j] = cursor->base + cursor->items[index + j];
+
+		i += n;
+		position += n;
+	}
+}
+
+/*
+ * Read @count items of column starting from the current position.
+ */
+int mempool_codec_cursor_read(struct mempool_codec_cursor *cursor,
+			      unsigned long long *items, unsigned int count)
+{
+	unsigned int i;
+	int err = 0;
+
+	if (count > cursor->records - cursor->position)
+		return -ERANGE;
+
+	switch (cursor->encoding) {
+	case MEMPOOL_PLAIN_ENCODING:
+		for (i = 0; i < count; i++) {
+			items[i] = mempool_codec_load(cursor->data +
+					(size_t)(cursor->position + i) *
+						cursor->granularity,
+					cursor->granularity);
+		}
+		break;
+
+	case MEMPOOL_FOR_ENCODING:
+		mempool_codec_read_for(cursor, items, count);
+		break;
+
+	case MEMPOOL_DELTA_ENCODING:
+		err = mempool_codec_read_delta(cursor, items, count);
+		break;
+
+	case MEMPOOL_RLE_ENCODING:
+		err = mempool_codec_read_rle(cursor, items, count);
+		break;
+
+	default:
+		err = -EBADMSG;
+		break;
+	}
+
+	if (err)
+		return err;
+
+	cursor->position += count;
+
+	return 0;
+}
+
+/*
+ * PLAIN and FOR encodings are accessed randomly. DELTA and RLE
+ * encodings are read from the beginning of column.
+ */
+int mempool_codec_cursor_seek(struct mempool_codec_cursor *cursor,
+			      unsigned int position)
+{
+	unsigned long long items[MEMPOOL_CODEC_GROUP];
+	int err;
+
+	if (position > cursor->records)
+		return -ERANGE;
+
+	if (cursor->encoding == MEMPOOL_PLAIN_ENCODING ||
+	    cursor->encoding == MEMPOOL_FOR_ENCODING) {
+		cursor->position = position;
+		return 0;
+	}
+
+	if (position < cursor->position) {
+		cursor->position = 0;
+		cursor->offset = 0;
+		cursor->value = cursor->base;
+		cursor->run = 0;
+	}
+
+	while (cursor->position < position) {
+		unsigned int count = position - cursor->position;
+
+		if (count > MEMPOOL_CODEC_GROUP)
+			count = MEMPOOL_CODEC_GROUP;
+
+		err = mempool_codec_cursor_read(cursor, items, count);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/*
+ * Decode encoded portion into records. The rest of @portion
+ * is cleaned.
+ */
+int mempool_codec_decode(const void *block, void *portion,
+			 size_t portion_size)
+{
+	const struct mempool_codec_header *header = block;
+	struct mempool_codec_cursor *cursor;
+	unsigned long long items[MEMPOOL_CODEC_GROUP];
+	uint8_t *output = portion;
+	size_t record_size;
+	unsigned int records;
+	unsigned int position;
+	int granularity;
+	int columns;
+	int i;
+	unsigned int j;
+	int err = 0;
+
+	columns = le16toh(header->columns);
+	granularity = le16toh(header->granularity);
+	records = le32toh(header->records);
+	record_size = (size_t)columns * granularity;
+
+	if (record_size * records > portion_size)
+		return -E2BIG;
+
+	cursor = malloc(sizeof(struct mempool_codec_cursor));
+	if (!cursor)
+		return -ENOMEM;
+
+	for (i = 0; i < columns; i++) {
+		err = mempool_codec_cursor_init(cursor, block, i);
+		if (err)
+			goto finish_decode;
+
+		for (position = 0; position < records;
+					position += MEMPOOL_CODEC_GROUP) {
+			unsigned int count = records - position;
+
+			if (count > MEMPOOL_CODEC_GROUP)
+				count = MEMPOOL_CODEC_GROUP;
+
+			err = mempool_codec_cursor_read(cursor, items, count);
+			if (err)
+				goto finish_decode;
+
+			for (j = 0; j < count; j++) {
+				memcpy(output +
+					(size_t)(position + j) * record_size +
+					(size_t)i * granularity,
+					&items[j], granularity);
+			}
+		}
+	}
+
+	memset(output + record_size * records, 0,
+		portion_size - record_size * records);
+
+finish_decode:
+	free(cursor);
+
+	return err;
+}
@@ -0,0 +1,531 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * lib/container.c - container format of datasets.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <endian.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+
+#include "memory_pool_tools.h"
+#include "memory_pool_container.h"
+#include "memory_pool_codec.h"
+#include "crc32c.h"
+
+uint32_t mempool_container_crc(const void *buf, size_t bytes)
+{
+	return crc32c(~0L, buf, bytes);
+}
+
+static inline
+size_t mempool_container_directory_size(int portions_count)
+{
+	return (size_t)portions_count * sizeof(struct mempool_container_entry);
+}
+
+/*
+ * Create empty directory of @portions_count portions. Payloads are
+ * placed one after another with @stride distance.
+ */
+int mempool_container_create(struct mempool_container *container,
+			     int portions_count, size_t stride)
+{
+	unsigned long long offset;
+	int i;
+
+	memset(container, 0, sizeof(struct mempool_container));
+
+	if (portions_count <= 0 || stride == 0 ||
+	    stride % MEMPOOL_CONTAINER_ALIGNMENT) {
+		MEMPOOL_ERR("invalid container: "
+			    "portions %d, stride %zu\n",
+			    portions_count, stride);
+		return -EINVAL;
+	}
+
+	container->portions = calloc(portions_count,
+				     sizeof(struct mempool_container_portion));
+	if (!container->portions) {
+		MEMPOOL_ERR("fail to allocate directory: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	offset = sizeof(struct mempool_container_header) +
+			mempool_container_directory_size(portions_count);
+
+	container->portions_count = portions_count;
+	container->key_type = MEMPOOL_UNSIGNED_KEY_TYPE;
+	container->sort_order = MEMPOOL_UNKNOWN_ORDER;
+	container->encoding = MEMPOOL_PLAIN_ENCODING;
+	container->layout = MEMPOOL_ROW_LAYOUT;
+	container->payload_offset = mempool_container_align(offset);
+	container->stride = stride;
+
+	for (i = 0; i < portions_count; i++) {
+		container->portions[i].offset = container->payload_offset +
+						(unsigned long long)i * stride;
+	}
+
+	return 0;
+}
+
+void mempool_container_destroy(struct mempool_container *container)
+{
+	if (container->portions)
+		free(container->portions);
+
+	container->portions = NULL;
+	container->portions_count = 0;
+}
+
+static
+int mempool_container_read_header(int fd,
+				  struct mempool_container_header *header)
+{
+	ssize_t bytes;
+	uint32_t crc;
+
+	bytes = pread(fd, header, sizeof(*header), 0);
+	if (bytes < 0)
+		return -errno;
+
+	/* raw file without container */
+	if (bytes != sizeof(*header) ||
+	    le32toh(header->magic) != MEMPOOL_CONTAINER_MAGIC)
+		return -ENOMSG;
+
+	if (le16toh(header->version) != MEMPOOL_CONTAINER_VERSION ||
+	    le16toh(header->header_size) != sizeof(*header)) {
+		MEMPOOL_ERR("unsupported container: "
+			    "version %u, header_size %u\n",
+			    le16toh(header->version),
+			    le16toh(header->header_size));
+		return -EPROTO;
+	}
+
+	crc = mempool_container_crc(header,
+			offsetof(struct mempool_container_header, header_crc));
+	if (crc != le32toh(header->header_crc)) {
+		MEMPOOL_ERR("corrupted header: crc %#x, expected %#x\n",
+			    crc, le32toh(header->header_crc));
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+/*
+ * Payloads of portions are placed regularly if directory
+ * has been created by mempool_container_create().
+ */
+static
+unsigned long long
+mempool_container_detect_stride(struct mempool_container *container)
+{
+	struct mempool_container_portion *portions = container->portions;
+	unsigned long long stride;
+	long long record_size;
+	int i;
+
+	/* encoded portions are packed one after another */
+	if (container->encoding != MEMPOOL_PLAIN_ENCODING)
+		return 0;
+
+	if (portions[0].offset != container->payload_offset)
+		return 0;
+
+	if (container->portions_count == 1) {
+		record_size = (long long)container->granularity *
+					container->record_capacity;
+		return mempool_container_align(record_size *
+						container->portion_capacity);
+	}
+
+	if (portions[1].offset <= portions[0].offset)
+		return 0;
+
+	stride = portions[1].offset - portions[0].offset;
+
+	for (i = 1; i < container->portions_count; i++) {
+		if (portions[i].offset != portions[0].offset +
+					(unsigned long long)i * stride)
+			return 0;
+	}
+
+	return stride;
+}
+
+/*
+ * Read header and directory of container. It returns -ENOMSG
+ * if the file is not a container.
+ */
+int mempool_container_read(int fd, struct mempool_container *container)
+{
+	struct mempool_container_header header;
+	struct mempool_container_entry *entries = NULL;
+	struct mempool_container_portion *portion;
+	struct stat st;
+	long long portion_size;
+	size_t directory_size;
+	ssize_t bytes;
+	uint32_t crc;
+	int i;
+	int err;
+
+	memset(container, 0, sizeof(struct mempool_container));
+
+	err = mempool_container_read_header(fd, &header);
+	if (err)
+		return err;
+
+	if (fstat(fd, &st)) {
+		err = -errno;
+		MEMPOOL_ERR("fail to get file size: %s\n",
+			    strerror(errno));
+		return err;
+	}
+
+	container->granularity = le32toh(header.granularity);
+	container->record_capacity = le32toh(header.record_capacity);
+	container->portion_capacity = le32toh(header.portion_capacity);
+	container->portions_count = le32toh(header.portions_count);
+	container->key_mask = le64toh(header.key_mask);
+	container->value_mask = le64toh(header.value_mask);
+	container->key_type = le32toh(header.key_type);
+	container->sort_order = le32toh(header.sort_order);
+	container->algorithm = le32toh(header.algorithm);
+	container->encoding = le32toh(header.encoding);
+	container->layout = le32toh(header.layout);
+	container->payload_offset = le64toh(header.payload_offset);
+
+	portion_size = (long long)container->granularity *
+				container->record_capacity;
+	portion_size *= container->portion_capacity;
+
+	if (container->portions_count <= 0 || portion_size <= 0 ||
+	    portion_size > INT_MAX ||
+	    container->key_type != MEMPOOL_UNSIGNED_KEY_TYPE ||
+	    container->sort_order >= MEMPOOL_ORDER_MAX ||
+	    container->encoding <= MEMPOOL_UNKNOWN_ENCODING ||
+	    container->encoding >= MEMPOOL_ENCODING_MAX ||
+	    container->layout <= MEMPOOL_UNKNOWN_LAYOUT ||
+	    container->layout >= MEMPOOL_LAYOUT_MAX ||
+	    (container->encoding != MEMPOOL_PLAIN_ENCODING &&
+	     container->layout != MEMPOOL_ROW_LAYOUT)) {
+		MEMPOOL_ERR("invalid container geometry: "
+			    "granularity %d, record_capacity %d, "
+			    "portion_capacity %d, portions %d, "
+			    "key_type %d, sort_order %d, encoding %d, "
+			    "layout %d\n",
+			    container->granularity,
+			    container->record_capacity,
+			    container->portion_capacity,
+			    container->portions_count,
+			    container->key_type,
+			    container->sort_order,
+			    container->encoding,
+			    container->layout);
+		return -EINVAL;
+	}
+
+	directory_size =
+		mempool_container_directory_size(container->portions_count);
+
+	entries = malloc(directory_size);
+	container->portions = calloc(container->portions_count,
+				     sizeof(struct mempool_container_portion));
+	if (!entries || !container->portions) {
+		err = -ENOMEM;
+		MEMPOOL_ERR("fail to allocate directory: %s\n",
+			    strerror(errno));
+		goto finish_read;
+	}
+
+	bytes = pread(fd, entries, directory_size,
+		      le64toh(header.directory_offset));
+	if (bytes != (ssize_t)directory_size) {
+		err = bytes < 0 ? -errno : -ENODATA;
+		MEMPOOL_ERR("fail to read directory: "
+			    "offset %llu, size %zu, err %d\n",
+			    (unsigned long long)le64toh(header.directory_offset),
+			    directory_size, err);
+		goto finish_read;
+	}
+
+	crc = mempool_container_crc(entries, directory_size);
+	if (crc != le32toh(header.directory_crc)) {
+		err = -EBADMSG;
+		MEMPOOL_ERR("corrupted directory: crc %#x, expected %#x\n",
+			    crc, le32toh(header.directory_crc));
+		goto finish_read;
+	}
+
+	for (i = 0; i < container->portions_count; i++) {
+		unsigned long long max_bytes = portion_size;
+		unsigned long long payload_size = portion_size;
+
+		portion = &container->portions[i];
+
+		portion->offset = le64toh(entries[i].offset);
+		portion->bytes = le64toh(entries[i].bytes);
+		portion->records = le32toh(entries[i].records);
+		portion->crc = le32toh(entries[i].crc);
+
+		/* encoded payload contains the valid bytes only */
+		if (container->encoding != MEMPOOL_PLAIN_ENCODING) {
+			max_bytes = mempool_codec_bound(container->granularity,
+						container->record_capacity,
+						portion->records);
+			payload_size = portion->bytes;
+		}
+
+		if (portion->offset < container->payload_offset ||
+		    portion->bytes > max_bytes ||
+		    portion->records > (unsigned int)container->portion_capacity ||
+		    portion->offset + payload_size > (unsigned long long)st.st_size) {
+			err = -ERANGE;
+			MEMPOOL_ERR("invalid portion: "
+				    "portion %d, offset %llu, bytes %llu, "
+				    "records %u, file_size %lld\n",
+				    i, portion->offset, portion->bytes,
+				    portion->records, (long long)st.st_size);
+			goto finish_read;
+		}
+	}
+
+	container->stride = mempool_container_detect_stride(container);
+
+finish_read:
+	if (entries)
+		free(entries);
+
+	if (err)
+		mempool_container_destroy(container);
+
+	return err;
+}
+
+/*
+ * Write header and directory. Payloads have to be written already,
+ * because directory keeps checksums of payloads.
+ */
+int mempool_container_write(int fd, struct mempool_container *container)
+{
+	struct mempool_container_header header;
+	struct mempool_container_entry *entries;
+	struct mempool_container_portion *portion;
+	size_t directory_size;
+	ssize_t bytes;
+	int i;
+	int err = 0;
+
+	directory_size =
+		mempool_container_directory_size(container->portions_count);
+
+	entries = calloc(1, directory_size);
+	if (!entries) {
+		MEMPOOL_ERR("fail to allocate directory: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < container->portions_count; i++) {
+		portion = &container->portions[i];
+
+		entries[i].offset = htole64(portion->offset);
+		entries[i].bytes = htole64(portion->bytes);
+		entries[i].records = htole32(portion->records);
+		entries[i].crc = htole32(portion->crc);
+	}
+
+	memset(&header, 0, sizeof(header));
+	header.magic = htole32(MEMPOOL_CONTAINER_MAGIC);
+	header.version = htole16(MEMPOOL_CONTAINER_VERSION);
+	header.header_size = htole16(sizeof(header));
+	header.granularity = htole32(container->granularity);
+	header.record_capacity = htole32(container->record_capacity);
+	header.portion_capacity = htole32(container->portion_capacity);
+	header.portions_count = htole32(container->portions_count);
+	header.key_mask = htole64(container->key_mask);
+	header.value_mask = htole64(container->value_mask);
+	header.key_type = htole32(container->key_type);
+	header.sort_order = htole32(container->sort_order);
+	header.algorithm = htole32(container->algorithm);
+	header.alignment = htole32(MEMPOOL_CONTAINER_ALIGNMENT);
+	header.encoding = htole32(container->encoding);
+	header.layout = htole32(container->layout);
+	header.directory_offset = htole64(sizeof(header));
+	header.payload_offset = htole64(container->payload_offset);
+	header.directory_crc = htole32(mempool_container_crc(entries,
+							     directory_size));
+	header.header_crc = htole32(mempool_container_crc(&header,
+			offsetof(struct mempool_container_header, header_crc)));
+
+	bytes = pwrite(fd, &header, sizeof(header), 0);
+	if (bytes == sizeof(header)) {
+		bytes = pwrite(fd, entries, directory_size, sizeof(header));
+		if (bytes == (ssize_t)directory_size)
+			goto finish_write;
+	}
+
+	err = bytes < 0 ? -errno : -EIO;
+	MEMPOOL_ERR("fail to write container header: err %d\n", err);
+
+finish_write:
+	free(entries);
+
+	return err;
+}
+
+/*
+ * Check payload of portion by checksum of directory.
+ */
+int mempool_container_check_portion(struct mempool_container *container,
+				    int index, const void *payload)
+{
+	struct mempool_container_portion *portion;
+	uint32_t crc;
+
+	portion = &container->portions[index];
+	crc = mempool_container_crc(payload, portion->bytes);
+
+	if (crc != portion->crc) {
+		MEMPOOL_ERR("corrupted portion: "
+			    "portion %d, crc %#x, expected %#x\n",
+			    index, crc, portion->crc);
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+/*
+ * Geometry of container replaces defaults of options. Options that
+ * have been defined explicitly have to match the container.
+ */
+int mempool_container_load_geometry(struct mempool_container *container,
+				    struct mempool_test_environment *env)
+{
+	long long portion_size;
+	unsigned int max_records = 0;
+	int i;
+
+	portion_size = (long long)container->granularity *
+				container->record_capacity;
+	portion_size *= container->portion_capacity;
+
+	if ((env->item.granularity != 1 &&
+	     env->item.granularity != container->granularity) ||
+	    (env->record.capacity != 1 &&
+	     env->record.capacity != container->record_capacity) ||
+	    (env->portion.capacity != 0 &&
+	     env->portion.capacity != container->portion_capacity) ||
+	    (env->threads.count != 0 &&
+	     env->threads.count != container->portions_count) ||
+	    (env->threads.portion_size != 0 &&
+	     env->threads.portion_size != portion_size)) {
+		MEMPOOL_ERR("options conflict with container: "
+			    "granularity %d, record_capacity %d, "
+			    "portion_capacity %d, portions %d, "
+			    "portion_size %lld\n",
+			    container->granularity,
+			    container->record_capacity,
+			    container->portion_capacity,
+			    container->portions_count,
+			    portion_size);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < container->portions_count; i++) {
+		if (container->portions[i].records > max_records)
+			max_records = container->portions[i].records;
+	}
+
+	if (env->portion.count != 0 &&
+	    env->portion.count != (int)max_records) {
+		MEMPOOL_WARN("count of records is defined by container: "
+			     "count %d is ignored\n",
+			     env->portion.count);
+	}
+
+	env->item.granularity = container->granularity;
+	env->record.capacity = container->record_capacity;
+	env->portion.capacity = container->portion_capacity;
+	env->portion.count = (int)max_records;
+	env->threads.count = container->portions_count;
+	env->threads.portion_size = portion_size;
+	env->encoding.input = container->encoding;
+	env->layout.input = container->layout;
+
+	/* explicit masks can redefine key and value */
+	if (env->key.mask == 0)
+		env->key.mask = container->key_mask;
+	if (env->value.mask == 0)
+		env->value.mask = container->value_mask;
+
+	return 0;
+}
+
+/*
+ * Convert portion of @records records from PAX layout into rows.
+ */
+void mempool_pax_to_rows(const void *pax, void *rows, unsigned int records,
+			 int granularity, int record_capacity)
+{
+	const unsigned char *input = pax;
+	unsigned char *output = rows;
+	size_t record_size = (size_t)granularity * record_capacity;
+	unsigned int i;
+	int j;
+
+	for (j = 0; j < record_capacity; j++) {
+		for (i = 0; i < records; i++) {
+			memcpy(output + i * record_size + (size_t)j * granularity,
+				input, granularity);
+			input += granularity;
+		}
+	}
+}
+
+/*
+ * Convert portion of @records records from rows into PAX layout.
+ */
+void mempool_rows_to_pax(const void *rows, void *pax, unsigned int records,
+			 int granularity, int record_capacity)
+{
+	const unsigned char *input = rows;
+	unsigned char *output = pax;
+	size_t record_size = (size_t)granularity * record_capacity;
+	unsigned int i;
+	int j;
+
+	for (j = 0; j < record_capacity; j++) {
+		for (i = 0; i < records; i++) {
+			memcpy(output,
+				input + i * record_size + (size_t)j * granularity,
+				granularity);
+			output += granularity;
+		}
+	}
+}
@@ -1,8 +1,11 @@
 /*
- * This code is from freebsd/sys/libkern/crc32.c
+ * Table of crc32c is from freebsd/sys/libkern/crc32.c
  *
- * Simplest table-based crc32c.  Performance is not important
- * for checking crcs on superblocks
+ * crc32c() chooses the implementation by features of CPU:
+ * (1) folding of 64 bytes blocks by PCLMULQDQ for large buffers;
+ * (2) three interleaved streams of SSE4.2 crc32 instruction;
+ * (3) slicing-by-8 tables.
+ * All implementations return the same result.
  */
 
 /*-
@@ -10,8 +13,27 @@
  *  code or tables extracted from it, as desired without restriction.
  */
 
+#define _DEFAULT_SOURCE
+
+#include <endian.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 #include "crc32c.h"
 
+/* reflected polynomial of crc32c */
+#define CRC32C_POLY		(0x82F63B78)
+
+/* length of interleaved streams of SSE4.2 implementation */
+#define CRC32C_LONG		(8192)
+#define CRC32C_SHORT		(256)
+
+/* PCLMULQDQ folding is used for buffers of this size and larger */
+#define CRC32C_FOLD_MIN		(1024)
+
 static const uint32_t crc32Table[256] = {
 	0x00000000L, 0xF26B8303L, 0xE13B70F7L, 0x1350F3F4L,
 	0xC79A971FL, 0x35F1141CL, 0x26A1E7E8L, 0xD4CA64EBL,
@@ -79,6 +101,389 @@ static const uint32_t crc32Table[256] = {
 	0xBE2DA0A5L, 0x4C4623A6L, 0x5F16D052L, 0xAD7D5351L
 };
 
+typedef uint32_t (*crc32c_fn)(uint32_t crc, const void *buf, size_t size);
+
+/* tables of slicing-by-8 (the first table is crc32Table) */
+static uint32_t crc32c_slices[8][256];
+
+/* operators that append CRC32C_LONG and CRC32C_SHORT zero bytes */
+static uint32_t crc32c_long_shift[4][256];
+static uint32_t crc32c_short_shift[4][256];
+
+static crc32c_fn crc32c_impl;
+
+/*
+ * Multiply polynomials modulo crc32c polynomial. Bit 31 of reflected
+ * value is the coefficient of x^0.
+ */
+static
+uint32_t crc32c_multiply(uint32_t a, uint32_t b)
+{
+	uint32_t product = 0;
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		if (a & 0x80000000)
+			product ^= b;
+		a <<= 1;
+		b = (b >> 1) ^ (b & 1 ? CRC32C_POLY : 0);
+	}
+
+	return product;
+}
+
+/*
+ * Calculate x^n modulo crc32c polynomial.
+ */
+static
+uint32_t crc32c_x_power(size_t n)
+{
+	uint32_t value = 0x80000000;	/* x^0 */
+	uint32_t square = 0x40000000;	/* x^1 */
+
+	while (n) {
+		if (n & 1)
+			value = crc32c_multiply(value, square);
+		square = crc32c_multiply(square, square);
+		n >>= 1;
+	}
+
+	return value;
+}
+
+static
+void crc32c_init_shift(uint32_t shift[4][256], size_t bytes)
+{
+	uint32_t op = crc32c_x_power(bytes * 8);
+	uint32_t i;
+	int j;
+
+	for (j = 0; j < 4; j++) {
+		for (i = 0; i < 256; i++)
+			shift[j][i] = crc32c_multiply(i << (j * 8), op);
+	}
+}
+
+static inline
+uint32_t crc32c_shift(uint32_t shift[4][256], uint32_t crc)
+{
+	return shift[0][crc & 0xff] ^ shift[1][(crc >> 8) & 0xff] ^
+		shift[2][(crc >> 16) & 0xff] ^ shift[3][crc >> 24];
+}
+
+static
+uint32_t crc32c_bytes(uint32_t crc, const uint8_t *p, size_t size)
+{
+	while (size--)
+		crc = crc32Table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+static
+uint32_t crc32c_slicing_by_8(uint32_t crc, const void *buf, size_t size)
+{
+	const uint8_t *p = buf;
+	uint32_t word1, word2;
+	size_t head;
+
+	head = (8 - ((uintptr_t)p & 7)) & 7;
+	if (head > size)
+		head = size;
+
+	crc = crc32c_bytes(crc, p, head);
+	p += head;
+	size -= head;
+
+	while (size >= 8) {
+		memcpy(&word1, p, sizeof(word1));
+		memcpy(&word2, p + 4, sizeof(word2));
+		word1 = le32toh(word1) ^ crc;
+		word2 = le32toh(word2);
+
+		crc = crc32c_slices[7][word1 & 0xff] ^
+			crc32c_slices[6][(word1 >> 8) & 0xff] ^
+			crc32c_slices[5][(word1 >> 16) & 0xff] ^
+			crc32c_slices[4][word1 >> 24] ^
+			crc32c_slices[3][word2 & 0xff] ^
+			crc32c_slices[2][(word2 >> 8) & 0xff] ^
+			crc32c_slices[1][(word2 >> 16) & 0xff] ^
+			crc32c_slices[0][word2 >> 24];
+
+		p += 8;
+		size -= 8;
+	}
+
+	return crc32c_bytes(crc, p, size);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2")))
+static
+uint32_t crc32c_sse42_serial(uint32_t crc, const uint8_t *p, size_t size)
+{
+	uint64_t crc64 = crc;
+	uint64_t word;
+
+	while (size >= 8) {
+		memcpy(&word, p, sizeof(word));
+		crc64 = _mm_crc32_u64(crc64, word);
+		p += 8;
+		size -= 8;
+	}
+
+	crc = (uint32_t)crc64;
+
+	while (size--)
+		crc = _mm_crc32_u8(crc, *p++);
+
+	return crc;
+}
+
+/*
+ * Latency of crc32 instruction is three cycles, so three independent
+ * streams keep the unit busy. CRCs of streams are combined by
+ * operators that append zero bytes.
+ */
+__attribute__((target("sse4.2")))
+static
+uint32_t crc32c_sse42_streams(uint32_t crc, const uint8_t **buf,
+			      size_t *size, size_t len,
+			      uint32_t shift[4][256])
+{
+	const uint8_t *p = *buf;
+	uint64_t crc0, crc1, crc2;
+	uint64_t word0, word1, word2;
+	const uint8_t *end;
+
+	while (*size >= len * 3) {
+		crc0 = crc;
+		crc1 = 0;
+		crc2 = 0;
+		end = p + len;
+
+		do {
+			memcpy(&word0, p, sizeof(word0));
+			memcpy(&word1, p + len, sizeof(word1));
+			memcpy(&word2, p + len * 2, sizeof(word2));
+			crc0 = _mm_crc32_u64(crc0, word0);
+			crc1 = _mm_crc32_u64(crc1, word1);
+			crc2 = _mm_crc32_u64(crc2, word2);
+			p += 8;
+		} while (p < end);
+
+		crc = crc32c_shift(shift, (uint32_t)crc0) ^ (uint32_t)crc1;
+		crc = crc32c_shift(shift, crc) ^ (uint32_t)crc2;
+
+		p += len * 2;
+		*size -= len * 3;
+	}
+
+	*buf = p;
+
+	return crc;
+}
+
+__attribute__((target("sse4.2")))
+static
+uint32_t crc32c_sse42(uint32_t crc, const void *buf, size_t size)
+{
+	const uint8_t *p = buf;
+	size_t head;
+
+	head = (8 - ((uintptr_t)p & 7)) & 7;
+	if (head > size)
+		head = size;
+
+	crc = crc32c_sse42_serial(crc, p, head);
+	p += head;
+	size -= head;
+
+	crc = crc32c_sse42_streams(crc, &p, &size, CRC32C_LONG,
+				   crc32c_long_shift);
+	crc = crc32c_sse42_streams(crc, &p, &size, CRC32C_SHORT,
+				   crc32c_short_shift);
+
+	return crc32c_sse42_serial(crc, p, size);
+}
+
+/*
+ * Three independent buffers are processed by interleaved crc32
+ * instructions on their common length.
+ */
+__attribute__((target("sse4.2")))
+static
+void crc32c_sse42_multi(uint32_t *crcs, const void * const *bufs,
+			const size_t *sizes, int count)
+{
+	const uint8_t *p0, *p1, *p2;
+	uint64_t crc0, crc1, crc2;
+	uint64_t word0, word1, word2;
+	size_t common;
+	size_t i;
+	int j;
+
+	for (j = 0; j + 3 <= count; j += 3) {
+		common = sizes[j];
+		if (common > sizes[j + 1])
+			common = sizes[j + 1];
+		if (common > sizes[j + 2])
+			common = sizes[j + 2];
+		common &= ~(size_t)7;
+
+		p0 = bufs[j];
+		p1 = bufs[j + 1];
+		p2 = bufs[j + 2];
+		crc0 = crcs[j];
+		crc1 = crcs[j + 1];
+		crc2 = crcs[j + 2];
+
+		for (i = 0; i < common; i += 8) {
+			memcpy(&word0, p0 + i, sizeof(word0));
+			memcpy(&word1, p1 + i, sizeof(word1));
+			memcpy(&word2, p2 + i, sizeof(word2));
+			crc0 = _mm_crc32_u64(crc0, word0);
+			crc1 = _mm_crc32_u64(crc1, word1);
+			crc2 = _mm_crc32_u64(crc2, word2);
+		}
+
+		crcs[j] = crc32c_impl((uint32_t)crc0, p0 + common,
+				      sizes[j] - common);
+		crcs[j + 1] = crc32c_impl((uint32_t)crc1, p1 + common,
+					  sizes[j + 1] - common);
+		crcs[j + 2] = crc32c_impl((uint32_t)crc2, p2 + common,
+					  sizes[j + 2] - common);
+	}
+
+	for (; j < count; j++)
+		crcs[j] = crc32c_impl(crcs[j], bufs[j], sizes[j]);
+}
+
+/* multipliers of 64-bit halves of 128-bit lane: x^(n + 63) and x^(n - 1) */
+static uint64_t crc32c_fold_512[2];
+static uint64_t crc32c_fold_128[2];
+
+static
+void crc32c_init_fold(uint64_t fold[2], size_t bits)
+{
+	fold[0] = (uint64_t)crc32c_x_power(bits + 63) << 32;
+	fold[1] = (uint64_t)crc32c_x_power(bits - 1) << 32;
+}
+
+/*
+ * Lane is replaced by the polynomial that is congruent to the lane
+ * moved forward by the distance of fold multipliers.
+ */
+__attribute__((target("sse4.2,pclmul")))
+static inline
+__m128i crc32c_fold(__m128i lane, __m128i fold)
+{
+	return _mm_xor_si128(_mm_clmulepi64_si128(lane, fold, 0x00),
+			     _mm_clmulepi64_si128(lane, fold, 0x11));
+}
+
+/*
+ * Four 128-bit lanes are folded over 64 bytes blocks, then lanes
+ * are folded into one lane that is reduced by crc32 instruction.
+ */
+__attribute__((target("sse4.2,pclmul")))
+static
+uint32_t crc32c_pclmul(uint32_t crc, const void *buf, size_t size)
+{
+	const __m128i *p = buf;
+	__m128i fold512, fold128;
+	__m128i x0, x1, x2, x3;
+	uint64_t crc64;
+
+	if (size < CRC32C_FOLD_MIN)
+		return crc32c_sse42(crc, buf, size);
+
+	fold512 = _mm_loadu_si128((const __m128i *)crc32c_fold_512);
+	fold128 = _mm_loadu_si128((const __m128i *)crc32c_fold_128);
+
+	x0 = _mm_xor_si128(_mm_loadu_si128(p), _mm_cvtsi32_si128(crc));
+	x1 = _mm_loadu_si128(p + 1);
+	x2 = _mm_loadu_si128(p + 2);
+	x3 = _mm_loadu_si128(p + 3);
+	p += 4;
+	size -= 64;
+
+	while (size >= 64) {
+		x0 = _mm_xor_si128(crc32c_fold(x0, fold512),
+				   _mm_loadu_si128(p));
+		x1 = _mm_xor_si128(crc32c_fold(x1, fold512),
+				   _mm_loadu_si128(p + 1));
+		x2 = _mm_xor_si128(crc32c_fold(x2, fold512),
+				   _mm_loadu_si128(p + 2));
+		x3 = _mm_xor_si128(crc32c_fold(x3, fold512),
+				   _mm_loadu_si128(p + 3));
+		p += 4;
+		size -= 64;
+	}
+
+	x1 = _mm_xor_si128(crc32c_fold(x0, fold128), x1);
+	x2 = _mm_xor_si128(crc32c_fold(x1, fold128), x2);
+	x3 = _mm_xor_si128(crc32c_fold(x2, fold128), x3);
+
+	crc64 = _mm_crc32_u64(0, (uint64_t)_mm_cvtsi128_si64(x3));
+	crc64 = _mm_crc32_u64(crc64,
+			      (uint64_t)_mm_extract_epi64(x3, 1));
+
+	return crc32c_sse42_serial((uint32_t)crc64, (const uint8_t *)p, size);
+}
+#endif /* __x86_64__ */
+
+/*
+ * Tables are prepared and implementation is chosen before main().
+ */
+__attribute__((constructor))
+static
+void crc32c_init(void)
+{
+	uint32_t crc;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		crc = crc32Table[i];
+		crc32c_slices[0][i] = crc;
+
+		for (j = 1; j < 8; j++) {
+			crc = crc32Table[crc & 0xff] ^ (crc >> 8);
+			crc32c_slices[j][i] = crc;
+		}
+	}
+
+	crc32c_impl = crc32c_slicing_by_8;
+
+#if defined(__x86_64__)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("sse4.2")) {
+		crc32c_init_shift(crc32c_long_shift, CRC32C_LONG);
+		crc32c_init_shift(crc32c_short_shift, CRC32C_SHORT);
+		crc32c_impl = crc32c_sse42;
+
+		if (__builtin_cpu_supports("pclmul")) {
+			crc32c_init_fold(crc32c_fold_512, 512);
+			crc32c_init_fold(crc32c_fold_128, 128);
+			crc32c_impl = crc32c_pclmul;
+		}
+	}
+#endif
+}
+
+const char *crc32c_name(void)
+{
+#if defined(__x86_64__)
+	if (crc32c_impl == crc32c_pclmul)
+		return "pclmul";
+	else if (crc32c_impl == crc32c_sse42)
+		return "sse4.2";
+#endif
+
+	return "slicing-by-8";
+}
+
 /*
  *This was singletable_crc32c() in bsd
  *
@@ -93,10 +498,41 @@ static const uint32_t crc32Table[256] = {
 uint32_t
 crc32c(uint32_t crc, const void *buf, size_t size)
 {
-	const uint8_t *p = buf;
+	return crc32c_impl(crc, buf, size);
+}
 
-	while (size--)
-		crc = crc32Table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+/*
+ * Continue @count independent CRCs: crcs[i] = crc32c(crcs[i], bufs[i],
+ * sizes[i]). Pages of the same size are checksummed by interleaved
+ * streams, so latency of crc32 instruction is hidden.
+ */
+void
+crc32c_multi(uint32_t *crcs, const void * const *bufs, const size_t *sizes,
+	     int count)
+{
+	int i;
 
-	return crc;
+#if defined(__x86_64__)
+	if (crc32c_impl != crc32c_slicing_by_8) {
+		crc32c_sse42_multi(crcs, bufs, sizes, count);
+		return;
+	}
+#endif
+
+	for (i = 0; i < count; i++)
+		crcs[i] = crc32c_impl(crcs[i], bufs[i], sizes[i]);
+}
+
+/*
+ * CRC of concatenation A|B by CRCs of A and B, where @len_b is
+ * the length of B in bytes. Both CRCs are final (with inverted
+ * initial and final values) or @crc_b starts from zero:
+ *
+ *    crc32c(crc, A|B, len_a + len_b) ==
+ *        crc32c_combine(crc32c(crc, A, len_a), crc32c(0, B, len_b), len_b)
+ */
+uint32_t
+crc32c_combine(uint32_t crc_a, uint32_t crc_b, size_t len_b)
+{
+	return crc32c_multiply(crc_a, crc32c_x_power(len_b * 8)) ^ crc_b;
 }
@@ -0,0 +1,175 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * lib/crc32c_file.c - parallel checksum of file.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <sys/types.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "memory_pool_tools.h"
+#include "crc32c.h"
+
+/* every thread reads its part by chunks of this size */
+#define CRC32C_FILE_CHUNK		(1024 * 1024)
+
+/*
+ * struct crc32c_file_part - part of file checksummed by thread
+ * @thread: thread descriptor
+ * @fd: file descriptor
+ * @offset: offset of part in bytes
+ * @size: size of part in bytes
+ * @crc: final crc32c of part
+ * @err: error of thread
+ */
+struct crc32c_file_part {
+	pthread_t thread;
+	int fd;
+	off_t offset;
+	off_t size;
+	uint32_t crc;
+	int err;
+};
+
+static
+void *crc32c_file_thread(void *arg)
+{
+	struct crc32c_file_part *part = arg;
+	uint32_t crc = ~0U;
+	off_t done = 0;
+	ssize_t bytes;
+	size_t len;
+	void *buf;
+
+	buf = malloc(CRC32C_FILE_CHUNK);
+	if (!buf) {
+		part->err = -ENOMEM;
+		return NULL;
+	}
+
+	while (done < part->size) {
+		len = CRC32C_FILE_CHUNK;
+		if (len > part->size - done)
+			len = part->size - done;
+
+		bytes = pread(part->fd, buf, len, part->offset + done);
+		if (bytes < 0) {
+			if (errno == EINTR)
+				continue;
+
+			part->err = -errno;
+			goto finish_thread;
+		} else if (bytes == 0) {
+			part->err = -ENODATA;
+			goto finish_thread;
+		}
+
+		crc = crc32c(crc, buf, bytes);
+		done += bytes;
+	}
+
+	part->crc = crc ^ ~0U;
+
+finish_thread:
+	free(buf);
+
+	return NULL;
+}
+
+/*
+ * Calculate final crc32c of @size bytes of file from @offset.
+ * Parts of file are checksummed by @threads threads and CRCs
+ * of parts are combined.
+ */
+int crc32c_file(int fd, off_t offset, off_t size, int threads,
+		uint32_t *crc)
+{
+	struct crc32c_file_part *parts;
+	off_t part_size;
+	int started;
+	int i;
+	int err = 0;
+
+	if (threads < 1)
+		threads = 1;
+
+	/* every part has at least one chunk */
+	part_size = (size + threads - 1) / threads;
+	part_size = (part_size + CRC32C_FILE_CHUNK - 1) /
+				CRC32C_FILE_CHUNK * CRC32C_FILE_CHUNK;
+	if (part_size == 0)
+		part_size = CRC32C_FILE_CHUNK;
+
+	threads = (size + part_size - 1) / part_size;
+	if (threads < 1)
+		threads = 1;
+
+	parts = calloc(threads, sizeof(struct crc32c_file_part));
+	if (!parts) {
+		MEMPOOL_ERR("fail to allocate parts: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < threads; i++) {
+		parts[i].fd = fd;
+		parts[i].offset = offset + (off_t)i * part_size;
+		parts[i].size = size - (off_t)i * part_size;
+		if (parts[i].size > part_size)
+			parts[i].size = part_size;
+	}
+
+	/* the main thread checksums the first part */
+	for (started = 1; started < threads; started++) {
+		err = pthread_create(&parts[started].thread, NULL,
+				     crc32c_file_thread, &parts[started]);
+		if (err) {
+			err = -err;
+			MEMPOOL_ERR("fail to create thread: err %d\n", err);
+			break;
+		}
+	}
+
+	crc32c_file_thread(&parts[0]);
+
+	for (i = 1; i < started; i++)
+		pthread_join(parts[i].thread, NULL);
+
+	if (err)
+		goto free_parts;
+
+	*crc = 0;
+
+	for (i = 0; i < threads; i++) {
+		if (parts[i].err) {
+			err = parts[i].err;
+			MEMPOOL_ERR("fail to read file: offset %lld, err %d\n",
+				    (long long)parts[i].offset, err);
+			goto free_parts;
+		}
+
+		*crc = crc32c_combine(*crc, parts[i].crc, parts[i].size);
+	}
+
+free_parts:
+	free(parts);
+
+	return err;
+}
@@ -0,0 +1,792 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/data_gen.c - synthetic data generator.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+
+#include "data_gen.h"
+
+/*
+ * Every portion has its own pseudo-random sequence that is defined
+ * by the seed and the index of portion only. So, the same options
+ * produce the same file for any number of generator threads.
+ */
+struct mempool_random {
+	unsigned long long s[4];
+};
+
+static inline
+unsigned long long mempool_splitmix64(unsigned long long *x)
+{
+	unsigned long long z = (*x += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static inline
+unsigned long long mempool_rotl(unsigned long long x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+static
+void mempool_random_init(struct mempool_random *rnd,
+			 unsigned long long seed, int portion)
+{
+	unsigned long long x = seed ^
+			((unsigned long long)(portion + 1) * 0xD1B54A32D192ED03ULL);
+	int i;
+
+	for (i = 0; i < 4; i++)
+		rnd->s[i] = mempool_splitmix64(&x);
+}
+
+/* xoshiro256** generator */
+static inline
+unsigned long long mempool_random_next(struct mempool_random *rnd)
+{
+	unsigned long long *s = rnd->s;
+	unsigned long long result = mempool_rotl(s[1] * 5, 7) * 9;
+	unsigned long long t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = mempool_rotl(s[3], 45);
+
+	return result;
+}
+
+static inline
+double mempool_random_double(struct mempool_random *rnd)
+{
+	return (mempool_random_next(rnd) >> 11) * 0x1.0p-53;
+}
+
+/*
+ * Scale random number into [0, range). Zero range means 2^64.
+ */
+static inline
+unsigned long long mempool_random_scale(unsigned long long value,
+					unsigned long long range)
+{
+	if (range == 0)
+		return value;
+
+	return (unsigned long long)(((unsigned __int128)value * range) >> 64);
+}
+
+static
+int is_bit_set(unsigned long long mask, int bit, int capacity)
+{
+	unsigned long long bmap = mask;
+	int check_bit;
+
+	if (bit >= sizeof(unsigned long long) * MEMPOOL_BITS_PER_BYTE)
+		return MEMPOOL_FALSE;
+
+	check_bit = capacity - bit - 1;
+
+	return (bmap >> check_bit) & 1;
+}
+
+/************************************************************************
+ *                   Zipfian distribution (rejection-inversion)         *
+ ************************************************************************/
+
+/* log1p(x) / x with precision for small x */
+static inline
+double mempool_zipf_helper1(double x)
+{
+	if (fabs(x) > 1e-8)
+		return log1p(x) / x;
+
+	return 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+/* expm1(x) / x with precision for small x */
+static inline
+double mempool_zipf_helper2(double x)
+{
+	if (fabs(x) > 1e-8)
+		return expm1(x) / x;
+
+	return 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+}
+
+static inline
+double mempool_zipf_h(struct mempool_zipf_sampler *zipf, double x)
+{
+	return exp(-zipf->skew * log(x));
+}
+
+static inline
+double mempool_zipf_h_integral(struct mempool_zipf_sampler *zipf, double x)
+{
+	double log_x = log(x);
+
+	return mempool_zipf_helper2((1.0 - zipf->skew) * log_x) * log_x;
+}
+
+static inline
+double mempool_zipf_h_integral_inverse(struct mempool_zipf_sampler *zipf,
+					double x)
+{
+	double t = x * (1.0 - zipf->skew);
+
+	if (t < -1.0)
+		t = -1.0;
+
+	return exp(mempool_zipf_helper1(t) * x);
+}
+
+static
+void mempool_zipf_init(struct mempool_zipf_sampler *zipf,
+		       double count, double skew)
+{
+	zipf->count = count;
+	zipf->skew = skew;
+	zipf->h_integral_x1 = mempool_zipf_h_integral(zipf, 1.5) - 1.0;
+	zipf->h_integral_n = mempool_zipf_h_integral(zipf, count + 0.5);
+	zipf->s = 2.0 - mempool_zipf_h_integral_inverse(zipf,
+				mempool_zipf_h_integral(zipf, 2.5) -
+				mempool_zipf_h(zipf, 2.0));
+}
+
+/*
+ * Rank in [1, count]: rank 1 is the most frequent one.
+ */
+static
+unsigned long long mempool_zipf_sample(struct mempool_zipf_sampler *zipf,
+				       struct mempool_random *rnd)
+{
+	double u, x;
+	double k;
+
+	while (MEMPOOL_TRUE) {
+		u = zipf->h_integral_n + mempool_random_double(rnd) *
+				(zipf->h_integral_x1 - zipf->h_integral_n);
+		x = mempool_zipf_h_integral_inverse(zipf, u);
+
+		k = floor(x + 0.5);
+		if (k < 1.0)
+			k = 1.0;
+		else if (k > zipf->count)
+			k = zipf->count;
+
+		if (k - x <= zipf->s ||
+		    u >= mempool_zipf_h_integral(zipf, k + 0.5) -
+						mempool_zipf_h(zipf, k))
+			break;
+	}
+
+	/* 2^64 cannot be represented by unsigned long long */
+	if (k >= 18446744073709551615.0)
+		return ULLONG_MAX;
+
+	return (unsigned long long)k;
+}
+
+/************************************************************************
+ *                         Generation of portions                       *
+ ************************************************************************/
+
+/*
+ * Key of record number @index in sorted dataset: keys are spread
+ * evenly through the range.
+ */
+static inline
+unsigned long long mempool_sorted_key(struct mempool_generator *gen,
+				      unsigned long long index)
+{
+	unsigned __int128 range = gen->range;
+
+	if (range == 0)
+		range = (unsigned __int128)1 << 64;
+
+	return (unsigned long long)(range * index / gen->records);
+}
+
+static
+void mempool_generate_keys(struct mempool_generator *gen,
+			   struct mempool_random *rnd,
+			   unsigned long long *keys,
+			   unsigned long long first, int count)
+{
+	struct mempool_distribution *dist = gen->dist;
+	unsigned __int128 step;
+	unsigned long long tmp;
+	long long swaps;
+	int i, j;
+
+	switch (dist->type) {
+	case MEMPOOL_UNIFORM_DISTRIBUTION:
+		for (i = 0; i < count; i++) {
+			keys[i] = mempool_random_scale(mempool_random_next(rnd),
+							gen->range);
+		}
+		break;
+
+	case MEMPOOL_ZIPF_DISTRIBUTION:
+		for (i = 0; i < count; i++)
+			keys[i] = mempool_zipf_sample(&gen->zipf, rnd) - 1;
+		break;
+
+	case MEMPOOL_SORTED_DISTRIBUTION:
+	case MEMPOOL_NEARLY_SORTED_DISTRIBUTION:
+		for (i = 0; i < count; i++)
+			keys[i] = mempool_sorted_key(gen, first + i);
+		break;
+
+	case MEMPOOL_REVERSE_SORTED_DISTRIBUTION:
+		for (i = 0; i < count; i++) {
+			keys[i] = mempool_sorted_key(gen,
+					gen->records - 1 - (first + i));
+		}
+		break;
+
+	case MEMPOOL_FEW_UNIQUE_DISTRIBUTION:
+		/* unique keys are spread evenly through the range */
+		step = gen->range;
+		if (step == 0)
+			step = (unsigned __int128)1 << 64;
+		step /= dist->unique;
+
+		for (i = 0; i < count; i++) {
+			keys[i] = (unsigned long long)(step *
+				mempool_random_scale(mempool_random_next(rnd),
+						     dist->unique));
+		}
+		break;
+	}
+
+	if (dist->type != MEMPOOL_NEARLY_SORTED_DISTRIBUTION)
+		return;
+
+	/* every swap displaces two records of portion */
+	swaps = ((long long)count * dist->disorder) / 200;
+
+	while (swaps-- > 0) {
+		i = (int)mempool_random_scale(mempool_random_next(rnd), count);
+		j = (int)mempool_random_scale(mempool_random_next(rnd), count);
+
+		tmp = keys[i];
+		keys[i] = keys[j];
+		keys[j] = tmp;
+	}
+}
+
+/*
+ * Key is placed into key items in the same way as algorithms
+ * extract it: bytes of key fill key items one after another.
+ * Other items receive pseudo-random bytes.
+ */
+static
+void mempool_generate_record(struct mempool_generator *gen,
+			     struct mempool_random *rnd,
+			     unsigned char *record,
+			     unsigned long long key)
+{
+	struct mempool_test_environment *env = gen->env;
+	int granularity = env->item.granularity;
+	int capacity = env->record.capacity;
+	size_t key_offset = 0;
+	unsigned long long value;
+	int bytes;
+	int i, j;
+
+	for (i = 0; i < capacity; i++) {
+		unsigned char *item = record + (size_t)i * granularity;
+
+		if (is_bit_set(env->key.mask, i, capacity)) {
+			bytes = 0;
+
+			if (key_offset < sizeof(key)) {
+				bytes = sizeof(key) - key_offset;
+				if (bytes > granularity)
+					bytes = granularity;
+
+				memcpy(item, (unsigned char *)&key + key_offset,
+					bytes);
+			}
+
+			memset(item + bytes, 0, granularity - bytes);
+			key_offset += granularity;
+			continue;
+		}
+
+		for (j = 0; j < granularity; j += sizeof(value)) {
+			bytes = granularity - j;
+			if (bytes > sizeof(value))
+				bytes = sizeof(value);
+
+			value = mempool_random_next(rnd);
+			memcpy(item + j, &value, bytes);
+		}
+	}
+}
+
+static
+void mempool_generate_portion(struct mempool_generator_thread *thread,
+			      int id, unsigned char *payload)
+{
+	struct mempool_generator *gen = thread->gen;
+	struct mempool_test_environment *env = gen->env;
+	struct mempool_container_portion *portion;
+	struct mempool_random rnd;
+	size_t record_size;
+	size_t bytes;
+	int count = env->portion.count;
+	int i;
+
+	record_size = (size_t)env->item.granularity * env->record.capacity;
+	bytes = record_size * count;
+
+	mempool_random_init(&rnd, gen->dist->seed, id);
+	mempool_generate_keys(gen, &rnd, thread->keys,
+			      (unsigned long long)id * count, count);
+
+	for (i = 0; i < count; i++) {
+		mempool_generate_record(gen, &rnd, payload + i * record_size,
+					thread->keys[i]);
+	}
+
+	/* the rest of portion and padding of container are cleaned */
+	memset(payload + bytes, 0, gen->stride - bytes);
+
+	if (gen->container) {
+		portion = &gen->container->portions[id];
+		portion->records = count;
+		portion->bytes = bytes;
+		portion->crc = mempool_container_crc(payload, bytes);
+	}
+}
+
+static
+int mempool_pwrite_full(int fd, const void *buf, size_t len, off_t offset)
+{
+	size_t done = 0;
+	ssize_t res;
+
+	while (done < len) {
+		res = pwrite(fd, (const char *)buf + done, len - done,
+			     offset + (off_t)done);
+		if (res < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+
+		done += (size_t)res;
+	}
+
+	return 0;
+}
+
+/*
+ * Generator threads take chunks of portions one by one,
+ * so the writes of file are big and sequential per thread.
+ */
+static
+void *mempool_generator_thread_func(void *arg)
+{
+	struct mempool_generator_thread *thread = arg;
+	struct mempool_generator *gen = thread->gen;
+	struct mempool_test_environment *env = gen->env;
+	int portions_count = env->threads.count;
+	int chunk;
+	int first;
+	int portions;
+	int i;
+
+	while (!thread->err) {
+		chunk = __atomic_fetch_add(&gen->next_chunk, 1,
+					   __ATOMIC_RELAXED);
+		if (chunk >= gen->chunks_count)
+			break;
+
+		first = chunk * gen->chunk_portions;
+		portions = portions_count - first;
+		if (portions > gen->chunk_portions)
+			portions = gen->chunk_portions;
+
+		for (i = 0; i < portions; i++) {
+			mempool_generate_portion(thread, first + i,
+				(unsigned char *)thread->buf + i * gen->stride);
+		}
+
+		thread->err = mempool_pwrite_full(env->output_file.fd,
+					thread->buf,
+					(size_t)portions * gen->stride,
+					gen->payload_offset +
+					    (off_t)first * gen->stride);
+		if (thread->err) {
+			MEMPOOL_ERR("fail to write chunk: "
+				    "chunk %d, err %d\n",
+				    chunk, thread->err);
+			break;
+		}
+
+		thread->bytes += (unsigned long long)portions * gen->stride;
+
+		MEMPOOL_DBG(env->show_debug,
+			    "thread %d, chunk %d, portions [%d, %d)\n",
+			    thread->id, chunk, first, first + portions);
+	}
+
+	return NULL;
+}
+
+static
+int mempool_key_bytes(struct mempool_test_environment *env)
+{
+	int bytes = 0;
+	int i;
+
+	for (i = 0; i < env->record.capacity; i++) {
+		if (is_bit_set(env->key.mask, i, env->record.capacity))
+			bytes += env->item.granularity;
+	}
+
+	return bytes;
+}
+
+static
+int mempool_generator_init(struct mempool_generator *gen,
+			   struct mempool_test_environment *env,
+			   struct mempool_distribution *dist,
+			   struct mempool_container *container)
+{
+	unsigned long long space = 0;
+	double count;
+
+	memset(gen, 0, sizeof(struct mempool_generator));
+
+	gen->env = env;
+	gen->dist = dist;
+	gen->container = container;
+	gen->records = (unsigned long long)env->threads.count *
+						env->portion.count;
+	gen->key_bytes = mempool_key_bytes(env);
+
+	/* key is extracted by 8 bytes at most */
+	if (gen->key_bytes < (int)sizeof(unsigned long long))
+		space = 1ULL << (gen->key_bytes * MEMPOOL_BITS_PER_BYTE);
+
+	gen->range = dist->range;
+	if (space != 0 && (gen->range == 0 || gen->range > space))
+		gen->range = space;
+
+	if (dist->type == MEMPOOL_FEW_UNIQUE_DISTRIBUTION &&
+	    gen->range != 0 && dist->unique > gen->range)
+		dist->unique = gen->range;
+
+	if (dist->type == MEMPOOL_ZIPF_DISTRIBUTION) {
+		count = gen->range ? (double)gen->range : 18446744073709551616.0;
+		mempool_zipf_init(&gen->zipf, count, dist->skew);
+	}
+
+	if (container) {
+		gen->stride = container->stride;
+		gen->payload_offset = container->payload_offset;
+	} else {
+		gen->stride = env->threads.portion_size;
+		gen->payload_offset = 0;
+	}
+
+	gen->chunk_portions = MEMPOOL_DATAGEN_CHUNK_SIZE / gen->stride;
+	if (gen->chunk_portions == 0)
+		gen->chunk_portions = 1;
+
+	gen->chunks_count = (env->threads.count + gen->chunk_portions - 1) /
+						gen->chunk_portions;
+
+	return 0;
+}
+
+static
+int mempool_create_output_container(struct mempool_test_environment *env,
+				    struct mempool_distribution *dist,
+				    struct mempool_container *container)
+{
+	int err;
+
+	err = mempool_container_create(container, env->threads.count,
+			mempool_container_align(env->threads.portion_size));
+	if (err)
+		return err;
+
+	container->granularity = env->item.granularity;
+	container->record_capacity = env->record.capacity;
+	container->portion_capacity = env->portion.capacity;
+	container->key_mask = env->key.mask;
+	container->value_mask = env->value.mask;
+	container->algorithm = MEMPOOL_UNKNOWN_ALGORITHM;
+
+	/* order by key is guaranteed if key is extracted completely */
+	if (env->key.mask == 0 ||
+	    mempool_key_bytes(env) > (int)sizeof(unsigned long long))
+		return 0;
+
+	if (dist->type == MEMPOOL_SORTED_DISTRIBUTION)
+		container->sort_order = MEMPOOL_ASCENDING_ORDER;
+	else if (dist->type == MEMPOOL_REVERSE_SORTED_DISTRIBUTION)
+		container->sort_order = MEMPOOL_DESCENDING_ORDER;
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct mempool_test_environment environment;
+	struct mempool_distribution distribution;
+	struct mempool_container container;
+	struct mempool_generator gen;
+	struct mempool_generator_thread *threads = NULL;
+	struct timespec start_time, finish_time;
+	unsigned long long written_bytes = 0;
+	long long portion_size;
+	off_t file_size;
+	double seconds;
+	long cpus;
+	int started = 0;
+	int i;
+	int err = 0;
+
+	memset(&environment, 0, sizeof(environment));
+	memset(&container, 0, sizeof(container));
+
+	environment.output_file.fd = -1;
+	environment.item.granularity = 1;
+	environment.record.capacity = 1;
+	environment.format.output = MEMPOOL_RAW_FORMAT;
+	environment.show_debug = MEMPOOL_FALSE;
+
+	distribution.type = MEMPOOL_UNIFORM_DISTRIBUTION;
+	distribution.seed = MEMPOOL_DEFAULT_SEED;
+	distribution.range = 0;
+	distribution.skew = MEMPOOL_DEFAULT_ZIPF_SKEW;
+	distribution.unique = MEMPOOL_DEFAULT_UNIQUE_KEYS;
+	distribution.disorder = MEMPOOL_DEFAULT_DISORDER;
+
+	parse_options(argc, argv, &environment, &distribution);
+
+	MEMPOOL_DBG(environment.show_debug,
+		    "options have been parsed\n");
+
+	if (!environment.output_file.name) {
+		err = -EINVAL;
+		MEMPOOL_ERR("output file is absent\n");
+		goto finish_execution;
+	}
+
+	if (environment.threads.count <= 0) {
+		MEMPOOL_INFO("Nothing can be done: "
+			     "threads.count %d\n",
+			     environment.threads.count);
+		goto finish_execution;
+	}
+
+	if (environment.record.capacity <= 0 ||
+	    environment.record.capacity >
+		(int)(sizeof(unsigned long long) * MEMPOOL_BITS_PER_BYTE) ||
+	    environment.portion.capacity <= 0 ||
+	    environment.portion.count < 0 ||
+	    environment.portion.count > environment.portion.capacity) {
+		err = -ERANGE;
+		MEMPOOL_ERR("invalid geometry: "
+			    "record_capacity %d, portion_capacity %d, "
+			    "portion_count %d\n",
+			    environment.record.capacity,
+			    environment.portion.capacity,
+			    environment.portion.count);
+		goto finish_execution;
+	}
+
+	/* every portion is full by default */
+	if (environment.portion.count == 0)
+		environment.portion.count = environment.portion.capacity;
+
+	portion_size = (long long)environment.item.granularity *
+			environment.record.capacity;
+	portion_size *= environment.portion.capacity;
+
+	if (environment.threads.portion_size == 0)
+		environment.threads.portion_size = portion_size;
+
+	if (portion_size != environment.threads.portion_size) {
+		err = -ERANGE;
+		MEMPOOL_ERR("invalid request: "
+			    "portion_size %lld, granularity %d, "
+			    "record_capacity %d, portion_capacity %d\n",
+			    environment.threads.portion_size,
+			    environment.item.granularity,
+			    environment.record.capacity,
+			    environment.portion.capacity);
+		goto finish_execution;
+	}
+
+	if (environment.workers.count == 0) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		environment.workers.count = cpus > 0 ? (int)cpus : 1;
+	}
+
+	if (environment.format.output == MEMPOOL_CONTAINER_FORMAT) {
+		err = mempool_create_output_container(&environment,
+						      &distribution,
+						      &container);
+		if (err) {
+			MEMPOOL_ERR("fail to create container: err %d\n",
+				    err);
+			goto finish_execution;
+		}
+
+		file_size = mempool_container_file_size(&container);
+	} else {
+		file_size = (off_t)environment.threads.count *
+				environment.threads.portion_size;
+	}
+
+	err = mempool_generator_init(&gen, &environment, &distribution,
+				     container.portions ? &container : NULL);
+	if (err)
+		goto finish_execution;
+
+	if (environment.workers.count > gen.chunks_count)
+		environment.workers.count = gen.chunks_count;
+
+	environment.output_file.fd = open(environment.output_file.name,
+					  O_CREAT | O_TRUNC | O_WRONLY, 0664);
+	if (environment.output_file.fd == -1) {
+		err = -ENOENT;
+		MEMPOOL_ERR("fail to open file: %s\n",
+			    strerror(errno));
+		goto finish_execution;
+	}
+
+	err = ftruncate(environment.output_file.fd, file_size);
+	if (err) {
+		err = -errno;
+		MEMPOOL_ERR("fail to prepare output file: %s\n",
+			    strerror(errno));
+		goto close_file;
+	}
+
+	threads = calloc(environment.workers.count,
+			 sizeof(struct mempool_generator_thread));
+	if (!threads) {
+		err = -ENOMEM;
+		MEMPOOL_ERR("fail to allocate threads: %s\n",
+			    strerror(errno));
+		goto close_file;
+	}
+
+	for (i = 0; i < environment.workers.count; i++) {
+		threads[i].id = i;
+		threads[i].gen = &gen;
+		threads[i].buf = malloc((size_t)gen.chunk_portions * gen.stride);
+		threads[i].keys = calloc(environment.portion.count,
+					 sizeof(unsigned long long));
+		if (!threads[i].buf || !threads[i].keys) {
+			err = -ENOMEM;
+			MEMPOOL_ERR("fail to allocate buffers: %s\n",
+				    strerror(errno));
+			goto free_threads;
+		}
+	}
+
+	MEMPOOL_INFO("Generate portions: portions %d, records %llu, "
+		     "threads %d...\n",
+		     environment.threads.count, gen.records,
+		     environment.workers.count);
+
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+	for (started = 0; started < environment.workers.count; started++) {
+		err = pthread_create(&threads[started].thread, NULL,
+				     mempool_generator_thread_func,
+				     &threads[started]);
+		if (err) {
+			err = -err;
+			MEMPOOL_ERR("fail to create thread: err %d\n", err);
+			break;
+		}
+	}
+
+	for (i = 0; i < started; i++) {
+		pthread_join(threads[i].thread, NULL);
+
+		if (threads[i].err && !err)
+			err = threads[i].err;
+
+		written_bytes += threads[i].bytes;
+	}
+
+	if (err)
+		goto free_threads;
+
+	clock_gettime(CLOCK_MONOTONIC, &finish_time);
+
+	seconds = (finish_time.tv_sec - start_time.tv_sec) +
+			(finish_time.tv_nsec - start_time.tv_nsec) / 1e9;
+
+	MEMPOOL_INFO("Generation: bytes %llu, time %.3f seconds, "
+		     "throughput %.1f MB/s\n",
+		     written_bytes, seconds,
+		     seconds > 0 ? written_bytes / seconds / (1024 * 1024) : 0);
+
+	if (container.portions) {
+		err = mempool_container_write(environment.output_file.fd,
+					      &container);
+		if (err) {
+			MEMPOOL_ERR("fail to write container: err %d\n", err);
+			goto free_threads;
+		}
+	}
+
+free_threads:
+	if (threads) {
+		for (i = 0; i < environment.workers.count; i++) {
+			free(threads[i].buf);
+			free(threads[i].keys);
+		}
+
+		free(threads);
+	}
+
+close_file:
+	close(environment.output_file.fd);
+
+finish_execution:
+	mempool_container_destroy(&container);
+
+	exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,179 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/data_gen.h - synthetic data generator declarations.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#ifndef _DATA_GEN_TOOL_H
+#define _DATA_GEN_TOOL_H
+
+#ifdef datagen_fmt
+#undef datagen_fmt
+#endif
+
+#include "version.h"
+
+#define datagen_fmt(fmt) "data-gen: " MEMPOOL_TOOLS_VERSION ": " fmt
+
+#include <pthread.h>
+#include <string.h>
+
+#include "memory_pool_constants.h"
+#include "memory_pool_tools.h"
+#include "memory_pool_container.h"
+
+#define DATA_GEN_INFO(show, fmt, ...) \
+	do { \
+		if (show) { \
+			fprintf(stdout, datagen_fmt(fmt), ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+/* distribution of keys */
+enum {
+	MEMPOOL_UNKNOWN_DISTRIBUTION,
+	MEMPOOL_UNIFORM_DISTRIBUTION,
+	MEMPOOL_ZIPF_DISTRIBUTION,
+	MEMPOOL_SORTED_DISTRIBUTION,
+	MEMPOOL_REVERSE_SORTED_DISTRIBUTION,
+	MEMPOOL_FEW_UNIQUE_DISTRIBUTION,
+	MEMPOOL_NEARLY_SORTED_DISTRIBUTION,
+	MEMPOOL_DISTRIBUTION_MAX
+};
+
+#define MEMPOOL_UNIFORM_DISTRIBUTION_STR		"uniform"
+#define MEMPOOL_ZIPF_DISTRIBUTION_STR			"zipf"
+#define MEMPOOL_SORTED_DISTRIBUTION_STR			"sorted"
+#define MEMPOOL_REVERSE_SORTED_DISTRIBUTION_STR		"reverse-sorted"
+#define MEMPOOL_FEW_UNIQUE_DISTRIBUTION_STR		"few-unique"
+#define MEMPOOL_NEARLY_SORTED_DISTRIBUTION_STR		"nearly-sorted"
+
+#define MEMPOOL_DEFAULT_SEED			(1)
+#define MEMPOOL_DEFAULT_ZIPF_SKEW		(0.99)
+#define MEMPOOL_DEFAULT_UNIQUE_KEYS		(16)
+#define MEMPOOL_DEFAULT_DISORDER		(1)
+
+/* every generator thread writes chunks of this size */
+#define MEMPOOL_DATAGEN_CHUNK_SIZE		(8 * 1024 * 1024)
+
+/*
+ * struct mempool_distribution - distribution of keys
+ * @type: type of distribution
+ * @seed: seed of pseudo-random sequences
+ * @range: number of possible keys (0 - the whole space of key)
+ * @skew: exponent of Zipfian distribution
+ * @unique: number of unique keys (few-unique distribution)
+ * @disorder: percent of displaced records (nearly-sorted distribution)
+ */
+struct mempool_distribution {
+	int type;
+	unsigned long long seed;
+	unsigned long long range;
+	double skew;
+	unsigned long long unique;
+	int disorder;
+};
+
+/*
+ * struct mempool_zipf_sampler - rejection-inversion sampler of Zipf
+ * @count: number of ranks
+ * @skew: exponent of distribution
+ * @h_integral_x1: integral of hat function at 1.5 minus 1
+ * @h_integral_n: integral of hat function at (count + 0.5)
+ * @s: threshold of immediate acceptance
+ */
+struct mempool_zipf_sampler {
+	double count;
+	double skew;
+	double h_integral_x1;
+	double h_integral_n;
+	double s;
+};
+
+/*
+ * struct mempool_generator - shared state of generator threads
+ * @env: generator's environment
+ * @dist: distribution of keys
+ * @zipf: sampler of Zipfian distribution
+ * @container: directory of output container (NULL for raw output)
+ * @range: number of possible keys (0 - 2^64)
+ * @records: number of records in the dataset
+ * @key_bytes: number of key bytes in record
+ * @stride: distance between portions in the file
+ * @payload_offset: offset of the first portion in the file
+ * @chunk_portions: number of portions in chunk
+ * @chunks_count: number of chunks in the file
+ * @next_chunk: index of the next chunk to generate
+ */
+struct mempool_generator {
+	struct mempool_test_environment *env;
+	struct mempool_distribution *dist;
+	struct mempool_zipf_sampler zipf;
+	struct mempool_container *container;
+	unsigned long long range;
+	unsigned long long records;
+	int key_bytes;
+	size_t stride;
+	unsigned long long payload_offset;
+	int chunk_portions;
+	int chunks_count;
+	int next_chunk;
+};
+
+/*
+ * struct mempool_generator_thread - generator thread
+ * @id: thread ID
+ * @thread: thread descriptor
+ * @gen: shared state of generator
+ * @buf: buffer of chunk
+ * @keys: keys of portion
+ * @bytes: number of written bytes
+ * @err: error of thread
+ */
+struct mempool_generator_thread {
+	int id;
+	pthread_t thread;
+	struct mempool_generator *gen;
+	void *buf;
+	unsigned long long *keys;
+	unsigned long long bytes;
+	int err;
+};
+
+static inline
+int convert_string2distribution(const char *str)
+{
+	if (strcmp(str, MEMPOOL_UNIFORM_DISTRIBUTION_STR) == 0)
+		return MEMPOOL_UNIFORM_DISTRIBUTION;
+	else if (strcmp(str, MEMPOOL_ZIPF_DISTRIBUTION_STR) == 0)
+		return MEMPOOL_ZIPF_DISTRIBUTION;
+	else if (strcmp(str, MEMPOOL_SORTED_DISTRIBUTION_STR) == 0)
+		return MEMPOOL_SORTED_DISTRIBUTION;
+	else if (strcmp(str, MEMPOOL_REVERSE_SORTED_DISTRIBUTION_STR) == 0)
+		return MEMPOOL_REVERSE_SORTED_DISTRIBUTION;
+	else if (strcmp(str, MEMPOOL_FEW_UNIQUE_DISTRIBUTION_STR) == 0)
+		return MEMPOOL_FEW_UNIQUE_DISTRIBUTION;
+	else if (strcmp(str, MEMPOOL_NEARLY_SORTED_DISTRIBUTION_STR) == 0)
+		return MEMPOOL_NEARLY_SORTED_DISTRIBUTION;
+	else
+		return MEMPOOL_UNKNOWN_DISTRIBUTION;
+}
+
+/* options.c */
+void print_version(void);
+void print_usage(void);
+void parse_options(int argc, char *argv[],
+		   struct mempool_test_environment *env,
+		   struct mempool_distribution *dist);
+
+#endif /* _DATA_GEN_TOOL_H */
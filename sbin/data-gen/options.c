@@ -0,0 +1,390 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/options.c - parsing command line options functionality.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#include <sys/types.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "data_gen.h"
+
+/************************************************************************
+ *                    Options parsing functionality                     *
+ ************************************************************************/
+
+void print_version(void)
+{
+	MEMPOOL_INFO("data-gen, part of %s\n", MEMPOOL_TOOLS_VERSION);
+}
+
+void print_usage(void)
+{
+	DATA_GEN_INFO(MEMPOOL_TRUE, "synthetic data generator\n\n");
+	MEMPOOL_INFO("Usage: data-gen  <options>\n");
+	MEMPOOL_INFO("Options:\n");
+	MEMPOOL_INFO("\t [-d|--debug]\t\t  show debug output.\n");
+	MEMPOOL_INFO("\t [-h|--help]\t\t  display help message and exit.\n");
+	MEMPOOL_INFO("\t [-o|--output-file]\t\t  define output file.\n");
+	MEMPOOL_INFO("\t [-f|--format]\t\t  define format of output file "
+		     "[raw|container].\n");
+	MEMPOOL_INFO("\t [-t|--thread number=value, "
+		     "portion-size=value]\t\t  define portions.\n");
+	MEMPOOL_INFO("\t [-w|--workers number=value]\t\t  "
+		     "define number of generator threads.\n");
+	MEMPOOL_INFO("\t [-I|--item granularity=value]\t\t  "
+		     "define item size in bytes.\n");
+	MEMPOOL_INFO("\t [-r|--record capacity=value]\t\t  "
+		     "define number of items in record.\n");
+	MEMPOOL_INFO("\t [-p|--portion capacity=value,count=value]\t\t  "
+		     "define number of records in portion.\n");
+	MEMPOOL_INFO("\t [-k|--key mask=value]\t\t  define key.\n");
+	MEMPOOL_INFO("\t [-v|--value mask=value]\t\t  define value.\n");
+	MEMPOOL_INFO("\t [-D|--distribution type=[uniform|zipf|sorted|"
+		     "reverse-sorted|few-unique|nearly-sorted],"
+		     "seed=value,range=value,skew=value,unique=value,"
+		     "disorder=value]\t\t  define distribution of keys.\n");
+	MEMPOOL_INFO("\t [-V|--version]\t\t  print version and exit.\n");
+}
+
+void parse_options(int argc, char *argv[],
+		   struct mempool_test_environment *env,
+		   struct mempool_distribution *dist)
+{
+	int c;
+	int oi = 1;
+	char *p;
+	char sopts[] = "dD:f:hI:o:p:k:r:t:v:Vw:";
+	static const struct option lopts[] = {
+		{"debug", 0, NULL, 'd'},
+		{"distribution", 1, NULL, 'D'},
+		{"format", 1, NULL, 'f'},
+		{"help", 0, NULL, 'h'},
+		{"item", 1, NULL, 'I'},
+		{"output-file", 1, NULL, 'o'},
+		{"portion", 1, NULL, 'p'},
+		{"key", 1, NULL, 'k'},
+		{"record", 1, NULL, 'r'},
+		{"thread", 1, NULL, 't'},
+		{"value", 1, NULL, 'v'},
+		{"version", 0, NULL, 'V'},
+		{"workers", 1, NULL, 'w'},
+		{ }
+	};
+	enum {
+		ITEM_GRANULARITY_OPT = 0,
+	};
+	char *const item_tokens[] = {
+		[ITEM_GRANULARITY_OPT]		= "granularity",
+		NULL
+	};
+	enum {
+		PORTION_CAPACITY_OPT = 0,
+		PORTION_COUNT_OPT,
+	};
+	char *const portion_tokens[] = {
+		[PORTION_CAPACITY_OPT]		= "capacity",
+		[PORTION_COUNT_OPT]		= "count",
+		NULL
+	};
+	enum {
+		KEY_MASK_OPT = 0,
+	};
+	char *const key_tokens[] = {
+		[KEY_MASK_OPT]			= "mask",
+		NULL
+	};
+	enum {
+		RECORD_CAPACITY_OPT = 0,
+	};
+	char *const record_tokens[] = {
+		[RECORD_CAPACITY_OPT]		= "capacity",
+		NULL
+	};
+	enum {
+		THREAD_COUNT_OPT = 0,
+		THREAD_PORTION_SIZE_OPT,
+	};
+	char *const threads_tokens[] = {
+		[THREAD_COUNT_OPT]		= "number",
+		[THREAD_PORTION_SIZE_OPT]	= "portion-size",
+		NULL
+	};
+	enum {
+		WORKERS_COUNT_OPT = 0,
+	};
+	char *const workers_tokens[] = {
+		[WORKERS_COUNT_OPT]		= "number",
+		NULL
+	};
+	enum {
+		VALUE_MASK_OPT = 0,
+	};
+	char *const value_tokens[] = {
+		[VALUE_MASK_OPT]		= "mask",
+		NULL
+	};
+	enum {
+		DISTRIBUTION_TYPE_OPT = 0,
+		DISTRIBUTION_SEED_OPT,
+		DISTRIBUTION_RANGE_OPT,
+		DISTRIBUTION_SKEW_OPT,
+		DISTRIBUTION_UNIQUE_OPT,
+		DISTRIBUTION_DISORDER_OPT,
+	};
+	char *const distribution_tokens[] = {
+		[DISTRIBUTION_TYPE_OPT]		= "type",
+		[DISTRIBUTION_SEED_OPT]		= "seed",
+		[DISTRIBUTION_RANGE_OPT]	= "range",
+		[DISTRIBUTION_SKEW_OPT]		= "skew",
+		[DISTRIBUTION_UNIQUE_OPT]	= "unique",
+		[DISTRIBUTION_DISORDER_OPT]	= "disorder",
+		NULL
+	};
+
+	while ((c = getopt_long(argc, argv, sopts, lopts, &oi)) != EOF) {
+		switch (c) {
+		case 'd':
+			env->show_debug = MEMPOOL_TRUE;
+			break;
+		case 'h':
+			print_usage();
+			exit(EXIT_SUCCESS);
+		case 'o':
+			env->output_file.name = optarg;
+			if (!env->output_file.name) {
+				MEMPOOL_ERR("output file is absent\n");
+				print_usage();
+				exit(EXIT_SUCCESS);
+			}
+			break;
+		case 'f':
+			env->format.output = convert_string2format(optarg);
+			if (env->format.output == MEMPOOL_UNKNOWN_FORMAT) {
+				MEMPOOL_ERR("invalid format\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 't':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, threads_tokens, &value)) {
+				case THREAD_COUNT_OPT:
+					env->threads.count = atoi(value);
+					break;
+				case THREAD_PORTION_SIZE_OPT:
+					env->threads.portion_size = atoll(value);
+					break;
+				default:
+					MEMPOOL_ERR("invalid threads option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'w':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, workers_tokens, &value)) {
+				case WORKERS_COUNT_OPT:
+					env->workers.count = atoi(value);
+					if (env->workers.count <= 0) {
+						MEMPOOL_ERR("invalid number of workers\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				default:
+					MEMPOOL_ERR("invalid workers option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'I':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+				int granularity;
+
+				switch (getsubopt(&p, item_tokens, &value)) {
+				case ITEM_GRANULARITY_OPT:
+					granularity = atoi(value);
+					if (!check_granularity(granularity)) {
+						MEMPOOL_ERR("invalid granularity\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					env->item.granularity = granularity;
+					break;
+				default:
+					MEMPOOL_ERR("invalid item option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'r':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, record_tokens, &value)) {
+				case RECORD_CAPACITY_OPT:
+					env->record.capacity = atoi(value);
+					break;
+				default:
+					MEMPOOL_ERR("invalid record option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'p':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, portion_tokens, &value)) {
+				case PORTION_CAPACITY_OPT:
+					env->portion.capacity = atoi(value);
+					break;
+				case PORTION_COUNT_OPT:
+					env->portion.count = atoi(value);
+					break;
+				default:
+					MEMPOOL_ERR("invalid portion option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'k':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, key_tokens, &value)) {
+				case KEY_MASK_OPT:
+					env->key.mask = atoll(value);
+					break;
+				default:
+					MEMPOOL_ERR("invalid key option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'v':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, value_tokens, &value)) {
+				case VALUE_MASK_OPT:
+					env->value.mask = atoll(value);
+					break;
+				default:
+					MEMPOOL_ERR("invalid value option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'D':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, distribution_tokens, &value)) {
+				case DISTRIBUTION_TYPE_OPT:
+					if (!value) {
+						MEMPOOL_ERR("distribution type is absent\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					dist->type = convert_string2distribution(value);
+					if (dist->type == MEMPOOL_UNKNOWN_DISTRIBUTION) {
+						MEMPOOL_ERR("invalid distribution\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case DISTRIBUTION_SEED_OPT:
+					if (!value) {
+						MEMPOOL_ERR("seed is absent\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					dist->seed = strtoull(value, NULL, 0);
+					break;
+				case DISTRIBUTION_RANGE_OPT:
+					if (!value) {
+						MEMPOOL_ERR("range is absent\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					dist->range = strtoull(value, NULL, 0);
+					break;
+				case DISTRIBUTION_SKEW_OPT:
+					if (value)
+						dist->skew = atof(value);
+					if (!value || dist->skew <= 0) {
+						MEMPOOL_ERR("invalid skew\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case DISTRIBUTION_UNIQUE_OPT:
+					if (value)
+						dist->unique = strtoull(value, NULL, 0);
+					if (!value || dist->unique == 0) {
+						MEMPOOL_ERR("invalid number of unique keys\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case DISTRIBUTION_DISORDER_OPT:
+					if (value)
+						dist->disorder = atoi(value);
+					if (!value || dist->disorder < 0 ||
+					    dist->disorder > 100) {
+						MEMPOOL_ERR("invalid disorder\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				default:
+					MEMPOOL_ERR("invalid distribution option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'V':
+			print_version();
+			exit(EXIT_SUCCESS);
+		default:
+			print_usage();
+			exit(EXIT_FAILURE);
+		}
+	}
+}
@@ -0,0 +1,763 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/fpga_emu.c - FPGA emulator.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "fpga_emu.h"
+#include "crc32c.h"
+
+/* emulator stops by SIGINT or SIGTERM */
+static volatile sig_atomic_t stop_emulation;
+
+static
+void mempool_emu_signal_handler(int signum)
+{
+	stop_emulation = MEMPOOL_TRUE;
+}
+
+static inline
+unsigned int mempool_emu_checksum(const unsigned char *data, size_t bytes)
+{
+	return crc32c(~0L, data, bytes) ^ ~0L;
+}
+
+/* frame is damaged with probability of error rate */
+static inline
+int mempool_emu_inject_error(struct mempool_emulator *emu)
+{
+	if (emu->opts->error_rate == 0)
+		return MEMPOOL_FALSE;
+
+	return (rand_r(&emu->random) % 100) < emu->opts->error_rate;
+}
+
+/*
+ * Get payload size of frame from the high byte of @address.
+ * It returns zero for unsupported frame size.
+ */
+static inline
+size_t mempool_emu_frame_size(unsigned long long address)
+{
+	unsigned long long shift = address >> MEMPOOL_FRAME_SHIFT_BITS;
+	size_t frame;
+
+	if (shift >= sizeof(size_t) * MEMPOOL_BITS_PER_BYTE)
+		return 0;
+
+	frame = MEMPOOL_PAGE_SIZE >> shift;
+	if (frame < MEMPOOL_MIN_LINK_FRAME)
+		return 0;
+
+	return frame;
+}
+
+/*
+ * Create pseudo-terminal. Slave side is kept opened, so the master
+ * side is alive when fpga-test closes the channel between runs.
+ */
+static
+int mempool_emu_open_pty(struct mempool_emulator *emu)
+{
+	struct mempool_test_environment *env = emu->env;
+	struct termios config;
+	struct stat st;
+	char *name;
+
+	emu->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (emu->master < 0) {
+		MEMPOOL_ERR("fail to open pseudo-terminal: %s\n",
+			    strerror(errno));
+		return -EFAULT;
+	}
+
+	if (grantpt(emu->master) < 0 || unlockpt(emu->master) < 0) {
+		MEMPOOL_ERR("fail to unlock pseudo-terminal: %s\n",
+			    strerror(errno));
+		return -EFAULT;
+	}
+
+	name = ptsname(emu->master);
+	if (!name) {
+		MEMPOOL_ERR("fail to get name of pseudo-terminal: %s\n",
+			    strerror(errno));
+		return -EFAULT;
+	}
+
+	strncpy(emu->slave_name, name, sizeof(emu->slave_name) - 1);
+
+	emu->slave = open(emu->slave_name, O_RDWR | O_NOCTTY);
+	if (emu->slave < 0) {
+		MEMPOOL_ERR("fail to open slave of pseudo-terminal: %s\n",
+			    strerror(errno));
+		return -EFAULT;
+	}
+
+	if (tcgetattr(emu->slave, &config) < 0) {
+		MEMPOOL_ERR("fail to get current configuration: %s\n",
+			    strerror(errno));
+		return -EFAULT;
+	}
+
+	cfmakeraw(&config);
+
+	if (tcsetattr(emu->slave, TCSANOW, &config) < 0) {
+		MEMPOOL_ERR("fail to set configuration of communication: %s\n",
+			    strerror(errno));
+		return -EFAULT;
+	}
+
+	if (env->uart_channel.name) {
+		/* stale link of previous run is replaced */
+		if (lstat(env->uart_channel.name, &st) == 0 &&
+		    S_ISLNK(st.st_mode))
+			unlink(env->uart_channel.name);
+
+		if (symlink(emu->slave_name, env->uart_channel.name) < 0) {
+			MEMPOOL_ERR("fail to create link %s: %s\n",
+				    env->uart_channel.name, strerror(errno));
+			return -EFAULT;
+		}
+	}
+
+	return 0;
+}
+
+static
+void mempool_emu_close_pty(struct mempool_emulator *emu)
+{
+	struct mempool_test_environment *env = emu->env;
+
+	if (env->uart_channel.name)
+		unlink(env->uart_channel.name);
+
+	if (emu->slave >= 0)
+		close(emu->slave);
+
+	if (emu->master >= 0)
+		close(emu->master);
+}
+
+/*
+ * Write @iovcnt buffers into pseudo-terminal. Answer is dropped
+ * if nobody reads the line.
+ */
+static
+int mempool_emu_writev(struct mempool_emulator *emu,
+		       struct iovec *iov, int iovcnt)
+{
+	struct pollfd pfd;
+	ssize_t written;
+	int res;
+
+	while (iovcnt > 0) {
+		written = writev(emu->master, iov, iovcnt);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+
+			if (errno != EAGAIN) {
+				MEMPOOL_ERR("fail to write answer: %s\n",
+					    strerror(errno));
+				return -EIO;
+			}
+
+			pfd.fd = emu->master;
+			pfd.events = POLLOUT;
+
+			res = poll(&pfd, 1, MEMPOOL_EMU_WRITE_TIMEOUT);
+			if (res == 0) {
+				MEMPOOL_ERR("answer is not read by host\n");
+				return -ETIMEDOUT;
+			} else if (res < 0 && errno != EINTR) {
+				return -EIO;
+			}
+
+			continue;
+		}
+
+		while (iovcnt > 0 && written >= iov->iov_len) {
+			written -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if (iovcnt > 0) {
+			iov->iov_base = (unsigned char *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+
+	return 0;
+}
+
+static
+int mempool_emu_send_answer(struct mempool_emulator *emu,
+			    unsigned char result,
+			    const unsigned char *data, unsigned short length)
+{
+	struct mempool_uart_answer answer = {0};
+	struct iovec iov[2];
+
+	answer.magic = MEMPOOL_FPGA2PC_MAGIC;
+	answer.result = result;
+	answer.length = length;
+	answer.crc32 = length > 0 ? mempool_emu_checksum(data, length) : 0;
+
+	iov[0].iov_base = &answer;
+	iov[0].iov_len = sizeof(struct mempool_uart_answer);
+	iov[1].iov_base = (void *)data;
+	iov[1].iov_len = length;
+
+	return mempool_emu_writev(emu, iov, length > 0 ? 2 : 1);
+}
+
+static
+int mempool_emu_send_ack(struct mempool_emulator *emu, unsigned char result,
+			 unsigned short sequence, unsigned int checksum)
+{
+	struct mempool_uart_ack ack = {0};
+	struct iovec iov;
+
+	ack.magic = MEMPOOL_FPGA2PC_MAGIC;
+	ack.result = result;
+	ack.sequence = sequence;
+	ack.crc32 = checksum;
+
+	iov.iov_base = &ack;
+	iov.iov_len = sizeof(struct mempool_uart_ack);
+
+	return mempool_emu_writev(emu, &iov, 1);
+}
+
+/*
+ * Send pages [@address, @address + @count) of result. The page
+ * that is shorter than frame is the last one.
+ */
+static
+int mempool_emu_send_result_pages(struct mempool_emulator *emu,
+				  unsigned long long address,
+				  unsigned short count)
+{
+	struct mempool_uart_page page;
+	unsigned char damaged[MEMPOOL_PAGE_SIZE];
+	struct iovec iov[2];
+	size_t frame = mempool_emu_frame_size(address);
+	unsigned long long last;
+	size_t offset;
+	size_t length;
+	int err;
+
+	if (frame == 0)
+		return 0;
+
+	address &= MEMPOOL_FRAME_ADDRESS_MASK;
+	last = address + count;
+
+	for (; address < last; address++) {
+		memset(&page, 0, sizeof(struct mempool_uart_page));
+		page.magic = MEMPOOL_FPGA2PC_MAGIC;
+		page.address = address;
+
+		offset = address * frame;
+		length = 0;
+
+		if (!emu->result) {
+			page.result = 1;
+		} else if (offset < emu->result_size) {
+			length = emu->result_size - offset;
+			if (length > frame)
+				length = frame;
+		}
+
+		page.length = length;
+
+		iov[0].iov_base = &page;
+		iov[0].iov_len = sizeof(struct mempool_uart_page);
+		iov[1].iov_base = emu->result + offset;
+		iov[1].iov_len = length;
+
+		if (length > 0) {
+			page.crc32 = mempool_emu_checksum(emu->result + offset,
+							  length);
+
+			if (mempool_emu_inject_error(emu)) {
+				memcpy(damaged, emu->result + offset, length);
+				damaged[rand_r(&emu->random) % length] ^= 0xFF;
+				iov[1].iov_base = damaged;
+			}
+		}
+
+		err = mempool_emu_writev(emu, iov, length > 0 ? 2 : 1);
+		if (err)
+			return err;
+
+		emu->stats.result_pages++;
+
+		if (length < frame)
+			break;
+	}
+
+	return 0;
+}
+
+static
+int mempool_emu_read_result(struct mempool_emulator *emu,
+			    struct mempool_uart_preamble *preamble)
+{
+	size_t length;
+
+	MEMPOOL_DBG(emu->env->show_debug,
+		    "read result: address %llu, length %u\n",
+		    preamble->address, preamble->length);
+
+	if (preamble->operation_type & MEMPOOL_FRAME_ACK_FLAG) {
+		return mempool_emu_send_result_pages(emu, preamble->address,
+						     preamble->length);
+	}
+
+	if (!emu->result)
+		return mempool_emu_send_answer(emu, 1, NULL, 0);
+
+	/* length of answer is limited by its header */
+	length = emu->result_size;
+	if (length > USHRT_MAX)
+		length = USHRT_MAX;
+
+	emu->stats.result_pages += (length + MEMPOOL_PAGE_SIZE - 1) /
+							MEMPOOL_PAGE_SIZE;
+
+	return mempool_emu_send_answer(emu, 0, emu->result, length);
+}
+
+/*
+ * Store payload of frame. It returns MEMPOOL_FALSE if frame
+ * is outside of emulated memory.
+ */
+static
+int mempool_emu_store_frame(struct mempool_emulator *emu,
+			    unsigned char operation,
+			    unsigned long long address,
+			    const unsigned char *payload,
+			    unsigned short length)
+{
+	size_t frame = mempool_emu_frame_size(address);
+	unsigned long long offset;
+
+	if (frame == 0 || length > frame)
+		return MEMPOOL_FALSE;
+
+	address &= MEMPOOL_FRAME_ADDRESS_MASK;
+
+	switch (operation) {
+	case MEMPOOL_WRITE_INPUT_DATA:
+		if (address < MEMPOOL_INPUT_DATA_BASE_ADDRESS)
+			return MEMPOOL_FALSE;
+
+		offset = (address - MEMPOOL_INPUT_DATA_BASE_ADDRESS) * frame;
+		if (offset + length > emu->memory_pages * MEMPOOL_PAGE_SIZE)
+			return MEMPOOL_FALSE;
+
+		memcpy(emu->memory + offset, payload, length);
+		break;
+
+	case MEMPOOL_SEND_MANAGEMENT_PAGE:
+		if (address < MEMPOOL_MANAGEMENT_PAGE_BASE_ADDRESS)
+			return MEMPOOL_FALSE;
+
+		offset = (address - MEMPOOL_MANAGEMENT_PAGE_BASE_ADDRESS) *
+									frame;
+		if (offset + length > MEMPOOL_EMU_MANAGEMENT_SIZE)
+			return MEMPOOL_FALSE;
+
+		memcpy(emu->management + offset, payload, length);
+
+		if (emu->management_bytes < offset + length)
+			emu->management_bytes = offset + length;
+		break;
+
+	default:
+		return MEMPOOL_FALSE;
+	}
+
+	return MEMPOOL_TRUE;
+}
+
+/*
+ * Process frame of input data or management page: preamble,
+ * payload and footer. Frames with acknowledgement flag are
+ * acknowledged at once, other ones are answered when the line
+ * becomes silent.
+ */
+static
+int mempool_emu_receive_frame(struct mempool_emulator *emu,
+			      struct mempool_uart_preamble *preamble,
+			      const unsigned char *payload,
+			      struct mempool_uart_footer *footer)
+{
+	unsigned char operation = preamble->operation_type &
+						~MEMPOOL_FRAME_ACK_FLAG;
+	int pending = MEMPOOL_EMU_MANAGEMENT_TRANSFER;
+	unsigned int checksum;
+	int valid;
+
+	emu->stats.frames++;
+
+	/* acknowledged input frames are not answered */
+	if (operation == MEMPOOL_WRITE_INPUT_DATA) {
+		pending = preamble->operation_type & MEMPOOL_FRAME_ACK_FLAG ?
+				MEMPOOL_EMU_NO_TRANSFER :
+				MEMPOOL_EMU_INPUT_TRANSFER;
+	}
+
+	if (emu->pending != pending) {
+		emu->pending = pending;
+		emu->transfer_err = MEMPOOL_FALSE;
+
+		if (pending == MEMPOOL_EMU_MANAGEMENT_TRANSFER)
+			emu->management_bytes = 0;
+	}
+
+	checksum = mempool_emu_checksum(payload, preamble->length);
+
+	valid = footer->magic == MEMPOOL_PC2FPGA_MAGIC &&
+		footer->operation_type == preamble->operation_type &&
+		footer->crc32 == preamble->crc32 &&
+		checksum == preamble->crc32;
+
+	/* only input data is damaged, management is small */
+	if (valid && operation == MEMPOOL_WRITE_INPUT_DATA &&
+	    mempool_emu_inject_error(emu))
+		valid = MEMPOOL_FALSE;
+
+	if (valid) {
+		valid = mempool_emu_store_frame(emu, operation,
+						preamble->address,
+						payload, preamble->length);
+	}
+
+	if (valid) {
+		emu->stats.bytes += preamble->length;
+	} else {
+		emu->stats.rejected++;
+
+		MEMPOOL_DBG(emu->env->show_debug,
+			    "frame is rejected: address %#llx, "
+			    "length %u, sequence %u\n",
+			    preamble->address, preamble->length,
+			    footer->sequence);
+	}
+
+	if (!(preamble->operation_type & MEMPOOL_FRAME_ACK_FLAG)) {
+		if (!valid)
+			emu->transfer_err = MEMPOOL_TRUE;
+
+		return 0;
+	}
+
+	return mempool_emu_send_ack(emu,
+				    valid ? MEMPOOL_FRAME_ACK :
+					    MEMPOOL_FRAME_NAK,
+				    footer->sequence, checksum);
+}
+
+static inline
+void mempool_emu_rx_consume(struct mempool_emulator *emu, size_t bytes)
+{
+	emu->rx_head += bytes;
+	emu->rx_count -= bytes;
+
+	if (emu->rx_count == 0)
+		emu->rx_head = 0;
+}
+
+/*
+ * Process buffered frames. It returns -EAGAIN if the rest of
+ * frame is not received yet.
+ */
+static
+int mempool_emu_process_frame(struct mempool_emulator *emu)
+{
+	struct mempool_uart_preamble preamble;
+	struct mempool_uart_footer footer;
+	unsigned char *head;
+	unsigned char *magic;
+	unsigned char operation;
+	size_t frame_size;
+
+	head = emu->rx + emu->rx_head;
+
+	/* bytes before preamble's magic are skipped */
+	magic = memchr(head, MEMPOOL_PC2FPGA_MAGIC, emu->rx_count);
+	if (!magic) {
+		mempool_emu_rx_consume(emu, emu->rx_count);
+		return -EAGAIN;
+	}
+
+	mempool_emu_rx_consume(emu, magic - head);
+	head = magic;
+
+	if (emu->rx_count < sizeof(struct mempool_uart_preamble))
+		return -EAGAIN;
+
+	memcpy(&preamble, head, sizeof(struct mempool_uart_preamble));
+	operation = preamble.operation_type & ~MEMPOOL_FRAME_ACK_FLAG;
+
+	switch (operation) {
+	case MEMPOOL_READ_RESULT:
+		mempool_emu_rx_consume(emu, sizeof(struct mempool_uart_preamble));
+		return mempool_emu_read_result(emu, &preamble);
+
+	case MEMPOOL_WRITE_INPUT_DATA:
+	case MEMPOOL_SEND_MANAGEMENT_PAGE:
+		if (preamble.length <= MEMPOOL_PAGE_SIZE)
+			break;
+		/* fall through */
+
+	default:
+		/* byte looks like magic but it is not a preamble */
+		mempool_emu_rx_consume(emu, 1);
+		return 0;
+	}
+
+	frame_size = sizeof(struct mempool_uart_preamble) + preamble.length +
+			sizeof(struct mempool_uart_footer);
+
+	if (emu->rx_count < frame_size)
+		return -EAGAIN;
+
+	memcpy(&footer, head + frame_size - sizeof(struct mempool_uart_footer),
+		sizeof(struct mempool_uart_footer));
+
+	mempool_emu_rx_consume(emu, frame_size);
+
+	return mempool_emu_receive_frame(emu, &preamble,
+				head + sizeof(struct mempool_uart_preamble),
+				&footer);
+}
+
+/*
+ * Line is silent: transfer without acknowledgements is finished
+ * and management pages are executed.
+ */
+static
+int mempool_emu_finish_transfer(struct mempool_emulator *emu)
+{
+	int pending = emu->pending;
+	int err;
+
+	if (emu->rx_count > 0) {
+		MEMPOOL_DBG(emu->env->show_debug,
+			    "incomplete frame is dropped: bytes %zu\n",
+			    emu->rx_count);
+		emu->rx_head = 0;
+		emu->rx_count = 0;
+	}
+
+	emu->pending = MEMPOOL_EMU_NO_TRANSFER;
+
+	switch (pending) {
+	case MEMPOOL_EMU_INPUT_TRANSFER:
+		return mempool_emu_send_answer(emu, emu->transfer_err ? 1 : 0,
+					       NULL, 0);
+
+	case MEMPOOL_EMU_MANAGEMENT_TRANSFER:
+		if (emu->transfer_err)
+			return mempool_emu_send_answer(emu, 1, NULL, 0);
+
+		err = mempool_emu_execute(emu);
+		if (err) {
+			MEMPOOL_ERR("fail to execute management pages: "
+				    "err %d\n", err);
+			return mempool_emu_send_answer(emu, 1, NULL, 0);
+		}
+
+		return mempool_emu_send_answer(emu, 0, emu->management,
+					       emu->management_bytes);
+	}
+
+	return 0;
+}
+
+static
+int mempool_emu_run(struct mempool_emulator *emu)
+{
+	struct pollfd pfd;
+	ssize_t bytes;
+	int timeout;
+	int res;
+	int err;
+
+	while (!stop_emulation) {
+		pfd.fd = emu->master;
+		pfd.events = POLLIN;
+
+		timeout = emu->pending != MEMPOOL_EMU_NO_TRANSFER ?
+					MEMPOOL_EMU_IDLE_TIMEOUT : -1;
+
+		res = poll(&pfd, 1, timeout);
+		if (res < 0) {
+			if (errno == EINTR)
+				continue;
+
+			MEMPOOL_ERR("fail to poll pseudo-terminal: %s\n",
+				    strerror(errno));
+			return -EIO;
+		} else if (res == 0) {
+			err = mempool_emu_finish_transfer(emu);
+			if (err)
+				MEMPOOL_ERR("fail to answer: err %d\n", err);
+			continue;
+		}
+
+		if (emu->rx_head > 0) {
+			memmove(emu->rx, emu->rx + emu->rx_head, emu->rx_count);
+			emu->rx_head = 0;
+		}
+
+		bytes = read(emu->master, emu->rx + emu->rx_count,
+			     sizeof(emu->rx) - emu->rx_count);
+		if (bytes < 0) {
+			if (errno == EINTR || errno == EAGAIN || errno == EIO)
+				continue;
+
+			MEMPOOL_ERR("fail to read pseudo-terminal: %s\n",
+				    strerror(errno));
+			return -EIO;
+		}
+
+		emu->rx_count += bytes;
+
+		do {
+			err = mempool_emu_process_frame(emu);
+			if (err && err != -EAGAIN)
+				MEMPOOL_ERR("fail to process frame: err %d\n", err);
+		} while (err != -EAGAIN && emu->rx_count > 0);
+	}
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct mempool_test_environment environment;
+	struct mempool_emu_options opts;
+	struct mempool_emulator *emu;
+	struct sigaction action;
+	int err = 0;
+
+	memset(&environment, 0, sizeof(environment));
+
+	environment.uart_channel.fd = -1;
+	environment.show_debug = MEMPOOL_FALSE;
+
+	memset(&opts, 0, sizeof(opts));
+
+	environment.link.window = MEMPOOL_DEFAULT_LINK_WINDOW;
+	environment.link.frame = MEMPOOL_PAGE_SIZE;
+
+	opts.mode = MEMPOOL_EMU_LINK_MODE;
+	opts.memory_size = MEMPOOL_EMU_DEFAULT_MEMORY_SIZE;
+	opts.error_rate = 0;
+	opts.timing.baud = MEMPOOL_UART_BAUD_RATE;
+	opts.timing.latency = MEMPOOL_EMU_DEFAULT_LATENCY;
+	opts.timing.throughput = MEMPOOL_EMU_DEFAULT_THROUGHPUT;
+
+	parse_options(argc, argv, &environment, &opts);
+
+	MEMPOOL_DBG(environment.show_debug,
+		    "options have been parsed\n");
+
+	switch (opts.mode) {
+	case MEMPOOL_EMU_TIMING_MODE:
+		err = mempool_emu_timing_model(&environment, &opts);
+		exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
+
+	case MEMPOOL_EMU_CALIBRATION_MODE:
+		err = mempool_emu_calibrate(&environment, &opts);
+		exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	emu = calloc(1, sizeof(struct mempool_emulator));
+	if (!emu) {
+		MEMPOOL_ERR("fail to allocate emulator: %s\n",
+			    strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	emu->env = &environment;
+	emu->opts = &opts;
+	emu->master = -1;
+	emu->slave = -1;
+	emu->random = (unsigned int)time(NULL) ^ (unsigned int)getpid();
+	emu->memory_pages = opts.memory_size / MEMPOOL_PAGE_SIZE;
+
+	emu->memory = calloc(emu->memory_pages, MEMPOOL_PAGE_SIZE);
+	if (!emu->memory) {
+		err = -ENOMEM;
+		MEMPOOL_ERR("fail to allocate emulated memory: "
+			    "size %llu, %s\n",
+			    opts.memory_size, strerror(errno));
+		goto free_emulator;
+	}
+
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = mempool_emu_signal_handler;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	err = mempool_emu_open_pty(emu);
+	if (err)
+		goto close_pty;
+
+	MEMPOOL_INFO("UART device: %s\n",
+		     environment.uart_channel.name ?
+			environment.uart_channel.name : emu->slave_name);
+	MEMPOOL_INFO("Memory: size %llu, error rate %d%%\n",
+		     emu->memory_pages * MEMPOOL_PAGE_SIZE, opts.error_rate);
+	fflush(stdout);
+
+	err = mempool_emu_run(emu);
+
+	MEMPOOL_INFO("Frames: received %llu, rejected %llu, bytes %llu\n",
+		     emu->stats.frames, emu->stats.rejected, emu->stats.bytes);
+	MEMPOOL_INFO("Jobs: executed %llu, result pages %llu\n",
+		     emu->stats.jobs, emu->stats.result_pages);
+
+close_pty:
+	mempool_emu_close_pty(emu);
+
+	free(emu->result);
+	free(emu->memory);
+
+free_emulator:
+	free(emu);
+
+	exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
+}
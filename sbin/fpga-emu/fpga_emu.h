@@ -0,0 +1,243 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/fpga_emu.h - FPGA emulator declarations.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#ifndef _FPGA_EMU_TOOL_H
+#define _FPGA_EMU_TOOL_H
+
+#ifdef fpgaemu_fmt
+#undef fpgaemu_fmt
+#endif
+
+#include "version.h"
+
+#define fpgaemu_fmt(fmt) "fpga-emu: " MEMPOOL_TOOLS_VERSION ": " fmt
+
+#include <pthread.h>
+#include <limits.h>
+
+#include "memory_pool_constants.h"
+#include "memory_pool_tools.h"
+#include "uart_declarations.h"
+#include "metadata_page.h"
+
+#define FPGA_EMU_INFO(show, fmt, ...) \
+	do { \
+		if (show) { \
+			fprintf(stdout, fpgaemu_fmt(fmt), ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+/* size of emulated memory of input data */
+#define MEMPOOL_EMU_DEFAULT_MEMORY_SIZE		(256ULL * 1024 * 1024)
+
+/* management pages are returned by one answer */
+#define MEMPOOL_EMU_MANAGEMENT_SIZE		(64 * 1024 - MEMPOOL_PAGE_SIZE)
+#define MEMPOOL_EMU_MAX_CORES			(MEMPOOL_EMU_MANAGEMENT_SIZE / \
+				sizeof(struct mempool_metadata_management))
+
+/*
+ * Transfer without acknowledgements is finished when the line
+ * has been silent for this number of milliseconds.
+ */
+#define MEMPOOL_EMU_IDLE_TIMEOUT		(50)
+
+/* answer is dropped if host does not read it during this time (ms) */
+#define MEMPOOL_EMU_WRITE_TIMEOUT		(5000)
+
+/* size of receive buffer of pseudo-terminal */
+#define MEMPOOL_EMU_RX_BUFFER_SIZE		(64 * 1024)
+
+/* default turnaround of request and answer in microseconds */
+#define MEMPOOL_EMU_DEFAULT_LATENCY		(1000)
+
+/* default throughput of FPGA core in bytes per second */
+#define MEMPOOL_EMU_DEFAULT_THROUGHPUT		(100ULL * 1024 * 1024)
+
+/* mode of emulator */
+enum {
+	MEMPOOL_EMU_LINK_MODE,
+	MEMPOOL_EMU_TIMING_MODE,
+	MEMPOOL_EMU_CALIBRATION_MODE,
+};
+
+/* phases of job */
+enum {
+	MEMPOOL_EMU_UPLOAD_PHASE,
+	MEMPOOL_EMU_EXECUTE_PHASE,
+	MEMPOOL_EMU_READBACK_PHASE,
+	MEMPOOL_EMU_PHASE_MAX
+};
+
+/* state of FPGA core */
+enum {
+	MEMPOOL_EMU_CORE_IDLE		= 0x0,
+	MEMPOOL_EMU_CORE_DONE		= 0x1,
+};
+
+/* transfer that waits for the silent line */
+enum {
+	MEMPOOL_EMU_NO_TRANSFER,
+	MEMPOOL_EMU_INPUT_TRANSFER,
+	MEMPOOL_EMU_MANAGEMENT_TRANSFER,
+};
+
+/*
+ * struct mempool_emu_timing - parameters of timing model
+ * @baud: baud rate of UART line
+ * @latency: turnaround of request and answer in microseconds
+ * @throughput: bytes per second that one FPGA core processes
+ */
+struct mempool_emu_timing {
+	unsigned long long baud;
+	unsigned long long latency;
+	unsigned long long throughput;
+};
+
+/*
+ * struct mempool_emu_phase - phase of job in timing model
+ * @bytes: number of bytes on the line
+ * @exchanges: number of requests that wait for answer
+ * @compute: time of execution by FPGA cores in seconds
+ * @seconds: time of phase in seconds
+ */
+struct mempool_emu_phase {
+	unsigned long long bytes;
+	unsigned long long exchanges;
+	double compute;
+	double seconds;
+};
+
+/*
+ * struct mempool_emu_options - options of emulator
+ * @mode: mode of emulator (link, timing model or calibration)
+ * @memory_size: size of emulated memory of input data in bytes
+ * @error_rate: percent of damaged frames and pages of result
+ * @timing: parameters of timing model
+ * @log_name: fpga-test log of calibration
+ */
+struct mempool_emu_options {
+	int mode;
+	unsigned long long memory_size;
+	int error_rate;
+	struct mempool_emu_timing timing;
+	const char *log_name;
+};
+
+/*
+ * struct mempool_emu_stats - statistics of emulator
+ * @frames: number of received frames
+ * @rejected: number of rejected frames
+ * @bytes: number of received payload bytes
+ * @jobs: number of executed jobs
+ * @result_pages: number of sent pages of result
+ */
+struct mempool_emu_stats {
+	unsigned long long frames;
+	unsigned long long rejected;
+	unsigned long long bytes;
+	unsigned long long jobs;
+	unsigned long long result_pages;
+};
+
+/*
+ * struct mempool_emulator - emulated FPGA board
+ * @env: emulator's environment
+ * @opts: options of emulator
+ * @master: master side of pseudo-terminal
+ * @slave: slave side of pseudo-terminal (kept opened between sessions)
+ * @slave_name: name of slave side
+ * @memory: emulated memory of input data
+ * @memory_pages: number of pages of emulated memory
+ * @management: management pages
+ * @management_bytes: number of received bytes of management pages
+ * @result: memory of result
+ * @result_size: size of result in bytes
+ * @rx: receive buffer
+ * @rx_head: offset of the first buffered byte
+ * @rx_count: number of buffered bytes
+ * @pending: transfer that waits for the silent line
+ * @transfer_err: frame of transfer without acknowledgements is damaged
+ * @random: state of pseudo-random generator of errors
+ * @stats: statistics
+ */
+struct mempool_emulator {
+	struct mempool_test_environment *env;
+	struct mempool_emu_options *opts;
+	int master;
+	int slave;
+	char slave_name[PATH_MAX];
+	unsigned char *memory;
+	unsigned long long memory_pages;
+	unsigned char management[MEMPOOL_EMU_MANAGEMENT_SIZE];
+	size_t management_bytes;
+	unsigned char *result;
+	size_t result_size;
+	unsigned char rx[MEMPOOL_EMU_RX_BUFFER_SIZE];
+	size_t rx_head;
+	size_t rx_count;
+	int pending;
+	int transfer_err;
+	unsigned int random;
+	struct mempool_emu_stats stats;
+};
+
+/*
+ * struct mempool_emu_core - FPGA core executing request
+ * @id: core ID
+ * @item: management structure of core
+ * @input: input portion
+ * @output: output slot of portion
+ */
+struct mempool_emu_core {
+	int id;
+	struct mempool_metadata_management *item;
+	const unsigned char *input;
+	unsigned char *output;
+};
+
+/*
+ * struct mempool_emu_job - cores executed by worker threads
+ * @emu: emulator
+ * @cores: cores of job
+ * @count: number of cores
+ * @next_core: index of the next core to execute
+ * @lock: lock of the next core
+ */
+struct mempool_emu_job {
+	struct mempool_emulator *emu;
+	struct mempool_emu_core *cores;
+	int count;
+	int next_core;
+	pthread_mutex_t lock;
+};
+
+/* options.c */
+void print_version(void);
+void print_usage(void);
+void parse_options(int argc, char *argv[],
+		   struct mempool_test_environment *env,
+		   struct mempool_emu_options *opts);
+
+/* kernels.c */
+int mempool_emu_execute(struct mempool_emulator *emu);
+
+/* timing.c */
+int mempool_emu_timing_model(struct mempool_test_environment *env,
+			     struct mempool_emu_options *opts);
+int mempool_emu_calibrate(struct mempool_test_environment *env,
+			  struct mempool_emu_options *opts);
+
+#endif /* _FPGA_EMU_TOOL_H */
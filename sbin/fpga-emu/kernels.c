@@ -0,0 +1,655 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/kernels.c - kernels of emulated FPGA cores.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "fpga_emu.h"
+
+/*
+ * struct mempool_emu_sort_item - record of portion to be sorted
+ * @key: key of record
+ * @index: index of record in portion
+ */
+struct mempool_emu_sort_item {
+	unsigned long long key;
+	unsigned int index;
+};
+
+/*
+ * struct mempool_emu_cursor - position in sorted output of core
+ * @key: key of the current record
+ * @core: core index
+ * @pos: index of the current record
+ */
+struct mempool_emu_cursor {
+	unsigned long long key;
+	int core;
+	unsigned int pos;
+};
+
+static inline
+int mempool_emu_is_bit_set(unsigned long long mask, int bit, int capacity)
+{
+	int check_bit = capacity - bit - 1;
+
+	return (mask >> check_bit) & 1;
+}
+
+static inline
+size_t mempool_emu_record_size(struct mempool_metadata_request *request)
+{
+	return (size_t)request->portion.type.granularity *
+					request->portion.type.capacity;
+}
+
+static inline
+size_t mempool_emu_portion_size(struct mempool_metadata_request *request)
+{
+	return mempool_emu_record_size(request) * request->portion.capacity;
+}
+
+/*
+ * Key is made of the first 8 bytes of key items.
+ */
+static
+unsigned long long mempool_emu_key(struct mempool_metadata_request *request,
+				   const unsigned char *record)
+{
+	int granularity = request->portion.type.granularity;
+	int capacity = request->portion.type.capacity;
+	unsigned long long key = 0;
+	size_t written = 0;
+	size_t bytes;
+	int i;
+
+	for (i = 0; i < capacity && written < sizeof(key); i++) {
+		if (!mempool_emu_is_bit_set(request->key.mask, i, capacity))
+			continue;
+
+		bytes = sizeof(key) - written;
+		if (bytes > granularity)
+			bytes = granularity;
+
+		memcpy((unsigned char *)&key + written,
+			record + (size_t)i * granularity, bytes);
+		written += bytes;
+	}
+
+	return key;
+}
+
+static
+size_t mempool_emu_copy_items(struct mempool_metadata_request *request,
+			      unsigned long long mask,
+			      const unsigned char *record,
+			      unsigned char *output)
+{
+	int granularity = request->portion.type.granularity;
+	int capacity = request->portion.type.capacity;
+	size_t written = 0;
+	int i;
+
+	for (i = 0; i < capacity; i++) {
+		if (!mempool_emu_is_bit_set(mask, i, capacity))
+			continue;
+
+		memcpy(output + written, record + (size_t)i * granularity,
+			granularity);
+		written += granularity;
+	}
+
+	return written;
+}
+
+/*
+ * KEY-VALUE and SELECT output: key items are followed by value items.
+ */
+static
+size_t mempool_emu_key_value(struct mempool_metadata_request *request,
+			     const unsigned char *record,
+			     unsigned char *output)
+{
+	size_t written;
+
+	written = mempool_emu_copy_items(request, request->key.mask,
+					 record, output);
+	written += mempool_emu_copy_items(request, request->value.mask,
+					  record, output + written);
+
+	return written;
+}
+
+static
+unsigned int mempool_emu_key_value_kernel(struct mempool_emu_core *core,
+					  unsigned int start, unsigned int end)
+{
+	struct mempool_metadata_request *request = &core->item->request;
+	size_t record_size = mempool_emu_record_size(request);
+	size_t written = 0;
+	unsigned int i;
+
+	for (i = start; i < end; i++) {
+		written += mempool_emu_key_value(request,
+						 core->input + i * record_size,
+						 core->output + written);
+	}
+
+	return end - start;
+}
+
+static
+unsigned int mempool_emu_select_kernel(struct mempool_emu_core *core,
+				       unsigned int start, unsigned int end)
+{
+	struct mempool_metadata_request *request = &core->item->request;
+	size_t record_size = mempool_emu_record_size(request);
+	const unsigned char *record;
+	unsigned long long key;
+	size_t written = 0;
+	unsigned int records = 0;
+	unsigned int i;
+
+	for (i = start; i < end; i++) {
+		record = core->input + i * record_size;
+		key = mempool_emu_key(request, record);
+
+		if (request->condition.min <= key &&
+		    key < request->condition.max) {
+			written += mempool_emu_key_value(request, record,
+							 core->output + written);
+			records++;
+		}
+	}
+
+	return records;
+}
+
+/*
+ * TOTAL adds the first byte of every value item.
+ */
+static
+unsigned int mempool_emu_total_kernel(struct mempool_emu_core *core,
+				      unsigned int start, unsigned int end)
+{
+	struct mempool_metadata_request *request = &core->item->request;
+	int granularity = request->portion.type.granularity;
+	int capacity = request->portion.type.capacity;
+	size_t record_size = mempool_emu_record_size(request);
+	unsigned long long sums[sizeof(unsigned long long) *
+					MEMPOOL_BITS_PER_BYTE] = {0};
+	const unsigned char *record;
+	unsigned int i;
+	int j;
+
+	for (i = start; i < end; i++) {
+		record = core->input + i * record_size;
+
+		for (j = 0; j < capacity; j++) {
+			if (mempool_emu_is_bit_set(request->value.mask,
+						   j, capacity))
+				sums[j] += record[(size_t)j * granularity];
+		}
+	}
+
+	memcpy(core->output, sums, capacity * sizeof(unsigned long long));
+
+	return 1;
+}
+
+static
+int mempool_emu_compare_items(const void *item1, const void *item2)
+{
+	const struct mempool_emu_sort_item *sort1 = item1;
+	const struct mempool_emu_sort_item *sort2 = item2;
+
+	if (sort1->key != sort2->key)
+		return sort1->key < sort2->key ? -1 : 1;
+
+	if (sort1->index != sort2->index)
+		return sort1->index < sort2->index ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * SORT orders records of portion. Portions are merged
+ * when all cores have finished.
+ */
+static
+int mempool_emu_sort_kernel(struct mempool_emu_core *core,
+			    unsigned int start, unsigned int end,
+			    unsigned int *records)
+{
+	struct mempool_metadata_request *request = &core->item->request;
+	size_t record_size = mempool_emu_record_size(request);
+	struct mempool_emu_sort_item *items;
+	unsigned int count = end - start;
+	unsigned int i;
+
+	*records = count;
+
+	if (count == 0)
+		return 0;
+
+	items = malloc((size_t)count * sizeof(struct mempool_emu_sort_item));
+	if (!items)
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		items[i].key = mempool_emu_key(request, core->input +
+						(size_t)(start + i) *
+							record_size);
+		items[i].index = start + i;
+	}
+
+	qsort(items, count, sizeof(struct mempool_emu_sort_item),
+		mempool_emu_compare_items);
+
+	for (i = 0; i < count; i++) {
+		memcpy(core->output + (size_t)i * record_size,
+			core->input + (size_t)items[i].index * record_size,
+			record_size);
+	}
+
+	free(items);
+
+	return 0;
+}
+
+static
+int mempool_emu_check_request(struct mempool_emulator *emu,
+			      struct mempool_emu_core *core,
+			      unsigned long long offset)
+{
+	struct mempool_metadata_request *request = &core->item->request;
+	unsigned long long portion_size;
+
+	if (!check_granularity(request->portion.type.granularity))
+		return -EINVAL;
+
+	if (request->portion.type.capacity <= 0 ||
+	    request->portion.type.capacity >
+		(int)(sizeof(unsigned long long) * MEMPOOL_BITS_PER_BYTE))
+		return -EINVAL;
+
+	if (request->portion.count > request->portion.capacity ||
+	    request->algorithm.start > request->algorithm.end)
+		return -ERANGE;
+
+	portion_size = mempool_emu_portion_size(request);
+	if (offset + portion_size >
+			emu->memory_pages * MEMPOOL_PAGE_SIZE)
+		return -E2BIG;
+
+	if (request->algorithm.code == MEMPOOL_TOTAL_ALGORITHM &&
+	    portion_size < request->portion.type.capacity *
+					sizeof(unsigned long long))
+		return -ENOSPC;
+
+	return 0;
+}
+
+static
+void mempool_emu_execute_core(struct mempool_emu_core *core)
+{
+	struct mempool_metadata_request *request = &core->item->request;
+	struct mempool_metadata_result *result = &core->item->result;
+	unsigned int start = request->algorithm.start;
+	unsigned int end = request->algorithm.end;
+	unsigned int count = request->portion.count;
+	unsigned int records = 0;
+	int err = 0;
+
+	/* every portion is full by default */
+	if (count == 0)
+		count = request->portion.capacity;
+
+	if (end > count)
+		end = count;
+
+	if (start > end)
+		start = end;
+
+	switch (request->algorithm.code) {
+	case MEMPOOL_KEY_VALUE_ALGORITHM:
+		records = mempool_emu_key_value_kernel(core, start, end);
+		break;
+
+	case MEMPOOL_SORT_ALGORITHM:
+		err = mempool_emu_sort_kernel(core, start, end, &records);
+		break;
+
+	case MEMPOOL_SELECT_ALGORITHM:
+		records = mempool_emu_select_kernel(core, start, end);
+		break;
+
+	case MEMPOOL_TOTAL_ALGORITHM:
+		records = mempool_emu_total_kernel(core, start, end);
+		break;
+
+	default:
+		err = -EOPNOTSUPP;
+		break;
+	}
+
+	result->err = err;
+	if (err)
+		return;
+
+	result->state = MEMPOOL_EMU_CORE_DONE;
+	result->portion.type = request->portion.type;
+	result->portion.count = records;
+	result->portion.capacity = request->portion.capacity;
+}
+
+static
+void *mempool_emu_worker_func(void *arg)
+{
+	struct mempool_emu_job *job = arg;
+	int index;
+
+	while (MEMPOOL_TRUE) {
+		pthread_mutex_lock(&job->lock);
+		index = job->next_core++;
+		pthread_mutex_unlock(&job->lock);
+
+		if (index >= job->count)
+			break;
+
+		if (job->cores[index].item->result.err)
+			continue;
+
+		mempool_emu_execute_core(&job->cores[index]);
+	}
+
+	return NULL;
+}
+
+static inline
+int mempool_emu_cursor_less(struct mempool_emu_cursor *cursor1,
+			    struct mempool_emu_cursor *cursor2)
+{
+	if (cursor1->key != cursor2->key)
+		return cursor1->key < cursor2->key;
+
+	return cursor1->core < cursor2->core;
+}
+
+static
+void mempool_emu_sift_down(struct mempool_emu_cursor *heap, int count,
+			   int index)
+{
+	struct mempool_emu_cursor tmp;
+	int child;
+
+	while ((child = 2 * index + 1) < count) {
+		if (child + 1 < count &&
+		    mempool_emu_cursor_less(&heap[child + 1], &heap[child]))
+			child++;
+
+		if (!mempool_emu_cursor_less(&heap[child], &heap[index]))
+			break;
+
+		tmp = heap[index];
+		heap[index] = heap[child];
+		heap[child] = tmp;
+		index = child;
+	}
+}
+
+/*
+ * Sorted portions of SORT cores are merged by k-way merge, so
+ * the whole result is ordered and every portion keeps the number
+ * of its records.
+ */
+static
+int mempool_emu_merge_sorted(struct mempool_emu_job *job)
+{
+	struct mempool_emu_cursor *heap;
+	struct mempool_metadata_request *request;
+	struct mempool_emu_core *core;
+	unsigned char *merged;
+	unsigned char *record;
+	size_t record_size = 0;
+	size_t offset = 0;
+	unsigned long long total = 0;
+	int count = 0;
+	int i;
+
+	for (i = 0; i < job->count; i++) {
+		core = &job->cores[i];
+		request = &core->item->request;
+
+		if (core->item->result.err ||
+		    request->algorithm.code != MEMPOOL_SORT_ALGORITHM)
+			continue;
+
+		if (record_size == 0)
+			record_size = mempool_emu_record_size(request);
+		else if (record_size != mempool_emu_record_size(request))
+			return -EINVAL;
+
+		total += core->item->result.portion.count;
+	}
+
+	if (total == 0)
+		return 0;
+
+	heap = calloc(job->count, sizeof(struct mempool_emu_cursor));
+	merged = malloc(total * record_size);
+	if (!heap || !merged) {
+		MEMPOOL_ERR("fail to allocate merge buffer: %s\n",
+			    strerror(errno));
+		free(heap);
+		free(merged);
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < job->count; i++) {
+		core = &job->cores[i];
+
+		if (core->item->result.err ||
+		    core->item->request.algorithm.code !=
+						MEMPOOL_SORT_ALGORITHM ||
+		    core->item->result.portion.count == 0)
+			continue;
+
+		heap[count].core = i;
+		heap[count].pos = 0;
+		heap[count].key = mempool_emu_key(&core->item->request,
+						  core->output);
+		count++;
+	}
+
+	for (i = count / 2 - 1; i >= 0; i--)
+		mempool_emu_sift_down(heap, count, i);
+
+	while (count > 0) {
+		core = &job->cores[heap[0].core];
+		record = core->output + (size_t)heap[0].pos * record_size;
+
+		memcpy(merged + offset, record, record_size);
+		offset += record_size;
+
+		if (++heap[0].pos < core->item->result.portion.count) {
+			heap[0].key = mempool_emu_key(&core->item->request,
+						      record + record_size);
+		} else {
+			heap[0] = heap[--count];
+		}
+
+		mempool_emu_sift_down(heap, count, 0);
+	}
+
+	offset = 0;
+
+	for (i = 0; i < job->count; i++) {
+		core = &job->cores[i];
+
+		if (core->item->result.err ||
+		    core->item->request.algorithm.code !=
+						MEMPOOL_SORT_ALGORITHM)
+			continue;
+
+		memcpy(core->output, merged + offset,
+			(size_t)core->item->result.portion.count *
+							record_size);
+		offset += (size_t)core->item->result.portion.count *
+							record_size;
+	}
+
+	free(merged);
+	free(heap);
+
+	return 0;
+}
+
+/*
+ * Execute management pages of @emu. Every management structure
+ * describes one FPGA core: core processes the portion that follows
+ * portions of previous cores and its output is stored at the same
+ * offset of result memory. Cores are executed by worker threads.
+ */
+int mempool_emu_execute(struct mempool_emulator *emu)
+{
+	struct mempool_test_environment *env = emu->env;
+	struct mempool_metadata_management *array;
+	struct mempool_emu_job job;
+	pthread_t *threads = NULL;
+	unsigned long long offset = 0;
+	int workers;
+	int started;
+	int i;
+	int err = 0;
+
+	array = (struct mempool_metadata_management *)emu->management;
+
+	memset(&job, 0, sizeof(job));
+	job.emu = emu;
+	job.count = emu->management_bytes /
+			sizeof(struct mempool_metadata_management);
+
+	if (job.count == 0)
+		return -ENODATA;
+
+	free(emu->result);
+	emu->result = NULL;
+	emu->result_size = 0;
+
+	job.cores = calloc(job.count, sizeof(struct mempool_emu_core));
+	if (!job.cores) {
+		MEMPOOL_ERR("fail to allocate cores: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < job.count; i++) {
+		struct mempool_emu_core *core = &job.cores[i];
+
+		core->id = i;
+		core->item = &array[i];
+		memset(&core->item->result, 0,
+			sizeof(struct mempool_metadata_result));
+
+		core->item->result.err = mempool_emu_check_request(emu, core,
+								   offset);
+		if (core->item->result.err) {
+			MEMPOOL_ERR("invalid request of core %d: err %d\n",
+				    i, core->item->result.err);
+			continue;
+		}
+
+		core->input = emu->memory + offset;
+		core->item->result.address = offset;
+		offset += mempool_emu_portion_size(&core->item->request);
+	}
+
+	emu->result = calloc(1, offset > 0 ? offset : 1);
+	if (!emu->result) {
+		err = -ENOMEM;
+		MEMPOOL_ERR("fail to allocate result: %s\n",
+			    strerror(errno));
+		goto free_cores;
+	}
+
+	emu->result_size = offset;
+
+	for (i = 0; i < job.count; i++) {
+		struct mempool_emu_core *core = &job.cores[i];
+
+		core->output = emu->result + core->item->result.address;
+	}
+
+	workers = env->workers.count;
+	if (workers <= 0 || workers > job.count)
+		workers = job.count;
+
+	threads = calloc(workers, sizeof(pthread_t));
+	if (!threads) {
+		err = -ENOMEM;
+		MEMPOOL_ERR("fail to allocate threads: %s\n",
+			    strerror(errno));
+		goto free_cores;
+	}
+
+	pthread_mutex_init(&job.lock, NULL);
+
+	/* the main thread is a worker too */
+	for (started = 1; started < workers; started++) {
+		err = pthread_create(&threads[started], NULL,
+				     mempool_emu_worker_func, &job);
+		if (err) {
+			MEMPOOL_ERR("fail to create thread: err %d\n", err);
+			err = 0;
+			break;
+		}
+	}
+
+	mempool_emu_worker_func(&job);
+
+	for (i = 1; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&job.lock);
+
+	err = mempool_emu_merge_sorted(&job);
+	if (err) {
+		MEMPOOL_ERR("fail to merge sorted portions: err %d\n", err);
+		goto free_threads;
+	}
+
+	for (i = 0; i < job.count; i++) {
+		MEMPOOL_DBG(env->show_debug,
+			    "core %d: algorithm %llu, err %d, records %u\n",
+			    i, array[i].request.algorithm.code,
+			    array[i].result.err,
+			    array[i].result.portion.count);
+	}
+
+	emu->stats.jobs++;
+
+free_threads:
+	free(threads);
+
+free_cores:
+	free(job.cores);
+
+	return err;
+}
@@ -0,0 +1,448 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/options.c - parsing command line options functionality.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#include <sys/types.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fpga_emu.h"
+
+/************************************************************************
+ *                    Options parsing functionality                     *
+ ************************************************************************/
+
+void print_version(void)
+{
+	MEMPOOL_INFO("fpga-emu, part of %s\n", MEMPOOL_TOOLS_VERSION);
+}
+
+void print_usage(void)
+{
+	FPGA_EMU_INFO(MEMPOOL_TRUE, "FPGA emulator\n\n");
+	MEMPOOL_INFO("Usage: fpga-emu  <options>\n");
+	MEMPOOL_INFO("Options:\n");
+	MEMPOOL_INFO("\t [-d|--debug]\t\t  show debug output.\n");
+	MEMPOOL_INFO("\t [-h|--help]\t\t  display help message and exit.\n");
+	MEMPOOL_INFO("\t [-U|--uart-device]\t\t  create link of UART device "
+		     "to pseudo-terminal.\n");
+	MEMPOOL_INFO("\t [-m|--memory size=value]\t\t  "
+		     "define size of emulated memory in bytes.\n");
+	MEMPOOL_INFO("\t [-w|--workers number=value]\t\t  "
+		     "define number of threads of FPGA cores.\n");
+	MEMPOOL_INFO("\t [-e|--errors rate=value]\t\t  "
+		     "define percent of damaged frames.\n");
+	MEMPOOL_INFO("\t [-T|--timing baud=value,latency=value,"
+		     "throughput=value]\t\t  predict time of job "
+		     "instead of emulation.\n");
+	MEMPOOL_INFO("\t [-C|--calibrate log=value]\t\t  "
+		     "fit timing model by fpga-test log of session.\n");
+	MEMPOOL_INFO("\t [-L|--link window=value,frame=value]\t\t  "
+		     "define number of frames in flight and payload size "
+		     "of frame (timing model).\n");
+	MEMPOOL_INFO("\t [-t|--fpga-core number=value, "
+		     "portion-size=value]\t\t  define FPGA cores info "
+		     "(timing model).\n");
+	MEMPOOL_INFO("\t [-I|--item granularity=value]\t\t  "
+		     "define size of item in bytes (timing model).\n");
+	MEMPOOL_INFO("\t [-r|--record capacity=value]\t\t  "
+		     "define number of items in record (timing model).\n");
+	MEMPOOL_INFO("\t [-p|--portion capacity=value,count=value]\t\t  "
+		     "define number of records in portion (timing model).\n");
+	MEMPOOL_INFO("\t [-a|--algorithm]\t\t  define algorithm "
+		     "[KEY-VALUE|SORT|SELECT|TOTAL] (timing model).\n");
+	MEMPOOL_INFO("\t [-V|--version]\t\t  print version and exit.\n");
+}
+
+void parse_options(int argc, char *argv[],
+		   struct mempool_test_environment *env,
+		   struct mempool_emu_options *opts)
+{
+	int c;
+	int oi = 1;
+	char *p;
+	char sopts[] = "a:C:de:hI:L:m:p:r:t:T:U:Vw:";
+	static const struct option lopts[] = {
+		{"algorithm", 1, NULL, 'a'},
+		{"calibrate", 1, NULL, 'C'},
+		{"debug", 0, NULL, 'd'},
+		{"errors", 1, NULL, 'e'},
+		{"help", 0, NULL, 'h'},
+		{"item", 1, NULL, 'I'},
+		{"link", 1, NULL, 'L'},
+		{"memory", 1, NULL, 'm'},
+		{"portion", 1, NULL, 'p'},
+		{"record", 1, NULL, 'r'},
+		{"fpga-core", 1, NULL, 't'},
+		{"timing", 1, NULL, 'T'},
+		{"uart-device", 1, NULL, 'U'},
+		{"version", 0, NULL, 'V'},
+		{"workers", 1, NULL, 'w'},
+		{ }
+	};
+	enum {
+		MEMORY_SIZE_OPT = 0,
+	};
+	char *const memory_tokens[] = {
+		[MEMORY_SIZE_OPT]		= "size",
+		NULL
+	};
+	enum {
+		WORKERS_COUNT_OPT = 0,
+	};
+	char *const workers_tokens[] = {
+		[WORKERS_COUNT_OPT]		= "number",
+		NULL
+	};
+	enum {
+		ERRORS_RATE_OPT = 0,
+	};
+	char *const errors_tokens[] = {
+		[ERRORS_RATE_OPT]		= "rate",
+		NULL
+	};
+	enum {
+		TIMING_BAUD_OPT = 0,
+		TIMING_LATENCY_OPT,
+		TIMING_THROUGHPUT_OPT,
+	};
+	char *const timing_tokens[] = {
+		[TIMING_BAUD_OPT]		= "baud",
+		[TIMING_LATENCY_OPT]		= "latency",
+		[TIMING_THROUGHPUT_OPT]		= "throughput",
+		NULL
+	};
+	enum {
+		CALIBRATE_LOG_OPT = 0,
+	};
+	char *const calibrate_tokens[] = {
+		[CALIBRATE_LOG_OPT]		= "log",
+		NULL
+	};
+	enum {
+		LINK_WINDOW_OPT = 0,
+		LINK_FRAME_OPT,
+	};
+	char *const link_tokens[] = {
+		[LINK_WINDOW_OPT]		= "window",
+		[LINK_FRAME_OPT]		= "frame",
+		NULL
+	};
+	enum {
+		THREAD_COUNT_OPT = 0,
+		THREAD_PORTION_SIZE_OPT,
+	};
+	char *const threads_tokens[] = {
+		[THREAD_COUNT_OPT]		= "number",
+		[THREAD_PORTION_SIZE_OPT]	= "portion-size",
+		NULL
+	};
+	enum {
+		ITEM_GRANULARITY_OPT = 0,
+	};
+	char *const item_tokens[] = {
+		[ITEM_GRANULARITY_OPT]		= "granularity",
+		NULL
+	};
+	enum {
+		RECORD_CAPACITY_OPT = 0,
+	};
+	char *const record_tokens[] = {
+		[RECORD_CAPACITY_OPT]		= "capacity",
+		NULL
+	};
+	enum {
+		PORTION_CAPACITY_OPT = 0,
+		PORTION_COUNT_OPT,
+	};
+	char *const portion_tokens[] = {
+		[PORTION_CAPACITY_OPT]		= "capacity",
+		[PORTION_COUNT_OPT]		= "count",
+		NULL
+	};
+
+	while ((c = getopt_long(argc, argv, sopts, lopts, &oi)) != EOF) {
+		switch (c) {
+		case 'd':
+			env->show_debug = MEMPOOL_TRUE;
+			break;
+		case 'h':
+			print_usage();
+			exit(EXIT_SUCCESS);
+		case 'U':
+			env->uart_channel.name = optarg;
+			if (!env->uart_channel.name) {
+				MEMPOOL_ERR("UART device is not defined\n");
+				print_usage();
+				exit(EXIT_SUCCESS);
+			}
+			break;
+		case 'm':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, memory_tokens, &value)) {
+				case MEMORY_SIZE_OPT:
+					if (value) {
+						opts->memory_size =
+						    strtoull(value, NULL, 0);
+					}
+					if (!value ||
+					    opts->memory_size < MEMPOOL_PAGE_SIZE) {
+						MEMPOOL_ERR("invalid memory size\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				default:
+					MEMPOOL_ERR("invalid memory option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'w':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, workers_tokens, &value)) {
+				case WORKERS_COUNT_OPT:
+					env->workers.count = atoi(value);
+					if (env->workers.count <= 0) {
+						MEMPOOL_ERR("invalid number of workers\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				default:
+					MEMPOOL_ERR("invalid workers option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'e':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, errors_tokens, &value)) {
+				case ERRORS_RATE_OPT:
+					if (value)
+						opts->error_rate = atoi(value);
+					if (!value || opts->error_rate < 0 ||
+					    opts->error_rate > 100) {
+						MEMPOOL_ERR("invalid error rate\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				default:
+					MEMPOOL_ERR("invalid errors option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'T':
+			opts->mode = MEMPOOL_EMU_TIMING_MODE;
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+				unsigned long long number = 0;
+				int token;
+
+				token = getsubopt(&p, timing_tokens, &value);
+				if (value)
+					number = strtoull(value, NULL, 0);
+
+				switch (token) {
+				case TIMING_BAUD_OPT:
+					opts->timing.baud = number;
+					break;
+				case TIMING_LATENCY_OPT:
+					opts->timing.latency = number;
+					break;
+				case TIMING_THROUGHPUT_OPT:
+					opts->timing.throughput = number;
+					break;
+				default:
+					MEMPOOL_ERR("invalid timing option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+
+			if (opts->timing.baud == 0 ||
+			    opts->timing.throughput == 0) {
+				MEMPOOL_ERR("invalid timing parameters\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'C':
+			opts->mode = MEMPOOL_EMU_CALIBRATION_MODE;
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, calibrate_tokens, &value)) {
+				case CALIBRATE_LOG_OPT:
+					opts->log_name = value;
+					break;
+				default:
+					MEMPOOL_ERR("invalid calibrate option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+
+			if (!opts->log_name) {
+				MEMPOOL_ERR("log of calibration is not defined\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'L':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, link_tokens, &value)) {
+				case LINK_WINDOW_OPT:
+					env->link.window = atoi(value);
+					if (env->link.window < 0 ||
+					    env->link.window >
+						MEMPOOL_MAX_LINK_WINDOW) {
+						MEMPOOL_ERR("invalid window\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case LINK_FRAME_OPT:
+					env->link.frame = atoi(value);
+					if (env->link.frame < MEMPOOL_MIN_LINK_FRAME ||
+					    env->link.frame > MEMPOOL_PAGE_SIZE ||
+					    (env->link.frame &
+						(env->link.frame - 1))) {
+						MEMPOOL_ERR("invalid frame size\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				default:
+					MEMPOOL_ERR("invalid link option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 't':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, threads_tokens, &value)) {
+				case THREAD_COUNT_OPT:
+					env->threads.count = atoi(value);
+					break;
+				case THREAD_PORTION_SIZE_OPT:
+					env->threads.portion_size = atoll(value);
+					break;
+				default:
+					MEMPOOL_ERR("invalid threads option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'I':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, item_tokens, &value)) {
+				case ITEM_GRANULARITY_OPT:
+					env->item.granularity = atoi(value);
+					if (!check_granularity(env->item.granularity)) {
+						MEMPOOL_ERR("invalid granularity\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				default:
+					MEMPOOL_ERR("invalid item option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'r':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, record_tokens, &value)) {
+				case RECORD_CAPACITY_OPT:
+					env->record.capacity = atoi(value);
+					break;
+				default:
+					MEMPOOL_ERR("invalid record option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'p':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, portion_tokens, &value)) {
+				case PORTION_CAPACITY_OPT:
+					env->portion.capacity = atoi(value);
+					break;
+				case PORTION_COUNT_OPT:
+					env->portion.count = atoi(value);
+					break;
+				default:
+					MEMPOOL_ERR("invalid portion option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'a':
+			env->algorithm.id = convert_string2algorithm(optarg);
+			if (env->algorithm.id < MEMPOOL_KEY_VALUE_ALGORITHM ||
+			    env->algorithm.id > MEMPOOL_TOTAL_ALGORITHM) {
+				MEMPOOL_ERR("invalid algorithm\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'V':
+			print_version();
+			exit(EXIT_SUCCESS);
+		default:
+			print_usage();
+			exit(EXIT_FAILURE);
+		}
+	}
+}
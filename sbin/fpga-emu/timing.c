@@ -0,0 +1,461 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/timing.c - timing model of FPGA board.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "fpga_emu.h"
+
+/*
+ * Every phase of job takes the line time of its bytes and
+ * the turnaround of its requests. Execution phase takes the
+ * time of the slowest FPGA core in addition. FPGA cores work
+ * in parallel, but portions pass the line one by one.
+ */
+
+static inline
+unsigned long long mempool_emu_pages(struct mempool_test_environment *env,
+				     unsigned long long bytes)
+{
+	return (bytes + env->link.frame - 1) / env->link.frame;
+}
+
+static inline
+unsigned long long
+mempool_emu_frames_bytes(struct mempool_test_environment *env,
+			 unsigned long long bytes)
+{
+	return bytes + mempool_emu_pages(env, bytes) *
+			(sizeof(struct mempool_uart_preamble) +
+			 sizeof(struct mempool_uart_footer));
+}
+
+static inline
+double mempool_emu_line_seconds(struct mempool_emu_timing *timing,
+				unsigned long long bytes,
+				unsigned long long exchanges)
+{
+	return (double)bytes * MEMPOOL_UART_BITS_PER_BYTE / timing->baud +
+			exchanges * timing->latency / 1e6;
+}
+
+static inline
+unsigned int mempool_emu_core_records(struct mempool_test_environment *env)
+{
+	/* every portion is full by default */
+	return env->portion.count > 0 ? env->portion.count :
+					env->portion.capacity;
+}
+
+/*
+ * SORT core makes log2(records) passes over its portion,
+ * other algorithms make one pass.
+ */
+static
+unsigned int mempool_emu_core_passes(struct mempool_test_environment *env)
+{
+	unsigned int records = mempool_emu_core_records(env);
+	unsigned int passes = 0;
+
+	if (env->algorithm.id != MEMPOOL_SORT_ALGORITHM)
+		return 1;
+
+	while ((1ULL << passes) < records)
+		passes++;
+
+	return passes > 0 ? passes : 1;
+}
+
+static inline
+unsigned long long mempool_emu_core_bytes(struct mempool_test_environment *env)
+{
+	return (unsigned long long)mempool_emu_core_records(env) *
+			env->item.granularity * env->record.capacity;
+}
+
+static
+int mempool_emu_check_geometry(struct mempool_test_environment *env)
+{
+	long long portion_size;
+
+	if (env->threads.count <= 0 ||
+	    env->threads.count > MEMPOOL_EMU_MAX_CORES ||
+	    !check_granularity(env->item.granularity) ||
+	    env->record.capacity <= 0 ||
+	    env->record.capacity >
+		(int)(sizeof(unsigned long long) * MEMPOOL_BITS_PER_BYTE) ||
+	    env->portion.capacity <= 0 ||
+	    env->portion.count < 0 ||
+	    env->portion.count > env->portion.capacity) {
+		MEMPOOL_ERR("invalid geometry: cores %d, granularity %d, "
+			    "record_capacity %d, portion_capacity %d, "
+			    "portion_count %d\n",
+			    env->threads.count, env->item.granularity,
+			    env->record.capacity, env->portion.capacity,
+			    env->portion.count);
+		return -ERANGE;
+	}
+
+	portion_size = (long long)env->item.granularity *
+			env->record.capacity * env->portion.capacity;
+
+	if (env->threads.portion_size == 0)
+		env->threads.portion_size = portion_size;
+
+	if (env->threads.portion_size != portion_size) {
+		MEMPOOL_ERR("inconsistent portion size: "
+			    "portion_size %lld, expected %lld\n",
+			    env->threads.portion_size, portion_size);
+		return -ERANGE;
+	}
+
+	if (env->algorithm.id < MEMPOOL_KEY_VALUE_ALGORITHM ||
+	    env->algorithm.id > MEMPOOL_TOTAL_ALGORITHM) {
+		MEMPOOL_ERR("algorithm is not defined\n");
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+/*
+ * Count bytes and requests of every phase. The frames follow
+ * fpga-test: sliding window or stop-and-wait upload, management
+ * pages with answer and readback by pages or by one answer.
+ */
+static
+void mempool_emu_model_link(struct mempool_test_environment *env,
+			    struct mempool_emu_phase *phases)
+{
+	unsigned long long data_size = (unsigned long long)env->threads.count *
+						env->threads.portion_size;
+	unsigned long long management_size = (unsigned long long)
+				env->threads.count *
+				sizeof(struct mempool_metadata_management);
+	unsigned long long pages = mempool_emu_pages(env, data_size);
+	unsigned long long length;
+	struct mempool_emu_phase *phase;
+
+	memset(phases, 0, MEMPOOL_EMU_PHASE_MAX *
+				sizeof(struct mempool_emu_phase));
+
+	/* frames are acknowledged on the other direction of the line */
+	phase = &phases[MEMPOOL_EMU_UPLOAD_PHASE];
+	phase->bytes = mempool_emu_frames_bytes(env, data_size);
+	if (env->link.window == 0)
+		phase->bytes += sizeof(struct mempool_uart_answer);
+	phase->exchanges = 1;
+
+	phase = &phases[MEMPOOL_EMU_EXECUTE_PHASE];
+	phase->bytes = mempool_emu_frames_bytes(env, management_size) +
+			sizeof(struct mempool_uart_answer) + management_size;
+	phase->exchanges = 1;
+
+	phase = &phases[MEMPOOL_EMU_READBACK_PHASE];
+	if (env->link.window > 0) {
+		phase->exchanges = (pages + env->link.window - 1) /
+							env->link.window;
+		phase->bytes = data_size +
+				phase->exchanges *
+					sizeof(struct mempool_uart_preamble) +
+				pages * sizeof(struct mempool_uart_page);
+	} else {
+		/* length of answer is limited by its header */
+		length = data_size;
+		if (length > USHRT_MAX)
+			length = USHRT_MAX;
+
+		phase->exchanges = 1;
+		phase->bytes = sizeof(struct mempool_uart_preamble) +
+				sizeof(struct mempool_uart_answer) + length;
+	}
+}
+
+static
+void mempool_emu_model_job(struct mempool_test_environment *env,
+			   struct mempool_emu_timing *timing,
+			   struct mempool_emu_phase *phases)
+{
+	struct mempool_emu_phase *phase;
+	int i;
+
+	mempool_emu_model_link(env, phases);
+
+	for (i = 0; i < MEMPOOL_EMU_PHASE_MAX; i++) {
+		phase = &phases[i];
+		phase->seconds = mempool_emu_line_seconds(timing, phase->bytes,
+							  phase->exchanges);
+	}
+
+	phase = &phases[MEMPOOL_EMU_EXECUTE_PHASE];
+	phase->compute = (double)mempool_emu_core_bytes(env) *
+				mempool_emu_core_passes(env) /
+				timing->throughput;
+	phase->seconds += phase->compute;
+}
+
+/*
+ * Core's portion passes the line after portions of previous cores.
+ * All cores start execution when management pages are received.
+ */
+static
+void mempool_emu_print_timeline(struct mempool_test_environment *env,
+				struct mempool_emu_phase *phases)
+{
+	struct mempool_emu_phase *upload = &phases[MEMPOOL_EMU_UPLOAD_PHASE];
+	struct mempool_emu_phase *execute = &phases[MEMPOOL_EMU_EXECUTE_PHASE];
+	struct mempool_emu_phase *readback =
+				&phases[MEMPOOL_EMU_READBACK_PHASE];
+	double compute_start = upload->seconds + execute->seconds -
+							execute->compute;
+	double readback_start = upload->seconds + execute->seconds;
+	double part = 1.0 / env->threads.count;
+	int i;
+
+	for (i = 0; i < env->threads.count; i++) {
+		MEMPOOL_INFO("Core %d: upload %.3f-%.3f, compute %.3f-%.3f, "
+			     "readback %.3f-%.3f seconds\n",
+			     i,
+			     upload->seconds * part * i,
+			     upload->seconds * part * (i + 1),
+			     compute_start,
+			     compute_start + execute->compute,
+			     readback_start + readback->seconds * part * i,
+			     readback_start + readback->seconds * part * (i + 1));
+	}
+
+	MEMPOOL_INFO("Upload: bytes %llu, time %.3f seconds\n",
+		     upload->bytes, upload->seconds);
+	MEMPOOL_INFO("Execute: bytes %llu, compute %.3f, time %.3f seconds\n",
+		     execute->bytes, execute->compute, execute->seconds);
+	MEMPOOL_INFO("Readback: bytes %llu, time %.3f seconds\n",
+		     readback->bytes, readback->seconds);
+	MEMPOOL_INFO("Job: time %.3f seconds\n",
+		     upload->seconds + execute->seconds + readback->seconds);
+}
+
+/*
+ * Predict upload, execution and readback of one job.
+ */
+int mempool_emu_timing_model(struct mempool_test_environment *env,
+			     struct mempool_emu_options *opts)
+{
+	struct mempool_emu_phase phases[MEMPOOL_EMU_PHASE_MAX];
+	int err;
+
+	err = mempool_emu_check_geometry(env);
+	if (err)
+		return err;
+
+	MEMPOOL_INFO("Timing model: cores %d, portion_size %lld, "
+		     "window %d, frame %d, baud %llu, latency %llu us, "
+		     "throughput %llu bytes/s\n",
+		     env->threads.count, env->threads.portion_size,
+		     env->link.window, env->link.frame, opts->timing.baud,
+		     opts->timing.latency, opts->timing.throughput);
+
+	mempool_emu_model_job(env, &opts->timing, phases);
+	mempool_emu_print_timeline(env, phases);
+
+	return 0;
+}
+
+/*
+ * Read phases of jobs from fpga-test log of session. It returns
+ * the number of jobs or negative error code.
+ */
+static
+int mempool_emu_read_log(const char *log_name, double **measured)
+{
+	char line[512];
+	double upload, execute, readback;
+	double *jobs = NULL;
+	double *tmp;
+	int capacity = 0;
+	int count = 0;
+	int job;
+	char *p;
+	FILE *log;
+
+	log = fopen(log_name, "r");
+	if (!log) {
+		MEMPOOL_ERR("fail to open log %s: %s\n",
+			    log_name, strerror(errno));
+		return -ENOENT;
+	}
+
+	while (fgets(line, sizeof(line), log)) {
+		p = strstr(line, "Job ");
+		if (!p)
+			continue;
+
+		if (sscanf(p, "Job %d: upload %lf, execute %lf, readback %lf",
+			   &job, &upload, &execute, &readback) != 4)
+			continue;
+
+		if (count == capacity) {
+			capacity = capacity ? capacity * 2 : 16;
+			tmp = realloc(jobs, capacity * MEMPOOL_EMU_PHASE_MAX *
+							sizeof(double));
+			if (!tmp) {
+				MEMPOOL_ERR("fail to allocate jobs: %s\n",
+					    strerror(errno));
+				free(jobs);
+				fclose(log);
+				return -ENOMEM;
+			}
+
+			jobs = tmp;
+		}
+
+		jobs[count * MEMPOOL_EMU_PHASE_MAX +
+					MEMPOOL_EMU_UPLOAD_PHASE] = upload;
+		jobs[count * MEMPOOL_EMU_PHASE_MAX +
+					MEMPOOL_EMU_EXECUTE_PHASE] = execute;
+		jobs[count * MEMPOOL_EMU_PHASE_MAX +
+					MEMPOOL_EMU_READBACK_PHASE] = readback;
+		count++;
+	}
+
+	fclose(log);
+
+	*measured = jobs;
+
+	return count;
+}
+
+/*
+ * Fit parameters of timing model from fpga-test log of session
+ * with the same geometry. Line time per byte and turnaround are
+ * fitted by least squares over upload and readback phases. The
+ * rest of execution phase gives throughput of FPGA core.
+ */
+int mempool_emu_calibrate(struct mempool_test_environment *env,
+			  struct mempool_emu_options *opts)
+{
+	struct mempool_emu_timing *timing = &opts->timing;
+	struct mempool_emu_phase phases[MEMPOOL_EMU_PHASE_MAX];
+	double mean[MEMPOOL_EMU_PHASE_MAX] = {0};
+	double sum_bb = 0, sum_be = 0, sum_ee = 0, sum_bt = 0, sum_et = 0;
+	double byte_time, latency, compute, det;
+	double *measured = NULL;
+	double bytes, exchanges, seconds;
+	int phase_ids[] = {MEMPOOL_EMU_UPLOAD_PHASE,
+			   MEMPOOL_EMU_READBACK_PHASE};
+	int count;
+	int i, j;
+	int err = 0;
+
+	err = mempool_emu_check_geometry(env);
+	if (err)
+		return err;
+
+	count = mempool_emu_read_log(opts->log_name, &measured);
+	if (count < 0)
+		return count;
+
+	if (count == 0) {
+		MEMPOOL_ERR("log has no phases of jobs: %s\n",
+			    opts->log_name);
+		return -ENODATA;
+	}
+
+	mempool_emu_model_link(env, phases);
+
+	for (i = 0; i < count; i++) {
+		for (j = 0; j < MEMPOOL_EMU_PHASE_MAX; j++)
+			mean[j] += measured[i * MEMPOOL_EMU_PHASE_MAX + j] / count;
+
+		for (j = 0; j < 2; j++) {
+			bytes = phases[phase_ids[j]].bytes;
+			exchanges = phases[phase_ids[j]].exchanges;
+			seconds = measured[i * MEMPOOL_EMU_PHASE_MAX +
+							phase_ids[j]];
+
+			sum_bb += bytes * bytes;
+			sum_be += bytes * exchanges;
+			sum_ee += exchanges * exchanges;
+			sum_bt += bytes * seconds;
+			sum_et += exchanges * seconds;
+		}
+	}
+
+	det = sum_bb * sum_ee - sum_be * sum_be;
+	byte_time = 0;
+	latency = 0;
+
+	if (det > 1e-9 * sum_bb * sum_ee) {
+		byte_time = (sum_bt * sum_ee - sum_et * sum_be) / det;
+		latency = (sum_bb * sum_et - sum_be * sum_bt) / det;
+	}
+
+	/* phases of the same size cannot separate turnaround */
+	if (byte_time <= 0 || latency < 0) {
+		byte_time = sum_bt / sum_bb;
+		latency = 0;
+	}
+
+	if (byte_time <= 0) {
+		MEMPOOL_ERR("line time cannot be fitted\n");
+		err = -ERANGE;
+		goto free_measured;
+	}
+
+	timing->baud = (unsigned long long)(MEMPOOL_UART_BITS_PER_BYTE /
+								byte_time);
+	timing->latency = (unsigned long long)(latency * 1e6);
+
+	compute = mean[MEMPOOL_EMU_EXECUTE_PHASE] -
+			mempool_emu_line_seconds(timing,
+				phases[MEMPOOL_EMU_EXECUTE_PHASE].bytes,
+				phases[MEMPOOL_EMU_EXECUTE_PHASE].exchanges);
+	if (compute > 0) {
+		timing->throughput = (unsigned long long)
+				(mempool_emu_core_bytes(env) *
+				 mempool_emu_core_passes(env) / compute);
+	} else {
+		MEMPOOL_WARN("execution is hidden by the line: "
+			     "throughput is not changed\n");
+	}
+
+	MEMPOOL_INFO("Calibration: jobs %d, baud %llu, latency %llu us, "
+		     "throughput %llu bytes/s\n",
+		     count, timing->baud, timing->latency,
+		     timing->throughput);
+	MEMPOOL_INFO("Timing options: -T baud=%llu,latency=%llu,"
+		     "throughput=%llu\n",
+		     timing->baud, timing->latency, timing->throughput);
+
+	mempool_emu_model_job(env, timing, phases);
+
+	MEMPOOL_INFO("Upload: measured %.3f, predicted %.3f seconds\n",
+		     mean[MEMPOOL_EMU_UPLOAD_PHASE],
+		     phases[MEMPOOL_EMU_UPLOAD_PHASE].seconds);
+	MEMPOOL_INFO("Execute: measured %.3f, predicted %.3f seconds\n",
+		     mean[MEMPOOL_EMU_EXECUTE_PHASE],
+		     phases[MEMPOOL_EMU_EXECUTE_PHASE].seconds);
+	MEMPOOL_INFO("Readback: measured %.3f, predicted %.3f seconds\n",
+		     mean[MEMPOOL_EMU_READBACK_PHASE],
+		     phases[MEMPOOL_EMU_READBACK_PHASE].seconds);
+
+free_measured:
+	free(measured);
+
+	return err;
+}
@@ -20,7 +20,9 @@
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #include <linux/fs.h>
+#include <poll.h>
 #include <getopt.h>
 #include <fcntl.h>
 #include <string.h>
@@ -32,12 +34,187 @@
 #include <errno.h>
 #include <pthread.h>
 #include <termios.h>
+#include <time.h>
 
 #include "uart_declarations.h"
 #include "metadata_page.h"
 #include "crc32c.h"
+#include "memory_pool_container.h"
+#include "memory_pool_codec.h"
 #include "fpga_test.h"
 
+/* margin of waiting acknowledgements in milliseconds */
+#define MEMPOOL_UART_ACK_TIMEOUT		(500)
+
+/* maximum number of retransmissions of one frame */
+#define MEMPOOL_UART_MAX_RETRIES		(8)
+
+/* waiting of FPGA answer in milliseconds */
+#define MEMPOOL_UART_ANSWER_TIMEOUT		(30 * 1000)
+
+/* size of receive ring buffer of UART channel */
+#define MEMPOOL_UART_RX_BUFFER_SIZE		(64 * 1024)
+
+/* frame is sent as preamble, payload and footer */
+#define MEMPOOL_UART_FRAME_IOVECS		(3)
+
+/* maximum number of frames sent by one writev() */
+#define MEMPOOL_UART_BATCH_FRAMES		(64)
+
+/* size of test data of link calibration */
+#define MEMPOOL_UART_PROBE_SIZE			(16 * 1024)
+
+/* frame size is divided by this factor between probes */
+#define MEMPOOL_UART_PROBE_FRAME_STEP		(4)
+
+/* window is multiplied by this factor between probes */
+#define MEMPOOL_UART_PROBE_WINDOW_STEP		(8)
+
+/* maximum percent of retransmitted frames of reliable link */
+#define MEMPOOL_UART_MAX_ERROR_RATE		(2)
+
+/*
+ * struct mempool_uart_speed - speed of termios
+ * @baud: baud rate
+ * @speed: termios constant of baud rate
+ */
+struct mempool_uart_speed {
+	int baud;
+	speed_t speed;
+};
+
+/* baud rates from the slowest one */
+static const struct mempool_uart_speed uart_speeds[] = {
+	{ 9600, B9600 },
+	{ 19200, B19200 },
+	{ 38400, B38400 },
+	{ 57600, B57600 },
+	{ 115200, B115200 },
+	{ 230400, B230400 },
+#ifdef B460800
+	{ 460800, B460800 },
+#endif
+#ifdef B500000
+	{ 500000, B500000 },
+#endif
+#ifdef B576000
+	{ 576000, B576000 },
+#endif
+#ifdef B921600
+	{ 921600, B921600 },
+#endif
+#ifdef B1000000
+	{ 1000000, B1000000 },
+#endif
+#ifdef B1152000
+	{ 1152000, B1152000 },
+#endif
+#ifdef B1500000
+	{ 1500000, B1500000 },
+#endif
+#ifdef B2000000
+	{ 2000000, B2000000 },
+#endif
+#ifdef B2500000
+	{ 2500000, B2500000 },
+#endif
+#ifdef B3000000
+	{ 3000000, B3000000 },
+#endif
+#ifdef B3500000
+	{ 3500000, B3500000 },
+#endif
+#ifdef B4000000
+	{ 4000000, B4000000 },
+#endif
+};
+
+#define MEMPOOL_UART_SPEEDS \
+	(sizeof(uart_speeds) / sizeof(struct mempool_uart_speed))
+
+/* state of page in window */
+enum {
+	MEMPOOL_PAGE_UNSENT,
+	MEMPOOL_PAGE_IN_FLIGHT,
+	MEMPOOL_PAGE_ACKED,
+};
+
+/*
+ * struct mempool_uart_batch - frames sent by one system call
+ * @preambles: preambles of frames
+ * @footers: footers of frames
+ * @iov: preamble, payload and footer of every frame
+ * @frames: number of frames in batch
+ */
+struct mempool_uart_batch {
+	struct mempool_uart_preamble preambles[MEMPOOL_UART_BATCH_FRAMES];
+	struct mempool_uart_footer footers[MEMPOOL_UART_BATCH_FRAMES];
+	struct iovec iov[MEMPOOL_UART_BATCH_FRAMES * MEMPOOL_UART_FRAME_IOVECS];
+	int frames;
+};
+
+/*
+ * struct mempool_uart_window - pages of transfer in flight
+ * @base_address: base address of pages in FPGA
+ * @operation_type: operation type
+ * @data: pages of transfer
+ * @size: size of transfer in bytes
+ * @frame: size of page in bytes
+ * @pages: number of pages
+ * @state: state of every page
+ * @retries: number of retransmissions of every page
+ * @crcs: checksums of pages
+ * @base: the oldest unacknowledged page
+ * @next: the next page to send
+ * @timeout: time of waiting acknowledgement in milliseconds
+ * @retransmitted: number of retransmitted frames
+ * @batch: frames waiting for sending
+ */
+struct mempool_uart_window {
+	unsigned long long base_address;
+	unsigned char operation_type;
+	unsigned char *data;
+	off_t size;
+	off_t frame;
+	off_t pages;
+	unsigned char *state;
+	unsigned char *retries;
+	unsigned int *crcs;
+	off_t base;
+	off_t next;
+	int timeout;
+	unsigned long long retransmitted;
+	struct mempool_uart_batch batch;
+};
+
+/*
+ * struct mempool_uart_rx - receive ring buffer of UART channel
+ * @buffer: ring buffer
+ * @head: offset of the first buffered byte
+ * @count: number of buffered bytes
+ */
+struct mempool_uart_rx {
+	unsigned char buffer[MEMPOOL_UART_RX_BUFFER_SIZE];
+	size_t head;
+	size_t count;
+};
+
+/* bytes received after the current frame are kept for the next one */
+static struct mempool_uart_rx uart_rx;
+
+static
+speed_t mempool_uart_baud2speed(int baud)
+{
+	int i;
+
+	for (i = 0; i < MEMPOOL_UART_SPEEDS; i++) {
+		if (uart_speeds[i].baud == baud)
+			return uart_speeds[i].speed;
+	}
+
+	return B0;
+}
+
 static
 int mempool_open_channel_to_fpga(struct mempool_test_environment *env)
 {
@@ -53,6 +230,9 @@ int mempool_open_channel_to_fpga(struct mempool_test_environment *env)
 		return -EFAULT;
 	}
 
+	uart_rx.head = 0;
+	uart_rx.count = 0;
+
 	MEMPOOL_DBG(env->show_debug,
 		    "UART channel has been opened\n");
 
@@ -63,10 +243,17 @@ static int
 mempool_configure_communication_parameters(struct mempool_test_environment *env)
 {
 	struct termios config;
+	speed_t speed;
 
 	MEMPOOL_DBG(env->show_debug,
-		    "env %p\n",
-		    env);
+		    "env %p, baud %d, flow %d\n",
+		    env, env->link.baud, env->link.flow);
+
+	speed = mempool_uart_baud2speed(env->link.baud);
+	if (speed == B0) {
+		MEMPOOL_ERR("unsupported baud rate %d\n", env->link.baud);
+		return -EINVAL;
+	}
 
 	if (tcgetattr(env->uart_channel.fd, &config) < 0) {
 		MEMPOOL_ERR("fail to get current configuration: %s\n",
@@ -114,6 +301,14 @@ mempool_configure_communication_parameters(struct mempool_test_environment *env)
 	config.c_cflag &= ~(CSIZE | PARENB);
 	config.c_cflag |= CS8;
 
+	//
+	// Hardware flow control: FPGA pauses the host by CTS
+	//
+	if (env->link.flow == MEMPOOL_RTSCTS_FLOW_CONTROL)
+		config.c_cflag |= CRTSCTS;
+	else
+		config.c_cflag &= ~CRTSCTS;
+
 	//
 	// One input byte is enough to return from read()
 	// Inter-character timer off
@@ -122,11 +317,10 @@ mempool_configure_communication_parameters(struct mempool_test_environment *env)
 	config.c_cc[VTIME] = 0;
 
 	//
-	// Communication speed (simple version, using the predefined
-	// constants)
+	// Communication speed (predefined constants of termios)
 	//
-	if (cfsetispeed(&config, B115200) < 0 ||
-	    cfsetospeed(&config, B115200) < 0) {
+	if (cfsetispeed(&config, speed) < 0 ||
+	    cfsetospeed(&config, speed) < 0) {
 		MEMPOOL_ERR("fail to set speed of communication: %s\n",
 			    strerror(errno));
 		return -EFAULT;
@@ -153,6 +347,7 @@ int mempool_close_channel_to_fpga(struct mempool_test_environment *env)
 
 	if (env->uart_channel.fd != -1) {
 		close(env->uart_channel.fd);
+		env->uart_channel.fd = -1;
 	} else {
 		MEMPOOL_ERR("UART channel's file descriptor invalid\n");
 		return -ERANGE;
@@ -164,6 +359,319 @@ int mempool_close_channel_to_fpga(struct mempool_test_environment *env)
 	return 0;
 }
 
+/*
+ * Every operation opens and configures the channel, unless
+ * the channel is kept opened by session. Configuration of session
+ * happens once, so TCSAFLUSH never discards data of previous
+ * operation.
+ */
+static
+int mempool_attach_channel_to_fpga(struct mempool_test_environment *env)
+{
+	int err;
+
+	if (env->uart_channel.fd != -1)
+		return 0;
+
+	err = mempool_open_channel_to_fpga(env);
+	if (err) {
+		MEMPOOL_ERR("fail to open channel to FPGA: "
+			    "err %d\n", err);
+		return err;
+	}
+
+	err = mempool_configure_communication_parameters(env);
+	if (err) {
+		MEMPOOL_ERR("fail to configure communication parameters: "
+			    "err %d\n", err);
+		mempool_close_channel_to_fpga(env);
+		return err;
+	}
+
+	return 0;
+}
+
+static
+void mempool_detach_channel_from_fpga(struct mempool_test_environment *env)
+{
+	if (env->session.jobs > 0)
+		return;
+
+	mempool_close_channel_to_fpga(env);
+}
+
+/*
+ * UART channel is opened with O_NDELAY, so the line can accept
+ * a part of vector only. The rest is written when the line
+ * becomes writable. Vector is modified.
+ */
+static
+int mempool_uart_writev(struct mempool_test_environment *env,
+			struct iovec *iov, int iovcnt)
+{
+	struct pollfd pfd = {
+		.fd = env->uart_channel.fd,
+		.events = POLLOUT,
+	};
+	ssize_t written_bytes;
+
+	while (iovcnt > 0) {
+		written_bytes = writev(env->uart_channel.fd, iov, iovcnt);
+		if (written_bytes < 0) {
+			if (errno == EINTR)
+				continue;
+
+			if (errno != EAGAIN) {
+				MEMPOOL_ERR("fail to write into FPGA: %s\n",
+					    strerror(errno));
+				return -EFAULT;
+			}
+
+			if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+				MEMPOOL_ERR("fail to wait UART channel: %s\n",
+					    strerror(errno));
+				return -EFAULT;
+			}
+
+			continue;
+		}
+
+		while (iovcnt > 0 && written_bytes >= (ssize_t)iov->iov_len) {
+			written_bytes -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		if (written_bytes > 0) {
+			iov->iov_base = (unsigned char *)iov->iov_base +
+								written_bytes;
+			iov->iov_len -= written_bytes;
+		}
+	}
+
+	return 0;
+}
+
+static
+int mempool_uart_write(struct mempool_test_environment *env,
+		       const void *buf, size_t bytes)
+{
+	struct iovec iov = {
+		.iov_base = (void *)buf,
+		.iov_len = bytes,
+	};
+
+	return mempool_uart_writev(env, &iov, 1);
+}
+
+/*
+ * Time of @bytes on the line in milliseconds.
+ */
+static inline
+int mempool_uart_line_time(struct mempool_test_environment *env,
+			   size_t bytes)
+{
+	return (int)((long long)bytes * MEMPOOL_UART_BITS_PER_BYTE * 1000 /
+							env->link.baud);
+}
+
+static
+void mempool_uart_set_deadline(struct timespec *deadline, int timeout)
+{
+	clock_gettime(CLOCK_MONOTONIC, deadline);
+
+	if (timeout < 0)
+		return;
+
+	deadline->tv_sec += timeout / 1000;
+	deadline->tv_nsec += (long)(timeout % 1000) * 1000000;
+
+	if (deadline->tv_nsec >= 1000000000) {
+		deadline->tv_sec++;
+		deadline->tv_nsec -= 1000000000;
+	}
+}
+
+/*
+ * Milliseconds till @deadline (-1 - wait infinitely).
+ */
+static
+int mempool_uart_time_left(struct timespec *deadline, int timeout)
+{
+	struct timespec now;
+	long long left;
+
+	if (timeout < 0)
+		return -1;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	left = (long long)(deadline->tv_sec - now.tv_sec) * 1000 +
+			(deadline->tv_nsec - now.tv_nsec) / 1000000;
+
+	return left > 0 ? (int)left : 0;
+}
+
+static inline
+void mempool_uart_rx_consume(size_t bytes)
+{
+	uart_rx.head = (uart_rx.head + bytes) % MEMPOOL_UART_RX_BUFFER_SIZE;
+	uart_rx.count -= bytes;
+
+	if (uart_rx.count == 0)
+		uart_rx.head = 0;
+}
+
+static
+void mempool_uart_rx_copy(void *buf, size_t bytes)
+{
+	size_t first = MEMPOOL_UART_RX_BUFFER_SIZE - uart_rx.head;
+
+	if (first > bytes)
+		first = bytes;
+
+	memcpy(buf, uart_rx.buffer + uart_rx.head, first);
+	memcpy((unsigned char *)buf + first, uart_rx.buffer, bytes - first);
+
+	mempool_uart_rx_consume(bytes);
+}
+
+/*
+ * Drop buffered bytes before magic of answer.
+ * It returns the number of dropped bytes.
+ */
+static
+size_t mempool_uart_rx_resync(void)
+{
+	unsigned char *start;
+	unsigned char *found;
+	size_t skipped = 0;
+	size_t len;
+
+	while (uart_rx.count > 0) {
+		start = uart_rx.buffer + uart_rx.head;
+
+		len = MEMPOOL_UART_RX_BUFFER_SIZE - uart_rx.head;
+		if (len > uart_rx.count)
+			len = uart_rx.count;
+
+		found = memchr(start, MEMPOOL_FPGA2PC_MAGIC, len);
+		if (found) {
+			mempool_uart_rx_consume(found - start);
+			skipped += found - start;
+			break;
+		}
+
+		mempool_uart_rx_consume(len);
+		skipped += len;
+	}
+
+	return skipped;
+}
+
+/*
+ * Receive everything available into free space of ring buffer:
+ * one poll() and one readv() during @timeout milliseconds.
+ */
+static
+int mempool_uart_rx_fill(struct mempool_test_environment *env, int timeout)
+{
+	struct pollfd pfd = {
+		.fd = env->uart_channel.fd,
+		.events = POLLIN,
+	};
+	struct iovec iov[2];
+	size_t free_bytes;
+	size_t tail;
+	ssize_t read_bytes;
+	int iovcnt = 1;
+	int res;
+
+	free_bytes = MEMPOOL_UART_RX_BUFFER_SIZE - uart_rx.count;
+	if (free_bytes == 0)
+		return -ENOBUFS;
+
+	tail = (uart_rx.head + uart_rx.count) % MEMPOOL_UART_RX_BUFFER_SIZE;
+
+	iov[0].iov_base = uart_rx.buffer + tail;
+	iov[0].iov_len = MEMPOOL_UART_RX_BUFFER_SIZE - tail;
+
+	if (iov[0].iov_len > free_bytes) {
+		iov[0].iov_len = free_bytes;
+	} else if (iov[0].iov_len < free_bytes) {
+		iov[1].iov_base = uart_rx.buffer;
+		iov[1].iov_len = free_bytes - iov[0].iov_len;
+		iovcnt = 2;
+	}
+
+	res = poll(&pfd, 1, timeout);
+	if (res < 0) {
+		if (errno == EINTR)
+			return 0;
+
+		MEMPOOL_ERR("fail to wait UART channel: %s\n",
+			    strerror(errno));
+		return -EFAULT;
+	} else if (res == 0) {
+		return -ETIMEDOUT;
+	}
+
+	read_bytes = readv(env->uart_channel.fd, iov, iovcnt);
+	if (read_bytes < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return 0;
+
+		MEMPOOL_ERR("fail to read from FPGA: %s\n",
+			    strerror(errno));
+		return -EFAULT;
+	} else if (read_bytes == 0) {
+		MEMPOOL_ERR("UART channel has been closed\n");
+		return -EFAULT;
+	}
+
+	uart_rx.count += read_bytes;
+
+	return 0;
+}
+
+/*
+ * Read @bytes from UART channel during @timeout milliseconds.
+ */
+static
+int mempool_uart_read(struct mempool_test_environment *env,
+		      void *buf, size_t bytes, int timeout)
+{
+	struct timespec deadline;
+	unsigned char *ptr = buf;
+	size_t copy_bytes;
+	int err;
+
+	mempool_uart_set_deadline(&deadline, timeout);
+
+	while (bytes > 0) {
+		if (uart_rx.count == 0) {
+			err = mempool_uart_rx_fill(env,
+					mempool_uart_time_left(&deadline,
+							       timeout));
+			if (err)
+				return err;
+
+			continue;
+		}
+
+		copy_bytes = uart_rx.count;
+		if (copy_bytes > bytes)
+			copy_bytes = bytes;
+
+		mempool_uart_rx_copy(ptr, copy_bytes);
+
+		ptr += copy_bytes;
+		bytes -= copy_bytes;
+	}
+
+	return 0;
+}
+
 static
 int mempool_send_preamble(struct mempool_test_environment *env,
 			  unsigned char magic,
@@ -174,8 +682,7 @@ int mempool_send_preamble(struct mempool_test_environment *env,
 			  unsigned short length)
 {
 	struct mempool_uart_preamble preamble = {0};
-	ssize_t written_bytes;
-	size_t bytes_count = sizeof(struct mempool_uart_preamble);
+	int err;
 
 	MEMPOOL_DBG(env->show_debug,
 		    "env %p\n",
@@ -187,16 +694,11 @@ int mempool_send_preamble(struct mempool_test_environment *env,
 	preamble.crc32 = checksum;
 	preamble.address = base_address + page_index;
 
-	written_bytes = write(env->uart_channel.fd,
-			      &preamble, bytes_count);
-	if (written_bytes < 0) {
-		MEMPOOL_ERR("fail to send preamble into FPGA: %s\n",
-			    strerror(errno));
-		return -EFAULT;
-	} else if (written_bytes != bytes_count) {
-		MEMPOOL_ERR("written_bytes %zd != bytes_count %zu\n",
-			    written_bytes, bytes_count);
-		return -EFAULT;
+	err = mempool_uart_write(env, &preamble,
+				 sizeof(struct mempool_uart_preamble));
+	if (err) {
+		MEMPOOL_ERR("fail to send preamble into FPGA: err %d\n", err);
+		return err;
 	}
 
 	MEMPOOL_DBG(env->show_debug,
@@ -205,181 +707,457 @@ int mempool_send_preamble(struct mempool_test_environment *env,
 	return 0;
 }
 
+/*
+ * Read answer or acknowledgement of FPGA of @size bytes during
+ * @timeout milliseconds. Bytes before answer's magic are skipped,
+ * so a lost or corrupted byte only costs one frame.
+ */
 static
-int mempool_send_footer(struct mempool_test_environment *env,
-			unsigned char magic,
-			unsigned char operation_type,
-			unsigned int checksum)
+int mempool_read_fpga_answer(struct mempool_test_environment *env,
+			     void *answer, size_t size, int timeout)
 {
-	struct mempool_uart_footer footer = {0};
-	ssize_t written_bytes;
-	size_t bytes_count = sizeof(struct mempool_uart_footer);
+	struct timespec deadline;
+	size_t skipped = 0;
+	int err;
 
-	MEMPOOL_DBG(env->show_debug,
-		    "env %p\n",
-		    env);
+	mempool_uart_set_deadline(&deadline, timeout);
 
-	footer.magic = magic;
-	footer.operation_type = operation_type;
-	footer.crc32 = checksum;
+	while (MEMPOOL_TRUE) {
+		skipped += mempool_uart_rx_resync();
 
-	written_bytes = write(env->uart_channel.fd,
-			      &footer, bytes_count);
-	if (written_bytes < 0) {
-		MEMPOOL_ERR("fail to send footer into FPGA: %s\n",
-			    strerror(errno));
-		return -EFAULT;
-	} else if (written_bytes != bytes_count) {
-		MEMPOOL_ERR("written_bytes %zd != bytes_count %zu\n",
-			    written_bytes, bytes_count);
-		return -EFAULT;
+		if (uart_rx.count >= size)
+			break;
+
+		err = mempool_uart_rx_fill(env,
+				mempool_uart_time_left(&deadline, timeout));
+		if (err)
+			return err;
 	}
 
-	MEMPOOL_DBG(env->show_debug,
-		    "footer has been sent to FPGA\n");
+	if (skipped > 0) {
+		MEMPOOL_DBG(env->show_debug,
+			    "skipped %zu bytes before answer\n",
+			    skipped);
+	}
+
+	mempool_uart_rx_copy(answer, size);
 
 	return 0;
 }
 
+static inline
+int mempool_is_frame_ack(unsigned char result)
+{
+	return result == MEMPOOL_FRAME_ACK || result == MEMPOOL_FRAME_NAK;
+}
+
 static
 int mempool_read_fpga_status(struct mempool_test_environment *env)
 {
 	struct mempool_uart_answer answer = {0};
-	ssize_t read_bytes = 0;
+	int err;
 
 	MEMPOOL_DBG(env->show_debug,
 		    "env %p\n",
 		    env);
 
+	/* late acknowledgements of retransmitted frames are skipped */
 	do {
-		read_bytes = read(env->uart_channel.fd, &answer.magic,
-				  sizeof(unsigned char));
-		if (read_bytes != sizeof(unsigned char)) {
-			MEMPOOL_ERR("fail to read answer from FPGA\n");
-			return -EFAULT;
+		err = mempool_read_fpga_answer(env, &answer,
+					sizeof(struct mempool_uart_answer),
+					MEMPOOL_UART_ANSWER_TIMEOUT);
+		if (err) {
+			MEMPOOL_ERR("fail to read answer from FPGA: err %d\n",
+				    err);
+			return err;
 		}
+	} while (mempool_is_frame_ack(answer.result));
 
-		if (answer.magic == MEMPOOL_FPGA2PC_MAGIC)
-			break;
-	} while (read_bytes > 0);
+	MEMPOOL_DBG(env->show_debug,
+		    "answer has been read from FPGA\n");
 
-	read_bytes = read(env->uart_channel.fd, &answer.result,
-			  sizeof(unsigned char));
-	if (read_bytes != sizeof(unsigned char)) {
-		MEMPOOL_ERR("fail to read answer from FPGA\n");
+	if (answer.result != 0) {
+		MEMPOOL_ERR("FPGA operation has failed\n");
 		return -EFAULT;
 	}
 
-	read_bytes = read(env->uart_channel.fd, &answer.length,
-			  sizeof(unsigned short));
-	if (read_bytes != sizeof(unsigned short)) {
-		MEMPOOL_ERR("fail to read answer from FPGA\n");
-		return -EFAULT;
-	}
+	return 0;
+}
 
-	read_bytes = read(env->uart_channel.fd, &answer.crc32,
-			  sizeof(unsigned int));
-	if (read_bytes != sizeof(unsigned int)) {
-		MEMPOOL_ERR("fail to read answer from FPGA\n");
-		return -EFAULT;
-	}
+/*
+ * Add page @page_index of @data into batch as frame: preamble,
+ * payload and footer. Payload is sent from @data without copy.
+ */
+static
+void mempool_batch_add_frame(struct mempool_uart_batch *batch,
+			     unsigned long long base_address,
+			     unsigned char operation_type,
+			     const unsigned char *data, off_t page_index,
+			     off_t bytes_count, unsigned int checksum)
+{
+	struct mempool_uart_preamble *preamble;
+	struct mempool_uart_footer *footer;
+	struct iovec *iov;
+
+	preamble = &batch->preambles[batch->frames];
+	footer = &batch->footers[batch->frames];
+	iov = &batch->iov[batch->frames * MEMPOOL_UART_FRAME_IOVECS];
+
+	memset(preamble, 0, sizeof(struct mempool_uart_preamble));
+	preamble->magic = MEMPOOL_PC2FPGA_MAGIC;
+	preamble->operation_type = operation_type;
+	preamble->length = bytes_count;
+	preamble->crc32 = checksum;
+	preamble->address = base_address + page_index;
+
+	memset(footer, 0, sizeof(struct mempool_uart_footer));
+	footer->magic = MEMPOOL_PC2FPGA_MAGIC;
+	footer->operation_type = operation_type;
+	footer->sequence = (unsigned short)page_index;
+	footer->crc32 = checksum;
+
+	iov[0].iov_base = preamble;
+	iov[0].iov_len = sizeof(struct mempool_uart_preamble);
+	iov[1].iov_base = (void *)data;
+	iov[1].iov_len = bytes_count;
+	iov[2].iov_base = footer;
+	iov[2].iov_len = sizeof(struct mempool_uart_footer);
+
+	batch->frames++;
+}
+
+/*
+ * Send all frames of batch by one writev().
+ */
+static
+int mempool_batch_flush(struct mempool_test_environment *env,
+			struct mempool_uart_batch *batch)
+{
+	int err;
+
+	if (batch->frames == 0)
+		return 0;
 
 	MEMPOOL_DBG(env->show_debug,
-		    "answer has been read from FPGA\n");
+		    "send batch: frames %d\n",
+		    batch->frames);
 
-	if (answer.result != 0) {
-		MEMPOOL_ERR("FPGA operation has failed\n");
-		return -EFAULT;
+	err = mempool_uart_writev(env, batch->iov,
+				  batch->frames * MEMPOOL_UART_FRAME_IOVECS);
+	if (err) {
+		MEMPOOL_ERR("fail to send frames into FPGA: "
+			    "frames %d, err %d\n",
+			    batch->frames, err);
 	}
 
-	return 0;
+	batch->frames = 0;
+
+	return err;
+}
+
+/*
+ * Frame size is kept by the high byte of address unless
+ * frame is MEMPOOL_PAGE_SIZE.
+ */
+static inline
+unsigned long long
+mempool_frame_base_address(struct mempool_test_environment *env,
+			   unsigned long long base_address)
+{
+	unsigned long long shift = 0;
+
+	while ((MEMPOOL_PAGE_SIZE >> shift) > env->link.frame)
+		shift++;
+
+	return base_address | (shift << MEMPOOL_FRAME_SHIFT_BITS);
 }
 
+static inline
+unsigned int mempool_page_checksum(const unsigned char *data,
+				   off_t bytes_count)
+{
+	return crc32c(~0L, data, bytes_count) ^ ~0L;
+}
+
+/*
+ * Stop-and-wait transfer: the line is drained after every page.
+ */
 static
-int __mempool_write_data_into_fpga(struct mempool_test_environment *env,
-				   unsigned long long base_address,
-				   unsigned char operation_type,
-				   void *input_addr, off_t file_size)
+int mempool_write_pages_into_fpga(struct mempool_test_environment *env,
+				  unsigned long long base_address,
+				  unsigned char operation_type,
+				  void *input_addr, off_t file_size)
 {
-	ssize_t written_bytes = 0;
+	struct mempool_uart_batch batch;
+	off_t written_bytes = 0;
 	int err = -ENODATA;
 
-	MEMPOOL_DBG(env->show_debug,
-		    "input_addr %p, file_size %lu\n",
-		    input_addr, file_size);
+	batch.frames = 0;
 
 	while (written_bytes < file_size) {
 		off_t bytes_count;
-		ssize_t sent_bytes;
-		off_t page_index = written_bytes / MEMPOOL_PAGE_SIZE;
-		unsigned int checksum;
+		off_t page_index = written_bytes / env->link.frame;
+		unsigned char *page;
 
 		bytes_count = file_size - written_bytes;
-		if (bytes_count > MEMPOOL_PAGE_SIZE)
-			bytes_count = MEMPOOL_PAGE_SIZE;
+		if (bytes_count > env->link.frame)
+			bytes_count = env->link.frame;
 
-		checksum = crc32c(~0L,
-				  (const void *)((unsigned char *)input_addr +
-								written_bytes),
-				  bytes_count);
-		checksum ^= ~0L;
+		page = (unsigned char *)input_addr + written_bytes;
 
-		err = mempool_send_preamble(env,
-					    MEMPOOL_PC2FPGA_MAGIC,
-					    base_address,
-					    page_index,
-					    operation_type,
-					    checksum,
-					    bytes_count);
-		if (err) {
-			MEMPOOL_ERR("fail to send preable into FPGA: err %d\n",
-				    err);
-			goto finish_write_data_into_fpga;
-		}
+		mempool_batch_add_frame(&batch, base_address, operation_type,
+					page, page_index, bytes_count,
+					mempool_page_checksum(page,
+							      bytes_count));
 
-		sent_bytes = write(env->uart_channel.fd,
-				   (unsigned char *)input_addr + written_bytes,
-				   bytes_count);
-		if (sent_bytes < 0) {
-			err = -EFAULT;
-			MEMPOOL_ERR("fail to write into FPGA: %s\n",
-				    strerror(errno));
-			goto finish_write_data_into_fpga;
-		} else if (sent_bytes != bytes_count) {
-			err = -EFAULT;
-			MEMPOOL_ERR("sent_bytes %zd != bytes_count %lu\n",
-				    sent_bytes, bytes_count);
-			goto finish_write_data_into_fpga;
-		}
-
-		err = mempool_send_footer(env,
-					  MEMPOOL_PC2FPGA_MAGIC,
-					  operation_type,
-					  checksum);
-		if (err) {
-			MEMPOOL_ERR("fail to send footer into FPGA: err %d\n",
-				    err);
-			goto finish_write_data_into_fpga;
-		}
+		err = mempool_batch_flush(env, &batch);
+		if (err)
+			return err;
 
 		err = tcdrain(env->uart_channel.fd);
 		if (err) {
-			err = -EFAULT;
 			MEMPOOL_ERR("wait function failed: %s\n",
 				    strerror(errno));
-			goto finish_write_data_into_fpga;
+			return -EFAULT;
 		}
 
 		written_bytes += bytes_count;
 	};
 
+	return err;
+}
+
+static inline
+off_t mempool_window_page_bytes(struct mempool_uart_window *window,
+				off_t page)
+{
+	off_t bytes_count = window->size - page * window->frame;
+
+	if (bytes_count > window->frame)
+		bytes_count = window->frame;
+
+	return bytes_count;
+}
+
+/*
+ * Add page into batch of window. Batch is sent when it is full
+ * or when the window has been filled.
+ */
+static
+int mempool_window_send(struct mempool_test_environment *env,
+			struct mempool_uart_window *window, off_t page)
+{
+	off_t bytes_count = mempool_window_page_bytes(window, page);
+	unsigned char *data = window->data + page * window->frame;
+	int err;
+
+	if (window->state[page] == MEMPOOL_PAGE_UNSENT) {
+		window->crcs[page] = mempool_page_checksum(data, bytes_count);
+	} else {
+		if (window->retries[page] >= MEMPOOL_UART_MAX_RETRIES) {
+			MEMPOOL_ERR("page cannot be delivered: "
+				    "page %lld, retries %u\n",
+				    (long long)page, window->retries[page]);
+			return -EIO;
+		}
+
+		window->retries[page]++;
+		window->retransmitted++;
+	}
+
+	window->state[page] = MEMPOOL_PAGE_IN_FLIGHT;
+
 	MEMPOOL_DBG(env->show_debug,
-		    "data stream has been sent to FPGA\n");
+		    "send page %lld, retries %u\n",
+		    (long long)page, window->retries[page]);
+
+	if (window->batch.frames == MEMPOOL_UART_BATCH_FRAMES) {
+		err = mempool_batch_flush(env, &window->batch);
+		if (err)
+			return err;
+	}
+
+	mempool_batch_add_frame(&window->batch, window->base_address,
+				window->operation_type | MEMPOOL_FRAME_ACK_FLAG,
+				data, page, bytes_count, window->crcs[page]);
+
+	return 0;
+}
+
+/*
+ * Sliding window transfer: up to @env->link.window frames are in
+ * flight and FPGA acknowledges every frame by its sequence number.
+ * Only pages with failed checksum are sent again. If acknowledgements
+ * are lost, all pages in flight are sent again after timeout.
+ */
+static
+int mempool_write_window_into_fpga(struct mempool_test_environment *env,
+				   unsigned long long base_address,
+				   unsigned char operation_type,
+				   void *input_addr, off_t file_size,
+				   unsigned long long *retransmitted)
+{
+	struct mempool_uart_window window = {0};
+	struct mempool_uart_ack ack;
+	int line_time;
+	off_t page;
+	int err = 0;
+
+	window.base_address = base_address;
+	window.operation_type = operation_type;
+	window.data = input_addr;
+	window.size = file_size;
+	window.frame = env->link.frame;
+	window.pages = (file_size + window.frame - 1) / window.frame;
+
+	if (window.pages == 0)
+		return -ENODATA;
+
+	window.state = calloc(window.pages, sizeof(unsigned char));
+	window.retries = calloc(window.pages, sizeof(unsigned char));
+	window.crcs = calloc(window.pages, sizeof(unsigned int));
+	if (!window.state || !window.retries || !window.crcs) {
+		err = -ENOMEM;
+		MEMPOOL_ERR("fail to allocate window: %s\n",
+			    strerror(errno));
+		goto free_window;
+	}
+
+	/* the whole window has to pass the line before acknowledgement */
+	line_time = mempool_uart_line_time(env, (size_t)env->link.window *
+					   (env->link.frame +
+					    sizeof(struct mempool_uart_preamble) +
+					    sizeof(struct mempool_uart_footer)));
+	window.timeout = line_time + MEMPOOL_UART_ACK_TIMEOUT;
+
+	while (window.base < window.pages) {
+		while (window.next < window.pages &&
+		       (window.next - window.base) < env->link.window) {
+			err = mempool_window_send(env, &window, window.next);
+			if (err)
+				goto free_window;
+
+			window.next++;
+		}
+
+		/* new, rejected and timed out pages are sent together */
+		err = mempool_batch_flush(env, &window.batch);
+		if (err)
+			goto free_window;
+
+		err = mempool_read_fpga_answer(env, &ack,
+					       sizeof(struct mempool_uart_ack),
+					       window.timeout);
+		if (err == -ETIMEDOUT) {
+			MEMPOOL_DBG(env->show_debug,
+				    "acknowledgement timeout: "
+				    "pages [%lld, %lld)\n",
+				    (long long)window.base,
+				    (long long)window.next);
+
+			for (page = window.base; page < window.next; page++) {
+				if (window.state[page] == MEMPOOL_PAGE_ACKED)
+					continue;
+
+				err = mempool_window_send(env, &window, page);
+				if (err)
+					goto free_window;
+			}
+
+			continue;
+		} else if (err) {
+			MEMPOOL_ERR("fail to read acknowledgement: err %d\n",
+				    err);
+			goto free_window;
+		}
+
+		/* window is shorter than the space of sequence numbers */
+		page = window.base +
+			(unsigned short)(ack.sequence -
+					 (unsigned short)window.base);
+		if (page >= window.next ||
+		    window.state[page] != MEMPOOL_PAGE_IN_FLIGHT) {
+			/* duplicate of acknowledgement */
+			continue;
+		}
+
+		if (ack.result == MEMPOOL_FRAME_ACK &&
+		    ack.crc32 == window.crcs[page]) {
+			window.state[page] = MEMPOOL_PAGE_ACKED;
+		} else {
+			MEMPOOL_DBG(env->show_debug,
+				    "page %lld is rejected: result %#x, "
+				    "crc32 %#x, expected %#x\n",
+				    (long long)page, ack.result,
+				    ack.crc32, window.crcs[page]);
+
+			err = mempool_window_send(env, &window, page);
+			if (err)
+				goto free_window;
+		}
+
+		while (window.base < window.next &&
+		       window.state[window.base] == MEMPOOL_PAGE_ACKED)
+			window.base++;
+	}
+
+	*retransmitted = window.retransmitted;
+
+free_window:
+	if (window.state)
+		free(window.state);
+
+	if (window.retries)
+		free(window.retries);
+
+	if (window.crcs)
+		free(window.crcs);
 
-finish_write_data_into_fpga:
 	return err;
 }
 
+static
+int __mempool_write_data_into_fpga(struct mempool_test_environment *env,
+				   unsigned long long base_address,
+				   unsigned char operation_type,
+				   void *input_addr, off_t file_size)
+{
+	unsigned long long retransmitted = 0;
+	int err;
+
+	MEMPOOL_DBG(env->show_debug,
+		    "input_addr %p, file_size %lu, window %d, frame %d\n",
+		    input_addr, file_size, env->link.window, env->link.frame);
+
+	base_address = mempool_frame_base_address(env, base_address);
+
+	if (env->link.window > 0) {
+		err = mempool_write_window_into_fpga(env, base_address,
+						     operation_type,
+						     input_addr, file_size,
+						     &retransmitted);
+		if (!err) {
+			MEMPOOL_INFO("Pages: sent %lld, retransmitted %llu, "
+				     "window %d\n",
+				     (long long)((file_size + env->link.frame - 1) /
+							env->link.frame),
+				     retransmitted, env->link.window);
+		}
+	} else {
+		err = mempool_write_pages_into_fpga(env, base_address,
+						    operation_type,
+						    input_addr, file_size);
+	}
+
+	if (err)
+		return err;
+
+	MEMPOOL_DBG(env->show_debug,
+		    "data stream has been sent to FPGA\n");
+
+	return 0;
+}
+
 static
 int mempool_write_data_into_fpga(struct mempool_test_environment *env,
 				 void *input_addr, off_t file_size)
@@ -390,19 +1168,9 @@ int mempool_write_data_into_fpga(struct mempool_test_environment *env,
 		    "input_addr %p, file_size %lu\n",
 		    input_addr, file_size);
 
-	err = mempool_open_channel_to_fpga(env);
-	if (err) {
-		MEMPOOL_ERR("fail to open channel to FPGA: "
-			    "err %d\n", err);
+	err = mempool_attach_channel_to_fpga(env);
+	if (err)
 		return err;
-	}
-
-	err = mempool_configure_communication_parameters(env);
-	if (err) {
-		MEMPOOL_ERR("fail to configure communication parameters: "
-			    "err %d\n", err);
-		goto close_channel;
-	}
 
 	err = __mempool_write_data_into_fpga(env,
 					     MEMPOOL_INPUT_DATA_BASE_ADDRESS,
@@ -415,6 +1183,10 @@ int mempool_write_data_into_fpga(struct mempool_test_environment *env,
 		goto close_channel;
 	}
 
+	/* every frame has been acknowledged by sliding window */
+	if (env->link.window > 0)
+		goto close_channel;
+
 	err = mempool_read_fpga_status(env);
 	if (err) {
 		MEMPOOL_ERR("write operation failed: "
@@ -423,7 +1195,7 @@ int mempool_write_data_into_fpga(struct mempool_test_environment *env,
 	}
 
 close_channel:
-	mempool_close_channel_to_fpga(env);
+	mempool_detach_channel_from_fpga(env);
 
 	MEMPOOL_DBG(env->show_debug,
 		    "write operation has been finished: "
@@ -439,87 +1211,283 @@ int __mempool_read_result_from_fpga(struct mempool_test_environment *env,
 	struct mempool_uart_answer answer = {0};
 	ssize_t read_bytes = 0;
 	ssize_t checked_bytes = 0;
-	unsigned int checksum = 0;
+	unsigned int checksum = ~0U;
+	int err;
 
 	MEMPOOL_DBG(env->show_debug,
 		    "output_addr %p, file_size %lu\n",
 		    output_addr, file_size);
 
+	/* late acknowledgements of retransmitted frames are skipped */
 	do {
-		read_bytes = read(env->uart_channel.fd, &answer.magic,
-				  sizeof(unsigned char));
-		if (read_bytes != sizeof(unsigned char)) {
-			MEMPOOL_ERR("fail to read answer from FPGA\n");
-			return -EFAULT;
+		err = mempool_read_fpga_answer(env, &answer,
+					sizeof(struct mempool_uart_answer),
+					MEMPOOL_UART_ANSWER_TIMEOUT);
+		if (err) {
+			MEMPOOL_ERR("fail to read answer from FPGA: err %d\n",
+				    err);
+			return err;
+		}
+	} while (mempool_is_frame_ack(answer.result));
+
+	MEMPOOL_DBG(env->show_debug,
+		    "answer has been read from FPGA\n");
+
+	if (answer.result != 0) {
+		MEMPOOL_ERR("FPGA operation has failed\n");
+		return -EFAULT;
+	}
+
+	if (answer.length > file_size) {
+		MEMPOOL_ERR("answer.length %u > file_size %lu\n",
+			    answer.length, file_size);
+		return -EFAULT;
+	}
+
+	err = mempool_uart_read(env, output_addr, answer.length,
+				mempool_uart_line_time(env, answer.length) +
+					MEMPOOL_UART_ACK_TIMEOUT);
+	if (err) {
+		MEMPOOL_ERR("fail to read result data from FPGA: err %d\n",
+			    err);
+		return err;
+	}
+
+	read_bytes = answer.length;
+
+	/* checksum of the whole payload */
+	while (checked_bytes < read_bytes) {
+		off_t bytes_count;
+
+		bytes_count = read_bytes - checked_bytes;
+		if (bytes_count > MEMPOOL_PAGE_SIZE)
+			bytes_count = MEMPOOL_PAGE_SIZE;
+
+		checksum = crc32c(checksum,
+				  (const void *)((unsigned char *)output_addr +
+								checked_bytes),
+				  bytes_count);
+		checked_bytes += bytes_count;
+	}
+
+	checksum ^= ~0U;
+
+	if (checksum != answer.crc32) {
+		MEMPOOL_ERR("checksum %u != answer.crc32 %u\n",
+			    checksum, answer.crc32);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+/*
+ * Receive the next page of result into @output_addr. Page has to be
+ * one of @count pages from @first_page that is not marked in
+ * @received map and its index is returned in @page_index (-1 if
+ * header is damaged). It returns 1 for the last
+ * page of result, -EAGAIN for damaged page, -ETIMEDOUT if no page
+ * has arrived or negative error code.
+ */
+static
+int mempool_read_result_page(struct mempool_test_environment *env,
+			     void *output_addr, off_t file_size,
+			     const unsigned char *received,
+			     off_t first_page, off_t count,
+			     off_t *page_index)
+{
+	struct mempool_uart_page page;
+	unsigned char *data;
+	unsigned int checksum;
+	off_t offset;
+	int timeout;
+	int err;
+
+	*page_index = -1;
+
+	/* result is ready, so the page follows the previous one */
+	timeout = mempool_uart_line_time(env, env->link.frame +
+					 sizeof(struct mempool_uart_page)) +
+			MEMPOOL_UART_ACK_TIMEOUT;
+
+	do {
+		err = mempool_read_fpga_answer(env, &page,
+					       sizeof(struct mempool_uart_page),
+					       timeout);
+		if (err)
+			return err;
+	} while (mempool_is_frame_ack(page.result));
+
+	/*
+	 * Bytes of damaged frame look like header: the next answer's
+	 * magic is looked for by the next call.
+	 */
+	if (page.address < first_page || page.address >= first_page + count ||
+	    received[page.address] || page.length > env->link.frame) {
+		MEMPOOL_DBG(env->show_debug,
+			    "unexpected page: address %llu, length %u, "
+			    "expected pages [%lld, %lld)\n",
+			    page.address, page.length,
+			    (long long)first_page,
+			    (long long)(first_page + count));
+		return -EAGAIN;
+	}
+
+	if (page.result != 0) {
+		MEMPOOL_ERR("FPGA operation has failed: "
+			    "page %llu, result %#x\n",
+			    page.address, page.result);
+		return -EFAULT;
+	}
+
+	offset = (off_t)page.address * env->link.frame;
+
+	if (offset + page.length > file_size) {
+		MEMPOOL_ERR("result is bigger than file: "
+			    "offset %lld, length %u, file_size %lu\n",
+			    (long long)offset, page.length, file_size);
+		return -E2BIG;
+	}
+
+	data = (unsigned char *)output_addr + offset;
+
+	err = mempool_uart_read(env, data, page.length,
+				mempool_uart_line_time(env, page.length) +
+					MEMPOOL_UART_ACK_TIMEOUT);
+	if (err)
+		return err;
+
+	*page_index = page.address;
+
+	checksum = mempool_page_checksum(data, page.length);
+	if (checksum != page.crc32) {
+		MEMPOOL_DBG(env->show_debug,
+			    "page %llu is corrupted: crc32 %#x, expected %#x\n",
+			    page.address, checksum, page.crc32);
+		return -EAGAIN;
+	}
+
+	return page.length < env->link.frame ? 1 : 0;
+}
+
+/*
+ * Result is requested by chunks of up to @env->link.window pages that
+ * have not been received yet. Every page is verified and stored into
+ * @output_addr as soon as it has been received. Damaged page does not
+ * stop the chunk: the following pages are received and only damaged
+ * or lost pages are requested again by the next chunk.
+ */
+static
+int mempool_read_pages_from_fpga(struct mempool_test_environment *env,
+				 void *output_addr, off_t file_size)
+{
+	off_t pages = (file_size + env->link.frame - 1) / env->link.frame;
+	unsigned char *received;
+	off_t next = 0;
+	off_t count;
+	off_t answered;
+	off_t got;
+	off_t index;
+	unsigned int retries = 0;
+	unsigned long long resumed = 0;
+	int err = 0;
+
+	received = calloc(pages > 0 ? pages : 1, sizeof(unsigned char));
+	if (!received) {
+		MEMPOOL_ERR("fail to allocate pages map: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	while (next < pages) {
+		/* only pages that have not been received are requested */
+		for (count = 0; count < env->link.window; count++) {
+			if (next + count >= pages || received[next + count])
+				break;
+		}
+
+		err = mempool_send_preamble(env,
+					    MEMPOOL_PC2FPGA_MAGIC,
+					    mempool_frame_base_address(env, 0),
+					    next,
+					    MEMPOOL_READ_RESULT |
+						MEMPOOL_FRAME_ACK_FLAG,
+					    0,
+					    count);
+		if (err) {
+			MEMPOOL_ERR("fail to request result: "
+				    "page %lld, err %d\n",
+				    (long long)next, err);
+			goto free_pages_map;
 		}
 
-		if (answer.magic == MEMPOOL_FPGA2PC_MAGIC)
-			break;
-	} while (read_bytes > 0);
+		got = 0;
+
+		for (answered = 0; answered < count; ) {
+			err = mempool_read_result_page(env, output_addr,
+							file_size, received,
+							next, count, &index);
+			if (err == -ETIMEDOUT)
+				break;
+
+			if (index >= 0)
+				answered++;
+
+			if (err == -EAGAIN) {
+				continue;
+			} else if (err < 0) {
+				MEMPOOL_ERR("fail to read result: "
+					    "offset %lld, err %d\n",
+					    (long long)next * env->link.frame,
+					    err);
+				goto free_pages_map;
+			}
+
+			received[index] = MEMPOOL_TRUE;
+			got++;
+
+			/* the last page of result is shorter than frame */
+			if (err > 0 && index + 1 < pages) {
+				pages = index + 1;
+				if (count > pages - next)
+					count = pages - next;
+			}
+		}
 
-	read_bytes = read(env->uart_channel.fd, &answer.result,
-			  sizeof(unsigned char));
-	if (read_bytes != sizeof(unsigned char)) {
-		MEMPOOL_ERR("fail to read answer from FPGA\n");
-		return -EFAULT;
-	}
+		err = 0;
 
-	read_bytes = read(env->uart_channel.fd, &answer.length,
-			  sizeof(unsigned short));
-	if (read_bytes != sizeof(unsigned short)) {
-		MEMPOOL_ERR("fail to read answer from FPGA\n");
-		return -EFAULT;
-	}
+		while (next < pages && received[next])
+			next++;
 
-	read_bytes = read(env->uart_channel.fd, &answer.crc32,
-			  sizeof(unsigned int));
-	if (read_bytes != sizeof(unsigned int)) {
-		MEMPOOL_ERR("fail to read answer from FPGA\n");
-		return -EFAULT;
-	}
+		if (got > 0)
+			retries = 0;
 
-	MEMPOOL_DBG(env->show_debug,
-		    "answer has been read from FPGA\n");
+		/* the whole chunk has been received */
+		if (got >= count)
+			continue;
 
-	if (answer.result != 0) {
-		MEMPOOL_ERR("FPGA operation has failed\n");
-		return -EFAULT;
-	}
+		if (got == 0 && ++retries > MEMPOOL_UART_MAX_RETRIES) {
+			MEMPOOL_ERR("result cannot be read: "
+				    "offset %lld\n",
+				    (long long)next * env->link.frame);
+			err = -EIO;
+			goto free_pages_map;
+		}
 
-	if (answer.length > file_size) {
-		MEMPOOL_ERR("answer.length %u > file_size %lu\n",
-			    answer.length, file_size);
-		return -EFAULT;
-	}
+		MEMPOOL_DBG(env->show_debug,
+			    "resume reading from page %lld\n",
+			    (long long)next);
 
-	read_bytes = read(env->uart_channel.fd, output_addr,
-			  answer.length);
-	if (read_bytes != answer.length) {
-		MEMPOOL_ERR("fail to read result data from FPGA\n");
-		return -EFAULT;
+		resumed++;
 	}
 
-	while (checked_bytes < read_bytes) {
-		off_t bytes_count;
-
-		bytes_count = read_bytes - checked_bytes;
-		if (bytes_count > MEMPOOL_PAGE_SIZE)
-			bytes_count = MEMPOOL_PAGE_SIZE;
-
-		checksum = crc32c(~0L,
-				  (const void *)((unsigned char *)output_addr +
-								checked_bytes),
-				  bytes_count);
-		checksum ^= ~0L;
-	}
+	MEMPOOL_INFO("Result: pages %lld, resumed %llu\n",
+		     (long long)pages, resumed);
 
-	if (checksum != answer.crc32) {
-		MEMPOOL_ERR("checksum %u != answer.crc32 %u\n",
-			    checksum, answer.crc32);
-		return -EFAULT;
-	}
+free_pages_map:
+	free(received);
 
-	return 0;
+	return err;
 }
 
 static
@@ -532,17 +1500,18 @@ int mempool_read_result_from_fpga(struct mempool_test_environment *env,
 		    "output_addr %p, file_size %lu\n",
 		    output_addr, file_size);
 
-	err = mempool_open_channel_to_fpga(env);
-	if (err) {
-		MEMPOOL_ERR("fail to open channel to FPGA: "
-			    "err %d\n", err);
+	err = mempool_attach_channel_to_fpga(env);
+	if (err)
 		return err;
-	}
 
-	err = mempool_configure_communication_parameters(env);
-	if (err) {
-		MEMPOOL_ERR("fail to configure communication parameters: "
-			    "err %d\n", err);
+	if (env->link.window > 0) {
+		err = mempool_read_pages_from_fpga(env, output_addr,
+						   file_size);
+		if (err) {
+			MEMPOOL_ERR("fail to read result form FPGA: err %d\n",
+				    err);
+		}
+
 		goto close_channel;
 	}
 
@@ -567,7 +1536,7 @@ int mempool_read_result_from_fpga(struct mempool_test_environment *env,
 	}
 
 close_channel:
-	mempool_close_channel_to_fpga(env);
+	mempool_detach_channel_from_fpga(env);
 
 	MEMPOOL_DBG(env->show_debug,
 		    "read operation has been finished: "
@@ -615,19 +1584,9 @@ int __mempool_fpga_execute_algorithm(struct mempool_test_environment *env)
 		item->request.algorithm.end = env->portion.capacity;
 	}
 
-	err = mempool_open_channel_to_fpga(env);
-	if (err) {
-		MEMPOOL_ERR("fail to open channel to FPGA: "
-			    "err %d\n", err);
+	err = mempool_attach_channel_to_fpga(env);
+	if (err)
 		goto free_array;
-	}
-
-	err = mempool_configure_communication_parameters(env);
-	if (err) {
-		MEMPOOL_ERR("fail to configure communication parameters: "
-			    "err %d\n", err);
-		goto close_channel;
-	}
 
 	err = __mempool_write_data_into_fpga(env,
 				     MEMPOOL_MANAGEMENT_PAGE_BASE_ADDRESS,
@@ -660,7 +1619,7 @@ int __mempool_fpga_execute_algorithm(struct mempool_test_environment *env)
 	}
 
 close_channel:
-	mempool_close_channel_to_fpga(env);
+	mempool_detach_channel_from_fpga(env);
 
 free_array:
 	if (array)
@@ -771,13 +1730,402 @@ int mempool_execute_algorithm_by_fpga(struct mempool_test_environment *env)
 	return err;
 }
 
+static inline
+double mempool_elapsed_seconds(struct timespec *start,
+			       struct timespec *finish)
+{
+	return (finish->tv_sec - start->tv_sec) +
+			(finish->tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/*
+ * Drop acknowledgements of failed probe that are still on the line:
+ * received bytes are discarded till the line becomes silent.
+ */
+static
+void mempool_uart_rx_discard(struct mempool_test_environment *env)
+{
+	do {
+		uart_rx.head = 0;
+		uart_rx.count = 0;
+	} while (mempool_uart_rx_fill(env, MEMPOOL_UART_ACK_TIMEOUT) == 0);
+
+	uart_rx.head = 0;
+	uart_rx.count = 0;
+}
+
+/*
+ * Send test frames of @probe by sliding window with the current
+ * window and frame size. It returns goodput in bytes per second
+ * or zero if the link is not reliable.
+ */
+static
+double mempool_probe_link(struct mempool_test_environment *env,
+			  unsigned char *probe)
+{
+	struct timespec start_time, finish_time;
+	unsigned long long retransmitted = 0;
+	long long frames;
+	double goodput = 0;
+	double seconds;
+	int reliable;
+	int err;
+
+	frames = (MEMPOOL_UART_PROBE_SIZE + env->link.frame - 1) /
+							env->link.frame;
+
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+	err = mempool_write_window_into_fpga(env,
+			mempool_frame_base_address(env,
+					MEMPOOL_INPUT_DATA_BASE_ADDRESS),
+			MEMPOOL_WRITE_INPUT_DATA,
+			probe, MEMPOOL_UART_PROBE_SIZE,
+			&retransmitted);
+
+	clock_gettime(CLOCK_MONOTONIC, &finish_time);
+
+	seconds = mempool_elapsed_seconds(&start_time, &finish_time);
+
+	reliable = !err && retransmitted * 100 <=
+				frames * MEMPOOL_UART_MAX_ERROR_RATE;
+	if (reliable && seconds > 0)
+		goodput = MEMPOOL_UART_PROBE_SIZE / seconds;
+
+	MEMPOOL_INFO("Probe: window %d, frame %d, goodput %.0f bytes/s, "
+		     "retransmitted %llu of %lld frames, %s\n",
+		     env->link.window, env->link.frame, goodput,
+		     retransmitted, frames,
+		     reliable ? "reliable" : "unreliable");
+
+	/* the rest of answers is not valid for the next probe */
+	if (err)
+		mempool_uart_rx_discard(env);
+
+	return goodput;
+}
+
+/*
+ * Probe frames from MEMPOOL_PAGE_SIZE to MEMPOOL_MIN_LINK_FRAME with
+ * windows from one frame to MEMPOOL_MAX_LINK_WINDOW. Larger window is
+ * not probed if it does not improve goodput of the frame size. Baud
+ * rate is not probed: FPGA does not change it, so the configured
+ * baud rate has to be the rate of FPGA. Test frames are written into
+ * input memory of FPGA, so the link is calibrated before upload
+ * of input data.
+ */
+static
+int mempool_calibrate_link(struct mempool_test_environment *env)
+{
+	unsigned char *probe;
+	double goodput;
+	double frame_goodput;
+	double best_goodput = 0;
+	int best_window = env->link.window;
+	int best_frame = env->link.frame;
+	int i;
+	int err;
+
+	probe = malloc(MEMPOOL_UART_PROBE_SIZE);
+	if (!probe) {
+		MEMPOOL_ERR("fail to allocate probe: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	/* every byte value passes the line */
+	for (i = 0; i < MEMPOOL_UART_PROBE_SIZE; i++)
+		probe[i] = (unsigned char)(i * 131 + (i >> 8));
+
+	err = mempool_attach_channel_to_fpga(env);
+	if (err)
+		goto free_probe;
+
+	for (env->link.frame = MEMPOOL_PAGE_SIZE;
+	     env->link.frame >= MEMPOOL_MIN_LINK_FRAME;
+	     env->link.frame /= MEMPOOL_UART_PROBE_FRAME_STEP) {
+		frame_goodput = 0;
+
+		for (env->link.window = 1;
+		     env->link.window <= MEMPOOL_MAX_LINK_WINDOW;
+		     env->link.window *= MEMPOOL_UART_PROBE_WINDOW_STEP) {
+			goodput = mempool_probe_link(env, probe);
+			if (goodput <= frame_goodput)
+				break;
+
+			frame_goodput = goodput;
+
+			if (goodput > best_goodput) {
+				best_goodput = goodput;
+				best_window = env->link.window;
+				best_frame = env->link.frame;
+			}
+		}
+	}
+
+	env->link.window = best_window;
+	env->link.frame = best_frame;
+
+	if (best_goodput == 0) {
+		err = -EIO;
+		MEMPOOL_ERR("link is not reliable with any frame size: "
+			    "baud %d\n", env->link.baud);
+		goto close_channel;
+	}
+
+	MEMPOOL_INFO("Link: baud %d, window %d, frame %d, "
+		     "goodput %.0f bytes/s\n",
+		     env->link.baud, env->link.window, env->link.frame,
+		     best_goodput);
+
+close_channel:
+	mempool_detach_channel_from_fpga(env);
+
+free_probe:
+	free(probe);
+
+	return err;
+}
+
+/*
+ * Session opens and configures the channel once: upload,
+ * execution and readback of every job are sent over it.
+ */
+static
+int mempool_run_session(struct mempool_test_environment *env,
+			void *input_data, void *output_data,
+			off_t data_size)
+{
+	struct timespec start_time, upload_time, execute_time, finish_time;
+	int job;
+	int err;
+
+	MEMPOOL_DBG(env->show_debug,
+		    "jobs %d, input %p, output %p, data_size %lu\n",
+		    env->session.jobs, input_data, output_data, data_size);
+
+	err = mempool_attach_channel_to_fpga(env);
+	if (err)
+		return err;
+
+	for (job = 0; job < env->session.jobs; job++) {
+		clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+		if (input_data) {
+			err = mempool_write_data_into_fpga(env, input_data,
+							   data_size);
+			if (err) {
+				MEMPOOL_ERR("fail to write data into FPGA: "
+					    "job %d, err %d\n", job, err);
+				goto close_channel;
+			}
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &upload_time);
+
+		err = mempool_execute_algorithm_by_fpga(env);
+		if (err) {
+			MEMPOOL_ERR("fail to execute an algorithm by FPGA: "
+				    "job %d, err %d\n", job, err);
+			goto close_channel;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &execute_time);
+
+		if (output_data) {
+			err = mempool_read_result_from_fpga(env, output_data,
+							    data_size);
+			if (err) {
+				MEMPOOL_ERR("fail to read result from FPGA: "
+					    "job %d, err %d\n", job, err);
+				goto close_channel;
+			}
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &finish_time);
+
+		/* phases are parsed by calibration of timing model */
+		MEMPOOL_INFO("Job %d: upload %.6f, execute %.6f, "
+			     "readback %.6f seconds\n",
+			     job,
+			     mempool_elapsed_seconds(&start_time, &upload_time),
+			     mempool_elapsed_seconds(&upload_time,
+						     &execute_time),
+			     mempool_elapsed_seconds(&execute_time,
+						     &finish_time));
+		MEMPOOL_INFO("Job %d: time %.3f seconds\n",
+			     job,
+			     mempool_elapsed_seconds(&start_time, &finish_time));
+	}
+
+close_channel:
+	mempool_close_channel_to_fpga(env);
+
+	return err;
+}
+
+/*
+ * FPGA receives portions back-to-back: payloads of container
+ * are gathered into contiguous buffer if the stride is bigger
+ * than portion. Encoded portions are decoded and PAX portions
+ * are converted into rows in the buffer.
+ */
+static
+int mempool_gather_input_container(struct mempool_test_environment *env,
+				   struct mempool_container *container,
+				   void *input_addr, void **data)
+{
+	size_t portion_size = env->threads.portion_size;
+	void *buf = NULL;
+	int i;
+	int err;
+
+	for (i = 0; i < container->portions_count; i++) {
+		unsigned long long offset = container->portions[i].offset;
+
+		err = mempool_container_check_portion(container, i,
+						(u_int8_t *)input_addr + offset);
+		if (!err && container->encoding != MEMPOOL_PLAIN_ENCODING) {
+			err = mempool_codec_check((u_int8_t *)input_addr + offset,
+						  container->portions[i].bytes,
+						  container->granularity,
+						  container->record_capacity,
+						  container->portions[i].records);
+		}
+
+		if (err) {
+			MEMPOOL_ERR("corrupted portion: "
+				    "index %d, err %d\n", i, err);
+			return err;
+		}
+	}
+
+	if (container->encoding == MEMPOOL_PLAIN_ENCODING &&
+	    container->layout == MEMPOOL_ROW_LAYOUT &&
+	    container->stride == portion_size) {
+		*data = (u_int8_t *)input_addr + container->payload_offset;
+		return 0;
+	}
+
+	buf = malloc(portion_size * container->portions_count);
+	if (!buf) {
+		MEMPOOL_ERR("fail to allocate buffer: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < container->portions_count; i++) {
+		u_int8_t *payload = (u_int8_t *)input_addr +
+					container->portions[i].offset;
+
+		if (container->layout == MEMPOOL_PAX_LAYOUT) {
+			memset((u_int8_t *)buf + portion_size * i,
+				0, portion_size);
+			mempool_pax_to_rows(payload,
+					    (u_int8_t *)buf + portion_size * i,
+					    container->portions[i].records,
+					    container->granularity,
+					    container->record_capacity);
+			continue;
+		} else if (container->encoding == MEMPOOL_PLAIN_ENCODING) {
+			memcpy((u_int8_t *)buf + portion_size * i,
+				payload, portion_size);
+			continue;
+		}
+
+		err = mempool_codec_decode(payload,
+					   (u_int8_t *)buf + portion_size * i,
+					   portion_size);
+		if (err) {
+			MEMPOOL_ERR("fail to decode portion: "
+				    "index %d, err %d\n", i, err);
+			free(buf);
+			return err;
+		}
+	}
+
+	*data = buf;
+	return 0;
+}
+
+static
+int mempool_create_output_container(struct mempool_test_environment *env,
+				    struct mempool_container *container)
+{
+	int err;
+
+	err = mempool_container_create(container, env->threads.count,
+			mempool_container_align(env->threads.portion_size));
+	if (err)
+		return err;
+
+	container->granularity = env->item.granularity;
+	container->record_capacity = env->record.capacity;
+	container->portion_capacity = env->portion.capacity;
+	container->key_mask = env->key.mask;
+	container->value_mask = env->value.mask;
+	container->algorithm = env->algorithm.id;
+
+	return 0;
+}
+
+/*
+ * Result is read back-to-back and every portion keeps
+ * portion.count records (the whole capacity by default).
+ */
+static
+int mempool_write_output_container(struct mempool_test_environment *env,
+				   struct mempool_container *container,
+				   void *output_addr, void *data)
+{
+	size_t portion_size = env->threads.portion_size;
+	unsigned int records = env->portion.count;
+	unsigned long long bytes;
+	int i;
+
+	if (records == 0)
+		records = env->portion.capacity;
+
+	bytes = (unsigned long long)records * env->item.granularity *
+					env->record.capacity;
+
+	for (i = 0; i < container->portions_count; i++) {
+		struct mempool_container_portion *portion;
+		u_int8_t *payload;
+
+		portion = &container->portions[i];
+		payload = (u_int8_t *)output_addr + portion->offset;
+
+		if (container->stride != portion_size) {
+			memcpy(payload,
+				(u_int8_t *)data + portion_size * i,
+				portion_size);
+		}
+
+		portion->records = records;
+		portion->bytes = bytes;
+		portion->crc = mempool_container_crc(payload, bytes);
+	}
+
+	return mempool_container_write(env->output_file.fd, container);
+}
+
 int main(int argc, char *argv[])
 {
 	struct mempool_test_environment environment;
+	struct mempool_container input_container;
+	struct mempool_container output_container;
+	struct stat file_stat;
 	void *input_addr = NULL;
 	void *output_addr = NULL;
-	off_t file_size;
-	unsigned int portion_size;
+	void *input_data = NULL;
+	void *output_data = NULL;
+	void *input_buffer = NULL;
+	void *output_buffer = NULL;
+	off_t input_size = 0;
+	off_t output_size = 0;
+	off_t data_size = 0;
+	long long portion_size;
 	int err = 0;
 
 	environment.input_file.fd = -1;
@@ -791,6 +2139,7 @@ int main(int argc, char *argv[])
 	environment.uart_channel.name = NULL;
 	environment.threads.count = 0;
 	environment.threads.portion_size = 0;
+	environment.workers.count = 1;
 	environment.item.granularity = 1;
 	environment.record.capacity = 1;
 	environment.portion.capacity = 0;
@@ -799,14 +2148,52 @@ int main(int argc, char *argv[])
 	environment.value.mask = 0;
 	environment.condition.min = 0;
 	environment.condition.max = ULLONG_MAX;
+	environment.limit.count = 0;
+	environment.limit.order = MEMPOOL_ASCENDING_ORDER;
+	environment.distinct.output = MEMPOOL_DISTINCT_KEY_OUTPUT;
+	environment.numa.mode = MEMPOOL_NUMA_NONE_MODE;
+	environment.map.mode = MEMPOOL_MAP_POPULATE_MODE;
+	environment.huge_pages.mode = MEMPOOL_HUGE_PAGES_NONE_MODE;
+	environment.stream.budget = 0;
+	environment.stream.backend = MEMPOOL_PREAD_IO_BACKEND;
+	environment.stream.depth = MEMPOOL_DEFAULT_IO_DEPTH;
+	environment.stream.direct = MEMPOOL_FALSE;
 	environment.algorithm.id = MEMPOOL_UNKNOWN_ALGORITHM;
+	environment.format.input = MEMPOOL_UNKNOWN_FORMAT;
+	environment.format.output = MEMPOOL_UNKNOWN_FORMAT;
+	environment.layout.input = MEMPOOL_ROW_LAYOUT;
+	environment.layout.output = MEMPOOL_ROW_LAYOUT;
+	environment.checksum.enabled = MEMPOOL_FALSE;
+	environment.link.window = MEMPOOL_DEFAULT_LINK_WINDOW;
+	environment.link.baud = MEMPOOL_UART_BAUD_RATE;
+	environment.link.flow = MEMPOOL_NO_FLOW_CONTROL;
+	environment.link.frame = MEMPOOL_PAGE_SIZE;
+	environment.link.calibrate = MEMPOOL_FALSE;
+	environment.session.jobs = 0;
 	environment.show_debug = MEMPOOL_FALSE;
 
+	memset(&input_container, 0, sizeof(struct mempool_container));
+	memset(&output_container, 0, sizeof(struct mempool_container));
+
 	parse_options(argc, argv, &environment);
 
 	MEMPOOL_DBG(environment.show_debug,
 		    "options have been parsed\n");
 
+	if (mempool_uart_baud2speed(environment.link.baud) == B0) {
+		err = -EINVAL;
+		MEMPOOL_ERR("unsupported baud rate %d\n",
+			    environment.link.baud);
+		goto finish_execution;
+	}
+
+	/* test frames overwrite the beginning of input memory of FPGA */
+	if (environment.link.calibrate && !environment.input_file.name) {
+		err = -EINVAL;
+		MEMPOOL_ERR("link calibration requires input file\n");
+		goto finish_execution;
+	}
+
 	if (environment.portion.count > environment.portion.capacity) {
 		err = -ERANGE;
 		MEMPOOL_ERR("invalid portion descriptor: "
@@ -816,7 +2203,7 @@ int main(int argc, char *argv[])
 		goto finish_execution;
 	}
 
-	portion_size = (unsigned int)environment.item.granularity *
+	portion_size = (long long)environment.item.granularity *
 			environment.record.capacity;
 	portion_size *= environment.portion.capacity;
 
@@ -832,10 +2219,33 @@ int main(int argc, char *argv[])
 			goto finish_execution;
 		}
 
+		err = mempool_container_read(environment.input_file.fd,
+					     &input_container);
+		if (err == -ENOMSG) {
+			environment.format.input = MEMPOOL_RAW_FORMAT;
+			err = 0;
+		} else if (err) {
+			MEMPOOL_ERR("fail to read container: %s, err %d\n",
+				    environment.input_file.name, err);
+			goto close_files;
+		} else {
+			environment.format.input = MEMPOOL_CONTAINER_FORMAT;
+
+			err = mempool_container_load_geometry(&input_container,
+							      &environment);
+			if (err) {
+				MEMPOOL_ERR("fail to load geometry: err %d\n",
+					    err);
+				goto close_files;
+			}
+
+			portion_size = environment.threads.portion_size;
+		}
+
 		if (portion_size != environment.threads.portion_size) {
 			err = -ERANGE;
 			MEMPOOL_ERR("invalid request: "
-				    "portion_size %d, granularity %d, "
+				    "portion_size %lld, granularity %d, "
 				    "record_capacity %d, portion_capacity %d\n",
 				    environment.threads.portion_size,
 				    environment.item.granularity,
@@ -844,12 +2254,32 @@ int main(int argc, char *argv[])
 			goto close_files;
 		}
 
-		file_size = (off_t)environment.threads.count *
+		data_size = (off_t)environment.threads.count *
 				environment.threads.portion_size;
+		input_size = data_size;
+
+		if (environment.format.input == MEMPOOL_CONTAINER_FORMAT) {
+			if (fstat(environment.input_file.fd, &file_stat)) {
+				err = -errno;
+				MEMPOOL_ERR("fail to get file size: %s\n",
+					    strerror(errno));
+				goto close_files;
+			}
+
+			input_size = file_stat.st_size;
+
+			if (mempool_container_file_size(&input_container) >
+								input_size) {
+				err = -ERANGE;
+				MEMPOOL_ERR("truncated container: "
+					    "file_size %lu\n", input_size);
+				goto close_files;
+			}
+		}
 
 		MEMPOOL_INFO("Mmap input file...\n");
 
-		input_addr = mmap(0, file_size, PROT_READ,
+		input_addr = mmap(0, input_size, PROT_READ,
 				  MAP_SHARED|MAP_POPULATE,
 				  environment.input_file.fd, 0);
 		if (input_addr == MAP_FAILED) {
@@ -859,18 +2289,25 @@ int main(int argc, char *argv[])
 			goto munmap_memory;
 		}
 
-		MEMPOOL_INFO("Write data into FPGA...\n");
+		input_data = input_addr;
 
-		err = mempool_write_data_into_fpga(&environment,
-						   input_addr,
-						   file_size);
-		if (err) {
-			MEMPOOL_ERR("fail to write data into FPGA board: "
-				    "file_size %lu, err %d\n",
-				    file_size, err);
-			goto munmap_memory;
+		if (environment.format.input == MEMPOOL_CONTAINER_FORMAT) {
+			err = mempool_gather_input_container(&environment,
+							     &input_container,
+							     input_addr,
+							     &input_data);
+			if (err)
+				goto munmap_memory;
+
+			if (input_data != (u_int8_t *)input_addr +
+					input_container.payload_offset)
+				input_buffer = input_data;
 		}
-	} else if (environment.output_file.name) {
+	}
+
+	/* session reads result of job uploaded by the same run */
+	if (environment.output_file.name &&
+	    (environment.session.jobs > 0 || !environment.input_file.name)) {
 		MEMPOOL_INFO("Open output file...\n");
 
 		environment.output_file.fd = open(environment.output_file.name,
@@ -879,52 +2316,121 @@ int main(int argc, char *argv[])
 			err = -ENOENT;
 			MEMPOOL_ERR("fail to open file: %s\n",
 				    strerror(errno));
-			goto finish_execution;
+			goto munmap_memory;
 		}
 
 		if (portion_size != environment.threads.portion_size) {
 			err = -ERANGE;
 			MEMPOOL_ERR("invalid request: "
-				    "portion_size %d, granularity %d, "
+				    "portion_size %lld, granularity %d, "
 				    "record_capacity %d, portion_capacity %d\n",
 				    environment.threads.portion_size,
 				    environment.item.granularity,
 				    environment.record.capacity,
 				    environment.portion.capacity);
-			goto close_files;
+			goto munmap_memory;
 		}
 
-		file_size = (off_t)environment.threads.count *
+		data_size = (off_t)environment.threads.count *
 				environment.threads.portion_size;
+		output_size = data_size;
+
+		if (environment.format.output == MEMPOOL_CONTAINER_FORMAT) {
+			err = mempool_create_output_container(&environment,
+							&output_container);
+			if (err) {
+				MEMPOOL_ERR("fail to create container: "
+					    "err %d\n", err);
+				goto munmap_memory;
+			}
+
+			output_size =
+				mempool_container_file_size(&output_container);
+		}
 
-		err = ftruncate(environment.output_file.fd, file_size);
+		err = ftruncate(environment.output_file.fd, output_size);
 		if (err) {
 			MEMPOOL_ERR("fail to prepare output file: %s\n",
 				    strerror(errno));
-			goto close_files;
+			goto munmap_memory;
 		}
 
 		MEMPOOL_INFO("Mmap output file...\n");
 
-		output_addr = mmap(0, file_size, PROT_READ|PROT_WRITE,
+		output_addr = mmap(0, output_size, PROT_READ|PROT_WRITE,
 				  MAP_SHARED|MAP_POPULATE,
 				  environment.output_file.fd, 0);
 		if (output_addr == MAP_FAILED) {
 			output_addr = NULL;
 			MEMPOOL_ERR("fail to mmap output file: %s\n",
 				    strerror(errno));
-			goto close_files;
+			goto munmap_memory;
+		}
+
+		output_data = output_addr;
+
+		if (environment.format.output == MEMPOOL_CONTAINER_FORMAT) {
+			output_data = (u_int8_t *)output_addr +
+					output_container.payload_offset;
+
+			if (output_container.stride != portion_size) {
+				output_buffer = malloc(data_size);
+				if (!output_buffer) {
+					err = -ENOMEM;
+					MEMPOOL_ERR("fail to allocate buffer: "
+						    "%s\n", strerror(errno));
+					goto munmap_memory;
+				}
+
+				output_data = output_buffer;
+			}
+		}
+	}
+
+	if (environment.link.calibrate) {
+		MEMPOOL_INFO("Calibrate UART link...\n");
+
+		err = mempool_calibrate_link(&environment);
+		if (err) {
+			MEMPOOL_ERR("fail to calibrate link: err %d\n", err);
+			goto munmap_memory;
+		}
+	}
+
+	if (environment.session.jobs > 0) {
+		MEMPOOL_INFO("Run jobs over UART session: "
+			     "jobs %d, crc32c %s...\n",
+			     environment.session.jobs, crc32c_name());
+
+		err = mempool_run_session(&environment, input_data,
+					  output_data, data_size);
+		if (err) {
+			MEMPOOL_ERR("fail to run session: err %d\n", err);
+			goto munmap_memory;
 		}
+	} else if (input_data) {
+		MEMPOOL_INFO("Write data into FPGA: crc32c %s...\n",
+			     crc32c_name());
 
+		err = mempool_write_data_into_fpga(&environment,
+						   input_data,
+						   data_size);
+		if (err) {
+			MEMPOOL_ERR("fail to write data into FPGA board: "
+				    "file_size %lu, err %d\n",
+				    data_size, err);
+			goto munmap_memory;
+		}
+	} else if (output_data) {
 		MEMPOOL_INFO("Read result from FPGA...\n");
 
 		err = mempool_read_result_from_fpga(&environment,
-						    output_addr,
-						    file_size);
+						    output_data,
+						    data_size);
 		if (err) {
 			MEMPOOL_ERR("fail to read result from FPGA board: "
 				    "file_size %lu, err %d\n",
-				    file_size, err);
+				    data_size, err);
 			goto munmap_memory;
 		}
 	} else {
@@ -938,24 +2444,37 @@ int main(int argc, char *argv[])
 		}
 	}
 
+	if (output_data &&
+	    environment.format.output == MEMPOOL_CONTAINER_FORMAT) {
+		err = mempool_write_output_container(&environment,
+						     &output_container,
+						     output_addr,
+						     output_data);
+		if (err) {
+			MEMPOOL_ERR("fail to write container: "
+				    "err %d\n", err);
+			goto munmap_memory;
+		}
+	}
+
 	MEMPOOL_DBG(environment.show_debug,
 		    "operation has been executed\n");
 
 munmap_memory:
-	if (input_addr) {
-		err = munmap(input_addr, file_size);
-		if (err) {
-			MEMPOOL_ERR("fail to unmap input file: %s\n",
-				    strerror(errno));
-		}
+	if (input_buffer)
+		free(input_buffer);
+
+	if (output_buffer)
+		free(output_buffer);
+
+	if (input_addr && munmap(input_addr, input_size)) {
+		MEMPOOL_ERR("fail to unmap input file: %s\n",
+			    strerror(errno));
 	}
 
-	if (output_addr) {
-		err = munmap(output_addr, file_size);
-		if (err) {
-			MEMPOOL_ERR("fail to unmap output file: %s\n",
-				    strerror(errno));
-		}
+	if (output_addr && munmap(output_addr, output_size)) {
+		MEMPOOL_ERR("fail to unmap output file: %s\n",
+			    strerror(errno));
 	}
 
 close_files:
@@ -966,5 +2485,8 @@ close_files:
 		close(environment.output_file.fd);
 
 finish_execution:
+	mempool_container_destroy(&input_container);
+	mempool_container_destroy(&output_container);
+
 	exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
 }
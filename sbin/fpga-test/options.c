@@ -42,7 +42,19 @@ void print_usage(void)
 		     "into FPGA board.\n");
 	MEMPOOL_INFO("\t [-o|--output-file]\t\t  extract result from FPGA "
 		     "board into output file.\n");
+	MEMPOOL_INFO("\t [-f|--format]\t\t  define format of output file "
+		     "[raw|container].\n");
 	MEMPOOL_INFO("\t [-U|--uart-device]\t\t  define UART device name.\n");
+	MEMPOOL_INFO("\t [-L|--link window=value,baud=value,"
+		     "flow=value,frame=value,calibrate]\t\t  "
+		     "define number of frames in flight, baud rate, "
+		     "flow control [none|rtscts] and payload size of frame "
+		     "or choose the fastest reliable window and frame size "
+		     "(baud rate has to be the rate of FPGA, "
+		     "calibration requires input file).\n");
+	MEMPOOL_INFO("\t [-S|--session jobs=value]\t\t  "
+		     "run upload, execution and readback "
+		     "over one UART session.\n");
 	MEMPOOL_INFO("\t [-t|--fpga-core number=value, "
 		     "portion-size=value]\t\t  define FPGA cores info.\n");
 	MEMPOOL_INFO("\t [-I|--item granularity=value]\t\t  "
@@ -66,15 +78,18 @@ void parse_options(int argc, char *argv[],
 	int c;
 	int oi = 1;
 	char *p;
-	char sopts[] = "a:c:dhi:I:o:p:k:r:t:U:v:V";
+	char sopts[] = "a:c:df:hi:I:L:o:p:k:r:S:t:U:v:V";
 	static const struct option lopts[] = {
 		{"algorithm", 1, NULL, 'a'},
 		{"condition", 1, NULL, 'c'},
 		{"debug", 0, NULL, 'd'},
+		{"format", 1, NULL, 'f'},
 		{"help", 0, NULL, 'h'},
 		{"input-file", 1, NULL, 'i'},
 		{"output-file", 1, NULL, 'o'},
 		{"uart-device", 1, NULL, 'U'},
+		{"link", 1, NULL, 'L'},
+		{"session", 1, NULL, 'S'},
 		{"item", 1, NULL, 'I'},
 		{"portion", 1, NULL, 'p'},
 		{"key", 1, NULL, 'k'},
@@ -139,6 +154,28 @@ void parse_options(int argc, char *argv[],
 		[CONDITION_MAX_OPT]		= "max",
 		NULL
 	};
+	enum {
+		LINK_WINDOW_OPT = 0,
+		LINK_BAUD_OPT,
+		LINK_FLOW_OPT,
+		LINK_FRAME_OPT,
+		LINK_CALIBRATE_OPT,
+	};
+	char *const link_tokens[] = {
+		[LINK_WINDOW_OPT]		= "window",
+		[LINK_BAUD_OPT]			= "baud",
+		[LINK_FLOW_OPT]			= "flow",
+		[LINK_FRAME_OPT]		= "frame",
+		[LINK_CALIBRATE_OPT]		= "calibrate",
+		NULL
+	};
+	enum {
+		SESSION_JOBS_OPT = 0,
+	};
+	char *const session_tokens[] = {
+		[SESSION_JOBS_OPT]		= "jobs",
+		NULL
+	};
 
 	while ((c = getopt_long(argc, argv, sopts, lopts, &oi)) != EOF) {
 		switch (c) {
@@ -164,6 +201,14 @@ void parse_options(int argc, char *argv[],
 				exit(EXIT_SUCCESS);
 			}
 			break;
+		case 'f':
+			env->format.output = convert_string2format(optarg);
+			if (env->format.output == MEMPOOL_UNKNOWN_FORMAT) {
+				MEMPOOL_ERR("invalid format\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case 'U':
 			env->uart_channel.name = optarg;
 			if (!env->uart_channel.name) {
@@ -172,6 +217,84 @@ void parse_options(int argc, char *argv[],
 				exit(EXIT_SUCCESS);
 			}
 			break;
+		case 'L':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, link_tokens, &value)) {
+				case LINK_WINDOW_OPT:
+					env->link.window = atoi(value);
+					if (env->link.window < 0 ||
+					    env->link.window >
+						MEMPOOL_MAX_LINK_WINDOW) {
+						MEMPOOL_ERR("invalid window\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case LINK_BAUD_OPT:
+					env->link.baud = atoi(value);
+					if (env->link.baud <= 0) {
+						MEMPOOL_ERR("invalid baud rate\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case LINK_FLOW_OPT:
+					env->link.flow =
+						convert_string2flow_control(value);
+					if (env->link.flow ==
+						MEMPOOL_UNKNOWN_FLOW_CONTROL) {
+						MEMPOOL_ERR("invalid flow control\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case LINK_FRAME_OPT:
+					env->link.frame = atoi(value);
+					if (env->link.frame < MEMPOOL_MIN_LINK_FRAME ||
+					    env->link.frame > MEMPOOL_PAGE_SIZE ||
+					    (env->link.frame &
+						(env->link.frame - 1))) {
+						MEMPOOL_ERR("invalid frame size\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case LINK_CALIBRATE_OPT:
+					env->link.calibrate = MEMPOOL_TRUE;
+					break;
+				default:
+					MEMPOOL_ERR("invalid link option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'S':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, session_tokens, &value)) {
+				case SESSION_JOBS_OPT:
+					env->session.jobs = atoi(value);
+					if (env->session.jobs < 1 ||
+					    env->session.jobs >
+						MEMPOOL_MAX_SESSION_JOBS) {
+						MEMPOOL_ERR("invalid jobs\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				default:
+					MEMPOOL_ERR("invalid session option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
 		case 't':
 			p = optarg;
 			while (*p != '\0') {
@@ -182,7 +305,7 @@ void parse_options(int argc, char *argv[],
 					env->threads.count = atoi(value);
 					break;
 				case THREAD_PORTION_SIZE_OPT:
-					env->threads.portion_size = atoi(value);
+					env->threads.portion_size = atoll(value);
 					break;
 				default:
 					MEMPOOL_ERR("invalid threads option\n");
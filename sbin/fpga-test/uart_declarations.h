@@ -31,9 +31,38 @@ enum {
 	MEMPOOL_READ_RESULT		= 0x4,
 };
 
+/*
+ * Flag of operation type: FPGA acknowledges every frame of
+ * the operation by struct mempool_uart_ack. Otherwise, the only
+ * answer is sent after the last frame.
+ */
+#define MEMPOOL_FRAME_ACK_FLAG			(0x80)
+
+/*
+ * Results of frame acknowledgement differ from results of
+ * operations, so a late acknowledgement is not taken as answer.
+ */
+enum {
+	MEMPOOL_FRAME_ACK	= 0x80,
+	MEMPOOL_FRAME_NAK	= 0x81,
+};
+
+/* UART frame is 8N1: every byte takes 10 bits on the line */
+#define MEMPOOL_UART_BITS_PER_BYTE		(10)
+#define MEMPOOL_UART_BAUD_RATE			(115200)
+
 #define MEMPOOL_INPUT_DATA_BASE_ADDRESS		(0x2000)
 #define MEMPOOL_MANAGEMENT_PAGE_BASE_ADDRESS	(0x3000)
 
+/*
+ * Address is base address plus index of frame. Frame is shorter
+ * than MEMPOOL_PAGE_SIZE if the high byte of address keeps
+ * log2(MEMPOOL_PAGE_SIZE / frame size). The high byte is zero
+ * for frames of MEMPOOL_PAGE_SIZE.
+ */
+#define MEMPOOL_FRAME_SHIFT_BITS		(56)
+#define MEMPOOL_FRAME_ADDRESS_MASK		((1ULL << MEMPOOL_FRAME_SHIFT_BITS) - 1)
+
 /*
  * struct mempool_uart_preamble - UART packet preamble
  * @magic: header magic
@@ -61,13 +90,14 @@ struct mempool_uart_preamble {
  * struct mempool_uart_footer - UART packet footer
  * @magic: footer magic
  * @operation_type: operation type
+ * @sequence: sequence number of frame
  * @crc32: payload's checksum
  */
 struct mempool_uart_footer {
 /* 0x0000 */
 	unsigned char magic;
 	unsigned char operation_type;
-	unsigned short padding;
+	unsigned short sequence;
 
 /* 0x0004 */
 	unsigned int crc32;
@@ -94,4 +124,50 @@ struct mempool_uart_answer {
 /* 0x0008 */
 } __attribute__((packed));
 
+/*
+ * struct mempool_uart_page - FPGA UART page of result
+ * @magic: answer magic
+ * @result: operation result
+ * @length: payload length (shorter than page - the last page of result)
+ * @crc32: payload's checksum
+ * @address: memory page address
+ *
+ * Pages are sent in answer on MEMPOOL_READ_RESULT request with
+ * MEMPOOL_FRAME_ACK_FLAG: preamble's address is the first page and
+ * preamble's length is the number of requested pages.
+ */
+struct mempool_uart_page {
+/* 0x0000 */
+	unsigned char magic;
+	unsigned char result;
+	unsigned short length;
+
+/* 0x0004 */
+	unsigned int crc32;
+
+/* 0x0008 */
+	unsigned long long address;
+
+/* 0x0010 */
+} __attribute__((packed));
+
+/*
+ * struct mempool_uart_ack - FPGA UART acknowledgement of frame
+ * @magic: answer magic
+ * @result: frame result (ACK or NAK)
+ * @sequence: sequence number of acknowledged frame
+ * @crc32: checksum of received payload
+ */
+struct mempool_uart_ack {
+/* 0x0000 */
+	unsigned char magic;
+	unsigned char result;
+	unsigned short sequence;
+
+/* 0x0004 */
+	unsigned int crc32;
+
+/* 0x0008 */
+} __attribute__((packed));
+
 #endif /* _UART_DECLARATIONS_H */
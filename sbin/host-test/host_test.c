@@ -20,6 +20,7 @@
 #include <sys/types.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <linux/fs.h>
 #include <getopt.h>
 #include <fcntl.h>
@@ -30,60 +31,246 @@
 #include <paths.h>
 #include <limits.h>
 #include <errno.h>
+#include <time.h>
 #include <pthread.h>
 
 #include "host_test.h"
+#include "memory_pool_container.h"
+#include "memory_pool_codec.h"
+#include "crc32c.h"
 
 /*
- * struct mempool_thread_queue - thread's queue
- * @lock: queue's lock
- * @state: queue's state
- * @bound: bound of a range
- * @record: temporary buffer for record
+ * struct mempool_topk_heap - bounded heap of TOPK candidates
+ * @records: candidate records
+ * @keys: keys of candidate records
+ * @slots: heap of slot indexes (root is the worst candidate)
+ * @count: number of candidates in heap
+ * @capacity: maximum number of candidates (K)
  */
-struct mempool_thread_queue {
-	pthread_mutex_t lock;
-	int state;
-	unsigned long long bound;
-	void *record;
+struct mempool_topk_heap {
+	void *records;
+	unsigned long long *keys;
+	int *slots;
+	int count;
+	int capacity;
+};
+
+#define MEMPOOL_DISTINCT_HASH_THRESHOLD		(64 * 1024)
+#define MEMPOOL_DISTINCT_SAMPLES_PER_PORTION	(64)
+
+/*
+ * struct mempool_distinct_entry - unique key descriptor
+ * @key: normalized key
+ * @count: number of records with the key
+ * @portion: portion of the first record with the key
+ * @index: index of the first record in the portion
+ */
+struct mempool_distinct_entry {
+	unsigned long long key;
+	unsigned long long count;
+	int portion;
+	int index;
+};
+
+/*
+ * struct mempool_distinct_set - set of unique keys
+ * @entries: unique keys sorted by key
+ * @count: number of unique keys
+ */
+struct mempool_distinct_set {
+	struct mempool_distinct_entry *entries;
+	int count;
+};
+
+/*
+ * struct mempool_distinct_context - shared state of DISTINCT algorithm
+ * @splitters: key ranges of partitions
+ * @offsets: output offsets of partitions
+ * @record_size: size of output record in bytes
+ * @output_addr: output buffer
+ * @output_size: size of output buffer in bytes
+ * @result_size: size of result in bytes
+ */
+struct mempool_distinct_context {
+	unsigned long long *splitters;
+	size_t *offsets;
+	unsigned int record_size;
+	void *output_addr;
+	size_t output_size;
+	size_t result_size;
+};
+
+#define MEMPOOL_SORT_SAMPLES_PER_RUN		(16)
+#define MEMPOOL_SORT_BUCKETS_PER_WORKER		(4)
+
+#define MEMPOOL_SLICES_PER_WORKER		(4)
+#define MEMPOOL_SLICE_MIN_RECORDS		(16 * 1024)
+
+/* written bytes are checksummed by blocks that are still in L1 cache */
+#define MEMPOOL_CHECKSUM_BLOCK			(4 * 1024)
+
+struct mempool_portion_state;
+
+/*
+ * struct mempool_portion_slice - record-aligned part of portion
+ * @id: slice ID in the portion
+ * @state: portion state
+ * @worker: worker that processes the slice
+ * @start: index of the first record of the slice
+ * @end: index of the record after the last record of the slice
+ * @written_bytes: number of bytes written by the slice
+ * @crc: crc32c of bytes written by the slice (from zero register)
+ * @sums: partial sums of values (TOTAL algorithm)
+ * @err: code of error
+ */
+struct mempool_portion_slice {
+	int id;
+	struct mempool_portion_state *state;
+	struct mempool_worker *worker;
+	int start;
+	int end;
+	size_t written_bytes;
+	uint32_t crc;
+	unsigned long long *sums;
+	int err;
+};
+
+/*
+ * struct mempool_sort_context - shared state of SORT algorithm
+ * @env: application options
+ * @portions: array of portions
+ * @slices: array of slices (every slice is sorted run)
+ * @slices_count: number of slices
+ * @runs: sorted copies of portions
+ * @runs_size: size of runs' buffer in bytes
+ * @splitters: key ranges of buckets
+ * @bounds: ranges of buckets in every run
+ * @offsets: output offsets of buckets (in records)
+ * @buckets: number of buckets
+ * @checksums: crc32c of parts of buckets in portions
+ * @output_addr: output buffer
+ */
+struct mempool_sort_context {
+	struct mempool_test_environment *env;
+	struct mempool_portion_state *portions;
+	struct mempool_portion_slice *slices;
+	int slices_count;
+	void *runs;
+	size_t runs_size;
+	unsigned long long *splitters;
+	int *bounds;
+	size_t *offsets;
+	int buckets;
+	uint32_t *checksums;
+	void *output_addr;
 };
 
 /*
- * Queue states
+ * struct mempool_sort_bucket - key range of SORT algorithm
+ * @id: bucket ID
+ * @ctx: shared state of SORT algorithm
  */
-enum {
-	MEMPOOL_QUEUE_UNKNOWN_STATE,
-	MEMPOOL_QUEUE_QUICKSORT_IN_PROGRESS,
-	MEMPOOL_QUEUE_READY_FOR_EXCHANGE,
-	MEMPOOL_QUEUE_PLEASE_TAKE_RECORD,
-	MEMPOOL_QUEUE_NO_FREE_SPACE,
-	MEMPOOL_QUEUE_FAILED,
-	MEMPOOL_QUEUE_STATE_MAX
+struct mempool_sort_bucket {
+	int id;
+	struct mempool_sort_context *ctx;
+};
+
+/*
+ * struct mempool_container_context - containers of files
+ * @input: container of input file (raw file has no directory)
+ * @output: container of output file (raw file has no directory)
+ */
+struct mempool_container_context {
+	struct mempool_container input;
+	struct mempool_container output;
+};
+
+/*
+ * struct mempool_encode_request - encoding of output portion
+ * @id: portion ID in output container
+ * @env: application options
+ * @container: output container
+ * @payload: records of the portion
+ * @block: encoded portion
+ * @bytes: size of encoded portion in bytes
+ */
+struct mempool_encode_request {
+	int id;
+	struct mempool_test_environment *env;
+	struct mempool_container *container;
+	void *payload;
+	void *block;
+	size_t bytes;
+};
+
+/*
+ * struct mempool_checksum_entry - checksum of output portion
+ * @records: number of records in portion
+ * @bytes: number of valid bytes in portion
+ * @crc: crc32c of the whole portion
+ */
+struct mempool_checksum_entry {
+	unsigned int records;
+	unsigned long long bytes;
+	uint32_t crc;
 };
 
 /*
- * struct mempool_thread_state - thread state
- * @id: thread ID
- * @thread: thread descriptor
+ * struct mempool_checksum_manifest - checksums of output file
+ * @portions: checksums of output portions
+ * @count: number of portions
+ * @portion_size: size of output portion in bytes
+ */
+struct mempool_checksum_manifest {
+	struct mempool_checksum_entry *portions;
+	int count;
+	size_t portion_size;
+};
+
+/*
+ * struct mempool_portion_state - portion state
+ * @id: portion ID
+ * @count: number of records in the portion
+ * @first: global index of the first record (SORT algorithm)
  * @env: application options
- * @input_portion: input data portion
+ * @input_portion: input data portion (NULL if encoded one is scanned)
+ * @input_layout: layout of records in input data portion
+ * @encoded_portion: encoded input portion (NULL for plain input)
+ * @pax_portion: input portion in PAX layout that is converted into rows
  * @output_portion: output data portion
- * @pool: pool of threads
- * @err: code of error
+ * @run: sorted copy of the portion (SORT algorithm)
+ * @slices: slices of the portion
+ * @slices_count: number of slices
+ * @topk: TOPK candidates of the portion
+ * @local_set: unique keys of the portion
+ * @partition_set: unique keys of the partition
+ * @distinct: shared state of DISTINCT algorithm
+ * @sort: shared state of SORT algorithm
+ * @containers: containers of files
+ * @manifest: checksums of output (NULL if checksums are disabled)
+ * @portions: array of all portions
  */
-struct mempool_thread_state {
+struct mempool_portion_state {
 	int id;
-	pthread_t thread;
+	int count;
+	size_t first;
 	struct mempool_test_environment *env;
 	void *input_portion;
+	int input_layout;
+	void *encoded_portion;
+	void *pax_portion;
 	void *output_portion;
-	void *buf;
-	unsigned int start_index;
-	unsigned int end_index;
-	struct mempool_thread_queue left_queue;
-	struct mempool_thread_queue right_queue;
-	struct mempool_thread_state *pool;
-	int err;
+	void *run;
+	struct mempool_portion_slice *slices;
+	int slices_count;
+	struct mempool_topk_heap topk;
+	struct mempool_distinct_set local_set;
+	struct mempool_distinct_set partition_set;
+	struct mempool_distinct_context *distinct;
+	struct mempool_sort_context *sort;
+	struct mempool_container_context *containers;
+	struct mempool_checksum_manifest *manifest;
+	struct mempool_portion_state *portions;
 };
 
 static
@@ -100,60 +287,73 @@ int is_bit_set(unsigned long long mask, int bit, int capacity)
 	return (bmap >> check_bit) & 1;
 }
 
+/*
+ * Item of input record: PAX layout keeps item N of all records
+ * of portion contiguously, so a kernel touches only the columns
+ * of its masks.
+ */
+static inline
+unsigned char *mempool_input_item(struct mempool_portion_state *state,
+				  int record_index, int item)
+{
+	size_t granularity = state->env->item.granularity;
+	size_t index;
+
+	if (state->input_layout == MEMPOOL_PAX_LAYOUT)
+		index = (size_t)item * state->count + record_index;
+	else
+		index = (size_t)record_index * state->env->record.capacity + item;
+
+	return (unsigned char *)state->input_portion + index * granularity;
+}
+
 static
-int mempool_copy(struct mempool_thread_state *state,
+int mempool_copy(struct mempool_portion_state *state,
 		 unsigned long long mask,
 		 int record_index, size_t *written_bytes)
 {
-	unsigned int record_size;
 	unsigned char *input;
 	unsigned char *output;
 	int i;
 
 	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, mask %#llx, "
+		    "portion %d, mask %#llx, "
 		    "record_index %d, written_bytes %zu\n",
 		    state->id, mask, record_index, *written_bytes);
 
 	if (!state->input_portion || !state->output_portion) {
 		MEMPOOL_ERR("fail to copy key: "
-			    "thread %d, input_portion %p, output_portion %p\n",
+			    "portion %d, input_portion %p, output_portion %p\n",
 			    state->id,
 			    state->input_portion,
 			    state->output_portion);
 		return -ERANGE;
 	}
 
-	if (state->env->portion.count > state->env->portion.capacity) {
+	if (state->count > state->env->portion.capacity) {
 		MEMPOOL_ERR("invalid portion descriptor: "
-			    "thread %d, count %d, capacity %d\n",
+			    "portion %d, count %d, capacity %d\n",
 			    state->id,
-			    state->env->portion.count,
+			    state->count,
 			    state->env->portion.capacity);
 		return -ERANGE;
 	}
 
-	if (record_index >= state->env->portion.count) {
+	if (record_index >= state->count) {
 		MEMPOOL_ERR("out of range: "
-			    "thread %d, record_index %d, count %d\n",
+			    "portion %d, record_index %d, count %d\n",
 			    state->id,
 			    record_index,
-			    state->env->portion.count);
+			    state->count);
 		return -ERANGE;
 	}
 
-	record_size = (unsigned int)state->env->record.capacity *
-					state->env->item.granularity;
-
 	for (i = 0; i < state->env->record.capacity; i++) {
-		input = (unsigned char *)state->input_portion;
-		input += (unsigned int)record_index * record_size;
-		input += (unsigned int)i * state->env->item.granularity;
-
 		output = (unsigned char *)state->output_portion;
 		output += *written_bytes;
 
 		if (is_bit_set(mask, i, state->env->record.capacity)) {
+			input = mempool_input_item(state, record_index, i);
 			memcpy(output, input, state->env->item.granularity);
 			*written_bytes += state->env->item.granularity;
 		}
@@ -163,11 +363,11 @@ int mempool_copy(struct mempool_thread_state *state,
 }
 
 static inline
-int mempool_copy_key(struct mempool_thread_state *state,
+int mempool_copy_key(struct mempool_portion_state *state,
 		     int record_index, size_t *written_bytes)
 {
 	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, record_index %d, written_bytes %zu\n",
+		    "portion %d, record_index %d, written_bytes %zu\n",
 		    state->id,
 		    record_index,
 		    *written_bytes);
@@ -177,11 +377,11 @@ int mempool_copy_key(struct mempool_thread_state *state,
 }
 
 static inline
-int mempool_copy_value(struct mempool_thread_state *state,
+int mempool_copy_value(struct mempool_portion_state *state,
 		       int record_index, size_t *written_bytes)
 {
 	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, record_index %d, written_bytes %zu\n",
+		    "portion %d, record_index %d, written_bytes %zu\n",
 		    state->id,
 		    record_index,
 		    *written_bytes);
@@ -191,31 +391,89 @@ int mempool_copy_value(struct mempool_thread_state *state,
 }
 
 static
-int mempool_key_value_algorithm(struct mempool_thread_state *state)
+int mempool_items_bytes(struct mempool_test_environment *env,
+			unsigned long long mask)
+{
+	int bytes = 0;
+	int i;
+
+	for (i = 0; i < env->record.capacity; i++) {
+		if (is_bit_set(mask, i, env->record.capacity))
+			bytes += env->item.granularity;
+	}
+
+	return bytes;
+}
+
+/*
+ * Every record produces key and value in output of KEY-VALUE
+ * and SELECT algorithms. So, output offset of every record
+ * is known before processing of previous records.
+ */
+static inline
+size_t mempool_key_value_bytes(struct mempool_test_environment *env)
+{
+	return (size_t)mempool_items_bytes(env, env->key.mask) +
+		mempool_items_bytes(env, env->value.mask);
+}
+
+/*
+ * Checksum output bytes [@checksummed, @written) of the slice when
+ * at least @threshold bytes are pending. Bytes are checksummed right
+ * after copying while they are in L1 cache. CRC of slice starts from
+ * zero register, so CRCs of slices are joined by crc32c_combine().
+ * It returns the new end of checksummed bytes.
+ */
+static inline
+size_t mempool_checksum_written(struct mempool_portion_slice *slice,
+				size_t checksummed, size_t written,
+				size_t threshold)
+{
+	struct mempool_portion_state *state = slice->state;
+
+	if (!state->manifest || (written - checksummed) < threshold)
+		return checksummed;
+
+	slice->crc = crc32c(slice->crc,
+			    (unsigned char *)state->output_portion + checksummed,
+			    written - checksummed);
+
+	return written;
+}
+
+static
+int mempool_key_value_algorithm(struct mempool_portion_slice *slice)
 {
+	struct mempool_portion_state *state = slice->state;
 	unsigned int record_size;
-	unsigned int portion_bytes;
-	size_t written_bytes = 0;
+	size_t portion_bytes;
+	size_t start_bytes;
+	size_t written_bytes;
+	size_t checksummed;
 	int i;
 	int err;
 
 	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, input %p, output %p\n",
-		    state->id,
+		    "portion %d, slice %d, records [%d, %d), "
+		    "input %p, output %p\n",
+		    state->id, slice->id,
+		    slice->start, slice->end,
 		    state->input_portion,
 		    state->output_portion);
 
 	record_size = (unsigned int)state->env->record.capacity *
 					state->env->item.granularity;
-	portion_bytes = record_size * state->env->portion.capacity;
+	portion_bytes = (size_t)record_size * state->env->portion.capacity;
 
-	memset(state->output_portion, 0, portion_bytes);
+	start_bytes = (size_t)slice->start * mempool_key_value_bytes(state->env);
+	written_bytes = start_bytes;
+	checksummed = start_bytes;
 
-	for (i = 0; i < state->env->portion.count; i++) {
+	for (i = slice->start; i < slice->end; i++) {
 		if ((written_bytes + record_size) > portion_bytes) {
 			MEMPOOL_ERR("out of space: "
-				    "thread %d, written_bytes %zu, "
-				    "portion_bytes %u\n",
+				    "portion %d, written_bytes %zu, "
+				    "portion_bytes %zu\n",
 				    state->id,
 				    written_bytes,
 				    portion_bytes);
@@ -225,7 +483,7 @@ int mempool_key_value_algorithm(struct mempool_thread_state *state)
 		err = mempool_copy_key(state, i, &written_bytes);
 		if (err) {
 			MEMPOOL_ERR("fail to copy key: "
-				    "thread %d, record_index %d, "
+				    "portion %d, record_index %d, "
 				    "written_bytes %zu, err %d\n",
 				    state->id, i, written_bytes, err);
 			return err;
@@ -234,18 +492,32 @@ int mempool_key_value_algorithm(struct mempool_thread_state *state)
 		err = mempool_copy_value(state, i, &written_bytes);
 		if (err) {
 			MEMPOOL_ERR("fail to copy value: "
-				    "thread %d, record_index %d, "
+				    "portion %d, record_index %d, "
 				    "written_bytes %zu, err %d\n",
 				    state->id, i, written_bytes, err);
 			return err;
 		}
+
+		checksummed = mempool_checksum_written(slice, checksummed,
+						written_bytes,
+						MEMPOOL_CHECKSUM_BLOCK);
+	}
+
+	mempool_checksum_written(slice, checksummed, written_bytes, 0);
+
+	slice->written_bytes = written_bytes - start_bytes;
+
+	if (slice->end == state->count) {
+		/* the last slice cleans the rest of output portion */
+		memset((unsigned char *)state->output_portion + written_bytes,
+			0, portion_bytes - written_bytes);
 	}
 
 	return 0;
 }
 
 static
-unsigned long long mempool_get_key(struct mempool_thread_state *state,
+unsigned long long mempool_get_key(struct mempool_portion_state *state,
 				   int record_index)
 {
 	unsigned int record_size;
@@ -256,21 +528,21 @@ unsigned long long mempool_get_key(struct mempool_thread_state *state,
 	size_t written_bytes = 0;
 	int i;
 
-	if (state->env->portion.count > state->env->portion.capacity) {
+	if (state->count > state->env->portion.capacity) {
 		MEMPOOL_ERR("invalid portion descriptor: "
-			    "thread %d, count %d, capacity %d\n",
+			    "portion %d, count %d, capacity %d\n",
 			    state->id,
-			    state->env->portion.count,
+			    state->count,
 			    state->env->portion.capacity);
 		return 0;
 	}
 
-	if (record_index >= state->env->portion.count) {
+	if (record_index >= state->count) {
 		MEMPOOL_ERR("out of range: "
-			    "thread %d, record_index %d, count %d\n",
+			    "portion %d, record_index %d, count %d\n",
 			    state->id,
 			    record_index,
-			    state->env->portion.count);
+			    state->count);
 		return 0;
 	}
 
@@ -278,9 +550,9 @@ unsigned long long mempool_get_key(struct mempool_thread_state *state,
 					state->env->item.granularity;
 
 	for (i = 0; i < state->env->record.capacity; i++) {
-		input = (unsigned char *)state->output_portion;
-		input += (unsigned int)record_index * record_size;
-		input += (unsigned int)i * state->env->item.granularity;
+		input = (unsigned char *)state->run;
+		input += (size_t)record_index * record_size;
+		input += (size_t)i * state->env->item.granularity;
 
 		if (written_bytes >= sizeof(unsigned long long))
 			return key;
@@ -298,664 +570,507 @@ unsigned long long mempool_get_key(struct mempool_thread_state *state,
 }
 
 static
-void mempool_swap_records(struct mempool_thread_state *state,
+void mempool_swap_records(struct mempool_portion_state *state, void *buf,
 			  int record_index1, int record_index2)
 {
 	unsigned int record_size;
 	unsigned char *record1;
 	unsigned char *record2;
 
-	if (state->env->portion.count > state->env->portion.capacity) {
+	if (state->count > state->env->portion.capacity) {
 		MEMPOOL_ERR("invalid portion descriptor: "
-			    "thread %d, count %d, capacity %d\n",
+			    "portion %d, count %d, capacity %d\n",
 			    state->id,
-			    state->env->portion.count,
+			    state->count,
 			    state->env->portion.capacity);
 		return;
 	}
 
-	if (record_index1 >= state->env->portion.count) {
+	if (record_index1 >= state->count) {
 		MEMPOOL_ERR("out of range: "
-			    "thread %d, record_index %d, count %d\n",
+			    "portion %d, record_index %d, count %d\n",
 			    state->id,
 			    record_index1,
-			    state->env->portion.count);
+			    state->count);
 		return;
 	}
 
-	if (record_index2 >= state->env->portion.count) {
+	if (record_index2 >= state->count) {
 		MEMPOOL_ERR("out of range: "
-			    "thread %d, record_index %d, count %d\n",
+			    "portion %d, record_index %d, count %d\n",
 			    state->id,
 			    record_index2,
-			    state->env->portion.count);
+			    state->count);
 		return;
 	}
 
 	record_size = (unsigned int)state->env->record.capacity *
 					state->env->item.granularity;
 
-	record1 = (unsigned char *)state->output_portion;
-	record1 += (unsigned int)record_index1 * record_size;
+	record1 = (unsigned char *)state->run;
+	record1 += (size_t)record_index1 * record_size;
 
-	record2 = (unsigned char *)state->output_portion;
-	record2 += (unsigned int)record_index2 * record_size;
+	record2 = (unsigned char *)state->run;
+	record2 += (size_t)record_index2 * record_size;
 
-	memcpy(state->buf, record1, record_size);
+	memcpy(buf, record1, record_size);
 	memcpy(record1, record2, record_size);
-	memcpy(record2, state->buf, record_size);
+	memcpy(record2, buf, record_size);
+}
+
+static inline
+unsigned long long mempool_median_key(unsigned long long key1,
+				      unsigned long long key2,
+				      unsigned long long key3)
+{
+	if (key1 > key2) {
+		unsigned long long key = key1;
+
+		key1 = key2;
+		key2 = key;
+	}
+
+	if (key2 > key3)
+		key2 = key3;
+
+	return key1 > key2 ? key1 : key2;
 }
 
+/*
+ * Three-way partition around median of three keys. Records with
+ * keys equal to the pivot are gathered in the middle [*lt, *gt],
+ * so duplicated keys do not degrade quicksort.
+ */
 static
-int mempool_partition(struct mempool_thread_state *state,
-		      int low, int high)
+void mempool_partition(struct mempool_portion_state *state, void *buf,
+		       int low, int high, int *lt, int *gt)
 {
+	unsigned long long pivot;
+	unsigned long long key;
 	int i;
-	int p;
-	int first_high;
 
-	p = high;
-	first_high = low;
+	pivot = mempool_median_key(mempool_get_key(state, low),
+				   mempool_get_key(state,
+						   low + (high - low) / 2),
+				   mempool_get_key(state, high));
+
+	*lt = low;
+	*gt = high;
+	i = low;
+
+	while (i <= *gt) {
+		key = mempool_get_key(state, i);
+
+		if (key < pivot) {
+			if (i != *lt)
+				mempool_swap_records(state, buf, i, *lt);
+			(*lt)++;
+			i++;
+		} else if (key > pivot) {
+			if (i != *gt)
+				mempool_swap_records(state, buf, i, *gt);
+			(*gt)--;
+		} else
+			i++;
+	}
+}
 
-	for (i = low; i < high; i++) {
-		if (mempool_get_key(state, i) < mempool_get_key(state, p)) {
-			mempool_swap_records(state, i, first_high);
-			first_high++;
+static
+void mempool_quicksort(struct mempool_portion_state *state, void *buf,
+		       int low, int high)
+{
+	int lt, gt;
+
+	while (low < high) {
+		mempool_partition(state, buf, low, high, &lt, &gt);
+
+		/* recursion into smaller part limits depth of stack */
+		if ((lt - low) < (high - gt)) {
+			mempool_quicksort(state, buf, low, lt - 1);
+			low = gt + 1;
+		} else {
+			mempool_quicksort(state, buf, gt + 1, high);
+			high = lt - 1;
 		}
 	}
-
-	mempool_swap_records(state, p, first_high);
-	return first_high;
 }
 
 static
-void mempool_quicksort(struct mempool_thread_state *state,
-		       int low, int high)
+int mempool_key_compare(const void *item1, const void *item2)
 {
-	int p;
+	unsigned long long key1 = *(const unsigned long long *)item1;
+	unsigned long long key2 = *(const unsigned long long *)item2;
 
-	if ((high - low) > 0) {
-		p = mempool_partition(state, low, high);
-		mempool_quicksort(state, low, p - 1);
-		mempool_quicksort(state, p + 1, high);
-	}
+	if (key1 != key2)
+		return key1 < key2 ? -1 : 1;
+
+	return 0;
 }
 
+/*
+ * The first phase of SORT algorithm: the slice of portion is copied
+ * into the run and the run is sorted by quicksort. Every slice
+ * is independent sorted run.
+ */
 static
-int mempool_send_record_to_left_thread(struct mempool_thread_state *state,
-					struct mempool_thread_state *left)
+int mempool_sort_algorithm(struct mempool_portion_slice *slice)
 {
-	unsigned long long lower_bound;
-	unsigned long long upper_bound;
-	unsigned char *record;
+	struct mempool_portion_state *state = slice->state;
 	unsigned int record_size;
-	int err = 0;
+	size_t portion_bytes;
+	size_t start_bytes;
+	size_t sorted_bytes;
+	void *buf;
 
-	if (!left)
-		return -ENOSPC;
+	MEMPOOL_DBG(state->env->show_debug,
+		    "portion %d, slice %d, records [%d, %d), "
+		    "input %p, output %p, run %p\n",
+		    state->id, slice->id,
+		    slice->start, slice->end,
+		    state->input_portion,
+		    state->output_portion,
+		    state->run);
 
 	record_size = (unsigned int)state->env->record.capacity *
 					state->env->item.granularity;
-
-	pthread_mutex_lock(&state->left_queue.lock);
-	lower_bound = state->left_queue.bound;
-	pthread_mutex_unlock(&state->left_queue.lock);
-
-	pthread_mutex_lock(&left->right_queue.lock);
-
-	switch (left->right_queue.state) {
-	case MEMPOOL_QUEUE_QUICKSORT_IN_PROGRESS:
-	case MEMPOOL_QUEUE_PLEASE_TAKE_RECORD:
-		err = -EAGAIN;
-		goto finish_send_record_to_left_thread;
-
-	case MEMPOOL_QUEUE_READY_FOR_EXCHANGE:
-		/* continue logic */
-		break;
-
-	case MEMPOOL_QUEUE_NO_FREE_SPACE:
-		err = -ENOSPC;
-		goto finish_send_record_to_left_thread;
-
-	default:
-		err = -EFAULT;
-		goto finish_send_record_to_left_thread;
+	portion_bytes = (size_t)record_size * state->env->portion.capacity;
+	start_bytes = (size_t)slice->start * record_size;
+	sorted_bytes = (size_t)slice->end * record_size;
+
+	memcpy((unsigned char *)state->run + start_bytes,
+		(unsigned char *)state->input_portion + start_bytes,
+		sorted_bytes - start_bytes);
+
+	if (slice->end == state->count) {
+		/* records beyond count of the portion are copied as is */
+		memcpy((unsigned char *)state->output_portion + sorted_bytes,
+			(unsigned char *)state->input_portion + sorted_bytes,
+			portion_bytes - sorted_bytes);
+		mempool_checksum_written(slice, sorted_bytes, portion_bytes, 0);
 	}
 
-	upper_bound = left->right_queue.bound;
-
-	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, "
-		    "lower_bound %#llx, upper_bound %#llx\n",
-		    state->id,
-		    lower_bound,
-		    upper_bound);
-
-	if (upper_bound <= lower_bound) {
-		err = -ENOSPC;
-		goto finish_send_record_to_left_thread;
+	buf = mempool_worker_scratch(slice->worker, record_size);
+	if (!buf) {
+		MEMPOOL_ERR("fail to allocate buffer: "
+			    "portion %d, slice %d\n",
+			    state->id, slice->id);
+		return -ENOMEM;
 	}
 
-	record = (unsigned char *)state->output_portion;
-	record += record_size;
+	mempool_quicksort(state, buf, slice->start, slice->end - 1);
 
-	memcpy(left->right_queue.record, record, record_size);
+	return 0;
+}
 
-	left->right_queue.state = MEMPOOL_QUEUE_PLEASE_TAKE_RECORD;
+static
+int mempool_sort_lower_bound(struct mempool_portion_slice *slice,
+			     unsigned long long key)
+{
+	int low = slice->start;
+	int high = slice->end;
+	int middle;
 
-	state->start_index++;
+	while (low < high) {
+		middle = low + (high - low) / 2;
 
-finish_send_record_to_left_thread:
-	pthread_mutex_unlock(&left->right_queue.lock);
+		if (mempool_get_key(slice->state, middle) < key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
 
-	return err;
+	return low;
 }
 
+/*
+ * Choose key ranges of buckets by means of regular sampling
+ * of sorted runs.
+ */
 static
-int mempool_send_record_to_right_thread(struct mempool_thread_state *state,
-					struct mempool_thread_state *right)
+int mempool_sort_choose_splitters(struct mempool_sort_context *ctx)
 {
-	unsigned long long lower_bound;
-	unsigned long long upper_bound;
-	unsigned char *record;
-	unsigned int record_size;
-	int err = 0;
-
-	if (!right)
-		return -ENOSPC;
-
-	if (state->env->portion.count > state->env->portion.capacity) {
-		MEMPOOL_ERR("invalid portion descriptor: "
-			    "thread %d, count %d, capacity %d\n",
-			    state->id,
-			    state->env->portion.count,
-			    state->env->portion.capacity);
-		return -EFAULT;
+	unsigned long long *samples;
+	size_t samples_count = 0;
+	int samples_per_run;
+	int count;
+	int i, j;
+
+	samples = calloc((size_t)ctx->slices_count *
+				MEMPOOL_SORT_SAMPLES_PER_RUN + 1,
+			 sizeof(unsigned long long));
+	if (!samples) {
+		MEMPOOL_ERR("fail to allocate samples: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
 	}
 
-	record_size = (unsigned int)state->env->record.capacity *
-					state->env->item.granularity;
+	for (i = 0; i < ctx->slices_count; i++) {
+		struct mempool_portion_slice *slice = &ctx->slices[i];
 
-	pthread_mutex_lock(&state->right_queue.lock);
-	upper_bound = state->right_queue.bound;
-	pthread_mutex_unlock(&state->right_queue.lock);
+		count = slice->end - slice->start;
+		samples_per_run = MEMPOOL_SORT_SAMPLES_PER_RUN;
 
-	pthread_mutex_lock(&right->left_queue.lock);
+		if (samples_per_run > count)
+			samples_per_run = count;
 
-	switch (right->left_queue.state) {
-	case MEMPOOL_QUEUE_QUICKSORT_IN_PROGRESS:
-	case MEMPOOL_QUEUE_PLEASE_TAKE_RECORD:
-		err = -EAGAIN;
-		goto finish_send_record_to_right_thread;
+		for (j = 0; j < samples_per_run; j++) {
+			int index = slice->start +
+				(int)(((long long)j * count) / samples_per_run);
 
-	case MEMPOOL_QUEUE_READY_FOR_EXCHANGE:
-		/* continue logic */
-		break;
+			samples[samples_count++] =
+				mempool_get_key(slice->state, index);
+		}
+	}
 
-	case MEMPOOL_QUEUE_NO_FREE_SPACE:
-		err = -ENOSPC;
-		goto finish_send_record_to_right_thread;
+	qsort(samples, samples_count, sizeof(unsigned long long),
+		mempool_key_compare);
 
-	default:
-		err = -EFAULT;
-		goto finish_send_record_to_right_thread;
+	for (i = 0; i < (ctx->buckets - 1); i++) {
+		size_t index = ((size_t)(i + 1) * samples_count) /
+							ctx->buckets;
+
+		ctx->splitters[i] = samples[index];
 	}
 
-	lower_bound = right->left_queue.bound;
+	free(samples);
 
-	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, "
-		    "lower_bound %#llx, upper_bound %#llx\n",
-		    state->id,
-		    lower_bound,
-		    upper_bound);
+	return 0;
+}
 
-	if (upper_bound <= lower_bound) {
-		err = -ENOSPC;
-		goto finish_send_record_to_right_thread;
-	}
+static
+int mempool_sort_bounds_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_portion_slice *slice = arg;
+	struct mempool_sort_context *ctx = slice->state->sort;
+	int *bounds;
+	int i;
 
-	record = (unsigned char *)state->output_portion;
-	record += (state->env->portion.count - 1) * record_size;
+	bounds = ctx->bounds + (size_t)(slice - ctx->slices) *
+						(ctx->buckets + 1);
 
-	memcpy(right->left_queue.record, record, record_size);
+	bounds[0] = slice->start;
+	bounds[ctx->buckets] = slice->end;
 
-	right->left_queue.state = MEMPOOL_QUEUE_PLEASE_TAKE_RECORD;
+	for (i = 1; i < ctx->buckets; i++) {
+		bounds[i] = mempool_sort_lower_bound(slice,
+						     ctx->splitters[i - 1]);
+	}
 
-	state->end_index--;
+	return 0;
+}
 
-finish_send_record_to_right_thread:
-	pthread_mutex_unlock(&right->left_queue.lock);
+static inline
+int mempool_sort_run_before(unsigned long long *keys, int run1, int run2)
+{
+	if (keys[run1] != keys[run2])
+		return keys[run1] < keys[run2];
 
-	return err;
+	return run1 < run2;
 }
 
 static
-unsigned long long mempool_get_buffer_key(struct mempool_thread_state *state)
+void mempool_sort_heap_sift_down(int *heap, int count,
+				 unsigned long long *keys, int index)
 {
-	unsigned long long mask = state->env->key.mask;
-	unsigned long long key;
-	unsigned char *input;
-	unsigned char *output;
-	size_t written_bytes = 0;
-	int i;
+	int child;
+	int run;
 
-	for (i = 0; i < state->env->record.capacity; i++) {
-		input = (unsigned char *)state->buf;
-		input += (unsigned int)i * state->env->item.granularity;
+	while ((2 * index + 1) < count) {
+		child = 2 * index + 1;
 
-		if (written_bytes >= sizeof(unsigned long long))
-			return key;
+		if ((child + 1) < count &&
+		    mempool_sort_run_before(keys, heap[child + 1], heap[child]))
+			child++;
 
-		output = (unsigned char *)&key;
-		output += written_bytes;
+		if (!mempool_sort_run_before(keys, heap[child], heap[index]))
+			break;
 
-		if (is_bit_set(mask, i, state->env->record.capacity)) {
-			memcpy(output, input, state->env->item.granularity);
-			written_bytes += state->env->item.granularity;
-		}
+		run = heap[index];
+		heap[index] = heap[child];
+		heap[child] = run;
+		index = child;
 	}
-
-	return key;
 }
 
+/*
+ * Find portion that keeps record with global index @position.
+ */
 static
-int mempool_binary_search(struct mempool_thread_state *state, int low, int high)
+struct mempool_portion_state *
+mempool_sort_find_portion(struct mempool_sort_context *ctx, size_t position)
 {
+	int low = 0;
+	int high = ctx->env->threads.count - 1;
 	int middle;
-	unsigned long long key1, key2;
-
-	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, low %d, high %d\n",
-		    state->id, low, high);
 
-	if (low > high) {
-		MEMPOOL_DBG(state->env->show_debug,
-			    "thread %d, found %d, "
-			    "key1 %#llx, key2 %#llx\n",
-			    state->id, low + 1,
-			    mempool_get_key(state, low),
-			    mempool_get_buffer_key(state));
-		low++;
-
-		if (low >= state->env->portion.count)
-			low = state->env->portion.count - 1;
+	while (low < high) {
+		middle = low + (high - low + 1) / 2;
 
-		return low;
+		if (ctx->portions[middle].first <= position)
+			low = middle;
+		else
+			high = middle - 1;
 	}
 
-	middle = (low + high) / 2;
+	return &ctx->portions[low];
+}
 
-	key1 = mempool_get_key(state, middle);
-	key2 = mempool_get_buffer_key(state);
+/*
+ * Checksum records [@checksummed, @position) of the bucket that have
+ * been merged into @portion recently and are still in L1 cache.
+ */
+static inline
+void mempool_sort_checksum(struct mempool_portion_state *portion,
+			   unsigned int record_size, size_t *checksummed,
+			   size_t position, uint32_t *crc)
+{
+	unsigned char *output = (unsigned char *)portion->output_portion;
 
-	if (key1 == key2) {
-		MEMPOOL_DBG(state->env->show_debug,
-			    "thread %d, found %d, "
-			    "key1 %#llx, key2 %#llx\n",
-			    state->id, middle,
-			    mempool_get_key(state, middle),
-			    mempool_get_buffer_key(state));
-		return middle;
-	}
+	output += (*checksummed - portion->first) * record_size;
+	*crc = crc32c(*crc, output, (position - *checksummed) * record_size);
+	*checksummed = position;
+}
 
-	if (key1 > key2) {
-		return mempool_binary_search(state, low, middle - 1);
-	} else {
-		return mempool_binary_search(state, middle + 1, high);
-	}
+/*
+ * Bucket and portion are both ranges of merged records. CRC of their
+ * intersection is kept by index @bucket + @portion that is unique
+ * for every non-empty intersection.
+ */
+static inline
+void mempool_sort_store_checksum(struct mempool_sort_context *ctx,
+				 int bucket, int portion, uint32_t crc)
+{
+	ctx->checksums[bucket + portion] = crc;
 }
 
+/*
+ * The last phase of SORT algorithm: the bucket's ranges of all runs
+ * are merged by k-way merge directly into output. Position of record
+ * in output is defined by global rank of the record.
+ */
 static
-int mempool_take_record_from_left_thread(struct mempool_thread_state *state)
+int mempool_sort_merge_bucket_task(struct mempool_worker *worker, void *arg)
 {
-	unsigned char *record;
+	struct mempool_sort_bucket *bucket = arg;
+	struct mempool_sort_context *ctx = bucket->ctx;
+	struct mempool_test_environment *env = ctx->env;
+	struct mempool_portion_state *portion;
+	int runs = ctx->slices_count;
 	unsigned int record_size;
-	int position;
-	int err = 0;
-
-	if (state->env->portion.count > state->env->portion.capacity) {
-		MEMPOOL_ERR("invalid portion descriptor: "
-			    "thread %d, count %d, capacity %d\n",
-			    state->id,
-			    state->env->portion.count,
-			    state->env->portion.capacity);
-		return -EFAULT;
-	}
+	unsigned long long *keys;
+	unsigned char *record;
+	unsigned char *output;
+	size_t position;
+	size_t segment;
+	size_t checksummed;
+	uint32_t crc = 0;
+	int *heap;
+	int *cursor;
+	int *end;
+	int heap_count = 0;
+	int run;
+	int i;
 
-	record_size = (unsigned int)state->env->record.capacity *
-					state->env->item.granularity;
+	record_size = (unsigned int)env->record.capacity *
+					env->item.granularity;
 
-	pthread_mutex_lock(&state->left_queue.lock);
+	keys = mempool_worker_scratch(worker, (size_t)runs *
+				(sizeof(unsigned long long) + 3 * sizeof(int)));
+	if (!keys) {
+		MEMPOOL_ERR("fail to allocate buffer: bucket %d\n",
+			    bucket->id);
+		return -ENOMEM;
+	}
 
-	switch (state->left_queue.state) {
-	case MEMPOOL_QUEUE_READY_FOR_EXCHANGE:
-		err = -EAGAIN;
-		goto finish_take_record_from_left_thread;
+	heap = (int *)(keys + runs);
+	cursor = heap + runs;
+	end = cursor + runs;
 
-	case MEMPOOL_QUEUE_PLEASE_TAKE_RECORD:
-		/* continue logic */
-		break;
+	for (i = 0; i < runs; i++) {
+		int *bounds = ctx->bounds + (size_t)i * (ctx->buckets + 1);
 
-	case MEMPOOL_QUEUE_NO_FREE_SPACE:
-		err = -ENOSPC;
-		goto finish_take_record_from_left_thread;
+		cursor[i] = bounds[bucket->id];
+		end[i] = bounds[bucket->id + 1];
 
-	default:
-		err = -EFAULT;
-		goto finish_take_record_from_left_thread;
+		if (cursor[i] < end[i]) {
+			keys[i] = mempool_get_key(ctx->slices[i].state,
+						  cursor[i]);
+			heap[heap_count++] = i;
+		}
 	}
 
-	memcpy(state->buf, state->left_queue.record, record_size);
-
-	position = mempool_binary_search(state,
-					 state->start_index,
-					 state->end_index);
+	for (i = (heap_count / 2) - 1; i >= 0; i--)
+		mempool_sort_heap_sift_down(heap, heap_count, keys, i);
+
+	position = ctx->offsets[bucket->id];
+	portion = mempool_sort_find_portion(ctx, position);
+	segment = position;
+	checksummed = position;
+
+	while (heap_count > 0) {
+		run = heap[0];
+
+		record = (unsigned char *)ctx->slices[run].state->run;
+		record += (size_t)cursor[run] * record_size;
+
+		/* portions can keep different number of records */
+		while (position >= portion->first + portion->count) {
+			if (ctx->checksums && position > segment) {
+				mempool_sort_checksum(portion, record_size,
+						      &checksummed, position,
+						      &crc);
+				mempool_sort_store_checksum(ctx, bucket->id,
+							    portion->id, crc);
+				segment = position;
+				crc = 0;
+			}
 
-	if (position < 0 || position >= state->env->portion.count) {
-		err = -EFAULT;
-		MEMPOOL_ERR("invalid position: "
-			    "thread %d, position %d\n",
-			    state->id,
-			    position);
-		goto finish_take_record_from_left_thread;
-	}
+			portion++;
+		}
 
-	record = (unsigned char *)state->output_portion;
-	record += record_size;
+		output = (unsigned char *)portion->output_portion;
+		output += (position - portion->first) * record_size;
 
-	memmove(state->output_portion, record, position * record_size);
+		memcpy(output, record, record_size);
 
-	record = (unsigned char *)state->output_portion;
-	record += position * record_size;
+		position++;
+		cursor[run]++;
 
-	memcpy(record, state->buf, record_size);
+		if (ctx->checksums &&
+		    (position - checksummed) * record_size >=
+						MEMPOOL_CHECKSUM_BLOCK) {
+			mempool_sort_checksum(portion, record_size,
+					      &checksummed, position, &crc);
+		}
 
-	state->start_index = 0;
+		if (cursor[run] < end[run]) {
+			keys[run] = mempool_get_key(ctx->slices[run].state,
+						    cursor[run]);
+		} else {
+			heap_count--;
+			heap[0] = heap[heap_count];
+		}
 
-	state->left_queue.bound = mempool_get_key(state, 0);
+		mempool_sort_heap_sift_down(heap, heap_count, keys, 0);
+	}
 
-	state->left_queue.state = MEMPOOL_QUEUE_READY_FOR_EXCHANGE;
+	if (ctx->checksums && position > segment) {
+		mempool_sort_checksum(portion, record_size,
+				      &checksummed, position, &crc);
+		mempool_sort_store_checksum(ctx, bucket->id, portion->id, crc);
+	}
 
-finish_take_record_from_left_thread:
-	pthread_mutex_unlock(&state->left_queue.lock);
+	MEMPOOL_DBG(env->show_debug,
+		    "bucket %d has been merged: records %zu\n",
+		    bucket->id, position - ctx->offsets[bucket->id]);
 
-	return err;
+	return 0;
 }
 
 static
-int mempool_take_record_from_right_thread(struct mempool_thread_state *state)
+unsigned long long mempool_get_input_key(struct mempool_portion_state *state,
+					 int record_index)
 {
-	unsigned char *record;
-	unsigned int record_size;
-	int position;
-	int err = 0;
-
-	if (state->env->portion.count > state->env->portion.capacity) {
-		MEMPOOL_ERR("invalid portion descriptor: "
-			    "thread %d, count %d, capacity %d\n",
-			    state->id,
-			    state->env->portion.count,
-			    state->env->portion.capacity);
-		return -EFAULT;
-	}
-
-	record_size = (unsigned int)state->env->record.capacity *
-					state->env->item.granularity;
-
-	pthread_mutex_lock(&state->right_queue.lock);
-
-	switch (state->right_queue.state) {
-	case MEMPOOL_QUEUE_READY_FOR_EXCHANGE:
-		err = -EAGAIN;
-		goto finish_take_record_from_right_thread;
-
-	case MEMPOOL_QUEUE_PLEASE_TAKE_RECORD:
-		/* continue logic */
-		break;
-
-	case MEMPOOL_QUEUE_NO_FREE_SPACE:
-		err = -ENOSPC;
-		goto finish_take_record_from_right_thread;
-
-	default:
-		err = -EFAULT;
-		goto finish_take_record_from_right_thread;
-	}
-
-	memcpy(state->buf, state->right_queue.record, record_size);
-
-	position = mempool_binary_search(state,
-					 state->start_index,
-					 state->end_index);
-
-	if (position < 0 || position >= state->env->portion.count) {
-		err = -EFAULT;
-		MEMPOOL_ERR("invalid position: "
-			    "thread %d, position %d\n",
-			    state->id,
-			    position);
-		goto finish_take_record_from_right_thread;
-	}
-
-	record = (unsigned char *)state->output_portion;
-	record += position * record_size;
-
-	memmove(record + record_size, record,
-		((state->env->portion.count - 1) - position) * record_size);
-
-	record = (unsigned char *)state->output_portion;
-	record += position * record_size;
-
-	memcpy(record, state->buf, record_size);
-
-	state->end_index = state->env->portion.count - 1;
-
-	state->right_queue.bound =
-		mempool_get_key(state, state->env->portion.count - 1);
-
-	state->right_queue.state = MEMPOOL_QUEUE_READY_FOR_EXCHANGE;
-
-finish_take_record_from_right_thread:
-	pthread_mutex_unlock(&state->right_queue.lock);
-
-	return err;
-}
-
-static
-void mempool_exchange_sort(struct mempool_thread_state *state)
-{
-	struct mempool_thread_state *left_thread = NULL;
-	struct mempool_thread_state *right_thread = NULL;
-	unsigned long long lower_bound;
-	unsigned long long upper_bound;
-	int queue_state = MEMPOOL_QUEUE_READY_FOR_EXCHANGE;
-	int err1, err2;
-	int err = 0;
-
-	if (state->id != 0)
-		left_thread = &state->pool[state->id - 1];
-	else {
-		pthread_mutex_lock(&state->left_queue.lock);
-		state->left_queue.state = MEMPOOL_QUEUE_NO_FREE_SPACE;
-		pthread_mutex_unlock(&state->left_queue.lock);
-	}
-
-	if ((state->id + 1) < state->env->threads.count)
-		right_thread = &state->pool[state->id + 1];
-	else {
-		pthread_mutex_lock(&state->right_queue.lock);
-		state->right_queue.state = MEMPOOL_QUEUE_NO_FREE_SPACE;
-		pthread_mutex_unlock(&state->right_queue.lock);
-	}
-
-	lower_bound = mempool_get_key(state, 0);
-	upper_bound = mempool_get_key(state, state->env->portion.count - 1);
-
-	pthread_mutex_lock(&state->left_queue.lock);
-	state->left_queue.bound = lower_bound;
-	state->left_queue.state = queue_state;
-	pthread_mutex_unlock(&state->left_queue.lock);
-
-	pthread_mutex_lock(&state->right_queue.lock);
-	state->right_queue.bound = upper_bound;
-	state->right_queue.state = queue_state;
-	pthread_mutex_unlock(&state->right_queue.lock);
-
-	while (queue_state == MEMPOOL_QUEUE_READY_FOR_EXCHANGE) {
-		err = mempool_send_record_to_left_thread(state, left_thread);
-		if (err == -EFAULT) {
-			MEMPOOL_ERR("fail to send record to left thread: "
-				    "thread %d\n", state->id);
-			goto finish_exchange_sort;
-		} else if (err == -ENOSPC) {
-			err = 0;
-			pthread_mutex_lock(&state->left_queue.lock);
-			state->left_queue.state = MEMPOOL_QUEUE_NO_FREE_SPACE;
-			pthread_mutex_unlock(&state->left_queue.lock);
-		}
-
-		err = mempool_send_record_to_right_thread(state, right_thread);
-		if (err == -EFAULT) {
-			MEMPOOL_ERR("fail to send record to right thread: "
-				    "thread %d\n", state->id);
-			goto finish_exchange_sort;
-		} else if (err == -ENOSPC) {
-			err = 0;
-			pthread_mutex_lock(&state->right_queue.lock);
-			state->right_queue.state = MEMPOOL_QUEUE_NO_FREE_SPACE;
-			pthread_mutex_unlock(&state->right_queue.lock);
-		} else if (err == -EAGAIN)
-			continue;
-
-		err1 = mempool_take_record_from_left_thread(state);
-		if (err1 == -EFAULT) {
-			err = err1;
-			MEMPOOL_ERR("fail to process record from left thread: "
-				    "thread %d\n", state->id);
-			goto finish_exchange_sort;
-		} else if (err1 == -ENOSPC) {
-			MEMPOOL_DBG(state->env->show_debug,
-				    "no free space: thread %d\n",
-				    state->id);
-			pthread_mutex_lock(&state->left_queue.lock);
-			state->left_queue.state = MEMPOOL_QUEUE_NO_FREE_SPACE;
-			pthread_mutex_unlock(&state->left_queue.lock);
-		}
-
-		err2 = mempool_take_record_from_right_thread(state);
-		if (err2 == -EFAULT) {
-			err = err2;
-			MEMPOOL_ERR("fail to process record from right thread: "
-				    "thread %d\n", state->id);
-			goto finish_exchange_sort;
-		} else if (err2 == -ENOSPC) {
-			MEMPOOL_DBG(state->env->show_debug,
-				    "no free space: thread %d\n",
-				    state->id);
-			pthread_mutex_lock(&state->right_queue.lock);
-			state->right_queue.state = MEMPOOL_QUEUE_NO_FREE_SPACE;
-			pthread_mutex_unlock(&state->right_queue.lock);
-		}
-
-		if (err1 == -ENOSPC && err2 == -ENOSPC)
-			queue_state = MEMPOOL_QUEUE_NO_FREE_SPACE;
-	};
-
-finish_exchange_sort:
-	if (err) {
-		pthread_mutex_lock(&state->left_queue.lock);
-		state->left_queue.state = MEMPOOL_QUEUE_FAILED;
-		pthread_mutex_unlock(&state->left_queue.lock);
-
-		pthread_mutex_lock(&state->right_queue.lock);
-		state->right_queue.state = MEMPOOL_QUEUE_FAILED;
-		pthread_mutex_unlock(&state->right_queue.lock);
-	}
-
-	return;
-}
-
-static
-int mempool_sort_algorithm(struct mempool_thread_state *state)
-{
-	unsigned int record_size;
-	unsigned int portion_bytes;
-	int err = 0;
-
-	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, input %p, output %p\n",
-		    state->id,
-		    state->input_portion,
-		    state->output_portion);
-
-	record_size = (unsigned int)state->env->record.capacity *
-					state->env->item.granularity;
-	portion_bytes = record_size * state->env->portion.capacity;
-
-	memcpy(state->output_portion, state->input_portion,
-		portion_bytes);
-
-	state->buf = calloc(1, record_size);
-	if (!state->buf) {
-		err = -ENOMEM;
-		MEMPOOL_ERR("fail to allocate buffer: "
-			    "thread %d, %s\n",
-			    state->id,
-			    strerror(errno));
-		goto finish_algorithm;
-	}
-
-	pthread_mutex_lock(&state->left_queue.lock);
-	state->left_queue.record = calloc(1, record_size);
-	if (!state->left_queue.record) {
-		err = -ENOMEM;
-		state->left_queue.state = MEMPOOL_QUEUE_FAILED;
-		MEMPOOL_ERR("fail to allocate buffer: "
-			    "thread %d, %s\n",
-			    state->id,
-			    strerror(errno));
-		goto finish_algorithm;
-	}
-	state->left_queue.state = MEMPOOL_QUEUE_QUICKSORT_IN_PROGRESS;
-	pthread_mutex_unlock(&state->left_queue.lock);
-
-	pthread_mutex_lock(&state->right_queue.lock);
-	state->right_queue.record = calloc(1, record_size);
-	if (!state->right_queue.record) {
-		err = -ENOMEM;
-		state->right_queue.state = MEMPOOL_QUEUE_FAILED;
-		MEMPOOL_ERR("fail to allocate buffer: "
-			    "thread %d, %s\n",
-			    state->id,
-			    strerror(errno));
-		goto finish_algorithm;
-	}
-	state->right_queue.state = MEMPOOL_QUEUE_QUICKSORT_IN_PROGRESS;
-	pthread_mutex_unlock(&state->right_queue.lock);
-
-	mempool_quicksort(state, 0, state->env->portion.count - 1);
-
-	mempool_exchange_sort(state);
-
-finish_algorithm:
-	if (state->buf)
-		free(state->buf);
-
-	if (state->left_queue.record)
-		free(state->left_queue.record);
-
-	if (state->right_queue.record)
-		free(state->right_queue.record);
-
-	return err;
-}
-
-static
-unsigned long long mempool_get_input_key(struct mempool_thread_state *state,
-					 int record_index)
-{
-	unsigned int record_size;
 	unsigned long long mask = state->env->key.mask;
 	unsigned long long key = 0;
 	unsigned char *input;
@@ -963,32 +1078,25 @@ unsigned long long mempool_get_input_key(struct mempool_thread_state *state,
 	size_t written_bytes = 0;
 	int i;
 
-	if (state->env->portion.count > state->env->portion.capacity) {
+	if (state->count > state->env->portion.capacity) {
 		MEMPOOL_ERR("invalid portion descriptor: "
-			    "thread %d, count %d, capacity %d\n",
+			    "portion %d, count %d, capacity %d\n",
 			    state->id,
-			    state->env->portion.count,
+			    state->count,
 			    state->env->portion.capacity);
 		return 0;
 	}
 
-	if (record_index >= state->env->portion.count) {
+	if (record_index >= state->count) {
 		MEMPOOL_ERR("out of range: "
-			    "thread %d, record_index %d, count %d\n",
+			    "portion %d, record_index %d, count %d\n",
 			    state->id,
 			    record_index,
-			    state->env->portion.count);
+			    state->count);
 		return 0;
 	}
 
-	record_size = (unsigned int)state->env->record.capacity *
-					state->env->item.granularity;
-
 	for (i = 0; i < state->env->record.capacity; i++) {
-		input = (unsigned char *)state->input_portion;
-		input += (unsigned int)record_index * record_size;
-		input += (unsigned int)i * state->env->item.granularity;
-
 		if (written_bytes >= sizeof(unsigned long long))
 			return key;
 
@@ -996,6 +1104,7 @@ unsigned long long mempool_get_input_key(struct mempool_thread_state *state,
 		output += written_bytes;
 
 		if (is_bit_set(mask, i, state->env->record.capacity)) {
+			input = mempool_input_item(state, record_index, i);
 			memcpy(output, input, state->env->item.granularity);
 			written_bytes += state->env->item.granularity;
 		}
@@ -1006,37 +1115,48 @@ unsigned long long mempool_get_input_key(struct mempool_thread_state *state,
 
 
 static
-int mempool_select_algorithm(struct mempool_thread_state *state)
+int mempool_select_algorithm(struct mempool_portion_slice *slice)
 {
+	struct mempool_portion_state *state = slice->state;
 	unsigned int record_size;
-	unsigned int portion_bytes;
-	size_t written_bytes = 0;
+	size_t portion_bytes;
+	size_t start_bytes;
+	size_t written_bytes;
+	size_t checksummed;
 	unsigned long long min;
 	unsigned long long max;
 	int i;
 	int err;
 
 	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, input %p, output %p\n",
-		    state->id,
+		    "portion %d, slice %d, records [%d, %d), "
+		    "input %p, output %p\n",
+		    state->id, slice->id,
+		    slice->start, slice->end,
 		    state->input_portion,
 		    state->output_portion);
 
 	record_size = (unsigned int)state->env->record.capacity *
 					state->env->item.granularity;
-	portion_bytes = record_size * state->env->portion.capacity;
+	portion_bytes = (size_t)record_size * state->env->portion.capacity;
 	min = state->env->condition.min;
 	max = state->env->condition.max;
 
-	memset(state->output_portion, 0, portion_bytes);
+	/*
+	 * Selected records are written from the slice's position
+	 * in KEY-VALUE output. The join moves them to the final place.
+	 */
+	start_bytes = (size_t)slice->start * mempool_key_value_bytes(state->env);
+	written_bytes = start_bytes;
+	checksummed = start_bytes;
 
-	for (i = 0; i < state->env->portion.count; i++) {
+	for (i = slice->start; i < slice->end; i++) {
 		unsigned long long key = 0;
 
 		if ((written_bytes + record_size) > portion_bytes) {
 			MEMPOOL_ERR("out of space: "
-				    "thread %d, written_bytes %zu, "
-				    "portion_bytes %u\n",
+				    "portion %d, written_bytes %zu, "
+				    "portion_bytes %zu\n",
 				    state->id,
 				    written_bytes,
 				    portion_bytes);
@@ -1046,7 +1166,7 @@ int mempool_select_algorithm(struct mempool_thread_state *state)
 		key = mempool_get_input_key(state, i);
 
 		MEMPOOL_DBG(state->env->show_debug,
-			    "thread %d, key %llu, min %llu, max %llu\n",
+			    "portion %d, key %llu, min %llu, max %llu\n",
 			    state->id,
 			    key, min, max);
 
@@ -1054,7 +1174,7 @@ int mempool_select_algorithm(struct mempool_thread_state *state)
 			err = mempool_copy_key(state, i, &written_bytes);
 			if (err) {
 				MEMPOOL_ERR("fail to copy key: "
-					    "thread %d, record_index %d, "
+					    "portion %d, record_index %d, "
 					    "written_bytes %zu, err %d\n",
 					    state->id, i, written_bytes, err);
 				return err;
@@ -1063,63 +1183,113 @@ int mempool_select_algorithm(struct mempool_thread_state *state)
 			err = mempool_copy_value(state, i, &written_bytes);
 			if (err) {
 				MEMPOOL_ERR("fail to copy value: "
-					    "thread %d, record_index %d, "
+					    "portion %d, record_index %d, "
 					    "written_bytes %zu, err %d\n",
 					    state->id, i, written_bytes, err);
 				return err;
 			}
+
+			checksummed = mempool_checksum_written(slice,
+						checksummed, written_bytes,
+						MEMPOOL_CHECKSUM_BLOCK);
 		}
 	}
 
+	mempool_checksum_written(slice, checksummed, written_bytes, 0);
+
+	slice->written_bytes = written_bytes - start_bytes;
+
 	return 0;
 }
 
+/*
+ * Join results of SELECT slices: selected records of every slice
+ * are moved right after the records of previous slice and the rest
+ * of output portion is cleaned.
+ */
 static
-int mempool_add_value(struct mempool_thread_state *state,
-		      unsigned long long mask,
-		      int record_index, size_t *written_bytes)
+int mempool_select_join_task(struct mempool_worker *worker, void *arg)
 {
+	struct mempool_portion_state *state = arg;
+	struct mempool_portion_slice *slice;
+	unsigned char *output = state->output_portion;
 	unsigned int record_size;
+	size_t portion_bytes;
+	size_t start_bytes;
+	size_t offset = 0;
+	int i;
+
+	record_size = (unsigned int)state->env->record.capacity *
+					state->env->item.granularity;
+	portion_bytes = (size_t)record_size * state->env->portion.capacity;
+
+	for (i = 0; i < state->slices_count; i++) {
+		slice = &state->slices[i];
+
+		start_bytes = (size_t)slice->start *
+				mempool_key_value_bytes(state->env);
+
+		if (start_bytes != offset && slice->written_bytes > 0) {
+			memmove(output + offset, output + start_bytes,
+				slice->written_bytes);
+		}
+
+		offset += slice->written_bytes;
+	}
+
+	memset(output + offset, 0, portion_bytes - offset);
+
+	MEMPOOL_DBG(state->env->show_debug,
+		    "portion %d, slices %d, selected bytes %zu\n",
+		    state->id, state->slices_count, offset);
+
+	return 0;
+}
+
+static
+int mempool_add_value(struct mempool_portion_state *state,
+		      unsigned long long mask,
+		      int record_index,
+		      unsigned long long *sums,
+		      size_t *written_bytes)
+{
 	unsigned char *input;
 	unsigned long long *output;
 	int value_items = 0;
 	int i;
 
 	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, mask %#llx, "
+		    "portion %d, mask %#llx, "
 		    "record_index %d, written_bytes %zu\n",
 		    state->id, mask, record_index, *written_bytes);
 
-	if (!state->input_portion || !state->output_portion) {
+	if (!state->input_portion || !sums) {
 		MEMPOOL_ERR("fail to copy key: "
-			    "thread %d, input_portion %p, output_portion %p\n",
+			    "portion %d, input_portion %p, sums %p\n",
 			    state->id,
 			    state->input_portion,
-			    state->output_portion);
+			    sums);
 		return -ERANGE;
 	}
 
-	if (state->env->portion.count > state->env->portion.capacity) {
+	if (state->count > state->env->portion.capacity) {
 		MEMPOOL_ERR("invalid portion descriptor: "
-			    "thread %d, count %d, capacity %d\n",
+			    "portion %d, count %d, capacity %d\n",
 			    state->id,
-			    state->env->portion.count,
+			    state->count,
 			    state->env->portion.capacity);
 		return -ERANGE;
 	}
 
-	if (record_index >= state->env->portion.count) {
+	if (record_index >= state->count) {
 		MEMPOOL_ERR("out of range: "
-			    "thread %d, record_index %d, count %d\n",
+			    "portion %d, record_index %d, count %d\n",
 			    state->id,
 			    record_index,
-			    state->env->portion.count);
+			    state->count);
 		return -ERANGE;
 	}
 
-	record_size = (unsigned int)state->env->record.capacity *
-					state->env->item.granularity;
-
 	for (i = 0; i < state->env->record.capacity; i++) {
 		if (is_bit_set(mask, i, state->env->record.capacity))
 			value_items++;
@@ -1131,14 +1301,11 @@ int mempool_add_value(struct mempool_thread_state *state,
 		return 0;
 
 	for (i = 0; i < state->env->record.capacity; i++) {
-		input = (unsigned char *)state->input_portion;
-		input += (unsigned int)record_index * record_size;
-		input += (unsigned int)i * state->env->item.granularity;
-
-		output = (unsigned long long *)state->output_portion;
+		output = sums;
 		output += i;
 
 		if (is_bit_set(mask, i, state->env->record.capacity)) {
+			input = mempool_input_item(state, record_index, i);
 			*output += *input;
 		}
 	}
@@ -1148,32 +1315,40 @@ int mempool_add_value(struct mempool_thread_state *state,
 	return 0;
 }
 
+/*
+ * Every slice of TOTAL algorithm accumulates partial sums.
+ * The join adds partial sums into output portion.
+ */
 static
-int mempool_total_algorithm(struct mempool_thread_state *state)
+int mempool_total_algorithm(struct mempool_portion_slice *slice)
 {
+	struct mempool_portion_state *state = slice->state;
 	unsigned int record_size;
-	unsigned int portion_bytes;
+	size_t portion_bytes;
 	size_t written_bytes = 0;
 	int i;
 	int err;
 
 	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, input %p, output %p\n",
-		    state->id,
+		    "portion %d, slice %d, records [%d, %d), "
+		    "input %p, output %p\n",
+		    state->id, slice->id,
+		    slice->start, slice->end,
 		    state->input_portion,
 		    state->output_portion);
 
 	record_size = (unsigned int)state->env->record.capacity *
 					state->env->item.granularity;
-	portion_bytes = record_size * state->env->portion.capacity;
+	portion_bytes = (size_t)record_size * state->env->portion.capacity;
 
-	memset(state->output_portion, 0, portion_bytes);
+	memset(slice->sums, 0,
+		state->env->record.capacity * sizeof(unsigned long long));
 
-	for (i = 0; i < state->env->portion.count; i++) {
+	for (i = slice->start; i < slice->end; i++) {
 		if ((written_bytes + record_size) > portion_bytes) {
 			MEMPOOL_ERR("out of space: "
-				    "thread %d, written_bytes %zu, "
-				    "portion_bytes %u\n",
+				    "portion %d, written_bytes %zu, "
+				    "portion_bytes %zu\n",
 				    state->id,
 				    written_bytes,
 				    portion_bytes);
@@ -1181,10 +1356,10 @@ int mempool_total_algorithm(struct mempool_thread_state *state)
 		}
 
 		err = mempool_add_value(state, state->env->value.mask,
-					i, &written_bytes);
+					i, slice->sums, &written_bytes);
 		if (err) {
 			MEMPOOL_ERR("fail to add value: "
-				    "thread %d, record_index %d, "
+				    "portion %d, record_index %d, "
 				    "written_bytes %zu, err %d\n",
 				    state->id, i, written_bytes, err);
 			return err;
@@ -1194,138 +1369,2777 @@ int mempool_total_algorithm(struct mempool_thread_state *state)
 	return 0;
 }
 
-void *ThreadFunc(void *arg)
+static
+int mempool_total_join_task(struct mempool_worker *worker, void *arg)
 {
-	struct mempool_thread_state *state = (struct mempool_thread_state *)arg;
+	struct mempool_portion_state *state = arg;
+	struct mempool_test_environment *env = state->env;
+	unsigned long long *output = state->output_portion;
+	unsigned int record_size;
+	size_t portion_bytes;
+	int i, j;
 
-	if (!state)
-		pthread_exit((void *)1);
+	record_size = (unsigned int)env->record.capacity *
+					env->item.granularity;
+	portion_bytes = (size_t)record_size * env->portion.capacity;
 
-	MEMPOOL_DBG(state->env->show_debug,
-		    "thread %d, input %p, output %p, algorithm %#x\n",
-		    state->id,
+	memset(state->output_portion, 0, portion_bytes);
+
+	if (state->count == 0)
+		return 0;
+
+	for (i = 0; i < env->record.capacity; i++) {
+		if (!is_bit_set(env->value.mask, i, env->record.capacity))
+			continue;
+
+		for (j = 0; j < state->slices_count; j++)
+			output[i] += state->slices[j].sums[i];
+	}
+
+	return 0;
+}
+
+/*
+ * CONVERT algorithm rewrites records of the slice into the output
+ * layout. Output is written sequentially: PAX output is filled
+ * by columns and ROW output is filled by records.
+ */
+static
+int mempool_convert_algorithm(struct mempool_portion_slice *slice)
+{
+	struct mempool_portion_state *state = slice->state;
+	struct mempool_test_environment *env = state->env;
+	size_t granularity = env->item.granularity;
+	int capacity = env->record.capacity;
+	unsigned char *output;
+	size_t portion_bytes;
+	size_t written_bytes;
+	size_t index;
+	int i, j;
+
+	MEMPOOL_DBG(env->show_debug,
+		    "portion %d, slice %d, records [%d, %d), "
+		    "input %p, output %p, layout %d\n",
+		    state->id, slice->id,
+		    slice->start, slice->end,
 		    state->input_portion,
 		    state->output_portion,
-		    state->env->algorithm.id);
+		    env->layout.output);
 
-	state->err = 0;
+	if (!state->input_portion || !state->output_portion ||
+	    state->count > env->portion.capacity) {
+		MEMPOOL_ERR("invalid portion descriptor: "
+			    "portion %d, count %d, capacity %d\n",
+			    state->id,
+			    state->count,
+			    env->portion.capacity);
+		return -ERANGE;
+	}
 
-	switch (state->env->algorithm.id) {
-	case MEMPOOL_KEY_VALUE_ALGORITHM:
-		state->err = mempool_key_value_algorithm(state);
-		if (state->err) {
-			MEMPOOL_ERR("key-value algorithm failed: "
-				    "thread %d, input %p, output %p, err %d\n",
-				    state->id,
-				    state->input_portion,
-				    state->output_portion,
-				    state->err);
-		}
-		break;
+	if (env->layout.output == MEMPOOL_PAX_LAYOUT) {
+		for (j = 0; j < capacity; j++) {
+			index = (size_t)j * state->count + slice->start;
+			output = (unsigned char *)state->output_portion +
+							index * granularity;
 
-	case MEMPOOL_SORT_ALGORITHM:
-		state->err = mempool_sort_algorithm(state);
-		if (state->err) {
-			MEMPOOL_ERR("sort algorithm failed: "
-				    "thread %d, input %p, output %p, err %d\n",
-				    state->id,
-				    state->input_portion,
-				    state->output_portion,
-				    state->err);
+			for (i = slice->start; i < slice->end; i++) {
+				memcpy(output, mempool_input_item(state, i, j),
+					granularity);
+				output += granularity;
+			}
 		}
-		break;
-
-	case MEMPOOL_SELECT_ALGORITHM:
-		state->err = mempool_select_algorithm(state);
-		if (state->err) {
-			MEMPOOL_ERR("select algorithm failed: "
-				    "thread %d, input %p, output %p, err %d\n",
-				    state->id,
-				    state->input_portion,
-				    state->output_portion,
-				    state->err);
+	} else {
+		index = (size_t)slice->start * capacity;
+		output = (unsigned char *)state->output_portion +
+							index * granularity;
+
+		for (i = slice->start; i < slice->end; i++) {
+			for (j = 0; j < capacity; j++) {
+				memcpy(output, mempool_input_item(state, i, j),
+					granularity);
+				output += granularity;
+			}
 		}
-		break;
+	}
 
-	case MEMPOOL_TOTAL_ALGORITHM:
-		state->err = mempool_total_algorithm(state);
-		if (state->err) {
-			MEMPOOL_ERR("total algorithm failed: "
-				    "thread %d, input %p, output %p, err %d\n",
-				    state->id,
-				    state->input_portion,
-				    state->output_portion,
-				    state->err);
-		}
-		break;
+	slice->written_bytes = (size_t)(slice->end - slice->start) *
+						capacity * granularity;
 
-	default:
-		state->err = -EOPNOTSUPP;
-		MEMPOOL_ERR("unknown algorithm %#x: "
-			    "thread %d, input %p, output %p\n",
-			    state->env->algorithm.id,
-			    state->id,
-			    state->input_portion,
-			    state->output_portion);
-		break;
+	if (slice->end == state->count) {
+		/* the last slice cleans the rest of output portion */
+		portion_bytes = (size_t)env->portion.capacity *
+						capacity * granularity;
+		written_bytes = (size_t)state->count * capacity * granularity;
+
+		memset((unsigned char *)state->output_portion + written_bytes,
+			0, portion_bytes - written_bytes);
 	}
 
-	MEMPOOL_DBG(state->env->show_debug,
-		    "algorithm %#x has been finished: "
-		    "thread %d, input %p, output %p, err %d\n",
-		    state->env->algorithm.id,
-		    state->id,
-		    state->input_portion,
-		    state->output_portion,
-		    state->err);
+	return 0;
+}
+
+/*
+ * struct mempool_scan_context - chunked reader of encoded portion
+ * @cursors: readers of columns
+ * @items: items of chunk (MEMPOOL_CODEC_GROUP items of every column)
+ * @mask: bitmap of columns that are read
+ */
+struct mempool_scan_context {
+	struct mempool_codec_cursor *cursors;
+	unsigned long long *items;
+	unsigned long long mask;
+};
+
+static
+void mempool_scan_destroy(struct mempool_scan_context *scan)
+{
+	if (scan->cursors)
+		free(scan->cursors);
 
-	pthread_exit((void *)0);
+	if (scan->items)
+		free(scan->items);
 }
 
-int main(int argc, char *argv[])
+static
+int mempool_scan_init(struct mempool_portion_slice *slice,
+		      unsigned long long mask,
+		      struct mempool_scan_context *scan)
 {
-	struct mempool_test_environment environment;
-	struct mempool_thread_state *pool = NULL;
-	struct mempool_thread_state *cur;
-	void *input_addr = NULL;
-	void *output_addr = NULL;
-	off_t file_size;
-	unsigned int portion_size;
+	struct mempool_portion_state *state = slice->state;
+	int capacity = state->env->record.capacity;
 	int i;
-	void *res;
-	int err = 0;
+	int err;
 
-	environment.input_file.fd = -1;
-	environment.input_file.stream = NULL;
-	environment.input_file.name = NULL;
-	environment.output_file.fd = -1;
-	environment.output_file.stream = NULL;
-	environment.output_file.name = NULL;
-	environment.threads.count = 0;
-	environment.threads.portion_size = 0;
-	environment.item.granularity = 1;
-	environment.record.capacity = 1;
-	environment.portion.capacity = 0;
-	environment.portion.count = 0;
-	environment.key.mask = 0;
-	environment.value.mask = 0;
-	environment.condition.min = 0;
-	environment.condition.max = ULLONG_MAX;
-	environment.algorithm.id = MEMPOOL_UNKNOWN_ALGORITHM;
-	environment.show_debug = MEMPOOL_FALSE;
+	scan->mask = mask;
+	scan->cursors = calloc(capacity, sizeof(struct mempool_codec_cursor));
+	scan->items = calloc((size_t)capacity * MEMPOOL_CODEC_GROUP,
+			     sizeof(unsigned long long));
+	if (!scan->cursors || !scan->items) {
+		MEMPOOL_ERR("fail to allocate scan context: %s\n",
+			    strerror(errno));
+		mempool_scan_destroy(scan);
+		return -ENOMEM;
+	}
 
-	parse_options(argc, argv, &environment);
+	for (i = 0; i < capacity; i++) {
+		if (!is_bit_set(mask, i, capacity))
+			continue;
 
-	MEMPOOL_DBG(environment.show_debug,
-		    "options have been parsed\n");
+		err = mempool_codec_cursor_init(&scan->cursors[i],
+						state->encoded_portion, i);
+		if (!err) {
+			err = mempool_codec_cursor_seek(&scan->cursors[i],
+							slice->start);
+		}
 
-	if (environment.threads.count == 0) {
-		MEMPOOL_INFO("Nothing can be done: "
-			     "threads.count %d\n",
-			     environment.threads.count);
-		goto finish_execution;
+		if (err) {
+			MEMPOOL_ERR("fail to prepare column: "
+				    "portion %d, column %d, err %d\n",
+				    state->id, i, err);
+			mempool_scan_destroy(scan);
+			return err;
+		}
 	}
 
+	return 0;
+}
+
+static
+int mempool_scan_read(struct mempool_portion_state *state,
+		      struct mempool_scan_context *scan,
+		      unsigned int count)
+{
+	int capacity = state->env->record.capacity;
+	int i;
+	int err;
+
+	for (i = 0; i < capacity; i++) {
+		if (!is_bit_set(scan->mask, i, capacity))
+			continue;
+
+		err = mempool_codec_cursor_read(&scan->cursors[i],
+				&scan->items[(size_t)i * MEMPOOL_CODEC_GROUP],
+				count);
+		if (err) {
+			MEMPOOL_ERR("fail to read column: "
+				    "portion %d, column %d, err %d\n",
+				    state->id, i, err);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
+static inline
+unsigned long long *mempool_scan_item(struct mempool_scan_context *scan,
+				      int column, unsigned int index)
+{
+	return &scan->items[(size_t)column * MEMPOOL_CODEC_GROUP + index];
+}
+
+/*
+ * Key is composed as mempool_get_input_key() does it.
+ */
+static
+unsigned long long mempool_scan_key(struct mempool_portion_state *state,
+				    struct mempool_scan_context *scan,
+				    unsigned int index)
+{
+	struct mempool_test_environment *env = state->env;
+	unsigned long long key = 0;
+	size_t written_bytes = 0;
+	size_t bytes;
+	int i;
+
+	for (i = 0; i < env->record.capacity; i++) {
+		if (written_bytes >= sizeof(unsigned long long))
+			break;
+
+		if (!is_bit_set(env->key.mask, i, env->record.capacity))
+			continue;
+
+		bytes = env->item.granularity;
+		if (bytes > sizeof(unsigned long long) - written_bytes)
+			bytes = sizeof(unsigned long long) - written_bytes;
+
+		memcpy((unsigned char *)&key + written_bytes,
+			mempool_scan_item(scan, i, index), bytes);
+		written_bytes += bytes;
+	}
+
+	return key;
+}
+
+static
+size_t mempool_scan_copy(struct mempool_portion_state *state,
+			 struct mempool_scan_context *scan,
+			 unsigned long long mask,
+			 unsigned int index, unsigned char *output)
+{
+	struct mempool_test_environment *env = state->env;
+	size_t written_bytes = 0;
+	int i;
+
+	for (i = 0; i < env->record.capacity; i++) {
+		if (!is_bit_set(mask, i, env->record.capacity))
+			continue;
+
+		memcpy(output + written_bytes,
+			mempool_scan_item(scan, i, index),
+			env->item.granularity);
+		written_bytes += env->item.granularity;
+	}
+
+	return written_bytes;
+}
+
+/*
+ * SELECT of encoded portion: key and value columns are unpacked
+ * by chunks, so the portion is never decoded completely.
+ */
+static
+int mempool_select_encoded(struct mempool_portion_slice *slice)
+{
+	struct mempool_portion_state *state = slice->state;
+	struct mempool_test_environment *env = state->env;
+	struct mempool_scan_context scan;
+	unsigned char *output = state->output_portion;
+	unsigned int record_size;
+	size_t portion_bytes;
+	size_t start_bytes;
+	size_t written_bytes;
+	size_t checksummed;
+	unsigned int count;
+	unsigned int j;
+	int i;
+	int err;
+
+	record_size = (unsigned int)env->record.capacity *
+					env->item.granularity;
+	portion_bytes = (size_t)record_size * env->portion.capacity;
+
+	err = mempool_scan_init(slice, env->key.mask | env->value.mask,
+				&scan);
+	if (err)
+		return err;
+
+	start_bytes = (size_t)slice->start * mempool_key_value_bytes(env);
+	written_bytes = start_bytes;
+	checksummed = start_bytes;
+
+	for (i = slice->start; i < slice->end; i += count) {
+		count = slice->end - i;
+		if (count > MEMPOOL_CODEC_GROUP)
+			count = MEMPOOL_CODEC_GROUP;
+
+		err = mempool_scan_read(state, &scan, count);
+		if (err)
+			goto finish_select;
+
+		for (j = 0; j < count; j++) {
+			unsigned long long key;
+
+			if ((written_bytes + record_size) > portion_bytes) {
+				err = -E2BIG;
+				MEMPOOL_ERR("out of space: "
+					    "portion %d, written_bytes %zu, "
+					    "portion_bytes %zu\n",
+					    state->id,
+					    written_bytes,
+					    portion_bytes);
+				goto finish_select;
+			}
+
+			key = mempool_scan_key(state, &scan, j);
+
+			if (env->condition.min <= key &&
+			    key < env->condition.max) {
+				written_bytes += mempool_scan_copy(state, &scan,
+							env->key.mask, j,
+							output + written_bytes);
+				written_bytes += mempool_scan_copy(state, &scan,
+							env->value.mask, j,
+							output + written_bytes);
+			}
+		}
+
+		checksummed = mempool_checksum_written(slice, checksummed,
+						written_bytes,
+						MEMPOOL_CHECKSUM_BLOCK);
+	}
+
+	mempool_checksum_written(slice, checksummed, written_bytes, 0);
+
+	slice->written_bytes = written_bytes - start_bytes;
+
+finish_select:
+	mempool_scan_destroy(&scan);
+
+	return err;
+}
+
+/*
+ * TOTAL of encoded portion: value columns are unpacked by chunks.
+ * The first byte of item is added as mempool_add_value() does it.
+ */
+static
+int mempool_total_encoded(struct mempool_portion_slice *slice)
+{
+	struct mempool_portion_state *state = slice->state;
+	struct mempool_test_environment *env = state->env;
+	struct mempool_scan_context scan;
+	unsigned long long *items;
+	unsigned int count;
+	unsigned int j;
+	int i, k;
+	int err;
+
+	memset(slice->sums, 0,
+		env->record.capacity * sizeof(unsigned long long));
+
+	err = mempool_scan_init(slice, env->value.mask, &scan);
+	if (err)
+		return err;
+
+	for (i = slice->start; i < slice->end; i += count) {
+		count = slice->end - i;
+		if (count > MEMPOOL_CODEC_GROUP)
+			count = MEMPOOL_CODEC_GROUP;
+
+		err = mempool_scan_read(state, &scan, count);
+		if (err)
+			goto finish_total;
+
+		for (k = 0; k < env->record.capacity; k++) {
+			if (!is_bit_set(env->value.mask, k,
+					env->record.capacity))
+				continue;
+
+			items = mempool_scan_item(&scan, k, 0);
+
+			for (j = 0; j < count; j++)
+				slice->sums[k] += (unsigned char)items[j];
+		}
+	}
+
+finish_total:
+	mempool_scan_destroy(&scan);
+
+	return err;
+}
+
+static
+int mempool_topk_heap_init(struct mempool_topk_heap *heap,
+			   int capacity, unsigned int record_size)
+{
+	heap->count = 0;
+	heap->capacity = capacity;
+
+	heap->records = calloc(capacity, record_size);
+	heap->keys = calloc(capacity, sizeof(unsigned long long));
+	heap->slots = calloc(capacity, sizeof(int));
+
+	if (!heap->records || !heap->keys || !heap->slots) {
+		MEMPOOL_ERR("fail to allocate TOPK heap: "
+			    "capacity %d, %s\n",
+			    capacity, strerror(errno));
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static
+void mempool_topk_heap_destroy(struct mempool_topk_heap *heap)
+{
+	if (heap->records)
+		free(heap->records);
+
+	if (heap->keys)
+		free(heap->keys);
+
+	if (heap->slots)
+		free(heap->slots);
+
+	heap->records = NULL;
+	heap->keys = NULL;
+	heap->slots = NULL;
+	heap->count = 0;
+}
+
+/*
+ * Check that key1 is worse candidate than key2: larger key is worse
+ * for ascending order and smaller key is worse for descending one.
+ */
+static inline
+int mempool_topk_is_worse(int order,
+			  unsigned long long key1,
+			  unsigned long long key2)
+{
+	if (order == MEMPOOL_DESCENDING_ORDER)
+		return key1 < key2;
+
+	return key1 > key2;
+}
+
+static
+void mempool_topk_sift_up(struct mempool_topk_heap *heap,
+			  int order, int index)
+{
+	int parent;
+	int slot;
+
+	while (index > 0) {
+		parent = (index - 1) / 2;
+
+		if (!mempool_topk_is_worse(order,
+					   heap->keys[heap->slots[index]],
+					   heap->keys[heap->slots[parent]]))
+			break;
+
+		slot = heap->slots[index];
+		heap->slots[index] = heap->slots[parent];
+		heap->slots[parent] = slot;
+		index = parent;
+	}
+}
+
+static
+void mempool_topk_sift_down(struct mempool_topk_heap *heap,
+			    int order, int index)
+{
+	int child;
+	int slot;
+
+	while ((2 * index + 1) < heap->count) {
+		child = 2 * index + 1;
+
+		if ((child + 1) < heap->count &&
+		    mempool_topk_is_worse(order,
+					  heap->keys[heap->slots[child + 1]],
+					  heap->keys[heap->slots[child]]))
+			child++;
+
+		if (!mempool_topk_is_worse(order,
+					   heap->keys[heap->slots[child]],
+					   heap->keys[heap->slots[index]]))
+			break;
+
+		slot = heap->slots[index];
+		heap->slots[index] = heap->slots[child];
+		heap->slots[child] = slot;
+		index = child;
+	}
+}
+
+/*
+ * Offer the record into the heap. The record is stored only if
+ * the heap is not full yet or the record is better than the worst
+ * candidate in the heap (the root). It costs O(log K).
+ */
+static
+void mempool_topk_heap_offer(struct mempool_topk_heap *heap, int order,
+			     unsigned long long key, const void *record,
+			     unsigned int record_size)
+{
+	unsigned char *slot_record;
+	int slot;
+
+	if (heap->capacity <= 0)
+		return;
+
+	if (heap->count < heap->capacity) {
+		slot = heap->count;
+
+		slot_record = (unsigned char *)heap->records;
+		slot_record += (size_t)slot * record_size;
+		memcpy(slot_record, record, record_size);
+		heap->keys[slot] = key;
+
+		heap->slots[heap->count] = slot;
+		heap->count++;
+		mempool_topk_sift_up(heap, order, heap->count - 1);
+	} else if (mempool_topk_is_worse(order,
+					 heap->keys[heap->slots[0]], key)) {
+		slot = heap->slots[0];
+
+		slot_record = (unsigned char *)heap->records;
+		slot_record += (size_t)slot * record_size;
+		memcpy(slot_record, record, record_size);
+		heap->keys[slot] = key;
+
+		mempool_topk_sift_down(heap, order, 0);
+	}
+}
+
+static
+int mempool_topk_algorithm(struct mempool_portion_state *state)
+{
+	unsigned int record_size;
+	unsigned char *record;
+	unsigned long long key;
+	int i;
+	int err;
+
+	MEMPOOL_DBG(state->env->show_debug,
+		    "portion %d, input %p, limit %d, order %d\n",
+		    state->id,
+		    state->input_portion,
+		    state->env->limit.count,
+		    state->env->limit.order);
+
+	record_size = (unsigned int)state->env->record.capacity *
+					state->env->item.granularity;
+
+	err = mempool_topk_heap_init(&state->topk,
+				     state->env->limit.count,
+				     record_size);
+	if (err) {
+		MEMPOOL_ERR("fail to create TOPK heap: "
+			    "portion %d, err %d\n",
+			    state->id, err);
+		return err;
+	}
+
+	for (i = 0; i < state->count; i++) {
+		key = mempool_get_input_key(state, i);
+
+		record = (unsigned char *)state->input_portion;
+		record += (size_t)i * record_size;
+
+		mempool_topk_heap_offer(&state->topk,
+					state->env->limit.order,
+					key, record, record_size);
+	}
+
+	return 0;
+}
+
+/*
+ * Merge candidates of every thread into global TOPK and write
+ * K records into output in the requested order of keys.
+ */
+static
+int mempool_topk_merge(struct mempool_test_environment *env,
+		       struct mempool_portion_state *pool,
+		       void *output_addr, size_t output_size)
+{
+	struct mempool_topk_heap heap = {0};
+	unsigned int record_size;
+	unsigned char *record;
+	unsigned char *output;
+	int *sorted = NULL;
+	int count;
+	int slot;
+	int i, j;
+	int err;
+
+	record_size = (unsigned int)env->record.capacity *
+					env->item.granularity;
+
+	err = mempool_topk_heap_init(&heap, env->limit.count, record_size);
+	if (err) {
+		MEMPOOL_ERR("fail to create TOPK heap: err %d\n", err);
+		goto finish_topk_merge;
+	}
+
+	for (i = 0; i < env->threads.count; i++) {
+		struct mempool_topk_heap *candidates = &pool[i].topk;
+
+		for (j = 0; j < candidates->count; j++) {
+			slot = candidates->slots[j];
+
+			record = (unsigned char *)candidates->records;
+			record += (size_t)slot * record_size;
+
+			mempool_topk_heap_offer(&heap, env->limit.order,
+						candidates->keys[slot],
+						record, record_size);
+		}
+	}
+
+	count = heap.count;
+
+	if (((size_t)count * record_size) > output_size) {
+		err = -E2BIG;
+		MEMPOOL_ERR("out of space: "
+			    "count %d, record_size %u, output_size %zu\n",
+			    count, record_size, output_size);
+		goto finish_topk_merge;
+	}
+
+	sorted = calloc(count > 0 ? count : 1, sizeof(int));
+	if (!sorted) {
+		err = -ENOMEM;
+		MEMPOOL_ERR("fail to allocate buffer: %s\n",
+			    strerror(errno));
+		goto finish_topk_merge;
+	}
+
+	/* the worst candidate goes out first */
+	while (heap.count > 0) {
+		sorted[heap.count - 1] = heap.slots[0];
+		heap.slots[0] = heap.slots[heap.count - 1];
+		heap.count--;
+		mempool_topk_sift_down(&heap, env->limit.order, 0);
+	}
+
+	for (i = 0; i < count; i++) {
+		record = (unsigned char *)heap.records;
+		record += (size_t)sorted[i] * record_size;
+
+		output = (unsigned char *)output_addr;
+		output += (size_t)i * record_size;
+
+		memcpy(output, record, record_size);
+	}
+
+	MEMPOOL_DBG(env->show_debug,
+		    "TOPK has been merged: count %d\n", count);
+
+finish_topk_merge:
+	if (sorted)
+		free(sorted);
+
+	mempool_topk_heap_destroy(&heap);
+
+	return err;
+}
+
+static
+unsigned int mempool_distinct_record_size(struct mempool_test_environment *env)
+{
+	unsigned int record_size;
+
+	record_size = mempool_items_bytes(env, env->key.mask);
+
+	switch (env->distinct.output) {
+	case MEMPOOL_DISTINCT_FIRST_VALUE_OUTPUT:
+		record_size += mempool_items_bytes(env, env->value.mask);
+		break;
+
+	case MEMPOOL_DISTINCT_COUNT_OUTPUT:
+		record_size += sizeof(unsigned long long);
+		break;
+	}
+
+	return record_size;
+}
+
+static
+int mempool_distinct_compare(const void *item1, const void *item2)
+{
+	const struct mempool_distinct_entry *entry1 = item1;
+	const struct mempool_distinct_entry *entry2 = item2;
+
+	if (entry1->key != entry2->key)
+		return entry1->key < entry2->key ? -1 : 1;
+
+	if (entry1->portion != entry2->portion)
+		return entry1->portion < entry2->portion ? -1 : 1;
+
+	if (entry1->index != entry2->index)
+		return entry1->index < entry2->index ? -1 : 1;
+
+	return 0;
+}
+
+static inline
+unsigned long long mempool_hash_key(unsigned long long key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+
+	return key;
+}
+
+/*
+ * Sort unique entries by key and merge the neighbours with the same key.
+ * The first record (by portion and index) of the key is kept.
+ */
+static
+void mempool_distinct_compact(struct mempool_distinct_set *set)
+{
+	struct mempool_distinct_entry *last = NULL;
+	int count = 0;
+	int i;
+
+	if (set->count == 0)
+		return;
+
+	qsort(set->entries, set->count,
+		sizeof(struct mempool_distinct_entry),
+		mempool_distinct_compare);
+
+	for (i = 0; i < set->count; i++) {
+		struct mempool_distinct_entry *cur = &set->entries[i];
+
+		if (last && last->key == cur->key) {
+			last->count += cur->count;
+			continue;
+		}
+
+		last = &set->entries[count];
+		if (last != cur)
+			memcpy(last, cur, sizeof(struct mempool_distinct_entry));
+		count++;
+	}
+
+	set->count = count;
+}
+
+/*
+ * Hash-based path for low cardinality: it returns -E2BIG if the portion
+ * has more than MEMPOOL_DISTINCT_HASH_THRESHOLD unique keys.
+ */
+static
+int mempool_distinct_hash_path(struct mempool_portion_state *state,
+				struct mempool_distinct_set *set)
+{
+	struct mempool_distinct_entry *entry;
+	unsigned long long key;
+	unsigned long long hash_mask;
+	unsigned long long hash;
+	int *table = NULL;
+	size_t table_size = 16;
+	int capacity;
+	int i;
+	int err = 0;
+
+	capacity = state->count;
+	if (capacity > MEMPOOL_DISTINCT_HASH_THRESHOLD)
+		capacity = MEMPOOL_DISTINCT_HASH_THRESHOLD;
+
+	while (table_size < ((size_t)capacity * 2))
+		table_size <<= 1;
+	hash_mask = table_size - 1;
+
+	set->count = 0;
+	set->entries = calloc(capacity > 0 ? capacity : 1,
+			      sizeof(struct mempool_distinct_entry));
+	table = calloc(table_size, sizeof(int));
+	if (!set->entries || !table) {
+		err = -ENOMEM;
+		MEMPOOL_ERR("fail to allocate hash table: "
+			    "portion %d, %s\n",
+			    state->id, strerror(errno));
+		goto finish_hash_path;
+	}
+
+	for (i = 0; i < state->count; i++) {
+		key = mempool_get_input_key(state, i);
+		hash = mempool_hash_key(key) & hash_mask;
+
+		while (table[hash] != 0) {
+			entry = &set->entries[table[hash] - 1];
+
+			if (entry->key == key)
+				break;
+
+			hash = (hash + 1) & hash_mask;
+		}
+
+		if (table[hash] != 0) {
+			entry->count++;
+			continue;
+		}
+
+		if (set->count >= capacity) {
+			err = -E2BIG;
+			goto finish_hash_path;
+		}
+
+		entry = &set->entries[set->count];
+		entry->key = key;
+		entry->count = 1;
+		entry->portion = state->id;
+		entry->index = i;
+
+		set->count++;
+		table[hash] = set->count;
+	}
+
+	mempool_distinct_compact(set);
+
+finish_hash_path:
+	if (table)
+		free(table);
+
+	if (err && set->entries) {
+		free(set->entries);
+		set->entries = NULL;
+		set->count = 0;
+	}
+
+	return err;
+}
+
+/*
+ * Sort-based path for high cardinality.
+ */
+static
+int mempool_distinct_sort_path(struct mempool_portion_state *state,
+				struct mempool_distinct_set *set)
+{
+	struct mempool_distinct_entry *entry;
+	int count = state->count;
+	int i;
+
+	set->count = 0;
+	set->entries = calloc(count > 0 ? count : 1,
+			      sizeof(struct mempool_distinct_entry));
+	if (!set->entries) {
+		MEMPOOL_ERR("fail to allocate buffer: "
+			    "portion %d, %s\n",
+			    state->id, strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < count; i++) {
+		entry = &set->entries[i];
+
+		entry->key = mempool_get_input_key(state, i);
+		entry->count = 1;
+		entry->portion = state->id;
+		entry->index = i;
+	}
+
+	set->count = count;
+
+	mempool_distinct_compact(set);
+
+	return 0;
+}
+
+static
+int mempool_distinct_local(struct mempool_portion_state *state)
+{
+	int err;
+
+	err = mempool_distinct_hash_path(state, &state->local_set);
+	if (err == -E2BIG) {
+		MEMPOOL_DBG(state->env->show_debug,
+			    "portion %d, high cardinality: "
+			    "switch to sort-based path\n",
+			    state->id);
+
+		err = mempool_distinct_sort_path(state, &state->local_set);
+	}
+
+	MEMPOOL_DBG(state->env->show_debug,
+		    "portion %d, unique keys %d, err %d\n",
+		    state->id, state->local_set.count, err);
+
+	return err;
+}
+
+/*
+ * Choose key ranges of partitions by means of sampling
+ * of unique keys of every portion.
+ */
+static
+int mempool_distinct_choose_splitters(struct mempool_test_environment *env,
+				      struct mempool_portion_state *portions,
+				      struct mempool_distinct_context *ctx)
+{
+	int partitions = env->threads.count;
+	unsigned long long *samples;
+	int samples_count = 0;
+	int i, j;
+
+	samples = calloc((size_t)partitions *
+				MEMPOOL_DISTINCT_SAMPLES_PER_PORTION,
+			 sizeof(unsigned long long));
+	if (!samples) {
+		MEMPOOL_ERR("fail to allocate samples: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < partitions; i++) {
+		struct mempool_distinct_set *set = &portions[i].local_set;
+		int count = set->count;
+
+		if (count > MEMPOOL_DISTINCT_SAMPLES_PER_PORTION)
+			count = MEMPOOL_DISTINCT_SAMPLES_PER_PORTION;
+
+		for (j = 0; j < count; j++) {
+			int index = (int)(((long long)j * set->count) / count);
+
+			samples[samples_count++] = set->entries[index].key;
+		}
+	}
+
+	qsort(samples, samples_count, sizeof(unsigned long long),
+		mempool_key_compare);
+
+	for (i = 0; i < (partitions - 1); i++) {
+		if (samples_count == 0)
+			ctx->splitters[i] = ULLONG_MAX;
+		else {
+			int index = (int)(((long long)(i + 1) *
+						samples_count) / partitions);
+			ctx->splitters[i] = samples[index];
+		}
+	}
+
+	free(samples);
+
+	return 0;
+}
+
+static
+int mempool_distinct_lower_bound(struct mempool_distinct_set *set,
+				 unsigned long long key)
+{
+	int low = 0;
+	int high = set->count;
+	int middle;
+
+	while (low < high) {
+		middle = low + (high - low) / 2;
+
+		if (set->entries[middle].key < key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	return low;
+}
+
+/*
+ * Merge unique keys of the partition from local sets of all portions.
+ */
+static
+int mempool_distinct_partition_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_portion_state *state = arg;
+	struct mempool_distinct_context *ctx = state->distinct;
+	struct mempool_distinct_set *partition = &state->partition_set;
+	int partitions = state->env->threads.count;
+	size_t total = 0;
+	int lower, upper;
+	int i;
+
+	for (i = 0; i < partitions; i++) {
+		struct mempool_distinct_set *set = &state->portions[i].local_set;
+
+		lower = state->id == 0 ? 0 :
+			mempool_distinct_lower_bound(set,
+					ctx->splitters[state->id - 1]);
+		upper = state->id == (partitions - 1) ? set->count :
+			mempool_distinct_lower_bound(set,
+					ctx->splitters[state->id]);
+
+		if (upper > lower)
+			total += upper - lower;
+	}
+
+	partition->count = 0;
+	partition->entries = calloc(total > 0 ? total : 1,
+				    sizeof(struct mempool_distinct_entry));
+	if (!partition->entries) {
+		MEMPOOL_ERR("fail to allocate partition: "
+			    "portion %d, %s\n",
+			    state->id, strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < partitions; i++) {
+		struct mempool_distinct_set *set = &state->portions[i].local_set;
+
+		lower = state->id == 0 ? 0 :
+			mempool_distinct_lower_bound(set,
+					ctx->splitters[state->id - 1]);
+		upper = state->id == (partitions - 1) ? set->count :
+			mempool_distinct_lower_bound(set,
+					ctx->splitters[state->id]);
+
+		if (upper <= lower)
+			continue;
+
+		memcpy(&partition->entries[partition->count],
+			&set->entries[lower],
+			(size_t)(upper - lower) *
+				sizeof(struct mempool_distinct_entry));
+		partition->count += upper - lower;
+	}
+
+	mempool_distinct_compact(partition);
+
+	MEMPOOL_DBG(state->env->show_debug,
+		    "portion %d, partition unique keys %d\n",
+		    state->id, partition->count);
+
+	return 0;
+}
+
+static
+size_t mempool_copy_record_items(struct mempool_test_environment *env,
+				 unsigned long long mask,
+				 const unsigned char *record,
+				 unsigned char *output)
+{
+	size_t written_bytes = 0;
+	int i;
+
+	for (i = 0; i < env->record.capacity; i++) {
+		if (is_bit_set(mask, i, env->record.capacity)) {
+			memcpy(output + written_bytes,
+				record + (size_t)i * env->item.granularity,
+				env->item.granularity);
+			written_bytes += env->item.granularity;
+		}
+	}
+
+	return written_bytes;
+}
+
+static
+int mempool_distinct_write_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_portion_state *state = arg;
+	struct mempool_distinct_context *ctx = state->distinct;
+	struct mempool_distinct_set *partition = &state->partition_set;
+	struct mempool_test_environment *env = state->env;
+	unsigned int record_size;
+	unsigned char *record;
+	unsigned char *output;
+	size_t written_bytes;
+	int i;
+
+	record_size = (unsigned int)env->record.capacity *
+					env->item.granularity;
+
+	if ((ctx->offsets[state->id] +
+	     (size_t)partition->count * ctx->record_size) > ctx->output_size) {
+		MEMPOOL_ERR("out of space: "
+			    "portion %d, offset %zu, count %d, "
+			    "output_size %zu\n",
+			    state->id, ctx->offsets[state->id],
+			    partition->count, ctx->output_size);
+		return -E2BIG;
+	}
+
+	output = (unsigned char *)ctx->output_addr;
+	output += ctx->offsets[state->id];
+
+	for (i = 0; i < partition->count; i++) {
+		struct mempool_distinct_entry *entry = &partition->entries[i];
+
+		record = (unsigned char *)
+			state->portions[entry->portion].input_portion;
+		record += (size_t)entry->index * record_size;
+
+		written_bytes = mempool_copy_record_items(env, env->key.mask,
+							  record, output);
+
+		switch (env->distinct.output) {
+		case MEMPOOL_DISTINCT_FIRST_VALUE_OUTPUT:
+			written_bytes += mempool_copy_record_items(env,
+							env->value.mask,
+							record,
+							output + written_bytes);
+			break;
+
+		case MEMPOOL_DISTINCT_COUNT_OUTPUT:
+			memcpy(output + written_bytes, &entry->count,
+				sizeof(unsigned long long));
+			written_bytes += sizeof(unsigned long long);
+			break;
+		}
+
+		output += written_bytes;
+	}
+
+	return 0;
+}
+
+/*
+ * The first phase of DISTINCT algorithm: duplicates are removed
+ * in the portion (hash-based or sort-based path).
+ */
+static
+int mempool_distinct_algorithm(struct mempool_portion_state *state)
+{
+	int err;
+
+	MEMPOOL_DBG(state->env->show_debug,
+		    "portion %d, input %p, output %#x\n",
+		    state->id,
+		    state->input_portion,
+		    state->env->distinct.output);
+
+	err = mempool_distinct_local(state);
+	if (err) {
+		MEMPOOL_ERR("fail to remove duplicates: "
+			    "portion %d, err %d\n",
+			    state->id, err);
+	}
+
+	return err;
+}
+
+static
+void mempool_distinct_set_destroy(struct mempool_distinct_set *set)
+{
+	if (set->entries)
+		free(set->entries);
+
+	set->entries = NULL;
+	set->count = 0;
+}
+
+/*
+ * Lazy mapping: the kernel reads ahead input of the slice
+ * while the worker processes the beginning of the slice.
+ */
+static
+void mempool_advise_slice(struct mempool_portion_slice *slice)
+{
+	struct mempool_portion_state *state = slice->state;
+	struct mempool_test_environment *env = state->env;
+	unsigned long start;
+	unsigned long end;
+	unsigned int record_size;
+
+	/* encoded portion is scanned by chunks, PAX one by columns */
+	if (!state->input_portion ||
+	    state->input_layout == MEMPOOL_PAX_LAYOUT)
+		return;
+
+	record_size = (unsigned int)env->record.capacity *
+					env->item.granularity;
+
+	start = (unsigned long)state->input_portion +
+				(size_t)slice->start * record_size;
+	end = (unsigned long)state->input_portion +
+				(size_t)slice->end * record_size;
+	start &= ~((unsigned long)MEMPOOL_PAGE_SIZE - 1);
+
+	if (end <= start)
+		return;
+
+	/* DISTINCT reads the first records of keys once again */
+	if (env->algorithm.id != MEMPOOL_DISTINCT_ALGORITHM &&
+	    madvise((void *)start, end - start, MADV_SEQUENTIAL)) {
+		MEMPOOL_DBG(env->show_debug,
+			    "fail to advise sequential access: "
+			    "portion %d, slice %d, %s\n",
+			    state->id, slice->id, strerror(errno));
+	}
+
+	if (madvise((void *)start, end - start, MADV_WILLNEED)) {
+		MEMPOOL_DBG(env->show_debug,
+			    "fail to advise read-ahead: "
+			    "portion %d, slice %d, %s\n",
+			    state->id, slice->id, strerror(errno));
+	}
+}
+
+static
+int mempool_slice_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_portion_slice *slice = (struct mempool_portion_slice *)arg;
+	struct mempool_portion_state *state;
+
+	if (!slice)
+		return -EINVAL;
+
+	state = slice->state;
+	slice->worker = worker;
+
+	MEMPOOL_DBG(state->env->show_debug,
+		    "portion %d, slice %d, worker %d, input %p, output %p, "
+		    "algorithm %#x\n",
+		    state->id,
+		    slice->id,
+		    worker->id,
+		    state->input_portion,
+		    state->output_portion,
+		    state->env->algorithm.id);
+
+	slice->err = 0;
+	slice->crc = 0;
+
+	if (state->env->map.mode == MEMPOOL_MAP_LAZY_MODE)
+		mempool_advise_slice(slice);
+
+	switch (state->env->algorithm.id) {
+	case MEMPOOL_KEY_VALUE_ALGORITHM:
+		slice->err = mempool_key_value_algorithm(slice);
+		if (slice->err) {
+			MEMPOOL_ERR("key-value algorithm failed: "
+				    "portion %d, input %p, output %p, err %d\n",
+				    state->id,
+				    state->input_portion,
+				    state->output_portion,
+				    slice->err);
+		}
+		break;
+
+	case MEMPOOL_SORT_ALGORITHM:
+		slice->err = mempool_sort_algorithm(slice);
+		if (slice->err) {
+			MEMPOOL_ERR("sort algorithm failed: "
+				    "portion %d, input %p, output %p, err %d\n",
+				    state->id,
+				    state->input_portion,
+				    state->output_portion,
+				    slice->err);
+		}
+		break;
+
+	case MEMPOOL_SELECT_ALGORITHM:
+		if (state->input_portion)
+			slice->err = mempool_select_algorithm(slice);
+		else
+			slice->err = mempool_select_encoded(slice);
+		if (slice->err) {
+			MEMPOOL_ERR("select algorithm failed: "
+				    "portion %d, input %p, output %p, err %d\n",
+				    state->id,
+				    state->input_portion,
+				    state->output_portion,
+				    slice->err);
+		}
+		break;
+
+	case MEMPOOL_TOTAL_ALGORITHM:
+		if (state->input_portion)
+			slice->err = mempool_total_algorithm(slice);
+		else
+			slice->err = mempool_total_encoded(slice);
+		if (slice->err) {
+			MEMPOOL_ERR("total algorithm failed: "
+				    "portion %d, input %p, output %p, err %d\n",
+				    state->id,
+				    state->input_portion,
+				    state->output_portion,
+				    slice->err);
+		}
+		break;
+
+	case MEMPOOL_TOPK_ALGORITHM:
+		slice->err = mempool_topk_algorithm(state);
+		if (slice->err) {
+			MEMPOOL_ERR("topk algorithm failed: "
+				    "portion %d, input %p, err %d\n",
+				    state->id,
+				    state->input_portion,
+				    slice->err);
+		}
+		break;
+
+	case MEMPOOL_DISTINCT_ALGORITHM:
+		slice->err = mempool_distinct_algorithm(state);
+		if (slice->err) {
+			MEMPOOL_ERR("distinct algorithm failed: "
+				    "portion %d, input %p, err %d\n",
+				    state->id,
+				    state->input_portion,
+				    slice->err);
+		}
+		break;
+
+	case MEMPOOL_CONVERT_ALGORITHM:
+		slice->err = mempool_convert_algorithm(slice);
+		if (slice->err) {
+			MEMPOOL_ERR("convert algorithm failed: "
+				    "portion %d, input %p, output %p, err %d\n",
+				    state->id,
+				    state->input_portion,
+				    state->output_portion,
+				    slice->err);
+		}
+		break;
+
+	default:
+		slice->err = -EOPNOTSUPP;
+		MEMPOOL_ERR("unknown algorithm %#x: "
+			    "portion %d, input %p, output %p\n",
+			    state->env->algorithm.id,
+			    state->id,
+			    state->input_portion,
+			    state->output_portion);
+		break;
+	}
+
+	MEMPOOL_DBG(state->env->show_debug,
+		    "algorithm %#x has been finished: "
+		    "portion %d, input %p, output %p, err %d\n",
+		    state->env->algorithm.id,
+		    state->id,
+		    state->input_portion,
+		    state->output_portion,
+		    slice->err);
+
+	worker->bytes += (size_t)(slice->end - slice->start) *
+				state->env->record.capacity *
+				state->env->item.granularity;
+
+	return slice->err;
+}
+
+/*
+ * Touch every page of the slice's input, output and run, so that
+ * pages are allocated on the NUMA node of the worker that owns
+ * the slice. Every algorithm overwrites output portion completely,
+ * so zero bytes can be written into output pages.
+ */
+static
+int mempool_prefault_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_portion_slice *slice = arg;
+	struct mempool_portion_state *state = slice->state;
+	struct mempool_test_environment *env = state->env;
+	volatile unsigned char *input;
+	unsigned char *output;
+	unsigned char *run;
+	unsigned int record_size;
+	size_t start_bytes;
+	size_t end_bytes;
+	size_t offset;
+	unsigned char sum = 0;
+
+	record_size = (unsigned int)env->record.capacity *
+					env->item.granularity;
+	start_bytes = (size_t)slice->start * record_size;
+	end_bytes = (size_t)slice->end * record_size;
+
+	if (slice->end == state->count)
+		end_bytes = (size_t)record_size * env->portion.capacity;
+
+	input = (volatile unsigned char *)state->input_portion;
+	output = (unsigned char *)state->output_portion;
+	run = (unsigned char *)state->run;
+
+	for (offset = start_bytes; offset < end_bytes;
+					offset += MEMPOOL_PAGE_SIZE) {
+		if (input)
+			sum += input[offset];
+
+		if (output)
+			output[offset] = 0;
+
+		if (run)
+			run[offset] = 0;
+	}
+
+	MEMPOOL_DBG(env->show_debug,
+		    "portion %d, slice %d, worker %d, node %d, "
+		    "prefaulted bytes %zu, sum %u\n",
+		    state->id, slice->id, worker->id, worker->node,
+		    end_bytes - start_bytes, sum);
+
+	return 0;
+}
+
+/*
+ * Check payload of input portion by checksum of container.
+ */
+static
+int mempool_container_check_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_portion_state *state = arg;
+	struct mempool_container *input = &state->containers->input;
+	int err;
+
+	if (state->pax_portion) {
+		return mempool_container_check_portion(input, state->id,
+						       state->pax_portion);
+	} else if (!state->encoded_portion) {
+		return mempool_container_check_portion(input, state->id,
+						       state->input_portion);
+	}
+
+	err = mempool_container_check_portion(input, state->id,
+					      state->encoded_portion);
+	if (err)
+		return err;
+
+	return mempool_codec_check(state->encoded_portion,
+				   input->portions[state->id].bytes,
+				   input->granularity,
+				   input->record_capacity,
+				   input->portions[state->id].records);
+}
+
+/*
+ * Decode encoded input portion or convert PAX input portion
+ * for algorithms that need records.
+ */
+static
+int mempool_decode_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_portion_state *state = arg;
+	struct mempool_test_environment *env = state->env;
+	int err;
+
+	if (state->pax_portion) {
+		mempool_pax_to_rows(state->pax_portion, state->input_portion,
+				    state->count, env->item.granularity,
+				    env->record.capacity);
+		return 0;
+	}
+
+	err = mempool_codec_decode(state->encoded_portion,
+				   state->input_portion,
+				   state->env->threads.portion_size);
+	if (err) {
+		MEMPOOL_ERR("fail to decode portion: "
+			    "portion %d, err %d\n",
+			    state->id, err);
+	}
+
+	return err;
+}
+
+/*
+ * Number of records and valid bytes of output portion.
+ */
+static
+int mempool_output_extent(struct mempool_portion_state *state,
+			  unsigned int *records, unsigned long long *bytes)
+{
+	struct mempool_test_environment *env = state->env;
+	unsigned int record_size;
+	int i;
+
+	record_size = (unsigned int)env->record.capacity *
+					env->item.granularity;
+
+	*records = 0;
+	*bytes = 0;
+
+	switch (env->algorithm.id) {
+	case MEMPOOL_KEY_VALUE_ALGORITHM:
+	case MEMPOOL_SELECT_ALGORITHM:
+		for (i = 0; i < state->slices_count; i++)
+			*bytes += state->slices[i].written_bytes;
+		*records = *bytes / mempool_key_value_bytes(env);
+		break;
+
+	case MEMPOOL_TOTAL_ALGORITHM:
+		/* sums of value items */
+		*records = 1;
+		*bytes = env->record.capacity * sizeof(unsigned long long);
+		break;
+
+	case MEMPOOL_SORT_ALGORITHM:
+	case MEMPOOL_CONVERT_ALGORITHM:
+		*records = state->count;
+		*bytes = (unsigned long long)*records * record_size;
+		break;
+
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	return 0;
+}
+
+/*
+ * Describe output portion in directory of output container.
+ */
+static
+int mempool_container_output_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_portion_state *state = arg;
+	struct mempool_container_portion *portion;
+	unsigned long long bytes;
+	unsigned int records;
+	int err;
+
+	portion = &state->containers->output.portions[state->id];
+
+	err = mempool_output_extent(state, &records, &bytes);
+	if (err)
+		return err;
+
+	portion->records = records;
+	portion->bytes = bytes;
+	portion->crc = mempool_container_crc(state->output_portion, bytes);
+
+	return 0;
+}
+
+/*
+ * Join CRCs of parts of SORT output portion. Every bucket has
+ * checksummed its intersection with the portion while merging.
+ */
+static
+uint32_t mempool_sort_portion_checksum(struct mempool_portion_state *state,
+				       unsigned int record_size)
+{
+	struct mempool_sort_context *ctx = state->sort;
+	struct mempool_portion_state *last;
+	size_t records;
+	size_t first;
+	size_t end;
+	uint32_t crc = 0;
+	int i;
+
+	last = &ctx->portions[state->env->threads.count - 1];
+	records = last->first + last->count;
+
+	for (i = 0; i < ctx->buckets; i++) {
+		first = ctx->offsets[i];
+		end = (i + 1) < ctx->buckets ? ctx->offsets[i + 1] : records;
+
+		if (first < state->first)
+			first = state->first;
+		if (end > state->first + state->count)
+			end = state->first + state->count;
+		if (first >= end)
+			continue;
+
+		crc = crc32c_combine(crc, ctx->checksums[i + state->id],
+				     (end - first) * record_size);
+	}
+
+	return crc;
+}
+
+/*
+ * Join CRCs that have been calculated while the output portion
+ * was written. Clean tail of raw portion is appended by
+ * crc32c_combine() without reading of the tail.
+ */
+static
+int mempool_checksum_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_portion_state *state = arg;
+	struct mempool_test_environment *env = state->env;
+	struct mempool_checksum_entry *entry;
+	size_t portion_bytes = state->manifest->portion_size;
+	unsigned int record_size;
+	size_t written = 0;
+	uint32_t crc = 0;
+	int i;
+	int err;
+
+	entry = &state->manifest->portions[state->id];
+
+	err = mempool_output_extent(state, &entry->records, &entry->bytes);
+	if (err)
+		return err;
+
+	record_size = (unsigned int)env->record.capacity *
+					env->item.granularity;
+
+	switch (env->algorithm.id) {
+	case MEMPOOL_KEY_VALUE_ALGORITHM:
+	case MEMPOOL_SELECT_ALGORITHM:
+		for (i = 0; i < state->slices_count; i++) {
+			crc = crc32c_combine(crc, state->slices[i].crc,
+					     state->slices[i].written_bytes);
+			written += state->slices[i].written_bytes;
+		}
+		break;
+
+	case MEMPOOL_TOTAL_ALGORITHM:
+		/* sums have been written by the join right now */
+		crc = crc32c(0, state->output_portion, entry->bytes);
+		written = entry->bytes;
+		break;
+
+	case MEMPOOL_SORT_ALGORITHM:
+		if (state->sort->checksums)
+			crc = mempool_sort_portion_checksum(state, record_size);
+
+		/* records beyond count are checksummed by the last slice */
+		written = (size_t)state->count * record_size;
+		crc = crc32c_combine(crc,
+				state->slices[state->slices_count - 1].crc,
+				portion_bytes - written);
+		written = portion_bytes;
+		break;
+
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	crc = crc32c_combine(crc, 0, portion_bytes - written);
+
+	/* crc32c of the same bytes from ~0 register with final inversion */
+	entry->crc = crc ^ crc32c_combine(~0U, 0, portion_bytes) ^ ~0U;
+
+	return 0;
+}
+
+/*
+ * Submit @func for every element of @args array and wait the end
+ * of execution. Every worker receives contiguous block of elements.
+ * Elements are pushed in reverse order, so the owner processes
+ * the block in ascending order and thieves steal from the end
+ * of the block.
+ */
+static
+int __mempool_process_tasks(struct mempool_scheduler *sched,
+			    void *args, size_t arg_size,
+			    int count, mempool_task_func func,
+			    int pinned)
+{
+	void *arg;
+	int worker_id;
+	int i;
+	int err;
+
+	for (i = count - 1; i >= 0; i--) {
+		worker_id = (int)(((long long)i * sched->count) / count);
+		arg = (unsigned char *)args + i * arg_size;
+
+		if (pinned) {
+			err = mempool_scheduler_submit_pinned(sched, worker_id,
+							      func, arg);
+		} else {
+			err = mempool_scheduler_submit(sched, worker_id,
+							func, arg);
+		}
+
+		if (err) {
+			MEMPOOL_ERR("fail to submit task %d: err %d\n",
+				    i, err);
+			mempool_scheduler_wait(sched);
+			return err;
+		}
+	}
+
+	return mempool_scheduler_wait(sched);
+}
+
+static inline
+int mempool_process_tasks(struct mempool_scheduler *sched,
+			  void *args, size_t arg_size,
+			  int count, mempool_task_func func)
+{
+	return __mempool_process_tasks(sched, args, arg_size, count, func,
+					MEMPOOL_FALSE);
+}
+
+/*
+ * Every task is executed by the worker that owns the element
+ * of @args array, i.e. it cannot be stolen.
+ */
+static inline
+int mempool_process_pinned_tasks(struct mempool_scheduler *sched,
+				 void *args, size_t arg_size,
+				 int count, mempool_task_func func)
+{
+	return __mempool_process_tasks(sched, args, arg_size, count, func,
+					MEMPOOL_TRUE);
+}
+
+/*
+ * The second and third phases of SORT algorithm: bucket's ranges
+ * are found in every sorted run and buckets are merged into output.
+ */
+static
+int mempool_sort_portions(struct mempool_scheduler *sched,
+			  struct mempool_sort_context *ctx)
+{
+	struct mempool_test_environment *env = ctx->env;
+	struct mempool_sort_bucket *buckets = NULL;
+	int portions = env->threads.count;
+	size_t records;
+	size_t offset = 0;
+	int *bounds;
+	int i, j;
+	int err;
+
+	records = 0;
+	for (i = 0; i < portions; i++) {
+		ctx->portions[i].first = records;
+		records += ctx->portions[i].count;
+	}
+
+	if (records == 0)
+		return 0;
+
+	ctx->buckets = sched->count * MEMPOOL_SORT_BUCKETS_PER_WORKER;
+	if ((size_t)ctx->buckets > records)
+		ctx->buckets = (int)records;
+
+	ctx->splitters = calloc(ctx->buckets, sizeof(unsigned long long));
+	ctx->bounds = calloc((size_t)ctx->slices_count * (ctx->buckets + 1),
+			     sizeof(int));
+	ctx->offsets = calloc(ctx->buckets, sizeof(size_t));
+	buckets = calloc(ctx->buckets, sizeof(struct mempool_sort_bucket));
+	if (ctx->portions[0].manifest) {
+		ctx->checksums = calloc((size_t)ctx->buckets + portions,
+					sizeof(uint32_t));
+	}
+	if (!ctx->splitters || !ctx->bounds || !ctx->offsets || !buckets ||
+	    (ctx->portions[0].manifest && !ctx->checksums)) {
+		err = -ENOMEM;
+		MEMPOOL_ERR("fail to allocate sort context: %s\n",
+			    strerror(errno));
+		goto finish_sort_portions;
+	}
+
+	err = mempool_sort_choose_splitters(ctx);
+	if (err) {
+		MEMPOOL_ERR("fail to choose splitters: err %d\n", err);
+		goto finish_sort_portions;
+	}
+
+	err = mempool_process_tasks(sched, ctx->slices,
+				    sizeof(struct mempool_portion_slice),
+				    ctx->slices_count,
+				    mempool_sort_bounds_task);
+	if (err) {
+		MEMPOOL_ERR("fail to find buckets' bounds: err %d\n", err);
+		goto finish_sort_portions;
+	}
+
+	for (i = 0; i < ctx->buckets; i++) {
+		ctx->offsets[i] = offset;
+
+		for (j = 0; j < ctx->slices_count; j++) {
+			bounds = ctx->bounds + (size_t)j * (ctx->buckets + 1);
+			offset += bounds[i + 1] - bounds[i];
+		}
+	}
+
+	for (i = 0; i < ctx->buckets; i++) {
+		buckets[i].id = i;
+		buckets[i].ctx = ctx;
+	}
+
+	err = mempool_process_tasks(sched, buckets,
+				    sizeof(struct mempool_sort_bucket),
+				    ctx->buckets,
+				    mempool_sort_merge_bucket_task);
+	if (err) {
+		MEMPOOL_ERR("fail to merge buckets: err %d\n", err);
+		goto finish_sort_portions;
+	}
+
+	MEMPOOL_DBG(env->show_debug,
+		    "SORT has been finished: buckets %d, records %zu\n",
+		    ctx->buckets, offset);
+
+finish_sort_portions:
+	if (buckets)
+		free(buckets);
+
+	return err;
+}
+
+/*
+ * The second and third phases of DISTINCT algorithm: unique keys are
+ * merged by partitions and partitions are written into output.
+ */
+static
+int mempool_distinct_portions(struct mempool_scheduler *sched,
+			      struct mempool_test_environment *env,
+			      struct mempool_portion_state *portions,
+			      struct mempool_distinct_context *ctx)
+{
+	int partitions = env->threads.count;
+	size_t offset = 0;
+	int i;
+	int err;
+
+	err = mempool_distinct_choose_splitters(env, portions, ctx);
+	if (err) {
+		MEMPOOL_ERR("fail to choose splitters: err %d\n", err);
+		return err;
+	}
+
+	err = mempool_process_tasks(sched, portions,
+				    sizeof(struct mempool_portion_state),
+				    partitions,
+				    mempool_distinct_partition_task);
+	if (err) {
+		MEMPOOL_ERR("fail to merge partitions: err %d\n", err);
+		return err;
+	}
+
+	for (i = 0; i < partitions; i++) {
+		ctx->offsets[i] = offset;
+		offset += (size_t)portions[i].partition_set.count *
+							ctx->record_size;
+	}
+
+	ctx->result_size = offset;
+
+	err = mempool_process_tasks(sched, portions,
+				    sizeof(struct mempool_portion_state),
+				    partitions,
+				    mempool_distinct_write_task);
+	if (err) {
+		MEMPOOL_ERR("fail to write partitions: err %d\n", err);
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * Report elapsed time and page faults of the phase.
+ * It returns elapsed time in seconds.
+ */
+static
+double mempool_report_usage(const char *phase,
+			    struct timespec *start_time,
+			    struct timespec *finish_time,
+			    struct rusage *start_usage,
+			    struct rusage *finish_usage)
+{
+	double seconds;
+
+	seconds = (double)(finish_time->tv_sec - start_time->tv_sec) +
+		(double)(finish_time->tv_nsec - start_time->tv_nsec) /
+								1000000000;
+
+	MEMPOOL_INFO("%s time %.3f sec, page faults: minor %ld, major %ld\n",
+		     phase, seconds,
+		     finish_usage->ru_minflt - start_usage->ru_minflt,
+		     finish_usage->ru_majflt - start_usage->ru_majflt);
+
+	return seconds;
+}
+
+/*
+ * Portion is split into record-aligned slices if there are
+ * not enough portions to load all workers.
+ */
+static
+int mempool_slices_per_portion(struct mempool_test_environment *env,
+				int portions)
+{
+	long long slices;
+	long long max_slices;
+
+	switch (env->algorithm.id) {
+	case MEMPOOL_KEY_VALUE_ALGORITHM:
+	case MEMPOOL_SORT_ALGORITHM:
+	case MEMPOOL_SELECT_ALGORITHM:
+	case MEMPOOL_TOTAL_ALGORITHM:
+	case MEMPOOL_CONVERT_ALGORITHM:
+		/* can be split */
+		break;
+
+	default:
+		return 1;
+	}
+
+	slices = (long long)env->workers.count * MEMPOOL_SLICES_PER_WORKER;
+	slices = (slices + portions - 1) / portions;
+
+	max_slices = env->portion.count / MEMPOOL_SLICE_MIN_RECORDS;
+	if (slices > max_slices)
+		slices = max_slices;
+
+	return slices > 1 ? (int)slices : 1;
+}
+
+/*
+ * Split records of the portion between its slices.
+ */
+static
+void mempool_split_portion(struct mempool_portion_state *state)
+{
+	struct mempool_portion_slice *slice;
+	int i;
+
+	for (i = 0; i < state->slices_count; i++) {
+		slice = &state->slices[i];
+
+		slice->start = (int)(((long long)i * state->count) /
+						state->slices_count);
+		slice->end = (int)(((long long)(i + 1) * state->count) /
+						state->slices_count);
+	}
+}
+
+static inline
+int mempool_portion_records(struct mempool_test_environment *env,
+			    struct mempool_container_context *containers,
+			    int id)
+{
+	if (containers->input.portions)
+		return containers->input.portions[id].records;
+
+	return env->portion.count;
+}
+
+/*
+ * SELECT and TOTAL scan encoded portions by chunks. Other
+ * algorithms process decoded copies of portions.
+ */
+static inline
+int mempool_scans_encoded(struct mempool_test_environment *env)
+{
+	return env->algorithm.id == MEMPOOL_SELECT_ALGORITHM ||
+		env->algorithm.id == MEMPOOL_TOTAL_ALGORITHM;
+}
+
+/*
+ * KEY-VALUE, SELECT, TOTAL and CONVERT read items of records
+ * by masks, so they process PAX portions in place. Other
+ * algorithms move whole records and process rows.
+ */
+static inline
+int mempool_reads_columns(struct mempool_test_environment *env)
+{
+	return env->algorithm.id == MEMPOOL_KEY_VALUE_ALGORITHM ||
+		env->algorithm.id == MEMPOOL_SELECT_ALGORITHM ||
+		env->algorithm.id == MEMPOOL_TOTAL_ALGORITHM ||
+		env->algorithm.id == MEMPOOL_CONVERT_ALGORITHM;
+}
+
+static inline
+int mempool_needs_rows(struct mempool_test_environment *env)
+{
+	if (env->encoding.input != MEMPOOL_PLAIN_ENCODING)
+		return !mempool_scans_encoded(env);
+
+	if (env->layout.input == MEMPOOL_PAX_LAYOUT)
+		return !mempool_reads_columns(env);
+
+	return MEMPOOL_FALSE;
+}
+
+static inline
+size_t mempool_portion_offset(struct mempool_test_environment *env,
+			      struct mempool_container *container,
+			      int id)
+{
+	if (container->portions)
+		return container->portions[id].offset;
+
+	return (size_t)id * env->threads.portion_size;
+}
+
+/*
+ * Read container of input file. It returns -ENOMSG for raw file.
+ */
+static
+int mempool_read_input_container(struct mempool_test_environment *env,
+				 struct mempool_container *container)
+{
+	int fd;
+	int err;
+
+	if (!env->input_file.name)
+		return -ENOMSG;
+
+	/* error is reported by opening of files */
+	fd = open(env->input_file.name, O_RDONLY);
+	if (fd == -1)
+		return -ENOMSG;
+
+	err = mempool_container_read(fd, container);
+	if (err && err != -ENOMSG) {
+		MEMPOOL_ERR("fail to read container: %s, err %d\n",
+			    env->input_file.name, err);
+	}
+
+	close(fd);
+
+	return err;
+}
+
+static inline
+unsigned long long mempool_items_mask(int items)
+{
+	if (items >= (int)(sizeof(unsigned long long) * MEMPOOL_BITS_PER_BYTE))
+		return ULLONG_MAX;
+
+	return (1ULL << items) - 1;
+}
+
+/*
+ * Every algorithm defines geometry of its output: KEY-VALUE and
+ * SELECT place key items before value items, TOTAL writes one record
+ * of sums, TOPK and DISTINCT write one portion of results.
+ */
+static
+int mempool_prepare_output_container(struct mempool_test_environment *env,
+				struct mempool_container_context *containers,
+				off_t records_count)
+{
+	struct mempool_container *output = &containers->output;
+	int granularity = env->item.granularity;
+	int record_capacity = env->record.capacity;
+	long long portion_capacity = env->portion.capacity;
+	int portions_count = env->threads.count;
+	unsigned long long key_mask = env->key.mask;
+	unsigned long long value_mask = env->value.mask;
+	int sort_order = MEMPOOL_UNKNOWN_ORDER;
+	int key_items;
+	int value_items;
+	size_t stride = 0;
+	int err;
+
+	key_items = mempool_items_bytes(env, env->key.mask) / granularity;
+	value_items = mempool_items_bytes(env, env->value.mask) / granularity;
+
+	switch (env->algorithm.id) {
+	case MEMPOOL_KEY_VALUE_ALGORITHM:
+	case MEMPOOL_SELECT_ALGORITHM:
+		record_capacity = key_items + value_items;
+		key_mask = mempool_items_mask(key_items) << value_items;
+		value_mask = mempool_items_mask(value_items);
+		break;
+
+	case MEMPOOL_TOTAL_ALGORITHM:
+		granularity = sizeof(unsigned long long);
+		portion_capacity = 1;
+		key_mask = 0;
+		break;
+
+	case MEMPOOL_SORT_ALGORITHM:
+		sort_order = MEMPOOL_ASCENDING_ORDER;
+		break;
+
+	case MEMPOOL_CONVERT_ALGORITHM:
+		/* order of records is kept */
+		sort_order = containers->input.sort_order;
+		break;
+
+	case MEMPOOL_TOPK_ALGORITHM:
+		portions_count = 1;
+		portion_capacity = records_count;
+		sort_order = env->limit.order;
+		break;
+
+	case MEMPOOL_DISTINCT_ALGORITHM:
+		portions_count = 1;
+		portion_capacity = records_count;
+		sort_order = MEMPOOL_ASCENDING_ORDER;
+
+		switch (env->distinct.output) {
+		case MEMPOOL_DISTINCT_KEY_OUTPUT:
+			record_capacity = key_items;
+			key_mask = mempool_items_mask(key_items);
+			value_mask = 0;
+			break;
+
+		case MEMPOOL_DISTINCT_FIRST_VALUE_OUTPUT:
+			record_capacity = key_items + value_items;
+			key_mask = mempool_items_mask(key_items) << value_items;
+			value_mask = mempool_items_mask(value_items);
+			break;
+
+		case MEMPOOL_DISTINCT_COUNT_OUTPUT:
+			/* counter is described by items of value */
+			if (sizeof(unsigned long long) % granularity) {
+				MEMPOOL_ERR("counter cannot be described "
+					    "by items: granularity %d\n",
+					    granularity);
+				return -EOPNOTSUPP;
+			}
+
+			value_items = sizeof(unsigned long long) / granularity;
+			record_capacity = key_items + value_items;
+			key_mask = mempool_items_mask(key_items) << value_items;
+			value_mask = mempool_items_mask(value_items);
+			break;
+		}
+		break;
+	}
+
+	if (record_capacity <= 0 || portion_capacity <= 0 ||
+	    portion_capacity > INT_MAX) {
+		MEMPOOL_ERR("output cannot be described by container: "
+			    "record_capacity %d, portion_capacity %lld\n",
+			    record_capacity, portion_capacity);
+		return -EINVAL;
+	}
+
+	if (portions_count == 1) {
+		stride = mempool_container_align((unsigned long long)granularity *
+						 record_capacity *
+						 portion_capacity);
+	} else if (containers->input.portions && containers->input.stride) {
+		/* output portion is written over input portion's place */
+		stride = containers->input.stride;
+	} else {
+		stride = mempool_container_align(env->threads.portion_size);
+	}
+
+	if (env->encoding.output != MEMPOOL_PLAIN_ENCODING &&
+	    granularity > MEMPOOL_CODEC_MAX_GRANULARITY) {
+		MEMPOOL_ERR("encoding is unsupported: granularity %d\n",
+			    granularity);
+		return -EOPNOTSUPP;
+	}
+
+	err = mempool_container_create(output, portions_count, stride);
+	if (err)
+		return err;
+
+	output->granularity = granularity;
+	output->record_capacity = record_capacity;
+	output->portion_capacity = (int)portion_capacity;
+	output->key_mask = key_mask;
+	output->value_mask = value_mask;
+	output->sort_order = sort_order;
+	output->algorithm = env->algorithm.id;
+	output->encoding = env->encoding.output;
+	output->layout = env->layout.output;
+
+	return 0;
+}
+
+static
+int mempool_encode_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_encode_request *req = arg;
+	struct mempool_container *container = req->container;
+	int err;
+
+	err = mempool_codec_encode(req->payload,
+				   container->portions[req->id].records,
+				   container->granularity,
+				   container->record_capacity,
+				   req->env->encoding.output,
+				   &req->block, &req->bytes);
+	if (err) {
+		MEMPOOL_ERR("fail to encode portion: "
+			    "portion %d, err %d\n",
+			    req->id, err);
+	}
+
+	return err;
+}
+
+/*
+ * Encode output portions and pack them one after another from
+ * the first payload. The rest of file is truncated at the end.
+ */
+static
+int mempool_encode_output_container(struct mempool_scheduler *sched,
+				    struct mempool_test_environment *env,
+				    struct mempool_container *output,
+				    void *output_addr)
+{
+	struct mempool_encode_request *requests;
+	struct mempool_container_portion *portion;
+	unsigned long long plain_bytes = 0;
+	unsigned long long offset;
+	ssize_t written;
+	int i;
+	int err;
+
+	requests = calloc(output->portions_count,
+			  sizeof(struct mempool_encode_request));
+	if (!requests) {
+		MEMPOOL_ERR("fail to allocate requests: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < output->portions_count; i++) {
+		requests[i].id = i;
+		requests[i].env = env;
+		requests[i].container = output;
+		requests[i].payload = (char *)output_addr +
+						output->portions[i].offset;
+	}
+
+	err = mempool_process_tasks(sched, requests,
+				    sizeof(struct mempool_encode_request),
+				    output->portions_count,
+				    mempool_encode_task);
+	if (err)
+		goto free_requests;
+
+	offset = output->payload_offset;
+
+	for (i = 0; i < output->portions_count; i++) {
+		portion = &output->portions[i];
+
+		written = pwrite(env->output_file.fd, requests[i].block,
+				 requests[i].bytes, offset);
+		if (written != (ssize_t)requests[i].bytes) {
+			err = written < 0 ? -errno : -EIO;
+			MEMPOOL_ERR("fail to write encoded portion: "
+				    "portion %d, err %d\n", i, err);
+			goto free_requests;
+		}
+
+		plain_bytes += portion->bytes;
+
+		portion->offset = offset;
+		portion->bytes = requests[i].bytes;
+		portion->crc = mempool_container_crc(requests[i].block,
+						     requests[i].bytes);
+
+		offset += (requests[i].bytes + MEMPOOL_CODEC_ALIGNMENT - 1) &
+				~((unsigned long long)MEMPOOL_CODEC_ALIGNMENT - 1);
+	}
+
+	output->stride = 0;
+
+	MEMPOOL_INFO("Encoded output: plain bytes %llu, encoded bytes %llu\n",
+		     plain_bytes, offset - output->payload_offset);
+
+free_requests:
+	for (i = 0; i < output->portions_count; i++) {
+		if (requests[i].block)
+			free(requests[i].block);
+	}
+
+	free(requests);
+
+	return err;
+}
+
+/*
+ * Describe results in directory and write header of output container.
+ * Portions of streaming mode have been described by chunks already.
+ */
+static
+int mempool_write_output_container(struct mempool_scheduler *sched,
+				struct mempool_test_environment *env,
+				struct mempool_portion_state *portions,
+				struct mempool_container_context *containers,
+				void *output_addr, size_t result_bytes,
+				int described)
+{
+	struct mempool_container *output = &containers->output;
+	struct mempool_container_portion *portion = &output->portions[0];
+	void *result = (char *)output_addr + portion->offset;
+	unsigned int record_size;
+	int err;
+
+	switch (env->algorithm.id) {
+	case MEMPOOL_TOPK_ALGORITHM:
+	case MEMPOOL_DISTINCT_ALGORITHM:
+		record_size = (unsigned int)output->granularity *
+						output->record_capacity;
+
+		portion->records = result_bytes / record_size;
+		portion->bytes = result_bytes;
+		portion->crc = mempool_container_crc(result, result_bytes);
+
+		if (env->algorithm.id == MEMPOOL_DISTINCT_ALGORITHM) {
+			/* output keeps unique records only */
+			output->portion_capacity = portion->records > 0 ?
+							portion->records : 1;
+			output->stride = mempool_container_align(
+				(unsigned long long)record_size *
+						output->portion_capacity);
+		}
+		break;
+
+	default:
+		if (described)
+			break;
+
+		err = mempool_process_tasks(sched, portions,
+					sizeof(struct mempool_portion_state),
+					env->threads.count,
+					mempool_container_output_task);
+		if (err) {
+			MEMPOOL_ERR("fail to describe portions: err %d\n",
+				    err);
+			return err;
+		}
+		break;
+	}
+
+	if (output->encoding != MEMPOOL_PLAIN_ENCODING) {
+		MEMPOOL_INFO("Encode output portions...\n");
+
+		err = mempool_encode_output_container(sched, env, output,
+						      output_addr);
+		if (err)
+			return err;
+	}
+
+	return mempool_container_write(env->output_file.fd, output);
+}
+
+/*
+ * Write manifest of output checksums next to output file:
+ *
+ * file_size <bytes>
+ * file_crc32c <crc>
+ * portion_size <bytes>
+ * portions <count>
+ * portion <index> offset <offset> records <count> bytes <bytes> crc32c <crc>
+ *
+ * CRC of the whole file is combined from CRCs of portions.
+ */
+static
+int mempool_write_manifest(struct mempool_test_environment *env,
+			   struct mempool_checksum_manifest *manifest)
+{
+	struct mempool_checksum_entry *entry;
+	unsigned long long file_size;
+	FILE *stream;
+	char *name;
+	uint32_t crc = 0;
+	int i;
+	int err = 0;
+
+	name = malloc(strlen(env->output_file.name) +
+			sizeof(MEMPOOL_CHECKSUM_MANIFEST_SUFFIX));
+	if (!name) {
+		MEMPOOL_ERR("fail to allocate manifest name: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	sprintf(name, "%s%s", env->output_file.name,
+		MEMPOOL_CHECKSUM_MANIFEST_SUFFIX);
+
+	file_size = (unsigned long long)manifest->count *
+					manifest->portion_size;
+
+	for (i = 0; i < manifest->count; i++) {
+		crc = crc32c_combine(crc, manifest->portions[i].crc,
+				     manifest->portion_size);
+	}
+
+	stream = fopen(name, "w");
+	if (!stream) {
+		err = -errno;
+		MEMPOOL_ERR("fail to create manifest %s: %s\n",
+			    name, strerror(errno));
+		goto free_name;
+	}
+
+	MEMPOOL_FILE_INFO(stream, "file_size %llu\n", file_size);
+	MEMPOOL_FILE_INFO(stream, "file_crc32c %#010x\n", crc);
+	MEMPOOL_FILE_INFO(stream, "portion_size %zu\n",
+			  manifest->portion_size);
+	MEMPOOL_FILE_INFO(stream, "portions %d\n", manifest->count);
+
+	for (i = 0; i < manifest->count; i++) {
+		entry = &manifest->portions[i];
+
+		MEMPOOL_FILE_INFO(stream,
+				  "portion %d offset %llu records %u "
+				  "bytes %llu crc32c %#010x\n",
+				  i,
+				  (unsigned long long)i *
+						manifest->portion_size,
+				  entry->records, entry->bytes, entry->crc);
+	}
+
+	if (fclose(stream)) {
+		err = -errno;
+		MEMPOOL_ERR("fail to write manifest %s: %s\n",
+			    name, strerror(errno));
+		goto free_name;
+	}
+
+	MEMPOOL_INFO("Output crc32c: %#x, manifest %s\n", crc, name);
+
+free_name:
+	free(name);
+
+	return err;
+}
+
+/*
+ * Streaming mode processes portions by chunks: workers process
+ * chunk N while the reader loads chunk N+1 and the writer stores
+ * chunk N-1. States of portions and slices are reused by chunks.
+ */
+static
+int mempool_stream_portions(struct mempool_scheduler *sched,
+			    struct mempool_stream *stream,
+			    struct mempool_portion_state *portions,
+			    int slices_per_portion)
+{
+	struct mempool_test_environment *env = stream->env;
+	struct mempool_stream_buffer *buf;
+	struct mempool_portion_state *cur;
+	size_t offset;
+	int chunk;
+	int i;
+	int err;
+
+	for (chunk = 0; chunk < stream->chunks_count; chunk++) {
+		buf = mempool_stream_get(stream, chunk);
+		if (!buf) {
+			MEMPOOL_ERR("fail to load chunk %d\n", chunk);
+			return -EIO;
+		}
+
+		for (i = 0; i < buf->portions; i++) {
+			cur = &portions[i];
+			offset = (size_t)i * stream->stride;
+
+			cur->id = buf->first + i;
+			cur->count = mempool_portion_records(env,
+							     cur->containers,
+							     cur->id);
+			cur->input_portion = (char *)buf->input + offset;
+			cur->input_layout = env->layout.input;
+			cur->output_portion = (char *)buf->output + offset;
+
+			mempool_split_portion(cur);
+		}
+
+		if (portions[0].containers->input.portions) {
+			err = mempool_process_tasks(sched, portions,
+					sizeof(struct mempool_portion_state),
+					buf->portions,
+					mempool_container_check_task);
+			if (err) {
+				MEMPOOL_ERR("fail to check chunk: "
+					    "chunk %d, err %d\n",
+					    chunk, err);
+				return err;
+			}
+		}
+
+		/* slices of portions are contiguous */
+		err = mempool_process_tasks(sched, portions[0].slices,
+					sizeof(struct mempool_portion_slice),
+					buf->portions * slices_per_portion,
+					mempool_slice_task);
+		if (err) {
+			MEMPOOL_ERR("fail to process chunk: "
+				    "chunk %d, err %d\n",
+				    chunk, err);
+			return err;
+		}
+
+		if (env->algorithm.id == MEMPOOL_SELECT_ALGORITHM) {
+			err = mempool_process_tasks(sched, portions,
+					sizeof(struct mempool_portion_state),
+					buf->portions,
+					mempool_select_join_task);
+		} else if (env->algorithm.id == MEMPOOL_TOTAL_ALGORITHM) {
+			err = mempool_process_tasks(sched, portions,
+					sizeof(struct mempool_portion_state),
+					buf->portions,
+					mempool_total_join_task);
+		}
+
+		if (err) {
+			MEMPOOL_ERR("fail to join slices: "
+				    "chunk %d, err %d\n",
+				    chunk, err);
+			return err;
+		}
+
+		if (portions[0].manifest) {
+			err = mempool_process_tasks(sched, portions,
+					sizeof(struct mempool_portion_state),
+					buf->portions,
+					mempool_checksum_task);
+			if (err) {
+				MEMPOOL_ERR("fail to checksum chunk: "
+					    "chunk %d, err %d\n",
+					    chunk, err);
+				return err;
+			}
+		}
+
+		if (portions[0].containers->output.portions) {
+			err = mempool_process_tasks(sched, portions,
+					sizeof(struct mempool_portion_state),
+					buf->portions,
+					mempool_container_output_task);
+			if (err) {
+				MEMPOOL_ERR("fail to describe chunk: "
+					    "chunk %d, err %d\n",
+					    chunk, err);
+				return err;
+			}
+		}
+
+		mempool_stream_put(stream, buf);
+	}
+
+	return mempool_stream_flush(stream);
+}
+
+int main(int argc, char *argv[])
+{
+	struct mempool_test_environment environment;
+	struct mempool_scheduler scheduler = {0};
+	struct mempool_distinct_context distinct = {0};
+	struct mempool_sort_context sort = {0};
+	struct mempool_portion_state *portions = NULL;
+	struct mempool_portion_state *cur;
+	struct mempool_portion_slice *slices = NULL;
+	struct mempool_portion_slice *slice;
+	struct mempool_numa_topology numa;
+	struct mempool_stream stream = {0};
+	struct mempool_container_context containers;
+	struct mempool_checksum_manifest manifest = {0};
+	struct stat input_stat;
+	struct timespec start_time, finish_time;
+	struct rusage start_usage, finish_usage;
+	double seconds;
+	int map_flags = MAP_SHARED;
+	void *input_addr = NULL;
+	void *output_addr = NULL;
+	void *decoded = NULL;
+	size_t decoded_size = 0;
+	off_t file_size;
+	off_t output_size;
+	off_t output_bytes;
+	off_t output_offset = 0;
+	off_t records_count = 0;
+	size_t stride;
+	long long portion_size;
+	int portions_failed = MEMPOOL_FALSE;
+	int streaming = MEMPOOL_FALSE;
+	int portions_count;
+	int slices_per_portion;
+	int slices_count;
+	long cpus;
+	int i, j;
+	int err = 0;
+
+	environment.input_file.fd = -1;
+	environment.input_file.stream = NULL;
+	environment.input_file.name = NULL;
+	environment.output_file.fd = -1;
+	environment.output_file.stream = NULL;
+	environment.output_file.name = NULL;
+	environment.threads.count = 0;
+	environment.threads.portion_size = 0;
+	environment.workers.count = 0;
+	environment.item.granularity = 1;
+	environment.record.capacity = 1;
+	environment.portion.capacity = 0;
+	environment.portion.count = 0;
+	environment.key.mask = 0;
+	environment.value.mask = 0;
+	environment.condition.min = 0;
+	environment.condition.max = ULLONG_MAX;
+	environment.limit.count = 0;
+	environment.limit.order = MEMPOOL_ASCENDING_ORDER;
+	environment.distinct.output = MEMPOOL_DISTINCT_KEY_OUTPUT;
+	environment.numa.mode = MEMPOOL_NUMA_NONE_MODE;
+	environment.map.mode = MEMPOOL_UNKNOWN_MAP_MODE;
+	environment.huge_pages.mode = MEMPOOL_HUGE_PAGES_NONE_MODE;
+	environment.stream.budget = 0;
+	environment.stream.backend = MEMPOOL_PREAD_IO_BACKEND;
+	environment.stream.depth = MEMPOOL_DEFAULT_IO_DEPTH;
+	environment.stream.direct = MEMPOOL_FALSE;
+	environment.format.input = MEMPOOL_UNKNOWN_FORMAT;
+	environment.format.output = MEMPOOL_UNKNOWN_FORMAT;
+	environment.encoding.input = MEMPOOL_PLAIN_ENCODING;
+	environment.encoding.output = MEMPOOL_UNKNOWN_ENCODING;
+	environment.layout.input = MEMPOOL_ROW_LAYOUT;
+	environment.layout.output = MEMPOOL_UNKNOWN_LAYOUT;
+	environment.checksum.enabled = MEMPOOL_FALSE;
+	environment.algorithm.id = MEMPOOL_UNKNOWN_ALGORITHM;
+	environment.show_debug = MEMPOOL_FALSE;
+
+	memset(&containers, 0, sizeof(containers));
+
+	parse_options(argc, argv, &environment);
+
+	MEMPOOL_DBG(environment.show_debug,
+		    "options have been parsed\n");
+
+	/* container defines geometry of dataset instead of options */
+	err = mempool_read_input_container(&environment, &containers.input);
+	if (err == -ENOMSG) {
+		environment.format.input = MEMPOOL_RAW_FORMAT;
+		err = 0;
+	} else if (err) {
+		goto finish_execution;
+	} else {
+		environment.format.input = MEMPOOL_CONTAINER_FORMAT;
+
+		err = mempool_container_load_geometry(&containers.input,
+						      &environment);
+		if (err) {
+			MEMPOOL_ERR("fail to load geometry: err %d\n", err);
+			goto finish_execution;
+		}
+	}
+
+	if (environment.format.output == MEMPOOL_UNKNOWN_FORMAT)
+		environment.format.output = environment.format.input;
+
+	/* only container describes encoding of portions */
+	if (environment.format.output != MEMPOOL_CONTAINER_FORMAT) {
+		if (environment.encoding.output != MEMPOOL_UNKNOWN_ENCODING &&
+		    environment.encoding.output != MEMPOOL_PLAIN_ENCODING) {
+			err = -EINVAL;
+			MEMPOOL_ERR("encoding requires container format\n");
+			goto finish_execution;
+		}
+
+		environment.encoding.output = MEMPOOL_PLAIN_ENCODING;
+	} else if (environment.encoding.output == MEMPOOL_UNKNOWN_ENCODING) {
+		if (environment.layout.output == MEMPOOL_PAX_LAYOUT)
+			environment.encoding.output = MEMPOOL_PLAIN_ENCODING;
+		else
+			environment.encoding.output = environment.encoding.input;
+	}
+
+	/* only CONVERT produces PAX portions */
+	if (environment.layout.output == MEMPOOL_PAX_LAYOUT) {
+		if (environment.algorithm.id != MEMPOOL_CONVERT_ALGORITHM ||
+		    environment.format.output != MEMPOOL_CONTAINER_FORMAT ||
+		    environment.encoding.output != MEMPOOL_PLAIN_ENCODING) {
+			err = -EOPNOTSUPP;
+			MEMPOOL_ERR("PAX layout requires CONVERT algorithm "
+				    "and plain container output\n");
+			goto finish_execution;
+		}
+	} else {
+		environment.layout.output = MEMPOOL_ROW_LAYOUT;
+	}
+
+	if (environment.checksum.enabled) {
+		switch (environment.algorithm.id) {
+		case MEMPOOL_KEY_VALUE_ALGORITHM:
+		case MEMPOOL_SELECT_ALGORITHM:
+		case MEMPOOL_SORT_ALGORITHM:
+		case MEMPOOL_TOTAL_ALGORITHM:
+			/* output portions are checksummed while written */
+			break;
+
+		default:
+			err = -EOPNOTSUPP;
+			MEMPOOL_ERR("checksums are unsupported: "
+				    "algorithm %#x\n",
+				    environment.algorithm.id);
+			goto finish_execution;
+		}
+
+		if (environment.format.output == MEMPOOL_CONTAINER_FORMAT) {
+			MEMPOOL_WARN("directory of container keeps "
+				     "crc32c of portions already\n");
+			environment.checksum.enabled = MEMPOOL_FALSE;
+		}
+	}
+
+	if (environment.threads.count == 0) {
+		MEMPOOL_INFO("Nothing can be done: "
+			     "threads.count %d\n",
+			     environment.threads.count);
+		goto finish_execution;
+	}
+
+	if (environment.workers.count == 0) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		environment.workers.count = cpus > 0 ? (int)cpus : 1;
+	}
+
+	if (environment.stream.budget > 0) {
+		switch (environment.algorithm.id) {
+		case MEMPOOL_KEY_VALUE_ALGORITHM:
+		case MEMPOOL_SELECT_ALGORITHM:
+		case MEMPOOL_TOTAL_ALGORITHM:
+		case MEMPOOL_CONVERT_ALGORITHM:
+			/* portions are processed independently */
+			break;
+
+		default:
+			err = -EOPNOTSUPP;
+			MEMPOOL_ERR("streaming mode is unsupported: "
+				    "algorithm %#x\n",
+				    environment.algorithm.id);
+			goto finish_execution;
+		}
+
+		/* encoded portions have variable size */
+		if (environment.encoding.input != MEMPOOL_PLAIN_ENCODING ||
+		    environment.encoding.output != MEMPOOL_PLAIN_ENCODING) {
+			err = -EOPNOTSUPP;
+			MEMPOOL_ERR("streaming mode is unsupported "
+				    "for encoded portions\n");
+			goto finish_execution;
+		}
+
+		if (environment.map.mode != MEMPOOL_UNKNOWN_MAP_MODE ||
+		    environment.huge_pages.mode !=
+					MEMPOOL_HUGE_PAGES_NONE_MODE) {
+			MEMPOOL_WARN("streaming mode ignores map mode "
+				     "and huge pages\n");
+			environment.huge_pages.mode =
+					MEMPOOL_HUGE_PAGES_NONE_MODE;
+		}
+
+		streaming = MEMPOOL_TRUE;
+	}
+
+	if (environment.numa.mode != MEMPOOL_NUMA_NONE_MODE) {
+		err = mempool_numa_init(&numa, environment.numa.mode,
+					environment.show_debug);
+		if (err) {
+			MEMPOOL_ERR("fail to detect NUMA topology: err %d\n",
+				    err);
+			goto finish_execution;
+		}
+	}
+
+	if (streaming) {
+		/* buffers of the stream are not mapped */
+		environment.map.mode = MEMPOOL_UNKNOWN_MAP_MODE;
+	} else if (environment.map.mode == MEMPOOL_UNKNOWN_MAP_MODE) {
+		/* pages have to be touched by the workers that own them */
+		if (environment.numa.mode != MEMPOOL_NUMA_NONE_MODE)
+			environment.map.mode = MEMPOOL_MAP_PREFAULT_MODE;
+		else
+			environment.map.mode = MEMPOOL_MAP_POPULATE_MODE;
+	} else if (environment.map.mode == MEMPOOL_MAP_POPULATE_MODE &&
+		   environment.numa.mode != MEMPOOL_NUMA_NONE_MODE) {
+		MEMPOOL_WARN("populate mode places pages on the node "
+			     "of the main thread\n");
+	}
+
+	/* pages have to be populated after advice of huge pages */
+	if (environment.map.mode == MEMPOOL_MAP_POPULATE_MODE &&
+	    environment.huge_pages.mode == MEMPOOL_HUGE_PAGES_NONE_MODE)
+		map_flags |= MAP_POPULATE;
+
 	if (environment.portion.count > environment.portion.capacity) {
 		err = -ERANGE;
 		MEMPOOL_ERR("invalid portion descriptor: "
@@ -1335,14 +4149,14 @@ int main(int argc, char *argv[])
 		goto finish_execution;
 	}
 
-	portion_size = (unsigned int)environment.item.granularity *
+	portion_size = (long long)environment.item.granularity *
 			environment.record.capacity;
 	portion_size *= environment.portion.capacity;
 
 	if (portion_size != environment.threads.portion_size) {
 		err = -ERANGE;
 		MEMPOOL_ERR("invalid request: "
-			    "portion_size %d, granularity %d, "
+			    "portion_size %lld, granularity %d, "
 			    "record_capacity %d, portion_capacity %d\n",
 			    environment.threads.portion_size,
 			    environment.item.granularity,
@@ -1353,6 +4167,85 @@ int main(int argc, char *argv[])
 
 	file_size = (off_t)environment.threads.count *
 			environment.threads.portion_size;
+	output_size = file_size;
+
+	for (i = 0; i < environment.threads.count; i++) {
+		records_count += mempool_portion_records(&environment,
+							 &containers, i);
+	}
+
+	if (environment.algorithm.id == MEMPOOL_TOPK_ALGORITHM) {
+		if (environment.limit.count <= 0 || records_count == 0) {
+			err = -EINVAL;
+			MEMPOOL_ERR("invalid limit: "
+				    "count %d, records %lld\n",
+				    environment.limit.count,
+				    (long long)records_count);
+			goto finish_execution;
+		}
+
+		if (environment.limit.count < records_count)
+			records_count = environment.limit.count;
+
+		output_size = records_count *
+				environment.record.capacity *
+				environment.item.granularity;
+	} else if (environment.algorithm.id == MEMPOOL_DISTINCT_ALGORITHM) {
+		if (mempool_items_bytes(&environment,
+					environment.key.mask) == 0 ||
+		    records_count == 0) {
+			err = -EINVAL;
+			MEMPOOL_ERR("invalid request: "
+				    "key mask %#llx, records %lld\n",
+				    environment.key.mask,
+				    (long long)records_count);
+			goto finish_execution;
+		}
+
+		distinct.record_size =
+			mempool_distinct_record_size(&environment);
+		output_size = records_count * distinct.record_size;
+	}
+
+	output_bytes = output_size;
+
+	if (environment.format.output == MEMPOOL_CONTAINER_FORMAT) {
+		err = mempool_prepare_output_container(&environment,
+						       &containers,
+						       records_count);
+		if (err) {
+			MEMPOOL_ERR("fail to prepare output container: "
+				    "err %d\n", err);
+			goto finish_execution;
+		}
+
+		output_offset = containers.output.payload_offset;
+		output_size = mempool_container_file_size(&containers.output);
+	}
+
+	stride = environment.threads.portion_size;
+
+	if (streaming) {
+		size_t input_stride = stride;
+		size_t output_stride = stride;
+
+		if (containers.input.portions)
+			input_stride = containers.input.stride;
+		if (containers.output.portions)
+			output_stride = containers.output.stride;
+
+		/* chunk is read and written by contiguous requests */
+		if (input_stride == 0 || input_stride != output_stride) {
+			err = -EOPNOTSUPP;
+			MEMPOOL_ERR("streaming mode requires the same layout "
+				    "of portions: input stride %zu, "
+				    "output stride %zu\n",
+				    input_stride, output_stride);
+			goto finish_execution;
+		}
+
+		stride = input_stride;
+	}
 
 	MEMPOOL_INFO("Open files...\n");
 
@@ -1365,6 +4258,18 @@ int main(int argc, char *argv[])
 		goto finish_execution;
 	}
 
+	if (containers.input.portions) {
+		/* payloads are mapped together with header */
+		if (fstat(environment.input_file.fd, &input_stat)) {
+			err = -errno;
+			MEMPOOL_ERR("fail to get file size: %s\n",
+				    strerror(errno));
+			goto close_files;
+		}
+
+		file_size = input_stat.st_size;
+	}
+
 	environment.output_file.fd = open(environment.output_file.name,
 					  O_CREAT | O_RDWR, 0664);
 	if (environment.output_file.fd == -1) {
@@ -1374,130 +4279,576 @@ int main(int argc, char *argv[])
 		goto close_files;
 	}
 
-	err = ftruncate(environment.output_file.fd, file_size);
+	err = ftruncate(environment.output_file.fd, output_size);
 	if (err) {
 		MEMPOOL_ERR("fail to prepare output file: %s\n",
 			    strerror(errno));
 		goto close_files;
 	}
 
-	input_addr = mmap(0, file_size, PROT_READ,
-			  MAP_SHARED|MAP_POPULATE,
-			  environment.input_file.fd, 0);
-	if (input_addr == MAP_FAILED) {
-		input_addr = NULL;
-		MEMPOOL_ERR("fail to mmap input file: %s\n",
-			    strerror(errno));
-		goto munmap_memory;
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	getrusage(RUSAGE_SELF, &start_usage);
+
+	if (streaming) {
+		err = mempool_stream_init(&stream, &environment,
+					  containers.input.payload_offset,
+					  containers.output.payload_offset,
+					  stride);
+		if (err) {
+			MEMPOOL_ERR("fail to create stream: err %d\n", err);
+			goto close_files;
+		}
+	} else {
+		input_addr = mmap(0, file_size, PROT_READ, map_flags,
+				  environment.input_file.fd, 0);
+		if (input_addr == MAP_FAILED) {
+			input_addr = NULL;
+			MEMPOOL_ERR("fail to mmap input file: %s\n",
+				    strerror(errno));
+			goto munmap_memory;
+		}
+
+		output_addr = mmap(0, output_size, PROT_READ|PROT_WRITE,
+				   map_flags, environment.output_file.fd, 0);
+		if (output_addr == MAP_FAILED) {
+			output_addr = NULL;
+			MEMPOOL_ERR("fail to mmap output file: %s\n",
+				    strerror(errno));
+			goto munmap_memory;
+		}
+
+		if (environment.huge_pages.mode !=
+					MEMPOOL_HUGE_PAGES_NONE_MODE) {
+			mempool_huge_advise(input_addr, file_size,
+					    "input file");
+			mempool_huge_advise(output_addr, output_size,
+					    "output file");
+
+			if (environment.map.mode ==
+					MEMPOOL_MAP_POPULATE_MODE) {
+				err = mempool_huge_populate(input_addr,
+							    file_size,
+							    MEMPOOL_FALSE);
+				if (!err) {
+					err = mempool_huge_populate(output_addr,
+							output_size,
+							MEMPOOL_TRUE);
+				}
+
+				if (err) {
+					MEMPOOL_WARN("fail to populate mapping: "
+						     "%s, pages will be "
+						     "faulted lazily\n",
+						     strerror(-err));
+					err = 0;
+				}
+			}
+		}
+	}
+
+	if (environment.algorithm.id == MEMPOOL_SORT_ALGORITHM) {
+		sort.runs = mempool_huge_alloc(environment.huge_pages.mode,
+					(size_t)environment.threads.count *
+						environment.threads.portion_size,
+					&sort.runs_size);
+		if (!sort.runs) {
+			err = -ENOMEM;
+			MEMPOOL_ERR("fail to allocate sorted runs: %s\n",
+				    strerror(errno));
+			goto munmap_memory;
+		}
+
+		sort.env = &environment;
+		sort.output_addr = output_addr;
+	} else if (environment.algorithm.id == MEMPOOL_DISTINCT_ALGORITHM) {
+		distinct.splitters = calloc(environment.threads.count,
+					    sizeof(unsigned long long));
+		distinct.offsets = calloc(environment.threads.count,
+					  sizeof(size_t));
+		if (!distinct.splitters || !distinct.offsets) {
+			err = -ENOMEM;
+			MEMPOOL_ERR("fail to allocate distinct context: %s\n",
+				    strerror(errno));
+			goto free_contexts;
+		}
+
+		distinct.output_addr = (char *)output_addr + output_offset;
+		distinct.output_size = output_bytes;
+	}
+
+	if (mempool_needs_rows(&environment)) {
+		decoded = mempool_huge_alloc(environment.huge_pages.mode,
+					(size_t)environment.threads.count *
+						environment.threads.portion_size,
+					&decoded_size);
+		if (!decoded) {
+			err = -ENOMEM;
+			MEMPOOL_ERR("fail to allocate decoded portions: %s\n",
+				    strerror(errno));
+			goto free_contexts;
+		}
+	}
+
+	/* stream reuses states of portions by chunks */
+	if (streaming)
+		portions_count = stream.chunk_portions;
+	else
+		portions_count = environment.threads.count;
+
+	if (environment.checksum.enabled) {
+		manifest.count = environment.threads.count;
+		manifest.portion_size = environment.threads.portion_size;
+		manifest.portions = calloc(manifest.count,
+					   sizeof(struct mempool_checksum_entry));
+		if (!manifest.portions) {
+			err = -ENOMEM;
+			MEMPOOL_ERR("fail to allocate manifest: %s\n",
+				    strerror(errno));
+			goto free_contexts;
+		}
 	}
 
-	output_addr = mmap(0, file_size, PROT_READ|PROT_WRITE,
-			  MAP_SHARED|MAP_POPULATE,
-			  environment.output_file.fd, 0);
-	if (output_addr == MAP_FAILED) {
-		output_addr = NULL;
-		MEMPOOL_ERR("fail to mmap output file: %s\n",
+	portions = calloc(portions_count,
+			  sizeof(struct mempool_portion_state));
+	if (!portions) {
+		err = -ENOMEM;
+		MEMPOOL_ERR("fail to allocate portions: %s\n",
 			    strerror(errno));
-		goto munmap_memory;
+		goto free_contexts;
 	}
 
-	MEMPOOL_INFO("Create threads...\n");
+	slices_per_portion = mempool_slices_per_portion(&environment,
+							portions_count);
+	slices_count = portions_count * slices_per_portion;
 
-	pool = calloc(environment.threads.count,
-			sizeof(struct mempool_thread_state));
-	if (!pool) {
+	slices = calloc(slices_count, sizeof(struct mempool_portion_slice));
+	if (!slices) {
 		err = -ENOMEM;
-		MEMPOOL_ERR("fail to allocate threads pool: %s\n",
+		MEMPOOL_ERR("fail to allocate slices: %s\n",
 			    strerror(errno));
-		goto close_files;
+		goto free_portions;
 	}
 
-	for (i = 0; i < environment.threads.count; i++) {
-		cur = &pool[i];
+	sort.portions = portions;
+	sort.slices = slices;
+	sort.slices_count = slices_count;
+
+	for (i = 0; i < portions_count; i++) {
+		cur = &portions[i];
 
 		cur->id = i;
+		cur->count = mempool_portion_records(&environment,
+						     &containers, i);
 		cur->env = &environment;
-		cur->input_portion = (char *)input_addr +
-				(i * environment.threads.portion_size);
-		cur->output_portion = (char *)output_addr +
-				(i * environment.threads.portion_size);
-		cur->buf = NULL;
 
-		cur->start_index = 0;
-		cur->end_index = environment.portion.count - 1;
+		/* buffers of chunk are assigned by the stream */
+		if (!streaming) {
+			cur->input_portion = (char *)input_addr +
+				mempool_portion_offset(&environment,
+						       &containers.input, i);
+			cur->output_portion = (char *)output_addr +
+				mempool_portion_offset(&environment,
+						       &containers.output, i);
+
+			cur->input_layout = environment.layout.input;
+
+			if (environment.encoding.input !=
+						MEMPOOL_PLAIN_ENCODING) {
+				cur->encoded_portion = cur->input_portion;
+				cur->input_portion = NULL;
+			} else if (decoded) {
+				cur->pax_portion = cur->input_portion;
+				cur->input_layout = MEMPOOL_ROW_LAYOUT;
+			}
+
+			if (decoded) {
+				cur->input_portion = (char *)decoded +
+				    ((size_t)i * environment.threads.portion_size);
+			}
+		}
+
+		if (environment.algorithm.id == MEMPOOL_TOPK_ALGORITHM ||
+		    environment.algorithm.id == MEMPOOL_DISTINCT_ALGORITHM) {
+			/* only merged result is written into output */
+			cur->output_portion = NULL;
+		}
+
+		if (sort.runs) {
+			cur->run = (char *)sort.runs +
+				((size_t)i * environment.threads.portion_size);
+		}
+
+		cur->distinct = &distinct;
+		cur->sort = &sort;
+		cur->containers = &containers;
+		cur->manifest = manifest.portions ? &manifest : NULL;
+		cur->portions = portions;
+
+		cur->slices = &slices[i * slices_per_portion];
+		cur->slices_count = slices_per_portion;
+
+		for (j = 0; j < slices_per_portion; j++) {
+			slice = &cur->slices[j];
+
+			slice->id = j;
+			slice->state = cur;
+
+			if (environment.algorithm.id ==
+					MEMPOOL_TOTAL_ALGORITHM) {
+				slice->sums = calloc(environment.record.capacity,
+						sizeof(unsigned long long));
+				if (!slice->sums) {
+					err = -ENOMEM;
+					MEMPOOL_ERR("fail to allocate sums: %s\n",
+						    strerror(errno));
+					goto free_portions;
+				}
+			}
+		}
+
+		mempool_split_portion(cur);
+	}
 
-		pthread_mutex_init(&cur->left_queue.lock, NULL);
-		cur->left_queue.state = MEMPOOL_QUEUE_UNKNOWN_STATE;
-		cur->left_queue.bound = ULLONG_MAX;
-		cur->left_queue.record = NULL;
+	MEMPOOL_INFO("Create workers...\n");
 
-		pthread_mutex_init(&cur->right_queue.lock, NULL);
-		cur->right_queue.state = MEMPOOL_QUEUE_UNKNOWN_STATE;
-		cur->right_queue.bound = ULLONG_MAX;
-		cur->right_queue.record = NULL;
+	err = mempool_scheduler_init(&scheduler, environment.workers.count,
+				     environment.show_debug);
+	if (err) {
+		MEMPOOL_ERR("fail to create workers: err %d\n", err);
+		goto free_portions;
+	}
 
-		cur->pool = pool;
+	if (environment.numa.mode != MEMPOOL_NUMA_NONE_MODE) {
+		MEMPOOL_INFO("Place workers and memory: NUMA nodes %d...\n",
+			     numa.count);
 
-		cur->err = 0;
+		for (i = 0; i < scheduler.count; i++) {
+			scheduler.workers[i].node =
+				mempool_numa_worker_node(&numa, i,
+							 scheduler.count);
+		}
 
-		err = pthread_create(&cur->thread, NULL,
-				     ThreadFunc, (void *)cur);
+		/* zero size of argument: every worker receives &numa */
+		err = mempool_process_pinned_tasks(&scheduler, &numa, 0,
+						   scheduler.count,
+						   mempool_numa_bind_task);
 		if (err) {
-			MEMPOOL_ERR("fail to create thread %d: %s\n",
-				    i, strerror(errno));
-			for (i--; i >= 0; i--) {
-				pthread_join(pool[i].thread, &res);
+			MEMPOOL_ERR("fail to pin workers: err %d\n", err);
+			goto destroy_scheduler;
+		}
+
+		if (sort.runs &&
+		    environment.numa.mode == MEMPOOL_NUMA_INTERLEAVE_MODE) {
+			err = mempool_numa_mbind(&numa, sort.runs,
+						 sort.runs_size, -1);
+		} else if (sort.runs) {
+			for (i = 0; i < environment.threads.count; i++) {
+				int worker_id = (int)(((long long)i *
+						scheduler.count) /
+						environment.threads.count);
+
+				err = mempool_numa_mbind(&numa, portions[i].run,
+					environment.threads.portion_size,
+					scheduler.workers[worker_id].node);
+				if (err)
+					break;
 			}
-			goto free_threads_pool;
+		}
+
+		if (err) {
+			MEMPOOL_ERR("fail to bind sorted runs: err %d\n", err);
+			goto destroy_scheduler;
 		}
 	}
 
-	MEMPOOL_INFO("Waiting threads...\n");
+	if (environment.map.mode == MEMPOOL_MAP_PREFAULT_MODE) {
+		err = mempool_process_pinned_tasks(&scheduler, slices,
+					sizeof(struct mempool_portion_slice),
+					slices_count,
+					mempool_prefault_task);
+		if (err) {
+			MEMPOOL_ERR("fail to prefault memory: err %d\n", err);
+			goto destroy_scheduler;
+		}
+	}
 
-	for (i = 0; i < environment.threads.count; i++) {
-		cur = &pool[i];
+	/* the stream checks portions by chunks */
+	if (!streaming && containers.input.portions) {
+		err = mempool_process_tasks(&scheduler, portions,
+					sizeof(struct mempool_portion_state),
+					environment.threads.count,
+					mempool_container_check_task);
+		if (err) {
+			MEMPOOL_ERR("input container is corrupted: err %d\n",
+				    err);
+			goto destroy_scheduler;
+		}
+	}
 
-		err = pthread_join(cur->thread, &res);
+	if (decoded) {
+		if (environment.layout.input == MEMPOOL_PAX_LAYOUT)
+			MEMPOOL_INFO("Convert PAX input portions into rows...\n");
+		else
+			MEMPOOL_INFO("Decode input portions...\n");
+
+		err = mempool_process_tasks(&scheduler, portions,
+					sizeof(struct mempool_portion_state),
+					environment.threads.count,
+					mempool_decode_task);
 		if (err) {
-			MEMPOOL_ERR("fail to finish thread %d: %s\n",
-				    i, strerror(errno));
-			continue;
+			MEMPOOL_ERR("fail to decode input: err %d\n", err);
+			goto destroy_scheduler;
 		}
+	} else if (environment.encoding.input != MEMPOOL_PLAIN_ENCODING) {
+		MEMPOOL_INFO("Scan encoded portions: unpack %s\n",
+			     mempool_codec_unpack_name());
+	}
 
-		if ((long)res != 0) {
-			MEMPOOL_ERR("thread %d has failed: res %lu\n",
-				    i, (long)res);
-			continue;
+	clock_gettime(CLOCK_MONOTONIC, &finish_time);
+	getrusage(RUSAGE_SELF, &finish_usage);
+
+	if (!streaming) {
+		MEMPOOL_INFO("Map mode: %s\n",
+			     convert_map_mode2string(environment.map.mode));
+	}
+
+	mempool_report_usage("Startup", &start_time, &finish_time,
+			     &start_usage, &finish_usage);
+
+	MEMPOOL_INFO("Process portions: portions %d, slices %d, "
+		     "workers %d...\n",
+		     environment.threads.count, slices_count,
+		     environment.workers.count);
+
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+	getrusage(RUSAGE_SELF, &start_usage);
+
+	if (streaming) {
+		err = mempool_stream_portions(&scheduler, &stream, portions,
+					      slices_per_portion);
+	} else {
+		err = mempool_process_tasks(&scheduler, slices,
+					sizeof(struct mempool_portion_slice),
+					slices_count,
+					mempool_slice_task);
+	}
+
+	if (err)
+		portions_failed = MEMPOOL_TRUE;
+
+	clock_gettime(CLOCK_MONOTONIC, &finish_time);
+	getrusage(RUSAGE_SELF, &finish_usage);
+
+	seconds = mempool_report_usage("Processing",
+					&start_time, &finish_time,
+					&start_usage, &finish_usage);
+
+	if (streaming)
+		mempool_stream_report(&stream, seconds);
+
+	if (environment.numa.mode != MEMPOOL_NUMA_NONE_MODE)
+		mempool_numa_report(&numa, &scheduler, seconds);
+
+	if (environment.huge_pages.mode != MEMPOOL_HUGE_PAGES_NONE_MODE) {
+		mempool_huge_report(input_addr, "input file");
+		mempool_huge_report(output_addr, "output file");
+		mempool_huge_report(sort.runs, "sorted runs");
+	}
+
+	for (i = 0; i < slices_count; i++) {
+		if (slices[i].err != 0) {
+			MEMPOOL_ERR("portion %d has failed: "
+				    "slice %d, err %d\n",
+				    slices[i].state->id,
+				    slices[i].id,
+				    slices[i].err);
+			portions_failed = MEMPOOL_TRUE;
+		}
+	}
+
+	if (portions_failed) {
+		err = -EFAULT;
+		MEMPOOL_ERR("algorithm %#x has failed\n",
+			    environment.algorithm.id);
+		goto destroy_scheduler;
+	}
+
+	if (streaming) {
+		/* slices have been joined by chunks */
+	} else if (environment.algorithm.id == MEMPOOL_SELECT_ALGORITHM) {
+		err = mempool_process_tasks(&scheduler, portions,
+					    sizeof(struct mempool_portion_state),
+					    environment.threads.count,
+					    mempool_select_join_task);
+		if (err) {
+			MEMPOOL_ERR("fail to join slices: err %d\n", err);
+			goto destroy_scheduler;
+		}
+	} else if (environment.algorithm.id == MEMPOOL_TOTAL_ALGORITHM) {
+		err = mempool_process_tasks(&scheduler, portions,
+					    sizeof(struct mempool_portion_state),
+					    environment.threads.count,
+					    mempool_total_join_task);
+		if (err) {
+			MEMPOOL_ERR("fail to join slices: err %d\n", err);
+			goto destroy_scheduler;
+		}
+	} else if (environment.algorithm.id == MEMPOOL_SORT_ALGORITHM) {
+		MEMPOOL_INFO("Merge sorted runs...\n");
+
+		err = mempool_sort_portions(&scheduler, &sort);
+		if (err) {
+			portions_failed = MEMPOOL_TRUE;
+			MEMPOOL_ERR("fail to merge sorted runs: err %d\n", err);
+			goto destroy_scheduler;
+		}
+	} else if (environment.algorithm.id == MEMPOOL_TOPK_ALGORITHM) {
+		MEMPOOL_INFO("Merge TOPK candidates...\n");
+
+		err = mempool_topk_merge(&environment, portions,
+					 (char *)output_addr + output_offset,
+					 output_bytes);
+		if (err) {
+			MEMPOOL_ERR("fail to merge TOPK: err %d\n", err);
+			goto destroy_scheduler;
+		}
+	} else if (environment.algorithm.id == MEMPOOL_DISTINCT_ALGORITHM) {
+		MEMPOOL_INFO("Merge unique keys...\n");
+
+		err = mempool_distinct_portions(&scheduler, &environment,
+						portions, &distinct);
+		if (err) {
+			portions_failed = MEMPOOL_TRUE;
+			MEMPOOL_ERR("DISTINCT has failed: err %d\n", err);
+			goto destroy_scheduler;
 		}
 
-		if (cur->err != 0) {
-			MEMPOOL_ERR("thread %d has failed: err %d\n",
-				    i, cur->err);
+		MEMPOOL_INFO("Unique records: %zu\n",
+			     distinct.result_size / distinct.record_size);
+
+		output_bytes = distinct.result_size;
+	}
+
+	/* the stream checksums portions by chunks */
+	if (!streaming && manifest.portions) {
+		err = mempool_process_tasks(&scheduler, portions,
+					    sizeof(struct mempool_portion_state),
+					    environment.threads.count,
+					    mempool_checksum_task);
+		if (err) {
+			MEMPOOL_ERR("fail to checksum output: err %d\n", err);
+			goto destroy_scheduler;
+		}
+	}
+
+	if (manifest.portions) {
+		err = mempool_write_manifest(&environment, &manifest);
+		if (err) {
+			MEMPOOL_ERR("fail to write manifest: err %d\n", err);
+			goto destroy_scheduler;
 		}
 	}
 
-	MEMPOOL_INFO("Threads have been destroyed...\n");
+	if (containers.output.portions) {
+		err = mempool_write_output_container(&scheduler, &environment,
+					portions, &containers,
+					output_addr,
+					output_bytes, streaming);
+		if (err) {
+			MEMPOOL_ERR("fail to write output container: err %d\n",
+				    err);
+			goto destroy_scheduler;
+		}
+	}
 
 	MEMPOOL_DBG(environment.show_debug,
 		    "operation has been executed\n");
 
-free_threads_pool:
-	if (pool)
-		free(pool);
+destroy_scheduler:
+	for (i = 0; i < scheduler.count; i++) {
+		MEMPOOL_DBG(environment.show_debug,
+			    "worker %d: executed %llu, stolen %llu\n",
+			    i,
+			    scheduler.workers[i].executed,
+			    scheduler.workers[i].stolen);
+	}
+
+	mempool_scheduler_destroy(&scheduler);
 
-munmap_memory:
-	if (input_addr) {
-		err = munmap(input_addr, file_size);
-		if (err) {
-			MEMPOOL_ERR("fail to unmap input file: %s\n",
-				    strerror(errno));
+	MEMPOOL_INFO("Workers have been destroyed...\n");
+
+free_portions:
+	if (slices) {
+		for (i = 0; i < slices_count; i++) {
+			if (slices[i].sums)
+				free(slices[i].sums);
 		}
+
+		free(slices);
 	}
 
-	if (output_addr) {
-		err = munmap(output_addr, file_size);
-		if (err) {
-			MEMPOOL_ERR("fail to unmap output file: %s\n",
+	for (i = 0; i < portions_count; i++) {
+		mempool_topk_heap_destroy(&portions[i].topk);
+		mempool_distinct_set_destroy(&portions[i].local_set);
+		mempool_distinct_set_destroy(&portions[i].partition_set);
+	}
+
+	free(portions);
+
+free_contexts:
+	if (manifest.portions)
+		free(manifest.portions);
+
+	if (distinct.splitters)
+		free(distinct.splitters);
+
+	if (distinct.offsets)
+		free(distinct.offsets);
+
+	if (sort.splitters)
+		free(sort.splitters);
+
+	if (sort.bounds)
+		free(sort.bounds);
+
+	if (sort.offsets)
+		free(sort.offsets);
+
+	if (sort.checksums)
+		free(sort.checksums);
+
+	if (sort.runs)
+		munmap(sort.runs, sort.runs_size);
+
+	if (decoded)
+		munmap(decoded, decoded_size);
+
+munmap_memory:
+	/* I/O errors of the stream have been reported already */
+	mempool_stream_destroy(&stream);
+
+	/* error of processing has to be kept */
+	if (input_addr && munmap(input_addr, file_size)) {
+		MEMPOOL_ERR("fail to unmap input file: %s\n",
+			    strerror(errno));
+	}
+
+	if (output_addr && munmap(output_addr, output_size)) {
+		MEMPOOL_ERR("fail to unmap output file: %s\n",
+			    strerror(errno));
+	}
+
+	if (containers.output.portions)
+		output_size = mempool_container_file_size(&containers.output);
+	else
+		output_size = distinct.result_size;
+
+	if ((environment.algorithm.id == MEMPOOL_DISTINCT_ALGORITHM ||
+	     environment.encoding.output != MEMPOOL_PLAIN_ENCODING) &&
+	    !portions_failed && output_size > 0) {
+		/* output keeps unique records or encoded portions only */
+		if (ftruncate(environment.output_file.fd, output_size)) {
+			MEMPOOL_ERR("fail to truncate output file: %s\n",
 				    strerror(errno));
 		}
 	}
@@ -1510,5 +4861,8 @@ close_files:
 		close(environment.output_file.fd);
 
 finish_execution:
+	mempool_container_destroy(&containers.input);
+	mempool_container_destroy(&containers.output);
+
 	exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
 }
@@ -25,6 +25,8 @@
 
 #define hosttest_fmt(fmt) "host-test: " MEMPOOL_TOOLS_VERSION ": " fmt
 
+#include <pthread.h>
+
 #include "memory_pool_constants.h"
 #include "memory_pool_tools.h"
 
@@ -35,10 +37,284 @@
 		} \
 	} while (0)
 
+struct mempool_worker;
+
+typedef int (*mempool_task_func)(struct mempool_worker *worker, void *arg);
+
+/*
+ * struct mempool_task - task of worker
+ * @func: task's function
+ * @arg: argument of task's function
+ * @pinned: task cannot be stolen by other workers
+ */
+struct mempool_task {
+	mempool_task_func func;
+	void *arg;
+	int pinned;
+};
+
+/*
+ * struct mempool_task_deque - deque of worker's tasks
+ * @lock: deque's lock
+ * @tasks: ring buffer of tasks
+ * @head: index of the oldest task (thieves' side)
+ * @tail: index after the newest task (owner's side)
+ * @capacity: capacity of ring buffer
+ */
+struct mempool_task_deque {
+	pthread_mutex_t lock;
+	struct mempool_task *tasks;
+	unsigned long head;
+	unsigned long tail;
+	unsigned long capacity;
+};
+
+struct mempool_scheduler;
+
+/*
+ * struct mempool_worker - worker of scheduler
+ * @id: worker ID
+ * @thread: thread descriptor
+ * @scheduler: scheduler of worker
+ * @deque: deque of worker's tasks
+ * @pinned: deque of tasks that only the worker executes
+ * @node: NUMA node of worker
+ * @buf: scratch buffer is reused by worker's tasks
+ * @buf_size: size of scratch buffer in bytes
+ * @executed: number of executed tasks
+ * @stolen: number of tasks stolen from other workers
+ * @bytes: number of input bytes processed by worker
+ */
+struct mempool_worker {
+	int id;
+	pthread_t thread;
+	struct mempool_scheduler *scheduler;
+	struct mempool_task_deque deque;
+	struct mempool_task_deque pinned;
+	int node;
+	void *buf;
+	size_t buf_size;
+	unsigned long long executed;
+	unsigned long long stolen;
+	unsigned long long bytes;
+};
+
+/*
+ * struct mempool_scheduler - work-stealing scheduler
+ * @workers: array of workers
+ * @count: number of workers
+ * @started: number of started worker threads
+ * @lock: scheduler's lock
+ * @wakeup: idle workers wait new tasks
+ * @idle: waiting the end of tasks
+ * @pending: number of unfinished tasks
+ * @stealable: number of tasks in deques that can be stolen
+ * @shutdown: workers have to exit
+ * @err: the first error of tasks
+ * @show_debug: show debug messages
+ */
+struct mempool_scheduler {
+	struct mempool_worker *workers;
+	int count;
+	int started;
+	pthread_mutex_t lock;
+	pthread_cond_t wakeup;
+	pthread_cond_t idle;
+	unsigned long pending;
+	unsigned long stealable;
+	int shutdown;
+	int err;
+	int show_debug;
+};
+
+#define MEMPOOL_NUMA_MAX_NODES		(64)
+#define MEMPOOL_NUMA_MAX_CPUS		(1024)
+#define MEMPOOL_BITS_PER_LONG		(sizeof(unsigned long) * \
+					 MEMPOOL_BITS_PER_BYTE)
+#define MEMPOOL_NUMA_CPU_WORDS		(MEMPOOL_NUMA_MAX_CPUS / \
+					 MEMPOOL_BITS_PER_LONG)
+
+/*
+ * struct mempool_numa_node - NUMA node
+ * @id: node ID
+ * @cpus: bitmap of node's CPUs
+ * @cpus_count: number of node's CPUs
+ */
+struct mempool_numa_node {
+	int id;
+	unsigned long cpus[MEMPOOL_NUMA_CPU_WORDS];
+	int cpus_count;
+};
+
+/*
+ * struct mempool_numa_topology - NUMA topology
+ * @nodes: online nodes with CPUs
+ * @count: number of nodes
+ * @mode: placement of workers and memory
+ * @show_debug: show debug messages
+ */
+struct mempool_numa_topology {
+	struct mempool_numa_node nodes[MEMPOOL_NUMA_MAX_NODES];
+	int count;
+	int mode;
+	int show_debug;
+};
+
+/* reader loads chunk N+1, workers process chunk N, writer stores chunk N-1 */
+#define MEMPOOL_STREAM_BUFFERS		(3)
+
+enum {
+	MEMPOOL_STREAM_BUFFER_FREE,
+	MEMPOOL_STREAM_BUFFER_LOADED,
+	MEMPOOL_STREAM_BUFFER_PROCESSED,
+};
+
+/*
+ * struct mempool_stream_buffer - buffer of streaming mode
+ * @chunk: index of chunk in the buffer
+ * @first: index of the first portion of chunk
+ * @portions: number of portions in chunk
+ * @bytes: size of chunk in bytes
+ * @input: aligned buffer of input portions
+ * @output: aligned buffer of output portions
+ * @state: state of buffer (free, loaded or processed)
+ */
+struct mempool_stream_buffer {
+	int chunk;
+	int first;
+	int portions;
+	size_t bytes;
+	void *input;
+	void *output;
+	int state;
+};
+
+struct mempool_stream;
+
+/*
+ * struct mempool_io_operations - I/O backend of streaming mode
+ * @name: backend's name
+ * @init: prepare backend for the stream
+ * @read: read input portions of the buffer's chunk
+ * @write: write output portions of the buffer's chunk
+ * @destroy: release backend's resources
+ */
+struct mempool_io_operations {
+	const char *name;
+	int (*init)(struct mempool_stream *stream);
+	int (*read)(struct mempool_stream *stream,
+		    struct mempool_stream_buffer *buf);
+	int (*write)(struct mempool_stream *stream,
+		     struct mempool_stream_buffer *buf);
+	void (*destroy)(struct mempool_stream *stream);
+};
+
+/*
+ * struct mempool_stream - streaming of portions through buffers
+ * @env: test's environment
+ * @ops: I/O backend
+ * @backend: backend's private data
+ * @buffers: ring of buffers
+ * @chunk_portions: number of portions in chunk
+ * @chunk_size: size of chunk in bytes
+ * @chunks_count: number of chunks in the file
+ * @stride: distance between portions in files and buffers
+ * @input_offset: offset of the first input portion in bytes
+ * @output_offset: offset of the first output portion in bytes
+ * @input_fd: input file descriptor of the stream
+ * @output_fd: output file descriptor of the stream
+ * @direct: files are opened with O_DIRECT
+ * @reader: thread that loads chunks
+ * @writer: thread that stores processed chunks
+ * @threads: number of started threads
+ * @lock: stream's lock
+ * @changed: state of some buffer has been changed
+ * @shutdown: reader and writer have to exit
+ * @err: the first I/O error
+ * @read_bytes: number of read bytes
+ * @written_bytes: number of written bytes
+ * @stall_time: time of waiting the input by workers (seconds)
+ */
+struct mempool_stream {
+	struct mempool_test_environment *env;
+	const struct mempool_io_operations *ops;
+	void *backend;
+	struct mempool_stream_buffer buffers[MEMPOOL_STREAM_BUFFERS];
+	int chunk_portions;
+	size_t chunk_size;
+	int chunks_count;
+	size_t stride;
+	off_t input_offset;
+	off_t output_offset;
+	int input_fd;
+	int output_fd;
+	int direct;
+	pthread_t reader;
+	pthread_t writer;
+	int threads;
+	pthread_mutex_t lock;
+	pthread_cond_t changed;
+	int shutdown;
+	int err;
+	unsigned long long read_bytes;
+	unsigned long long written_bytes;
+	double stall_time;
+};
+
 /* options.c */
 void print_version(void);
 void print_usage(void);
 void parse_options(int argc, char *argv[],
 		   struct mempool_test_environment *env);
 
+/* scheduler.c */
+int mempool_scheduler_init(struct mempool_scheduler *sched,
+			   int count, int show_debug);
+void mempool_scheduler_destroy(struct mempool_scheduler *sched);
+int mempool_scheduler_submit(struct mempool_scheduler *sched,
+			     int worker_id,
+			     mempool_task_func func, void *arg);
+int mempool_scheduler_submit_pinned(struct mempool_scheduler *sched,
+				    int worker_id,
+				    mempool_task_func func, void *arg);
+int mempool_scheduler_spawn(struct mempool_worker *worker,
+			    mempool_task_func func, void *arg);
+int mempool_scheduler_wait(struct mempool_scheduler *sched);
+void *mempool_worker_scratch(struct mempool_worker *worker, size_t size);
+
+/* numa.c */
+int mempool_numa_init(struct mempool_numa_topology *numa,
+		      int mode, int show_debug);
+int mempool_numa_worker_node(struct mempool_numa_topology *numa,
+			     int worker_id, int workers);
+int mempool_numa_bind_task(struct mempool_worker *worker, void *arg);
+int mempool_numa_mbind(struct mempool_numa_topology *numa,
+		       void *addr, size_t len, int node);
+void mempool_numa_report(struct mempool_numa_topology *numa,
+			 struct mempool_scheduler *sched,
+			 double seconds);
+
+/* hugepage.c */
+size_t mempool_huge_page_size(void);
+void *mempool_huge_alloc(int mode, size_t size, size_t *mapped_size);
+void mempool_huge_advise(void *addr, size_t len, const char *name);
+int mempool_huge_populate(void *addr, size_t len, int write);
+void mempool_huge_report(void *addr, const char *name);
+
+/* uring.c */
+extern const struct mempool_io_operations mempool_uring_operations;
+
+/* stream.c */
+int mempool_stream_init(struct mempool_stream *stream,
+			struct mempool_test_environment *env,
+			off_t input_offset, off_t output_offset,
+			size_t stride);
+struct mempool_stream_buffer *
+mempool_stream_get(struct mempool_stream *stream, int chunk);
+void mempool_stream_put(struct mempool_stream *stream,
+			struct mempool_stream_buffer *buf);
+int mempool_stream_flush(struct mempool_stream *stream);
+int mempool_stream_destroy(struct mempool_stream *stream);
+void mempool_stream_report(struct mempool_stream *stream, double seconds);
+
 #endif /* _HOST_TEST_TOOL_H */
@@ -0,0 +1,217 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/hugepage.c - huge pages backing of memory.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "host_test.h"
+
+/* advices of Linux kernel 5.14+ (include/uapi/asm-generic/mman-common.h) */
+#ifndef MADV_POPULATE_READ
+#define MADV_POPULATE_READ		(22)
+#endif
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE		(23)
+#endif
+
+#define MEMPOOL_MEMINFO_PATH		"/proc/meminfo"
+#define MEMPOOL_SMAPS_PATH		"/proc/self/smaps"
+
+/* the most common size of PMD page */
+#define MEMPOOL_DEFAULT_HUGE_PAGE_SIZE	(2 * 1024 * 1024)
+
+/*
+ * Size of default huge page of hugetlbfs pool.
+ */
+size_t mempool_huge_page_size(void)
+{
+	char line[256];
+	unsigned long kbytes;
+	size_t size = MEMPOOL_DEFAULT_HUGE_PAGE_SIZE;
+	FILE *stream;
+
+	stream = fopen(MEMPOOL_MEMINFO_PATH, "r");
+	if (!stream)
+		return size;
+
+	while (fgets(line, sizeof(line), stream)) {
+		if (sscanf(line, "Hugepagesize: %lu kB", &kbytes) == 1) {
+			size = (size_t)kbytes * 1024;
+			break;
+		}
+	}
+
+	fclose(stream);
+
+	return size;
+}
+
+/*
+ * Allocate private anonymous buffer. Explicit mode takes huge pages
+ * from hugetlbfs pool and falls back to transparent huge pages if
+ * the pool is empty. The size of mapping is returned by @mapped_size,
+ * because hugetlbfs mapping is rounded up to huge page size.
+ */
+void *mempool_huge_alloc(int mode, size_t size, size_t *mapped_size)
+{
+	size_t page_size;
+	size_t aligned_size;
+	void *addr;
+
+	*mapped_size = 0;
+
+	if (mode == MEMPOOL_HUGE_PAGES_EXPLICIT_MODE) {
+		page_size = mempool_huge_page_size();
+		aligned_size = (size + page_size - 1) & ~(page_size - 1);
+
+		addr = mmap(0, aligned_size, PROT_READ|PROT_WRITE,
+			    MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+		if (addr != MAP_FAILED) {
+			*mapped_size = aligned_size;
+			return addr;
+		}
+
+		MEMPOOL_WARN("fail to allocate explicit huge pages: "
+			     "size %zu, %s, transparent huge pages "
+			     "will be used\n",
+			     aligned_size, strerror(errno));
+	}
+
+	addr = mmap(0, size, PROT_READ|PROT_WRITE,
+		    MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+	if (addr == MAP_FAILED)
+		return NULL;
+
+	*mapped_size = size;
+
+	if (mode != MEMPOOL_HUGE_PAGES_NONE_MODE)
+		mempool_huge_advise(addr, size, "buffer");
+
+	return addr;
+}
+
+/*
+ * Ask the kernel to back the mapping by transparent huge pages.
+ * File mappings get huge pages only if the filesystem supports
+ * large folios, otherwise advice is simply ignored.
+ */
+void mempool_huge_advise(void *addr, size_t len, const char *name)
+{
+	if (!addr || len == 0)
+		return;
+
+	if (madvise(addr, len, MADV_HUGEPAGE)) {
+		MEMPOOL_WARN("transparent huge pages are unavailable: "
+			     "%s, %s\n",
+			     name, strerror(errno));
+	}
+}
+
+/*
+ * Populate the mapping after advice, because pages that have been
+ * faulted before advice keep the base page size.
+ * It returns -EINVAL if the kernel doesn't support population.
+ */
+int mempool_huge_populate(void *addr, size_t len, int write)
+{
+	int advice = write ? MADV_POPULATE_WRITE : MADV_POPULATE_READ;
+
+	if (!addr || len == 0)
+		return 0;
+
+	if (madvise(addr, len, advice))
+		return -errno;
+
+	return 0;
+}
+
+/*
+ * Report page size of the mapping that starts from @addr
+ * and the amount of memory that is mapped by huge pages.
+ */
+void mempool_huge_report(void *addr, const char *name)
+{
+	char line[256];
+	unsigned long start, end;
+	unsigned long kbytes;
+	unsigned long page_size = 0;
+	unsigned long resident = 0;
+	unsigned long huge = 0;
+	int found = MEMPOOL_FALSE;
+	FILE *stream;
+
+	if (!addr)
+		return;
+
+	stream = fopen(MEMPOOL_SMAPS_PATH, "r");
+	if (!stream) {
+		MEMPOOL_WARN("fail to open %s: %s\n",
+			     MEMPOOL_SMAPS_PATH, strerror(errno));
+		return;
+	}
+
+	while (fgets(line, sizeof(line), stream)) {
+		/* fields' names cannot be parsed as address range */
+		if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+			if (found)
+				break;
+
+			/* anonymous mapping can be merged with neighbours */
+			found = start <= (unsigned long)addr &&
+				(unsigned long)addr < end;
+			continue;
+		}
+
+		if (!found)
+			continue;
+
+		if (sscanf(line, "KernelPageSize: %lu kB", &kbytes) == 1)
+			page_size = kbytes;
+		else if (sscanf(line, "Rss: %lu kB", &kbytes) == 1)
+			resident += kbytes;
+		else if (sscanf(line, "AnonHugePages: %lu kB", &kbytes) == 1 ||
+			 sscanf(line, "ShmemPmdMapped: %lu kB", &kbytes) == 1 ||
+			 sscanf(line, "FilePmdMapped: %lu kB", &kbytes) == 1)
+			huge += kbytes;
+		else if (sscanf(line, "Private_Hugetlb: %lu kB", &kbytes) == 1 ||
+			 sscanf(line, "Shared_Hugetlb: %lu kB", &kbytes) == 1) {
+			/* hugetlbfs pages are not accounted in RSS */
+			huge += kbytes;
+			resident += kbytes;
+		}
+	}
+
+	fclose(stream);
+
+	if (!found) {
+		MEMPOOL_WARN("mapping is not found: %s, addr %p\n",
+			     name, addr);
+		return;
+	}
+
+	MEMPOOL_INFO("Huge pages: %s: page size %lu KB, "
+		     "huge %lu KB of resident %lu KB\n",
+		     name, page_size, huge, resident);
+}
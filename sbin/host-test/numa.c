@@ -0,0 +1,330 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/numa.c - NUMA placement of workers and memory.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "host_test.h"
+
+/*
+ * Memory policies of Linux kernel (include/uapi/linux/mempolicy.h).
+ * libnuma is not used, so syscalls are called directly.
+ */
+#define MEMPOOL_MPOL_PREFERRED		(1)
+#define MEMPOOL_MPOL_BIND		(2)
+#define MEMPOOL_MPOL_INTERLEAVE		(3)
+
+/* the kernel takes into account (maxnode - 1) bits of node mask */
+#define MEMPOOL_NUMA_MAXNODE		(MEMPOOL_BITS_PER_LONG + 1)
+
+#define MEMPOOL_NUMA_SYSFS_PATH		"/sys/devices/system/node"
+
+/************************************************************************
+ *                        NUMA topology                                 *
+ ************************************************************************/
+
+static inline
+void mempool_set_cpu(unsigned long *cpus, int cpu)
+{
+	cpus[cpu / MEMPOOL_BITS_PER_LONG] |= 1UL << (cpu % MEMPOOL_BITS_PER_LONG);
+}
+
+static inline
+int mempool_test_cpu(unsigned long *cpus, int cpu)
+{
+	return (cpus[cpu / MEMPOOL_BITS_PER_LONG] >>
+				(cpu % MEMPOOL_BITS_PER_LONG)) & 1;
+}
+
+/*
+ * Parse CPU list of the node (for example, "0-7,16-23").
+ */
+static
+int mempool_numa_parse_cpulist(struct mempool_numa_node *node,
+			       const char *cpulist)
+{
+	const char *p = cpulist;
+	char *end;
+	long first, last;
+	long cpu;
+
+	while (*p != '\0' && *p != '\n') {
+		first = strtol(p, &end, 10);
+		if (end == p)
+			return -EINVAL;
+
+		last = first;
+		p = end;
+
+		if (*p == '-') {
+			p++;
+			last = strtol(p, &end, 10);
+			if (end == p)
+				return -EINVAL;
+			p = end;
+		}
+
+		if (first < 0 || last < first || last >= MEMPOOL_NUMA_MAX_CPUS)
+			return -ERANGE;
+
+		for (cpu = first; cpu <= last; cpu++) {
+			mempool_set_cpu(node->cpus, (int)cpu);
+			node->cpus_count++;
+		}
+
+		if (*p == ',')
+			p++;
+	}
+
+	return 0;
+}
+
+int mempool_numa_init(struct mempool_numa_topology *numa,
+		      int mode, int show_debug)
+{
+	struct mempool_numa_node *node;
+	char path[256];
+	char cpulist[4096];
+	FILE *stream;
+	int i;
+	int err;
+
+	memset(numa, 0, sizeof(struct mempool_numa_topology));
+	numa->mode = mode;
+	numa->show_debug = show_debug;
+
+	for (i = 0; i < MEMPOOL_NUMA_MAX_NODES; i++) {
+		snprintf(path, sizeof(path), "%s/node%d/cpulist",
+			 MEMPOOL_NUMA_SYSFS_PATH, i);
+
+		stream = fopen(path, "r");
+		if (!stream)
+			continue;
+
+		if (!fgets(cpulist, sizeof(cpulist), stream))
+			cpulist[0] = '\0';
+
+		fclose(stream);
+
+		node = &numa->nodes[numa->count];
+		memset(node, 0, sizeof(struct mempool_numa_node));
+		node->id = i;
+
+		err = mempool_numa_parse_cpulist(node, cpulist);
+		if (err) {
+			MEMPOOL_ERR("fail to parse CPU list: "
+				    "node %d, cpulist %s, err %d\n",
+				    i, cpulist, err);
+			return err;
+		}
+
+		/* memory-only nodes cannot run workers */
+		if (node->cpus_count == 0)
+			continue;
+
+		MEMPOOL_DBG(show_debug,
+			    "NUMA node %d: cpus %d\n",
+			    node->id, node->cpus_count);
+
+		numa->count++;
+	}
+
+	if (numa->count == 0) {
+		MEMPOOL_ERR("NUMA topology is unavailable: %s\n",
+			    MEMPOOL_NUMA_SYSFS_PATH);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+/*
+ * Workers are distributed between nodes by contiguous blocks
+ * as portions are distributed between workers. So, contiguous
+ * block of portions is processed by workers of one node.
+ */
+int mempool_numa_worker_node(struct mempool_numa_topology *numa,
+			     int worker_id, int workers)
+{
+	if (numa->count == 0 || workers <= 0)
+		return 0;
+
+	return (int)(((long long)worker_id * numa->count) / workers);
+}
+
+/************************************************************************
+ *                        Placement of workers                          *
+ ************************************************************************/
+
+static inline
+unsigned long mempool_numa_node_mask(struct mempool_numa_topology *numa,
+				     int node)
+{
+	unsigned long mask = 0;
+	int i;
+
+	if (node >= 0)
+		return 1UL << numa->nodes[node].id;
+
+	for (i = 0; i < numa->count; i++)
+		mask |= 1UL << numa->nodes[i].id;
+
+	return mask;
+}
+
+/*
+ * Pin worker to CPUs of its node and define memory policy of worker,
+ * because pages of shared file mappings are allocated on the node
+ * of the thread that first touches them.
+ */
+int mempool_numa_bind_task(struct mempool_worker *worker, void *arg)
+{
+	struct mempool_numa_topology *numa = arg;
+	struct mempool_numa_node *node;
+	unsigned long mask;
+	cpu_set_t cpus;
+	int policy;
+	int cpu;
+	int err;
+
+	node = &numa->nodes[worker->node];
+
+	CPU_ZERO(&cpus);
+
+	for (cpu = 0; cpu < MEMPOOL_NUMA_MAX_CPUS; cpu++) {
+		if (mempool_test_cpu(node->cpus, cpu))
+			CPU_SET(cpu, &cpus);
+	}
+
+	err = syscall(SYS_sched_setaffinity, 0, sizeof(cpu_set_t), &cpus);
+	if (err) {
+		err = -errno;
+		MEMPOOL_ERR("fail to pin worker: "
+			    "worker %d, node %d, %s\n",
+			    worker->id, node->id, strerror(-err));
+		return err;
+	}
+
+	if (numa->mode == MEMPOOL_NUMA_INTERLEAVE_MODE) {
+		policy = MEMPOOL_MPOL_INTERLEAVE;
+		mask = mempool_numa_node_mask(numa, -1);
+	} else {
+		/* preferred policy falls back to other nodes on shortage */
+		policy = MEMPOOL_MPOL_PREFERRED;
+		mask = mempool_numa_node_mask(numa, worker->node);
+	}
+
+	err = syscall(SYS_set_mempolicy, policy, &mask,
+		      MEMPOOL_NUMA_MAXNODE);
+	if (err) {
+		err = -errno;
+		MEMPOOL_ERR("fail to set memory policy: "
+			    "worker %d, node %d, %s\n",
+			    worker->id, node->id, strerror(-err));
+		return err;
+	}
+
+	MEMPOOL_DBG(numa->show_debug,
+		    "worker %d has been pinned: node %d, cpus %d\n",
+		    worker->id, node->id, node->cpus_count);
+
+	return 0;
+}
+
+/*
+ * Bind anonymous memory to @node or interleave it between all nodes
+ * (@node < 0). The kernel ignores policy of shared file mappings,
+ * their pages are placed by first touch of pinned workers.
+ */
+int mempool_numa_mbind(struct mempool_numa_topology *numa,
+		       void *addr, size_t len, int node)
+{
+	unsigned long start;
+	unsigned long end;
+	unsigned long mask;
+	int policy;
+	int err;
+
+	if (len == 0)
+		return 0;
+
+	start = (unsigned long)addr & ~((unsigned long)MEMPOOL_PAGE_SIZE - 1);
+	end = (unsigned long)addr + len;
+
+	if (node < 0) {
+		policy = MEMPOOL_MPOL_INTERLEAVE;
+		mask = mempool_numa_node_mask(numa, -1);
+	} else {
+		policy = MEMPOOL_MPOL_BIND;
+		mask = mempool_numa_node_mask(numa, node);
+	}
+
+	err = syscall(SYS_mbind, start, end - start, policy,
+		      &mask, MEMPOOL_NUMA_MAXNODE, 0);
+	if (err) {
+		err = -errno;
+		MEMPOOL_ERR("fail to bind memory: "
+			    "addr %p, len %zu, node %d, %s\n",
+			    addr, len, node, strerror(-err));
+		return err;
+	}
+
+	return 0;
+}
+
+/*
+ * Report bandwidth of every node: input bytes processed by
+ * the node's workers during @seconds.
+ */
+void mempool_numa_report(struct mempool_numa_topology *numa,
+			 struct mempool_scheduler *sched,
+			 double seconds)
+{
+	unsigned long long bytes;
+	double bandwidth;
+	int workers;
+	int i, j;
+
+	for (i = 0; i < numa->count; i++) {
+		bytes = 0;
+		workers = 0;
+
+		for (j = 0; j < sched->count; j++) {
+			if (sched->workers[j].node != i)
+				continue;
+
+			bytes += sched->workers[j].bytes;
+			workers++;
+		}
+
+		bandwidth = 0;
+		if (seconds > 0)
+			bandwidth = (double)bytes / seconds / (1024 * 1024);
+
+		MEMPOOL_INFO("NUMA node %d: workers %d, bytes %llu, "
+			     "bandwidth %.1f MB/s\n",
+			     numa->nodes[i].id, workers, bytes, bandwidth);
+	}
+}
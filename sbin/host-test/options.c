@@ -36,12 +36,32 @@ void print_usage(void)
 	HOST_TEST_INFO(MEMPOOL_TRUE, "host test tool\n\n");
 	MEMPOOL_INFO("Usage: host-test  <options>\n");
 	MEMPOOL_INFO("Options:\n");
+	MEMPOOL_INFO("\t [-C|--checksum]\t\t  calculate crc32c of output "
+		     "portions and write manifest.\n");
 	MEMPOOL_INFO("\t [-d|--debug]\t\t  show debug output.\n");
 	MEMPOOL_INFO("\t [-h|--help]\t\t  display help message and exit.\n");
 	MEMPOOL_INFO("\t [-i|--input-file]\t\t  define input file.\n");
 	MEMPOOL_INFO("\t [-o|--output-file]\t\t  define output file.\n");
 	MEMPOOL_INFO("\t [-t|--thread number=value, "
-		     "portion-size=value]\t\t  define threads.\n");
+		     "portion-size=value]\t\t  define portions.\n");
+	MEMPOOL_INFO("\t [-w|--workers number=value]\t\t  "
+		     "define number of worker threads.\n");
+	MEMPOOL_INFO("\t [-N|--numa mode=[none|bind|interleave]]\t\t  "
+		     "define placement of workers and memory.\n");
+	MEMPOOL_INFO("\t [-m|--map-mode]\t\t  define mapping of files "
+		     "[populate|lazy|prefault].\n");
+	MEMPOOL_INFO("\t [-H|--huge-pages]\t\t  define huge pages "
+		     "[none|transparent|explicit].\n");
+	MEMPOOL_INFO("\t [-s|--stream budget=value,backend=[pread|uring],"
+		     "depth=value,direct]\t\t  "
+		     "stream portions through buffers of "
+		     "budget size in bytes.\n");
+	MEMPOOL_INFO("\t [-e|--encoding]\t\t  define encoding of output "
+		     "portions [plain|for|delta|rle|auto].\n");
+	MEMPOOL_INFO("\t [-L|--layout]\t\t  define layout of output "
+		     "portions [row|pax].\n");
+	MEMPOOL_INFO("\t [-f|--format]\t\t  define format of output file "
+		     "[raw|container].\n");
 	MEMPOOL_INFO("\t [-I|--item granularity=value]\t\t  "
 		     "define item size in bytes.\n");
 	MEMPOOL_INFO("\t [-r|--record capacity=value]\t\t  "
@@ -52,8 +72,12 @@ void print_usage(void)
 	MEMPOOL_INFO("\t [-v|--value mask=value]\t\t  define value.\n");
 	MEMPOOL_INFO("\t [-c|--condition min=value,max=value]\t\t  "
 		     "define condition.\n");
+	MEMPOOL_INFO("\t [-l|--limit count=value,order=[asc|desc]]\t\t  "
+		     "define number of records in TOPK result.\n");
+	MEMPOOL_INFO("\t [-u|--distinct output=[key|first|count]]\t\t  "
+		     "define output of DISTINCT algorithm.\n");
 	MEMPOOL_INFO("\t [-a|--algorithm]\t\t  define algorithm "
-		     "[KEY-VALUE|SORT|SELECT|TOTAL].\n");
+		     "[KEY-VALUE|SORT|SELECT|TOTAL|TOPK|DISTINCT|CONVERT].\n");
 	MEMPOOL_INFO("\t [-V|--version]\t\t  print version and exit.\n");
 }
 
@@ -63,21 +87,32 @@ void parse_options(int argc, char *argv[],
 	int c;
 	int oi = 1;
 	char *p;
-	char sopts[] = "a:c:dhi:I:o:p:k:r:t:v:V";
+	char sopts[] = "a:Cc:de:f:hH:i:I:l:L:m:N:o:p:k:r:s:t:u:v:Vw:";
 	static const struct option lopts[] = {
 		{"algorithm", 1, NULL, 'a'},
+		{"checksum", 0, NULL, 'C'},
 		{"condition", 1, NULL, 'c'},
 		{"debug", 0, NULL, 'd'},
+		{"encoding", 1, NULL, 'e'},
+		{"format", 1, NULL, 'f'},
 		{"help", 0, NULL, 'h'},
 		{"input-file", 1, NULL, 'i'},
 		{"item", 1, NULL, 'I'},
+		{"limit", 1, NULL, 'l'},
+		{"layout", 1, NULL, 'L'},
+		{"map-mode", 1, NULL, 'm'},
+		{"huge-pages", 1, NULL, 'H'},
+		{"stream", 1, NULL, 's'},
+		{"numa", 1, NULL, 'N'},
 		{"output-file", 1, NULL, 'o'},
 		{"portion", 1, NULL, 'p'},
 		{"key", 1, NULL, 'k'},
 		{"record", 1, NULL, 'r'},
 		{"thread", 1, NULL, 't'},
+		{"distinct", 1, NULL, 'u'},
 		{"value", 1, NULL, 'v'},
 		{"version", 0, NULL, 'V'},
+		{"workers", 1, NULL, 'w'},
 		{ }
 	};
 	enum {
@@ -119,6 +154,33 @@ void parse_options(int argc, char *argv[],
 		[THREAD_PORTION_SIZE_OPT]	= "portion-size",
 		NULL
 	};
+	enum {
+		WORKERS_COUNT_OPT = 0,
+	};
+	char *const workers_tokens[] = {
+		[WORKERS_COUNT_OPT]		= "number",
+		NULL
+	};
+	enum {
+		NUMA_MODE_OPT = 0,
+	};
+	char *const numa_tokens[] = {
+		[NUMA_MODE_OPT]			= "mode",
+		NULL
+	};
+	enum {
+		STREAM_BUDGET_OPT = 0,
+		STREAM_BACKEND_OPT,
+		STREAM_DEPTH_OPT,
+		STREAM_DIRECT_OPT,
+	};
+	char *const stream_tokens[] = {
+		[STREAM_BUDGET_OPT]		= "budget",
+		[STREAM_BACKEND_OPT]		= "backend",
+		[STREAM_DEPTH_OPT]		= "depth",
+		[STREAM_DIRECT_OPT]		= "direct",
+		NULL
+	};
 	enum {
 		VALUE_MASK_OPT = 0,
 	};
@@ -135,9 +197,28 @@ void parse_options(int argc, char *argv[],
 		[CONDITION_MAX_OPT]		= "max",
 		NULL
 	};
+	enum {
+		LIMIT_COUNT_OPT = 0,
+		LIMIT_ORDER_OPT,
+	};
+	char *const limit_tokens[] = {
+		[LIMIT_COUNT_OPT]		= "count",
+		[LIMIT_ORDER_OPT]		= "order",
+		NULL
+	};
+	enum {
+		DISTINCT_OUTPUT_OPT = 0,
+	};
+	char *const distinct_tokens[] = {
+		[DISTINCT_OUTPUT_OPT]		= "output",
+		NULL
+	};
 
 	while ((c = getopt_long(argc, argv, sopts, lopts, &oi)) != EOF) {
 		switch (c) {
+		case 'C':
+			env->checksum.enabled = MEMPOOL_TRUE;
+			break;
 		case 'd':
 			env->show_debug = MEMPOOL_TRUE;
 			break;
@@ -170,7 +251,7 @@ void parse_options(int argc, char *argv[],
 					env->threads.count = atoi(value);
 					break;
 				case THREAD_PORTION_SIZE_OPT:
-					env->threads.portion_size = atoi(value);
+					env->threads.portion_size = atoll(value);
 					break;
 				default:
 					MEMPOOL_ERR("invalid threads option\n");
@@ -179,6 +260,27 @@ void parse_options(int argc, char *argv[],
 				};
 			};
 			break;
+		case 'w':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, workers_tokens, &value)) {
+				case WORKERS_COUNT_OPT:
+					env->workers.count = atoi(value);
+					if (env->workers.count <= 0) {
+						MEMPOOL_ERR("invalid number of workers\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				default:
+					MEMPOOL_ERR("invalid workers option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
 		case 'I':
 			p = optarg;
 			while (*p != '\0') {
@@ -272,12 +374,54 @@ void parse_options(int argc, char *argv[],
 		case 'a':
 			env->algorithm.id = convert_string2algorithm(optarg);
 			if (env->algorithm.id < MEMPOOL_KEY_VALUE_ALGORITHM ||
-			    env->algorithm.id > MEMPOOL_TOTAL_ALGORITHM) {
+			    env->algorithm.id > MEMPOOL_CONVERT_ALGORITHM) {
 				MEMPOOL_ERR("invalid algorithm\n");
 				print_usage();
 				exit(EXIT_SUCCESS);
 			}
 			break;
+		case 'm':
+			env->map.mode = convert_string2map_mode(optarg);
+			if (env->map.mode == MEMPOOL_UNKNOWN_MAP_MODE) {
+				MEMPOOL_ERR("invalid map mode\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'e':
+			env->encoding.output = convert_string2encoding(optarg);
+			if (env->encoding.output == MEMPOOL_UNKNOWN_ENCODING) {
+				MEMPOOL_ERR("invalid encoding\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'L':
+			env->layout.output = convert_string2layout(optarg);
+			if (env->layout.output == MEMPOOL_UNKNOWN_LAYOUT) {
+				MEMPOOL_ERR("invalid layout\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'f':
+			env->format.output = convert_string2format(optarg);
+			if (env->format.output == MEMPOOL_UNKNOWN_FORMAT) {
+				MEMPOOL_ERR("invalid format\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'H':
+			env->huge_pages.mode =
+				convert_string2huge_pages_mode(optarg);
+			if (env->huge_pages.mode ==
+					MEMPOOL_UNKNOWN_HUGE_PAGES_MODE) {
+				MEMPOOL_ERR("invalid huge pages mode\n");
+				print_usage();
+				exit(EXIT_FAILURE);
+			}
+			break;
 		case 'c':
 			p = optarg;
 			while (*p != '\0') {
@@ -297,6 +441,121 @@ void parse_options(int argc, char *argv[],
 				};
 			};
 			break;
+		case 'l':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, limit_tokens, &value)) {
+				case LIMIT_COUNT_OPT:
+					env->limit.count = atoi(value);
+					break;
+				case LIMIT_ORDER_OPT:
+					env->limit.order = convert_string2order(value);
+					if (env->limit.order == MEMPOOL_UNKNOWN_ORDER) {
+						MEMPOOL_ERR("invalid order\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				default:
+					MEMPOOL_ERR("invalid limit option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'u':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+				int output;
+
+				switch (getsubopt(&p, distinct_tokens, &value)) {
+				case DISTINCT_OUTPUT_OPT:
+					output = convert_string2distinct_output(value);
+					if (output == MEMPOOL_UNKNOWN_DISTINCT_OUTPUT) {
+						MEMPOOL_ERR("invalid distinct output\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					env->distinct.output = output;
+					break;
+				default:
+					MEMPOOL_ERR("invalid distinct option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 'N':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+				int mode;
+
+				switch (getsubopt(&p, numa_tokens, &value)) {
+				case NUMA_MODE_OPT:
+					mode = convert_string2numa_mode(value);
+					if (mode == MEMPOOL_UNKNOWN_NUMA_MODE) {
+						MEMPOOL_ERR("invalid NUMA mode\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					env->numa.mode = mode;
+					break;
+				default:
+					MEMPOOL_ERR("invalid NUMA option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
+		case 's':
+			p = optarg;
+			while (*p != '\0') {
+				char *value;
+
+				switch (getsubopt(&p, stream_tokens, &value)) {
+				case STREAM_BUDGET_OPT:
+					if (!value) {
+						MEMPOOL_ERR("invalid budget\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					env->stream.budget = atoll(value);
+					break;
+				case STREAM_BACKEND_OPT:
+					if (value) {
+						env->stream.backend =
+						    convert_string2io_backend(value);
+					}
+					if (!value || env->stream.backend ==
+						MEMPOOL_UNKNOWN_IO_BACKEND) {
+						MEMPOOL_ERR("invalid I/O backend\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case STREAM_DEPTH_OPT:
+					if (value)
+						env->stream.depth = atoi(value);
+					if (!value || env->stream.depth <= 0) {
+						MEMPOOL_ERR("invalid I/O depth\n");
+						print_usage();
+						exit(EXIT_FAILURE);
+					}
+					break;
+				case STREAM_DIRECT_OPT:
+					env->stream.direct = MEMPOOL_TRUE;
+					break;
+				default:
+					MEMPOOL_ERR("invalid stream option\n");
+					print_usage();
+					exit(EXIT_FAILURE);
+				};
+			};
+			break;
 		case 'V':
 			print_version();
 			exit(EXIT_SUCCESS);
@@ -0,0 +1,483 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/scheduler.c - work-stealing scheduler of tasks.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#include <sys/types.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "host_test.h"
+
+#define MEMPOOL_DEQUE_INITIAL_CAPACITY	(64)
+
+/************************************************************************
+ *                        Deque of tasks                                *
+ ************************************************************************/
+
+static
+int mempool_deque_init(struct mempool_task_deque *deque)
+{
+	pthread_mutex_init(&deque->lock, NULL);
+
+	deque->head = 0;
+	deque->tail = 0;
+	deque->capacity = MEMPOOL_DEQUE_INITIAL_CAPACITY;
+
+	deque->tasks = calloc(deque->capacity, sizeof(struct mempool_task));
+	if (!deque->tasks) {
+		MEMPOOL_ERR("fail to allocate deque: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static
+void mempool_deque_destroy(struct mempool_task_deque *deque)
+{
+	if (deque->tasks)
+		free(deque->tasks);
+
+	deque->tasks = NULL;
+	pthread_mutex_destroy(&deque->lock);
+}
+
+/*
+ * Tasks are kept in ring buffer: owner pushes and pops tasks
+ * at the tail (LIFO), thieves steal tasks from the head (FIFO).
+ */
+static
+int mempool_deque_push(struct mempool_task_deque *deque,
+			struct mempool_task *task)
+{
+	struct mempool_task *tasks;
+	unsigned long count;
+	unsigned long i;
+	int err = 0;
+
+	pthread_mutex_lock(&deque->lock);
+
+	count = deque->tail - deque->head;
+
+	if (count >= deque->capacity) {
+		tasks = calloc(deque->capacity * 2,
+				sizeof(struct mempool_task));
+		if (!tasks) {
+			err = -ENOMEM;
+			MEMPOOL_ERR("fail to grow deque: %s\n",
+				    strerror(errno));
+			goto finish_deque_push;
+		}
+
+		for (i = 0; i < count; i++) {
+			tasks[i] = deque->tasks[(deque->head + i) %
+							deque->capacity];
+		}
+
+		free(deque->tasks);
+		deque->tasks = tasks;
+		deque->capacity *= 2;
+		deque->head = 0;
+		deque->tail = count;
+	}
+
+	deque->tasks[deque->tail % deque->capacity] = *task;
+	deque->tail++;
+
+finish_deque_push:
+	pthread_mutex_unlock(&deque->lock);
+
+	return err;
+}
+
+static
+int mempool_deque_empty(struct mempool_task_deque *deque)
+{
+	int empty;
+
+	pthread_mutex_lock(&deque->lock);
+	empty = deque->tail == deque->head;
+	pthread_mutex_unlock(&deque->lock);
+
+	return empty;
+}
+
+static
+int mempool_deque_pop(struct mempool_task_deque *deque,
+		      struct mempool_task *task)
+{
+	int found = MEMPOOL_FALSE;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->tail > deque->head) {
+		deque->tail--;
+		*task = deque->tasks[deque->tail % deque->capacity];
+		found = MEMPOOL_TRUE;
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return found;
+}
+
+static
+int mempool_deque_steal(struct mempool_task_deque *deque,
+			struct mempool_task *task)
+{
+	int found = MEMPOOL_FALSE;
+
+	pthread_mutex_lock(&deque->lock);
+
+	if (deque->tail > deque->head) {
+		*task = deque->tasks[deque->head % deque->capacity];
+		deque->head++;
+		found = MEMPOOL_TRUE;
+	}
+
+	pthread_mutex_unlock(&deque->lock);
+
+	return found;
+}
+
+/************************************************************************
+ *                        Workers' logic                                *
+ ************************************************************************/
+
+static
+int mempool_worker_take_task(struct mempool_worker *worker,
+			     struct mempool_task *task)
+{
+	struct mempool_scheduler *sched = worker->scheduler;
+	struct mempool_worker *victim;
+	int i;
+
+	if (mempool_deque_pop(&worker->pinned, task))
+		return MEMPOOL_TRUE;
+
+	if (mempool_deque_pop(&worker->deque, task))
+		return MEMPOOL_TRUE;
+
+	/* thieves never look into deques of pinned tasks */
+	for (i = 1; i < sched->count; i++) {
+		victim = &sched->workers[(worker->id + i) % sched->count];
+
+		if (mempool_deque_steal(&victim->deque, task)) {
+			worker->stolen++;
+			return MEMPOOL_TRUE;
+		}
+	}
+
+	return MEMPOOL_FALSE;
+}
+
+static
+void *mempool_worker_thread(void *arg)
+{
+	struct mempool_worker *worker = (struct mempool_worker *)arg;
+	struct mempool_scheduler *sched = worker->scheduler;
+	struct mempool_task task;
+	int err;
+
+	while (MEMPOOL_TRUE) {
+		if (mempool_worker_take_task(worker, &task)) {
+			if (!task.pinned) {
+				pthread_mutex_lock(&sched->lock);
+				sched->stealable--;
+				pthread_mutex_unlock(&sched->lock);
+			}
+
+			err = task.func(worker, task.arg);
+
+			worker->executed++;
+
+			pthread_mutex_lock(&sched->lock);
+			if (err && !sched->err)
+				sched->err = err;
+			sched->pending--;
+			if (sched->pending == 0)
+				pthread_cond_broadcast(&sched->idle);
+			pthread_mutex_unlock(&sched->lock);
+
+			continue;
+		}
+
+		pthread_mutex_lock(&sched->lock);
+
+		if (sched->shutdown) {
+			pthread_mutex_unlock(&sched->lock);
+			break;
+		}
+
+		/* task can be pushed between steal attempt and lock */
+		if (sched->stealable == 0 &&
+		    mempool_deque_empty(&worker->pinned) &&
+		    mempool_deque_empty(&worker->deque))
+			pthread_cond_wait(&sched->wakeup, &sched->lock);
+
+		pthread_mutex_unlock(&sched->lock);
+	}
+
+	MEMPOOL_DBG(sched->show_debug,
+		    "worker %d has been finished: "
+		    "executed %llu, stolen %llu\n",
+		    worker->id, worker->executed, worker->stolen);
+
+	pthread_exit((void *)0);
+}
+
+/*
+ * Scratch buffer of worker is reused by all tasks that worker executes.
+ * The buffer grows on demand and it is never shrunk.
+ */
+void *mempool_worker_scratch(struct mempool_worker *worker, size_t size)
+{
+	void *buf;
+
+	if (size <= worker->buf_size)
+		return worker->buf;
+
+	buf = realloc(worker->buf, size);
+	if (!buf) {
+		MEMPOOL_ERR("fail to allocate scratch buffer: "
+			    "worker %d, size %zu, %s\n",
+			    worker->id, size, strerror(errno));
+		return NULL;
+	}
+
+	worker->buf = buf;
+	worker->buf_size = size;
+
+	return worker->buf;
+}
+
+/************************************************************************
+ *                        Scheduler's logic                             *
+ ************************************************************************/
+
+int mempool_scheduler_init(struct mempool_scheduler *sched,
+			   int count, int show_debug)
+{
+	struct mempool_worker *worker;
+	int i;
+	int err;
+
+	memset(sched, 0, sizeof(struct mempool_scheduler));
+
+	if (count <= 0) {
+		MEMPOOL_ERR("invalid number of workers %d\n", count);
+		return -EINVAL;
+	}
+
+	pthread_mutex_init(&sched->lock, NULL);
+	pthread_cond_init(&sched->wakeup, NULL);
+	pthread_cond_init(&sched->idle, NULL);
+	sched->show_debug = show_debug;
+
+	sched->workers = calloc(count, sizeof(struct mempool_worker));
+	if (!sched->workers) {
+		MEMPOOL_ERR("fail to allocate workers: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	sched->count = count;
+
+	for (i = 0; i < count; i++) {
+		worker = &sched->workers[i];
+
+		worker->id = i;
+		worker->scheduler = sched;
+
+		err = mempool_deque_init(&worker->deque);
+		if (err)
+			goto destroy_scheduler;
+
+		err = mempool_deque_init(&worker->pinned);
+		if (err)
+			goto destroy_scheduler;
+	}
+
+	for (i = 0; i < count; i++) {
+		worker = &sched->workers[i];
+
+		err = pthread_create(&worker->thread, NULL,
+				     mempool_worker_thread, (void *)worker);
+		if (err) {
+			err = -err;
+			MEMPOOL_ERR("fail to create worker %d: %s\n",
+				    i, strerror(-err));
+			goto destroy_scheduler;
+		}
+
+		sched->started++;
+	}
+
+	MEMPOOL_DBG(show_debug,
+		    "scheduler has been started: workers %d\n",
+		    sched->count);
+
+	return 0;
+
+destroy_scheduler:
+	mempool_scheduler_destroy(sched);
+	return err;
+}
+
+void mempool_scheduler_destroy(struct mempool_scheduler *sched)
+{
+	void *res;
+	int i;
+
+	if (!sched->workers)
+		return;
+
+	pthread_mutex_lock(&sched->lock);
+	sched->shutdown = MEMPOOL_TRUE;
+	pthread_cond_broadcast(&sched->wakeup);
+	pthread_mutex_unlock(&sched->lock);
+
+	for (i = 0; i < sched->started; i++)
+		pthread_join(sched->workers[i].thread, &res);
+
+	for (i = 0; i < sched->count; i++) {
+		if (sched->workers[i].deque.tasks)
+			mempool_deque_destroy(&sched->workers[i].deque);
+
+		if (sched->workers[i].pinned.tasks)
+			mempool_deque_destroy(&sched->workers[i].pinned);
+
+		if (sched->workers[i].buf)
+			free(sched->workers[i].buf);
+	}
+
+	free(sched->workers);
+	sched->workers = NULL;
+	sched->count = 0;
+	sched->started = 0;
+
+	pthread_cond_destroy(&sched->wakeup);
+	pthread_cond_destroy(&sched->idle);
+	pthread_mutex_destroy(&sched->lock);
+}
+
+static
+int __mempool_scheduler_push(struct mempool_scheduler *sched,
+			     struct mempool_worker *worker,
+			     mempool_task_func func, void *arg,
+			     int pinned)
+{
+	struct mempool_task task = {
+		.func = func,
+		.arg = arg,
+		.pinned = pinned,
+	};
+	int err;
+
+	pthread_mutex_lock(&sched->lock);
+
+	err = mempool_deque_push(pinned ? &worker->pinned : &worker->deque,
+				 &task);
+	if (!err) {
+		sched->pending++;
+
+		if (pinned) {
+			/* only the owner can execute the task */
+			pthread_cond_broadcast(&sched->wakeup);
+		} else {
+			sched->stealable++;
+			pthread_cond_signal(&sched->wakeup);
+		}
+	}
+
+	pthread_mutex_unlock(&sched->lock);
+
+	return err;
+}
+
+/*
+ * Submit task into deque of worker with @worker_id (modulo number
+ * of workers). Idle workers will steal the task if the owner is busy.
+ */
+int mempool_scheduler_submit(struct mempool_scheduler *sched,
+			     int worker_id,
+			     mempool_task_func func, void *arg)
+{
+	struct mempool_worker *worker;
+
+	if (sched->count <= 0)
+		return -EINVAL;
+
+	worker = &sched->workers[worker_id % sched->count];
+
+	return __mempool_scheduler_push(sched, worker, func, arg,
+					MEMPOOL_FALSE);
+}
+
+/*
+ * Submit task that has to be executed by worker with @worker_id
+ * (modulo number of workers) only, for example, to first-touch
+ * memory on the worker's NUMA node.
+ */
+int mempool_scheduler_submit_pinned(struct mempool_scheduler *sched,
+				    int worker_id,
+				    mempool_task_func func, void *arg)
+{
+	struct mempool_worker *worker;
+
+	if (sched->count <= 0)
+		return -EINVAL;
+
+	worker = &sched->workers[worker_id % sched->count];
+
+	return __mempool_scheduler_push(sched, worker, func, arg,
+					MEMPOOL_TRUE);
+}
+
+/*
+ * Spawn new task from the task that is executed by @worker.
+ */
+int mempool_scheduler_spawn(struct mempool_worker *worker,
+			    mempool_task_func func, void *arg)
+{
+	return __mempool_scheduler_push(worker->scheduler, worker, func, arg,
+					MEMPOOL_FALSE);
+}
+
+/*
+ * Wait the end of all submitted (and spawned) tasks.
+ * It returns the first error of tasks.
+ */
+int mempool_scheduler_wait(struct mempool_scheduler *sched)
+{
+	int err;
+
+	pthread_mutex_lock(&sched->lock);
+
+	while (sched->pending > 0)
+		pthread_cond_wait(&sched->idle, &sched->lock);
+
+	err = sched->err;
+	sched->err = 0;
+
+	pthread_mutex_unlock(&sched->lock);
+
+	return err;
+}
@@ -0,0 +1,553 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/stream.c - streaming of portions through ring of buffers.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "host_test.h"
+
+/************************************************************************
+ *                        pread/pwrite backend                          *
+ ************************************************************************/
+
+static
+int mempool_pread_full(int fd, void *buf, size_t len, off_t offset)
+{
+	size_t done = 0;
+	ssize_t res;
+
+	while (done < len) {
+		res = pread(fd, (char *)buf + done, len - done,
+			    offset + (off_t)done);
+		if (res < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		} else if (res == 0) {
+			/* input file is shorter than geometry */
+			return -ENODATA;
+		}
+
+		done += (size_t)res;
+	}
+
+	return 0;
+}
+
+static
+int mempool_pwrite_full(int fd, const void *buf, size_t len, off_t offset)
+{
+	size_t done = 0;
+	ssize_t res;
+
+	while (done < len) {
+		res = pwrite(fd, (const char *)buf + done, len - done,
+			     offset + (off_t)done);
+		if (res < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+
+		done += (size_t)res;
+	}
+
+	return 0;
+}
+
+static
+int mempool_pread_chunk(struct mempool_stream *stream,
+			struct mempool_stream_buffer *buf)
+{
+	off_t offset = stream->input_offset +
+				(off_t)buf->first * stream->stride;
+
+	return mempool_pread_full(stream->input_fd, buf->input,
+				  buf->bytes, offset);
+}
+
+static
+int mempool_pwrite_chunk(struct mempool_stream *stream,
+			 struct mempool_stream_buffer *buf)
+{
+	off_t offset = stream->output_offset +
+				(off_t)buf->first * stream->stride;
+
+	return mempool_pwrite_full(stream->output_fd, buf->output,
+				   buf->bytes, offset);
+}
+
+static const struct mempool_io_operations mempool_pread_operations = {
+	.name = "pread",
+	.read = mempool_pread_chunk,
+	.write = mempool_pwrite_chunk,
+};
+
+/************************************************************************
+ *                        Reader and writer                             *
+ ************************************************************************/
+
+static
+void mempool_stream_fail(struct mempool_stream *stream, int err)
+{
+	pthread_mutex_lock(&stream->lock);
+	if (!stream->err)
+		stream->err = err;
+	pthread_cond_broadcast(&stream->changed);
+	pthread_mutex_unlock(&stream->lock);
+}
+
+/*
+ * Reader loads chunks in order into free buffers of the ring.
+ */
+static
+void *mempool_stream_reader(void *arg)
+{
+	struct mempool_stream *stream = (struct mempool_stream *)arg;
+	struct mempool_test_environment *env = stream->env;
+	struct mempool_stream_buffer *buf;
+	int chunk;
+	int err;
+
+	for (chunk = 0; chunk < stream->chunks_count; chunk++) {
+		buf = &stream->buffers[chunk % MEMPOOL_STREAM_BUFFERS];
+
+		pthread_mutex_lock(&stream->lock);
+		while (buf->state != MEMPOOL_STREAM_BUFFER_FREE &&
+		       !stream->shutdown && !stream->err) {
+			pthread_cond_wait(&stream->changed, &stream->lock);
+		}
+
+		if (stream->shutdown || stream->err) {
+			pthread_mutex_unlock(&stream->lock);
+			break;
+		}
+		pthread_mutex_unlock(&stream->lock);
+
+		buf->chunk = chunk;
+		buf->first = chunk * stream->chunk_portions;
+		buf->portions = env->threads.count - buf->first;
+		if (buf->portions > stream->chunk_portions)
+			buf->portions = stream->chunk_portions;
+		buf->bytes = (size_t)buf->portions * stream->stride;
+
+		err = stream->ops->read(stream, buf);
+		if (err) {
+			MEMPOOL_ERR("fail to read chunk: "
+				    "chunk %d, first portion %d, %s\n",
+				    chunk, buf->first, strerror(-err));
+			mempool_stream_fail(stream, err);
+			break;
+		}
+
+		pthread_mutex_lock(&stream->lock);
+		buf->state = MEMPOOL_STREAM_BUFFER_LOADED;
+		stream->read_bytes += buf->bytes;
+		pthread_cond_broadcast(&stream->changed);
+		pthread_mutex_unlock(&stream->lock);
+	}
+
+	pthread_exit((void *)0);
+}
+
+/*
+ * Writer stores processed chunks in order and frees their buffers.
+ * Processed chunks are stored even if the stream is shut down.
+ */
+static
+void *mempool_stream_writer(void *arg)
+{
+	struct mempool_stream *stream = (struct mempool_stream *)arg;
+	struct mempool_stream_buffer *buf;
+	int chunk;
+	int err;
+
+	for (chunk = 0; chunk < stream->chunks_count; chunk++) {
+		buf = &stream->buffers[chunk % MEMPOOL_STREAM_BUFFERS];
+
+		pthread_mutex_lock(&stream->lock);
+		while (buf->state != MEMPOOL_STREAM_BUFFER_PROCESSED ||
+		       buf->chunk != chunk) {
+			if (stream->shutdown || stream->err)
+				break;
+
+			pthread_cond_wait(&stream->changed, &stream->lock);
+		}
+
+		if (buf->state != MEMPOOL_STREAM_BUFFER_PROCESSED ||
+		    buf->chunk != chunk) {
+			pthread_mutex_unlock(&stream->lock);
+			break;
+		}
+		pthread_mutex_unlock(&stream->lock);
+
+		err = stream->ops->write(stream, buf);
+		if (err) {
+			MEMPOOL_ERR("fail to write chunk: "
+				    "chunk %d, first portion %d, %s\n",
+				    chunk, buf->first, strerror(-err));
+			mempool_stream_fail(stream, err);
+			break;
+		}
+
+		pthread_mutex_lock(&stream->lock);
+		buf->state = MEMPOOL_STREAM_BUFFER_FREE;
+		stream->written_bytes += buf->bytes;
+		pthread_cond_broadcast(&stream->changed);
+		pthread_mutex_unlock(&stream->lock);
+	}
+
+	pthread_exit((void *)0);
+}
+
+/************************************************************************
+ *                        Stream's logic                                *
+ ************************************************************************/
+
+/*
+ * O_DIRECT requires aligned buffers, offsets and lengths. Buffers
+ * are page-aligned and chunks consist of whole portions, so portion
+ * has to be aligned too. Buffered I/O is used if the file system
+ * doesn't support O_DIRECT.
+ */
+static
+void mempool_stream_open_direct(struct mempool_stream *stream)
+{
+	struct mempool_test_environment *env = stream->env;
+	int input_fd;
+	int output_fd;
+
+	if (stream->stride % MEMPOOL_PAGE_SIZE ||
+	    stream->input_offset % MEMPOOL_PAGE_SIZE ||
+	    stream->output_offset % MEMPOOL_PAGE_SIZE) {
+		MEMPOOL_WARN("O_DIRECT requires portion aligned on %d bytes: "
+			     "stride %zu, buffered I/O will be used\n",
+			     MEMPOOL_PAGE_SIZE, stream->stride);
+		return;
+	}
+
+	input_fd = open(env->input_file.name, O_RDONLY | O_DIRECT);
+	if (input_fd == -1) {
+		MEMPOOL_WARN("fail to open input file with O_DIRECT: %s, "
+			     "buffered I/O will be used\n",
+			     strerror(errno));
+		return;
+	}
+
+	output_fd = open(env->output_file.name, O_WRONLY | O_DIRECT);
+	if (output_fd == -1) {
+		MEMPOOL_WARN("fail to open output file with O_DIRECT: %s, "
+			     "buffered I/O will be used\n",
+			     strerror(errno));
+		close(input_fd);
+		return;
+	}
+
+	stream->input_fd = input_fd;
+	stream->output_fd = output_fd;
+	stream->direct = MEMPOOL_TRUE;
+}
+
+/*
+ * Every buffer of the ring keeps input and output of the chunk,
+ * so chunk is as big as the memory budget allows. Portions are
+ * placed by @stride in files and buffers, because payloads of
+ * container are aligned.
+ */
+int mempool_stream_init(struct mempool_stream *stream,
+			struct mempool_test_environment *env,
+			off_t input_offset, off_t output_offset,
+			size_t stride)
+{
+	struct mempool_stream_buffer *buf;
+	long long min_budget;
+	long long chunk_portions;
+	int i;
+	int err;
+
+	memset(stream, 0, sizeof(struct mempool_stream));
+	pthread_mutex_init(&stream->lock, NULL);
+	pthread_cond_init(&stream->changed, NULL);
+
+	stream->env = env;
+	stream->ops = &mempool_pread_operations;
+	stream->input_fd = env->input_file.fd;
+	stream->output_fd = env->output_file.fd;
+	stream->stride = stride;
+	stream->input_offset = input_offset;
+	stream->output_offset = output_offset;
+
+	min_budget = (long long)stride * 2 * MEMPOOL_STREAM_BUFFERS;
+
+	if (env->threads.portion_size <= 0 ||
+	    env->stream.budget < min_budget) {
+		MEMPOOL_ERR("memory budget is too small: "
+			    "budget %lld, minimum %lld\n",
+			    env->stream.budget, min_budget);
+		err = -EINVAL;
+		goto destroy_stream;
+	}
+
+	chunk_portions = env->stream.budget / min_budget;
+	if (chunk_portions > env->threads.count)
+		chunk_portions = env->threads.count;
+
+	stream->chunk_portions = (int)chunk_portions;
+	stream->chunk_size = (size_t)chunk_portions * stride;
+	stream->chunks_count = (env->threads.count +
+				stream->chunk_portions - 1) /
+					stream->chunk_portions;
+
+	for (i = 0; i < MEMPOOL_STREAM_BUFFERS; i++) {
+		buf = &stream->buffers[i];
+
+		buf->state = MEMPOOL_STREAM_BUFFER_FREE;
+
+		err = posix_memalign(&buf->input, MEMPOOL_PAGE_SIZE,
+				     stream->chunk_size);
+		if (!err) {
+			err = posix_memalign(&buf->output, MEMPOOL_PAGE_SIZE,
+					     stream->chunk_size);
+		}
+
+		if (err) {
+			err = -err;
+			MEMPOOL_ERR("fail to allocate stream buffer: "
+				    "size %zu, %s\n",
+				    stream->chunk_size, strerror(-err));
+			goto destroy_stream;
+		}
+
+		/* padding between portions is never written by workers */
+		if (stride > (size_t)env->threads.portion_size)
+			memset(buf->output, 0, stream->chunk_size);
+	}
+
+	if (env->stream.direct)
+		mempool_stream_open_direct(stream);
+
+	if (env->stream.backend == MEMPOOL_URING_IO_BACKEND) {
+		err = mempool_uring_operations.init(stream);
+		if (!err) {
+			stream->ops = &mempool_uring_operations;
+		} else {
+			MEMPOOL_WARN("io_uring is unavailable: %s, "
+				     "pread backend will be used\n",
+				     strerror(-err));
+		}
+	}
+
+	err = pthread_create(&stream->reader, NULL,
+			     mempool_stream_reader, (void *)stream);
+	if (err) {
+		err = -err;
+		MEMPOOL_ERR("fail to create reader: %s\n", strerror(-err));
+		goto destroy_stream;
+	}
+
+	stream->threads++;
+
+	err = pthread_create(&stream->writer, NULL,
+			     mempool_stream_writer, (void *)stream);
+	if (err) {
+		err = -err;
+		MEMPOOL_ERR("fail to create writer: %s\n", strerror(-err));
+		goto destroy_stream;
+	}
+
+	stream->threads++;
+
+	MEMPOOL_DBG(env->show_debug,
+		    "stream has been started: backend %s, "
+		    "chunks %d, chunk portions %d, chunk size %zu\n",
+		    stream->ops->name, stream->chunks_count,
+		    stream->chunk_portions, stream->chunk_size);
+
+	return 0;
+
+destroy_stream:
+	mempool_stream_destroy(stream);
+	return err;
+}
+
+/*
+ * Wait the loaded chunk. It returns NULL if the chunk
+ * cannot be loaded because of I/O error.
+ */
+struct mempool_stream_buffer *
+mempool_stream_get(struct mempool_stream *stream, int chunk)
+{
+	struct mempool_stream_buffer *buf;
+	struct timespec start_time, finish_time;
+
+	buf = &stream->buffers[chunk % MEMPOOL_STREAM_BUFFERS];
+
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+	pthread_mutex_lock(&stream->lock);
+
+	while (buf->state != MEMPOOL_STREAM_BUFFER_LOADED ||
+	       buf->chunk != chunk) {
+		if (stream->err) {
+			buf = NULL;
+			break;
+		}
+
+		pthread_cond_wait(&stream->changed, &stream->lock);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &finish_time);
+
+	stream->stall_time +=
+		(double)(finish_time.tv_sec - start_time.tv_sec) +
+		(double)(finish_time.tv_nsec - start_time.tv_nsec) /
+								1000000000;
+
+	pthread_mutex_unlock(&stream->lock);
+
+	return buf;
+}
+
+/*
+ * Pass the processed chunk to the writer.
+ */
+void mempool_stream_put(struct mempool_stream *stream,
+			struct mempool_stream_buffer *buf)
+{
+	pthread_mutex_lock(&stream->lock);
+	buf->state = MEMPOOL_STREAM_BUFFER_PROCESSED;
+	pthread_cond_broadcast(&stream->changed);
+	pthread_mutex_unlock(&stream->lock);
+}
+
+/*
+ * Wait the end of writing all chunks. It returns the first I/O error.
+ */
+int mempool_stream_flush(struct mempool_stream *stream)
+{
+	struct mempool_test_environment *env = stream->env;
+	unsigned long long total;
+	int err;
+
+	total = (unsigned long long)env->threads.count * stream->stride;
+
+	pthread_mutex_lock(&stream->lock);
+
+	while (!stream->err && stream->written_bytes < total)
+		pthread_cond_wait(&stream->changed, &stream->lock);
+
+	err = stream->err;
+
+	pthread_mutex_unlock(&stream->lock);
+
+	return err;
+}
+
+/*
+ * Wait the end of writing processed chunks and release the stream.
+ * It returns the first I/O error.
+ */
+int mempool_stream_destroy(struct mempool_stream *stream)
+{
+	void *res;
+	int i;
+	int err;
+
+	/* stream has not been initialized or it is destroyed already */
+	if (!stream->ops)
+		return 0;
+
+	pthread_mutex_lock(&stream->lock);
+	stream->shutdown = MEMPOOL_TRUE;
+	pthread_cond_broadcast(&stream->changed);
+	pthread_mutex_unlock(&stream->lock);
+
+	if (stream->threads > 1)
+		pthread_join(stream->writer, &res);
+
+	if (stream->threads > 0)
+		pthread_join(stream->reader, &res);
+
+	stream->threads = 0;
+
+	if (stream->ops->destroy)
+		stream->ops->destroy(stream);
+
+	if (stream->direct) {
+		close(stream->input_fd);
+		close(stream->output_fd);
+		stream->direct = MEMPOOL_FALSE;
+	}
+
+	for (i = 0; i < MEMPOOL_STREAM_BUFFERS; i++) {
+		if (stream->buffers[i].input)
+			free(stream->buffers[i].input);
+
+		if (stream->buffers[i].output)
+			free(stream->buffers[i].output);
+
+		stream->buffers[i].input = NULL;
+		stream->buffers[i].output = NULL;
+	}
+
+	err = stream->err;
+
+	pthread_cond_destroy(&stream->changed);
+	pthread_mutex_destroy(&stream->lock);
+
+	stream->ops = NULL;
+
+	return err;
+}
+
+/*
+ * Report throughput of the stream and the time that workers
+ * have spent waiting for the input.
+ */
+void mempool_stream_report(struct mempool_stream *stream, double seconds)
+{
+	double read_bandwidth = 0;
+	double write_bandwidth = 0;
+
+	if (seconds > 0) {
+		read_bandwidth = (double)stream->read_bytes / seconds /
+							(1024 * 1024);
+		write_bandwidth = (double)stream->written_bytes / seconds /
+							(1024 * 1024);
+	}
+
+	MEMPOOL_INFO("Stream: backend %s, direct I/O %s, chunks %d, "
+		     "chunk size %zu, buffers %d\n",
+		     stream->ops->name, stream->direct ? "yes" : "no",
+		     stream->chunks_count, stream->chunk_size,
+		     MEMPOOL_STREAM_BUFFERS);
+	MEMPOOL_INFO("Stream: read %llu bytes (%.1f MB/s), "
+		     "written %llu bytes (%.1f MB/s), "
+		     "input stall %.3f sec\n",
+		     stream->read_bytes, read_bandwidth,
+		     stream->written_bytes, write_bandwidth,
+		     stream->stall_time);
+}
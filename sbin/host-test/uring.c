@@ -0,0 +1,596 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/uring.c - io_uring backend of streaming mode.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "host_test.h"
+
+/*
+ * ABI of io_uring (include/uapi/linux/io_uring.h, Linux 5.1+).
+ * liburing is not used, so syscalls are called directly.
+ */
+#ifndef SYS_io_uring_setup
+#define SYS_io_uring_setup		(425)
+#endif
+
+#ifndef SYS_io_uring_enter
+#define SYS_io_uring_enter		(426)
+#endif
+
+#ifndef SYS_io_uring_register
+#define SYS_io_uring_register		(427)
+#endif
+
+#define MEMPOOL_IORING_OP_READV		(1)
+#define MEMPOOL_IORING_OP_WRITEV	(2)
+#define MEMPOOL_IORING_OP_READ_FIXED	(4)
+#define MEMPOOL_IORING_OP_WRITE_FIXED	(5)
+
+#define MEMPOOL_IORING_ENTER_GETEVENTS	(1U << 0)
+#define MEMPOOL_IORING_FEAT_SINGLE_MMAP	(1U << 0)
+#define MEMPOOL_IORING_REGISTER_BUFFERS	(0)
+
+#define MEMPOOL_IORING_OFF_SQ_RING	(0ULL)
+#define MEMPOOL_IORING_OFF_CQ_RING	(0x8000000ULL)
+#define MEMPOOL_IORING_OFF_SQES		(0x10000000ULL)
+
+/* request cannot be longer than 32-bit length of SQE */
+#define MEMPOOL_URING_MAX_REQUEST	(1U << 30)
+
+struct mempool_io_uring_sqe {
+	uint8_t opcode;
+	uint8_t flags;
+	uint16_t ioprio;
+	int32_t fd;
+	uint64_t off;
+	uint64_t addr;
+	uint32_t len;
+	uint32_t rw_flags;
+	uint64_t user_data;
+	uint16_t buf_index;
+	uint16_t personality;
+	int32_t splice_fd_in;
+	uint64_t pad[2];
+};
+
+struct mempool_io_uring_cqe {
+	uint64_t user_data;
+	int32_t res;
+	uint32_t flags;
+};
+
+struct mempool_io_sqring_offsets {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t ring_mask;
+	uint32_t ring_entries;
+	uint32_t flags;
+	uint32_t dropped;
+	uint32_t array;
+	uint32_t resv1;
+	uint64_t resv2;
+};
+
+struct mempool_io_cqring_offsets {
+	uint32_t head;
+	uint32_t tail;
+	uint32_t ring_mask;
+	uint32_t ring_entries;
+	uint32_t overflow;
+	uint32_t cqes;
+	uint32_t flags;
+	uint32_t resv1;
+	uint64_t resv2;
+};
+
+struct mempool_io_uring_params {
+	uint32_t sq_entries;
+	uint32_t cq_entries;
+	uint32_t flags;
+	uint32_t sq_thread_cpu;
+	uint32_t sq_thread_idle;
+	uint32_t features;
+	uint32_t wq_fd;
+	uint32_t resv[3];
+	struct mempool_io_sqring_offsets sq_off;
+	struct mempool_io_cqring_offsets cq_off;
+};
+
+/*
+ * struct mempool_uring_request - I/O request in flight
+ * @offset: offset of request in the buffer
+ * @len: length of request in bytes
+ * @iov: vector of unregistered buffer
+ */
+struct mempool_uring_request {
+	size_t offset;
+	size_t len;
+	struct iovec iov;
+};
+
+/*
+ * struct mempool_uring_ring - submission and completion queues
+ * @fd: io_uring file descriptor
+ * @sq_ptr: mapping of submission queue
+ * @sq_size: size of submission queue's mapping
+ * @cq_ptr: mapping of completion queue
+ * @cq_size: size of completion queue's mapping
+ * @sqes: array of submission entries
+ * @sqes_size: size of submission entries' mapping
+ * @sq_head: head of submission queue
+ * @sq_tail: tail of submission queue
+ * @sq_mask: mask of submission queue
+ * @sq_array: indexes of submission entries
+ * @cq_head: head of completion queue
+ * @cq_tail: tail of completion queue
+ * @cq_mask: mask of completion queue
+ * @cqes: array of completion entries
+ * @requests: requests in flight
+ * @free: stack of free requests
+ * @free_count: number of free requests
+ * @depth: maximal number of requests in flight
+ * @registered: buffers are registered in the ring
+ */
+struct mempool_uring_ring {
+	int fd;
+	void *sq_ptr;
+	size_t sq_size;
+	void *cq_ptr;
+	size_t cq_size;
+	struct mempool_io_uring_sqe *sqes;
+	size_t sqes_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct mempool_io_uring_cqe *cqes;
+	struct mempool_uring_request *requests;
+	int *free;
+	int free_count;
+	int depth;
+	int registered;
+};
+
+enum {
+	MEMPOOL_URING_READ_RING,
+	MEMPOOL_URING_WRITE_RING,
+	MEMPOOL_URING_RINGS
+};
+
+/*
+ * struct mempool_uring - io_uring backend
+ * @rings: rings of the reader and the writer
+ */
+struct mempool_uring {
+	struct mempool_uring_ring rings[MEMPOOL_URING_RINGS];
+};
+
+/************************************************************************
+ *                        Ring's logic                                  *
+ ************************************************************************/
+
+static
+void mempool_uring_ring_destroy(struct mempool_uring_ring *ring)
+{
+	if (ring->sqes)
+		munmap(ring->sqes, ring->sqes_size);
+
+	if (ring->cq_ptr && ring->cq_ptr != ring->sq_ptr)
+		munmap(ring->cq_ptr, ring->cq_size);
+
+	if (ring->sq_ptr)
+		munmap(ring->sq_ptr, ring->sq_size);
+
+	if (ring->fd >= 0)
+		close(ring->fd);
+
+	if (ring->requests)
+		free(ring->requests);
+
+	if (ring->free)
+		free(ring->free);
+
+	memset(ring, 0, sizeof(struct mempool_uring_ring));
+	ring->fd = -1;
+}
+
+static
+int mempool_uring_ring_init(struct mempool_uring_ring *ring, int depth)
+{
+	struct mempool_io_uring_params params;
+	void *ptr;
+	int i;
+	int err;
+
+	memset(ring, 0, sizeof(struct mempool_uring_ring));
+	memset(&params, 0, sizeof(params));
+
+	ring->fd = (int)syscall(SYS_io_uring_setup, depth, &params);
+	if (ring->fd < 0) {
+		ring->fd = -1;
+		return -errno;
+	}
+
+	ring->sq_size = params.sq_off.array +
+				params.sq_entries * sizeof(unsigned);
+	ring->cq_size = params.cq_off.cqes + params.cq_entries *
+				sizeof(struct mempool_io_uring_cqe);
+
+	if (params.features & MEMPOOL_IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_size > ring->sq_size)
+			ring->sq_size = ring->cq_size;
+		ring->cq_size = ring->sq_size;
+	}
+
+	ptr = mmap(0, ring->sq_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, ring->fd,
+		   MEMPOOL_IORING_OFF_SQ_RING);
+	if (ptr == MAP_FAILED) {
+		err = -errno;
+		goto destroy_ring;
+	}
+
+	ring->sq_ptr = ptr;
+
+	if (params.features & MEMPOOL_IORING_FEAT_SINGLE_MMAP) {
+		ring->cq_ptr = ring->sq_ptr;
+	} else {
+		ptr = mmap(0, ring->cq_size, PROT_READ | PROT_WRITE,
+			   MAP_SHARED | MAP_POPULATE, ring->fd,
+			   MEMPOOL_IORING_OFF_CQ_RING);
+		if (ptr == MAP_FAILED) {
+			err = -errno;
+			goto destroy_ring;
+		}
+
+		ring->cq_ptr = ptr;
+	}
+
+	ring->sqes_size = params.sq_entries *
+				sizeof(struct mempool_io_uring_sqe);
+
+	ptr = mmap(0, ring->sqes_size, PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_POPULATE, ring->fd,
+		   MEMPOOL_IORING_OFF_SQES);
+	if (ptr == MAP_FAILED) {
+		err = -errno;
+		goto destroy_ring;
+	}
+
+	ring->sqes = ptr;
+
+	ring->sq_head = (unsigned *)((char *)ring->sq_ptr +
+						params.sq_off.head);
+	ring->sq_tail = (unsigned *)((char *)ring->sq_ptr +
+						params.sq_off.tail);
+	ring->sq_mask = (unsigned *)((char *)ring->sq_ptr +
+						params.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)((char *)ring->sq_ptr +
+						params.sq_off.array);
+	ring->cq_head = (unsigned *)((char *)ring->cq_ptr +
+						params.cq_off.head);
+	ring->cq_tail = (unsigned *)((char *)ring->cq_ptr +
+						params.cq_off.tail);
+	ring->cq_mask = (unsigned *)((char *)ring->cq_ptr +
+						params.cq_off.ring_mask);
+	ring->cqes = (struct mempool_io_uring_cqe *)((char *)ring->cq_ptr +
+						params.cq_off.cqes);
+
+	/* the kernel can round up number of entries */
+	ring->depth = depth;
+	if (ring->depth > (int)params.sq_entries)
+		ring->depth = (int)params.sq_entries;
+
+	ring->requests = calloc(ring->depth,
+				sizeof(struct mempool_uring_request));
+	ring->free = calloc(ring->depth, sizeof(int));
+	if (!ring->requests || !ring->free) {
+		err = -ENOMEM;
+		goto destroy_ring;
+	}
+
+	for (i = 0; i < ring->depth; i++)
+		ring->free[i] = i;
+
+	ring->free_count = ring->depth;
+
+	return 0;
+
+destroy_ring:
+	mempool_uring_ring_destroy(ring);
+	return err;
+}
+
+/*
+ * Registered buffers are pinned once, so the kernel doesn't map
+ * pages of buffers for every request. Registration can fail because
+ * of RLIMIT_MEMLOCK, then requests use unregistered buffers.
+ */
+static
+void mempool_uring_ring_register(struct mempool_uring_ring *ring,
+				 struct iovec *iov, int count)
+{
+	if (syscall(SYS_io_uring_register, ring->fd,
+		    MEMPOOL_IORING_REGISTER_BUFFERS, iov, count) == 0)
+		ring->registered = MEMPOOL_TRUE;
+}
+
+static
+void mempool_uring_ring_prepare(struct mempool_uring_ring *ring,
+				int write, int fd, void *buf, int buf_index,
+				off_t offset, int slot)
+{
+	struct mempool_uring_request *req = &ring->requests[slot];
+	struct mempool_io_uring_sqe *sqe;
+	unsigned tail;
+	unsigned index;
+
+	tail = *ring->sq_tail;
+	index = tail & *ring->sq_mask;
+	sqe = &ring->sqes[index];
+
+	memset(sqe, 0, sizeof(struct mempool_io_uring_sqe));
+	sqe->fd = fd;
+	sqe->off = (uint64_t)(offset + (off_t)req->offset);
+	sqe->user_data = (uint64_t)slot;
+
+	if (ring->registered) {
+		sqe->opcode = write ? MEMPOOL_IORING_OP_WRITE_FIXED :
+					MEMPOOL_IORING_OP_READ_FIXED;
+		sqe->addr = (uint64_t)(uintptr_t)((char *)buf + req->offset);
+		sqe->len = (uint32_t)req->len;
+		sqe->buf_index = (uint16_t)buf_index;
+	} else {
+		req->iov.iov_base = (char *)buf + req->offset;
+		req->iov.iov_len = req->len;
+
+		sqe->opcode = write ? MEMPOOL_IORING_OP_WRITEV :
+					MEMPOOL_IORING_OP_READV;
+		sqe->addr = (uint64_t)(uintptr_t)&req->iov;
+		sqe->len = 1;
+	}
+
+	ring->sq_array[index] = index;
+
+	/* the kernel has to see the entry before the new tail */
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Transfer @len bytes between @buf and the file by requests
+ * of @request_size bytes, keeping up to ring's depth of requests
+ * in flight. Short transfers are resubmitted for the rest of bytes.
+ */
+static
+int mempool_uring_ring_transfer(struct mempool_uring_ring *ring,
+				int write, int fd, void *buf, int buf_index,
+				size_t len, off_t offset, size_t request_size)
+{
+	struct mempool_uring_request *req;
+	struct mempool_io_uring_cqe *cqe;
+	size_t next = 0;
+	int inflight = 0;
+	unsigned to_submit = 0;
+	unsigned head, tail;
+	int slot;
+	long res;
+	int err = 0;
+
+	if (request_size > MEMPOOL_URING_MAX_REQUEST)
+		request_size = MEMPOOL_URING_MAX_REQUEST;
+
+	while (next < len || inflight > 0) {
+		while (!err && next < len && ring->free_count > 0) {
+			slot = ring->free[--ring->free_count];
+			req = &ring->requests[slot];
+
+			req->offset = next;
+			req->len = len - next;
+			if (req->len > request_size)
+				req->len = request_size;
+
+			mempool_uring_ring_prepare(ring, write, fd, buf,
+						   buf_index, offset, slot);
+
+			next += req->len;
+			inflight++;
+			to_submit++;
+		}
+
+		if (err && inflight == 0)
+			break;
+
+		res = syscall(SYS_io_uring_enter, ring->fd, to_submit, 1,
+			      MEMPOOL_IORING_ENTER_GETEVENTS, NULL, 0);
+		if (res < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+
+			/* requests in flight cannot be waited anymore */
+			return -errno;
+		}
+
+		to_submit -= (unsigned)res;
+
+		head = *ring->cq_head;
+		tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+		while (head != tail) {
+			cqe = &ring->cqes[head & *ring->cq_mask];
+			slot = (int)cqe->user_data;
+			req = &ring->requests[slot];
+
+			if (cqe->res < 0 && !err) {
+				err = cqe->res;
+			} else if (cqe->res == 0 && !err) {
+				/* file is shorter than geometry */
+				err = -ENODATA;
+			} else if (cqe->res > 0 &&
+				   (size_t)cqe->res < req->len && !err) {
+				/* resubmit the rest of short transfer */
+				req->offset += (size_t)cqe->res;
+				req->len -= (size_t)cqe->res;
+				head++;
+				__atomic_store_n(ring->cq_head, head,
+						 __ATOMIC_RELEASE);
+				mempool_uring_ring_prepare(ring, write, fd,
+							   buf, buf_index,
+							   offset, slot);
+				to_submit++;
+				continue;
+			}
+
+			ring->free[ring->free_count++] = slot;
+			inflight--;
+
+			head++;
+			__atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+		}
+	}
+
+	return err;
+}
+
+/************************************************************************
+ *                        Backend's logic                               *
+ ************************************************************************/
+
+static
+void mempool_uring_destroy(struct mempool_stream *stream)
+{
+	struct mempool_uring *uring = stream->backend;
+	int i;
+
+	if (!uring)
+		return;
+
+	for (i = 0; i < MEMPOOL_URING_RINGS; i++)
+		mempool_uring_ring_destroy(&uring->rings[i]);
+
+	free(uring);
+	stream->backend = NULL;
+}
+
+/*
+ * The reader and the writer have own rings, so submission
+ * and completion queues are never shared between threads.
+ */
+static
+int mempool_uring_init(struct mempool_stream *stream)
+{
+	struct mempool_test_environment *env = stream->env;
+	struct mempool_uring *uring;
+	struct iovec iov[MEMPOOL_STREAM_BUFFERS];
+	int i;
+	int err;
+
+	uring = calloc(1, sizeof(struct mempool_uring));
+	if (!uring)
+		return -ENOMEM;
+
+	for (i = 0; i < MEMPOOL_URING_RINGS; i++)
+		uring->rings[i].fd = -1;
+
+	stream->backend = uring;
+
+	for (i = 0; i < MEMPOOL_URING_RINGS; i++) {
+		err = mempool_uring_ring_init(&uring->rings[i],
+					      env->stream.depth);
+		if (err)
+			goto destroy_backend;
+	}
+
+	for (i = 0; i < MEMPOOL_STREAM_BUFFERS; i++) {
+		iov[i].iov_base = stream->buffers[i].input;
+		iov[i].iov_len = stream->chunk_size;
+	}
+
+	mempool_uring_ring_register(&uring->rings[MEMPOOL_URING_READ_RING],
+				    iov, MEMPOOL_STREAM_BUFFERS);
+
+	for (i = 0; i < MEMPOOL_STREAM_BUFFERS; i++) {
+		iov[i].iov_base = stream->buffers[i].output;
+		iov[i].iov_len = stream->chunk_size;
+	}
+
+	mempool_uring_ring_register(&uring->rings[MEMPOOL_URING_WRITE_RING],
+				    iov, MEMPOOL_STREAM_BUFFERS);
+
+	MEMPOOL_INFO("io_uring: depth %d, registered buffers %s\n",
+		     uring->rings[MEMPOOL_URING_READ_RING].depth,
+		     uring->rings[MEMPOOL_URING_READ_RING].registered &&
+		     uring->rings[MEMPOOL_URING_WRITE_RING].registered ?
+							"yes" : "no");
+
+	return 0;
+
+destroy_backend:
+	mempool_uring_destroy(stream);
+	return err;
+}
+
+static
+int mempool_uring_read(struct mempool_stream *stream,
+		       struct mempool_stream_buffer *buf)
+{
+	struct mempool_uring *uring = stream->backend;
+	off_t offset = stream->input_offset +
+				(off_t)buf->first * stream->stride;
+
+	return mempool_uring_ring_transfer(
+				&uring->rings[MEMPOOL_URING_READ_RING],
+				MEMPOOL_FALSE, stream->input_fd,
+				buf->input, buf->chunk % MEMPOOL_STREAM_BUFFERS,
+				buf->bytes, offset, stream->stride);
+}
+
+static
+int mempool_uring_write(struct mempool_stream *stream,
+			struct mempool_stream_buffer *buf)
+{
+	struct mempool_uring *uring = stream->backend;
+	off_t offset = stream->output_offset +
+				(off_t)buf->first * stream->stride;
+
+	return mempool_uring_ring_transfer(
+				&uring->rings[MEMPOOL_URING_WRITE_RING],
+				MEMPOOL_TRUE, stream->output_fd,
+				buf->output, buf->chunk % MEMPOOL_STREAM_BUFFERS,
+				buf->bytes, offset, stream->stride);
+}
+
+const struct mempool_io_operations mempool_uring_operations = {
+	.name = "uring",
+	.init = mempool_uring_init,
+	.read = mempool_uring_read,
+	.write = mempool_uring_write,
+	.destroy = mempool_uring_destroy,
+};
@@ -0,0 +1,401 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/reference.c - reference kernels of algorithms.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#include <sys/types.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "verify.h"
+
+/*
+ * Reference kernels are written as simple as possible: they process
+ * one record at a time and do not share any code with host-test.
+ */
+
+int mempool_ref_is_bit_set(unsigned long long mask, int bit, int capacity)
+{
+	int check_bit;
+
+	if (bit >= sizeof(unsigned long long) * MEMPOOL_BITS_PER_BYTE)
+		return MEMPOOL_FALSE;
+
+	check_bit = capacity - bit - 1;
+
+	return (mask >> check_bit) & 1;
+}
+
+size_t mempool_ref_items_bytes(struct mempool_test_environment *env,
+				unsigned long long mask)
+{
+	size_t bytes = 0;
+	int i;
+
+	for (i = 0; i < env->record.capacity; i++) {
+		if (mempool_ref_is_bit_set(mask, i, env->record.capacity))
+			bytes += env->item.granularity;
+	}
+
+	return bytes;
+}
+
+/*
+ * Key is made of the first 8 bytes of key items.
+ */
+unsigned long long mempool_ref_key(struct mempool_test_environment *env,
+				   const unsigned char *record)
+{
+	unsigned long long key = 0;
+	size_t written = 0;
+	size_t bytes;
+	int i;
+
+	for (i = 0; i < env->record.capacity; i++) {
+		if (written >= sizeof(key))
+			break;
+
+		if (!mempool_ref_is_bit_set(env->key.mask, i,
+					    env->record.capacity))
+			continue;
+
+		bytes = sizeof(key) - written;
+		if (bytes > env->item.granularity)
+			bytes = env->item.granularity;
+
+		memcpy((unsigned char *)&key + written,
+			record + (size_t)i * env->item.granularity, bytes);
+		written += env->item.granularity;
+	}
+
+	return key;
+}
+
+size_t mempool_ref_copy_items(struct mempool_test_environment *env,
+			      unsigned long long mask,
+			      const unsigned char *record,
+			      unsigned char *output)
+{
+	size_t written = 0;
+	int i;
+
+	for (i = 0; i < env->record.capacity; i++) {
+		if (!mempool_ref_is_bit_set(mask, i, env->record.capacity))
+			continue;
+
+		memcpy(output + written,
+			record + (size_t)i * env->item.granularity,
+			env->item.granularity);
+		written += env->item.granularity;
+	}
+
+	return written;
+}
+
+/*
+ * KEY-VALUE and SELECT output: key items are followed by value items.
+ */
+size_t mempool_ref_key_value(struct mempool_test_environment *env,
+			     const unsigned char *record,
+			     unsigned char *output)
+{
+	size_t written;
+
+	written = mempool_ref_copy_items(env, env->key.mask, record, output);
+	written += mempool_ref_copy_items(env, env->value.mask, record,
+					  output + written);
+
+	return written;
+}
+
+/*
+ * TOTAL adds the first byte of every value item.
+ */
+void mempool_ref_total(struct mempool_test_environment *env,
+		       const unsigned char *record,
+		       unsigned long long *sums)
+{
+	int i;
+
+	for (i = 0; i < env->record.capacity; i++) {
+		if (mempool_ref_is_bit_set(env->value.mask, i,
+					   env->record.capacity))
+			sums[i] += record[(size_t)i * env->item.granularity];
+	}
+}
+
+static inline
+unsigned long long mempool_ref_mix(unsigned long long value)
+{
+	value ^= value >> 33;
+	value *= 0xff51afd7ed558ccdULL;
+	value ^= value >> 33;
+	value *= 0xc4ceb9fe1a85ec53ULL;
+	value ^= value >> 33;
+
+	return value;
+}
+
+static
+unsigned long long mempool_ref_hash(const unsigned char *record, size_t size)
+{
+	unsigned long long hash = 0x9E3779B97F4A7C15ULL ^ size;
+	unsigned long long word;
+	size_t bytes;
+	size_t i;
+
+	for (i = 0; i < size; i += sizeof(word)) {
+		bytes = size - i;
+		if (bytes > sizeof(word))
+			bytes = sizeof(word);
+
+		word = 0;
+		memcpy(&word, record + i, bytes);
+		hash = mempool_ref_mix(hash ^ word) + i;
+	}
+
+	return hash;
+}
+
+/*
+ * Summary is independent of the order of records, so sums of
+ * input and output portions are equal if the records are permuted.
+ */
+void mempool_ref_summarize(struct mempool_test_environment *env,
+			   const unsigned char *records, unsigned int count,
+			   struct mempool_verify_summary *summary)
+{
+	size_t record_size = (size_t)env->item.granularity *
+						env->record.capacity;
+	unsigned long long hash;
+	unsigned int i;
+
+	memset(summary, 0, sizeof(struct mempool_verify_summary));
+
+	summary->records = count;
+
+	if (count == 0)
+		return;
+
+	summary->first_key = mempool_ref_key(env, records);
+	summary->last_key = mempool_ref_key(env, records +
+					(size_t)(count - 1) * record_size);
+
+	for (i = 0; i < count; i++) {
+		hash = mempool_ref_hash(records + i * record_size, record_size);
+		summary->hash_sum += hash;
+		summary->mix_sum += mempool_ref_mix(hash);
+	}
+}
+
+static
+int mempool_ref_compare_asc(const void *item1, const void *item2)
+{
+	unsigned long long key1 = *(const unsigned long long *)item1;
+	unsigned long long key2 = *(const unsigned long long *)item2;
+
+	if (key1 == key2)
+		return 0;
+
+	return key1 < key2 ? -1 : 1;
+}
+
+static
+int mempool_ref_compare_desc(const void *item1, const void *item2)
+{
+	return mempool_ref_compare_asc(item2, item1);
+}
+
+int mempool_ref_sort_keys(unsigned long long *keys, int count, int order)
+{
+	qsort(keys, count, sizeof(unsigned long long),
+		order == MEMPOOL_DESCENDING_ORDER ?
+			mempool_ref_compare_desc : mempool_ref_compare_asc);
+
+	return 0;
+}
+
+/*
+ * Keep @limit the best keys of portion in order of TOPK.
+ * It returns the number of kept keys.
+ */
+int mempool_ref_best_keys(struct mempool_test_environment *env,
+			  const unsigned char *records, unsigned int count,
+			  unsigned long long *keys, int limit)
+{
+	size_t record_size = (size_t)env->item.granularity *
+						env->record.capacity;
+	unsigned long long *all;
+	unsigned int i;
+
+	if (count == 0)
+		return 0;
+
+	all = malloc((size_t)count * sizeof(unsigned long long));
+	if (!all) {
+		MEMPOOL_ERR("fail to allocate keys: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < count; i++)
+		all[i] = mempool_ref_key(env, records + i * record_size);
+
+	mempool_ref_sort_keys(all, count, env->limit.order);
+
+	if (limit > count)
+		limit = count;
+
+	memcpy(keys, all, (size_t)limit * sizeof(unsigned long long));
+	free(all);
+
+	return limit;
+}
+
+static
+int mempool_ref_compare_entries(const void *item1, const void *item2)
+{
+	const struct mempool_verify_entry *entry1 = item1;
+	const struct mempool_verify_entry *entry2 = item2;
+
+	if (entry1->key != entry2->key)
+		return entry1->key < entry2->key ? -1 : 1;
+
+	if (entry1->portion != entry2->portion)
+		return entry1->portion < entry2->portion ? -1 : 1;
+
+	if (entry1->index != entry2->index)
+		return entry1->index < entry2->index ? -1 : 1;
+
+	return 0;
+}
+
+/*
+ * Sort entries and keep the first entry of every key.
+ */
+static
+void mempool_ref_compact(struct mempool_verify_set *set)
+{
+	struct mempool_verify_entry *last = NULL;
+	int count = 0;
+	int i;
+
+	qsort(set->entries, set->count, sizeof(struct mempool_verify_entry),
+		mempool_ref_compare_entries);
+
+	for (i = 0; i < set->count; i++) {
+		if (last && last->key == set->entries[i].key) {
+			last->count += set->entries[i].count;
+			continue;
+		}
+
+		last = &set->entries[count++];
+		*last = set->entries[i];
+	}
+
+	set->count = count;
+}
+
+int mempool_ref_distinct_set(struct mempool_test_environment *env,
+			     const unsigned char *records, unsigned int count,
+			     int portion, struct mempool_verify_set *set)
+{
+	size_t record_size = (size_t)env->item.granularity *
+						env->record.capacity;
+	unsigned int i;
+
+	set->count = 0;
+	set->entries = malloc((size_t)(count > 0 ? count : 1) *
+				sizeof(struct mempool_verify_entry));
+	if (!set->entries) {
+		MEMPOOL_ERR("fail to allocate entries: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct mempool_verify_entry *entry = &set->entries[i];
+
+		entry->key = mempool_ref_key(env, records + i * record_size);
+		entry->portion = portion;
+		entry->index = i;
+		entry->count = 1;
+	}
+
+	set->count = count;
+	mempool_ref_compact(set);
+
+	return 0;
+}
+
+int mempool_ref_merge_sets(struct mempool_verify_set *sets, int count,
+			   struct mempool_verify_set *result)
+{
+	size_t total = 0;
+	int i;
+
+	for (i = 0; i < count; i++)
+		total += sets[i].count;
+
+	result->count = 0;
+	result->entries = malloc((total > 0 ? total : 1) *
+				 sizeof(struct mempool_verify_entry));
+	if (!result->entries) {
+		MEMPOOL_ERR("fail to allocate entries: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < count; i++) {
+		memcpy(result->entries + result->count, sets[i].entries,
+			(size_t)sets[i].count *
+				sizeof(struct mempool_verify_entry));
+		result->count += sets[i].count;
+	}
+
+	mempool_ref_compact(result);
+
+	return 0;
+}
+
+/*
+ * DISTINCT output: key items are followed by value items of the first
+ * record or by the number of records with the key.
+ */
+size_t mempool_ref_distinct_record(struct mempool_test_environment *env,
+				   struct mempool_verify_entry *entry,
+				   const unsigned char *record,
+				   unsigned char *output)
+{
+	size_t written;
+
+	written = mempool_ref_copy_items(env, env->key.mask, record, output);
+
+	switch (env->distinct.output) {
+	case MEMPOOL_DISTINCT_FIRST_VALUE_OUTPUT:
+		written += mempool_ref_copy_items(env, env->value.mask,
+						  record, output + written);
+		break;
+
+	case MEMPOOL_DISTINCT_COUNT_OUTPUT:
+		memcpy(output + written, &entry->count,
+			sizeof(unsigned long long));
+		written += sizeof(unsigned long long);
+		break;
+	}
+
+	return written;
+}
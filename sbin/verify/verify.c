@@ -0,0 +1,1395 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/verify.c - parallel verifier of outputs.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+
+#include "verify.h"
+#include "memory_pool_codec.h"
+#include "crc32c.h"
+
+/*
+ * Verifier recomputes the expected result of algorithm by reference
+ * kernels (see reference.c) and compares it with the output of
+ * host-test or fpga-test. Portions are checked in parallel by
+ * threads that take the next task from the shared counter.
+ */
+
+/************************************************************************
+ *                        Reports of mismatches                         *
+ ************************************************************************/
+
+static
+void mempool_verify_dump(const char *title, const unsigned char *buf,
+			 size_t bytes)
+{
+	size_t i;
+
+	if (bytes > MEMPOOL_VERIFY_DUMP_BYTES)
+		bytes = MEMPOOL_VERIFY_DUMP_BYTES;
+
+	MEMPOOL_INFO("\t %s:", title);
+
+	for (i = 0; i < bytes; i++)
+		MEMPOOL_INFO(" %02x", buf[i]);
+
+	MEMPOOL_INFO("\n");
+}
+
+/*
+ * Account mismatch and show the first MEMPOOL_VERIFY_MAX_REPORTS
+ * mismatches in details. @expected or @actual can be NULL.
+ */
+static
+void mempool_verify_report(struct mempool_verify_context *ctx,
+			   int portion, long long record,
+			   const void *expected, const void *actual,
+			   size_t bytes, const char *reason)
+{
+	pthread_mutex_lock(&ctx->lock);
+
+	ctx->mismatches++;
+
+	if (ctx->mismatches <= MEMPOOL_VERIFY_MAX_REPORTS) {
+		MEMPOOL_INFO("MISMATCH: portion %d, record %lld: %s\n",
+			     portion, record, reason);
+
+		if (expected)
+			mempool_verify_dump("expected", expected, bytes);
+		if (actual)
+			mempool_verify_dump("actual  ", actual, bytes);
+	}
+
+	pthread_mutex_unlock(&ctx->lock);
+}
+
+/*
+ * Compare @bytes of records and report every mismatched record.
+ */
+static
+void mempool_verify_compare(struct mempool_verify_context *ctx,
+			    int portion, const unsigned char *expected,
+			    const unsigned char *actual, size_t bytes,
+			    size_t record_size)
+{
+	size_t offset;
+	size_t size;
+
+	if (memcmp(expected, actual, bytes) == 0)
+		return;
+
+	for (offset = 0; offset < bytes; offset += record_size) {
+		size = bytes - offset;
+		if (size > record_size)
+			size = record_size;
+
+		if (memcmp(expected + offset, actual + offset, size) == 0)
+			continue;
+
+		mempool_verify_report(ctx, portion, offset / record_size,
+				      expected + offset, actual + offset,
+				      size, "records differ");
+	}
+}
+
+/*
+ * Raw output has no directory, so the rest of portion has to be clean.
+ */
+static
+void mempool_verify_clean_tail(struct mempool_verify_context *ctx,
+			       int portion, const unsigned char *data,
+			       size_t start, size_t end)
+{
+	size_t i;
+
+	for (i = start; i < end; i++) {
+		if (data[i] == 0)
+			continue;
+
+		mempool_verify_report(ctx, portion, i / ctx->record_size,
+				      NULL, data + i, end - i,
+				      "garbage after the last record");
+		return;
+	}
+}
+
+/************************************************************************
+ *                         Parallel execution                           *
+ ************************************************************************/
+
+static
+void *mempool_verify_thread_func(void *arg)
+{
+	struct mempool_verify_context *ctx = arg;
+	int index;
+	int err;
+
+	while (!__atomic_load_n(&ctx->err, __ATOMIC_RELAXED)) {
+		index = __atomic_fetch_add(&ctx->next_task, 1,
+					   __ATOMIC_RELAXED);
+		if (index >= ctx->tasks)
+			break;
+
+		err = ctx->func(ctx, index);
+		if (err) {
+			MEMPOOL_ERR("task has failed: index %d, err %d\n",
+				    index, err);
+
+			pthread_mutex_lock(&ctx->lock);
+			if (!ctx->err)
+				__atomic_store_n(&ctx->err, err,
+						 __ATOMIC_RELAXED);
+			pthread_mutex_unlock(&ctx->lock);
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Execute @func for every task in [0, @tasks) by worker threads.
+ */
+static
+int mempool_verify_run(struct mempool_verify_context *ctx,
+		       mempool_verify_func func, int tasks)
+{
+	pthread_t *threads;
+	int count = ctx->env->workers.count;
+	int started;
+	int i;
+	int err = 0;
+
+	if (tasks <= 0)
+		return 0;
+
+	if (count > tasks)
+		count = tasks;
+
+	threads = calloc(count, sizeof(pthread_t));
+	if (!threads) {
+		MEMPOOL_ERR("fail to allocate threads: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	ctx->func = func;
+	ctx->tasks = tasks;
+	ctx->next_task = 0;
+
+	for (started = 0; started < count; started++) {
+		err = pthread_create(&threads[started], NULL,
+				     mempool_verify_thread_func, ctx);
+		if (err) {
+			err = -err;
+			MEMPOOL_ERR("fail to create thread: err %d\n", err);
+			break;
+		}
+	}
+
+	/* the main thread helps if some threads have not been created */
+	if (started < count)
+		mempool_verify_thread_func(ctx);
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	free(threads);
+
+	return ctx->err;
+}
+
+/************************************************************************
+ *                              Datasets                                *
+ ************************************************************************/
+
+static
+int mempool_verify_open(struct mempool_verify_dataset *dataset)
+{
+	struct stat file_stat;
+	int err;
+
+	dataset->fd = open(dataset->name, O_RDONLY);
+	if (dataset->fd == -1) {
+		err = -errno;
+		MEMPOOL_ERR("fail to open file: %s, %s\n",
+			    dataset->name, strerror(errno));
+		return err;
+	}
+
+	if (fstat(dataset->fd, &file_stat)) {
+		err = -errno;
+		MEMPOOL_ERR("fail to get file size: %s\n",
+			    strerror(errno));
+		return err;
+	}
+
+	dataset->size = file_stat.st_size;
+
+	err = mempool_container_read(dataset->fd, &dataset->container);
+	if (err == -ENOMSG) {
+		err = 0;
+	} else if (err) {
+		MEMPOOL_ERR("fail to read container: %s, err %d\n",
+			    dataset->name, err);
+		return err;
+	}
+
+	if (dataset->size == 0)
+		return 0;
+
+	dataset->addr = mmap(0, dataset->size, PROT_READ, MAP_SHARED,
+			     dataset->fd, 0);
+	if (dataset->addr == MAP_FAILED) {
+		dataset->addr = NULL;
+		err = -errno;
+		MEMPOOL_ERR("fail to mmap file: %s, %s\n",
+			    dataset->name, strerror(errno));
+		return err;
+	}
+
+	madvise(dataset->addr, dataset->size, MADV_SEQUENTIAL);
+
+	return 0;
+}
+
+static
+void mempool_verify_close(struct mempool_verify_dataset *dataset)
+{
+	if (dataset->buffer)
+		free(dataset->buffer);
+
+	if (dataset->portions)
+		free(dataset->portions);
+
+	if (dataset->addr)
+		munmap(dataset->addr, dataset->size);
+
+	if (dataset->fd != -1)
+		close(dataset->fd);
+
+	mempool_container_destroy(&dataset->container);
+}
+
+static inline
+size_t mempool_verify_slot_size(struct mempool_container *container)
+{
+	return (size_t)container->granularity * container->record_capacity *
+					container->portion_capacity;
+}
+
+/*
+ * Describe portions of dataset. Raw file is split into @count portions
+ * of @portion_size bytes with @records records. Portions of container
+ * are described by directory and they are prepared by load tasks.
+ */
+static
+int mempool_verify_describe(struct mempool_verify_dataset *dataset,
+			    int count, size_t portion_size,
+			    unsigned int records)
+{
+	struct mempool_container *container = &dataset->container;
+	int i;
+
+	if (container->portions)
+		count = container->portions_count;
+
+	dataset->portions = calloc(count > 0 ? count : 1,
+				   sizeof(struct mempool_verify_portion));
+	if (!dataset->portions) {
+		MEMPOOL_ERR("fail to allocate portions: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	dataset->portions_count = count;
+
+	if (!container->portions) {
+		if ((size_t)count * portion_size > dataset->size) {
+			MEMPOOL_ERR("file is too short: %s, size %zu, "
+				    "expected %zu\n",
+				    dataset->name, dataset->size,
+				    (size_t)count * portion_size);
+			return -ERANGE;
+		}
+
+		for (i = 0; i < count; i++) {
+			dataset->portions[i].data =
+				(unsigned char *)dataset->addr +
+						(size_t)i * portion_size;
+			dataset->portions[i].records = records;
+			dataset->portions[i].bytes = portion_size;
+		}
+
+		return 0;
+	}
+
+	for (i = 0; i < count; i++) {
+		struct mempool_container_portion *portion;
+
+		portion = &container->portions[i];
+		if (portion->offset + portion->bytes > dataset->size) {
+			MEMPOOL_ERR("portion is out of file: %s, portion %d, "
+				    "offset %llu, bytes %llu\n",
+				    dataset->name, i,
+				    portion->offset, portion->bytes);
+			return -ERANGE;
+		}
+	}
+
+	/* encoded and PAX portions are converted into rows */
+	if (container->encoding != MEMPOOL_PLAIN_ENCODING ||
+	    container->layout == MEMPOOL_PAX_LAYOUT) {
+		dataset->buffer_size = mempool_verify_slot_size(container) *
+								count;
+		dataset->buffer = malloc(dataset->buffer_size > 0 ?
+						dataset->buffer_size : 1);
+		if (!dataset->buffer) {
+			MEMPOOL_ERR("fail to allocate buffer: %s\n",
+				    strerror(errno));
+			return -ENOMEM;
+		}
+	}
+
+	return 0;
+}
+
+/*
+ * Check payload of container's portion and convert it into rows.
+ * Corrupted output is a mismatch, but corrupted input is an error.
+ */
+static
+int mempool_verify_load_portion(struct mempool_verify_context *ctx,
+				struct mempool_verify_dataset *dataset,
+				int index, int is_output)
+{
+	struct mempool_container *container = &dataset->container;
+	struct mempool_container_portion *portion = &container->portions[index];
+	struct mempool_verify_portion *dst = &dataset->portions[index];
+	const unsigned char *payload;
+	unsigned char *rows;
+	size_t record_size;
+	size_t slot_size;
+	int err;
+
+	payload = (const unsigned char *)dataset->addr + portion->offset;
+	record_size = (size_t)container->granularity *
+					container->record_capacity;
+	slot_size = mempool_verify_slot_size(container);
+
+	dst->data = NULL;
+	dst->records = portion->records;
+	dst->bytes = portion->bytes;
+
+	err = mempool_container_check_portion(container, index, payload);
+	if (err)
+		goto corrupted_portion;
+
+	if (container->encoding != MEMPOOL_PLAIN_ENCODING) {
+		rows = (unsigned char *)dataset->buffer + index * slot_size;
+
+		err = mempool_codec_check(payload, portion->bytes,
+					  container->granularity,
+					  container->record_capacity,
+					  portion->records);
+		if (!err)
+			err = mempool_codec_decode(payload, rows, slot_size);
+		if (err)
+			goto corrupted_portion;
+
+		dst->data = rows;
+		dst->bytes = (unsigned long long)portion->records * record_size;
+	} else if (container->layout == MEMPOOL_PAX_LAYOUT) {
+		rows = (unsigned char *)dataset->buffer + index * slot_size;
+
+		if ((unsigned long long)portion->records * record_size >
+							portion->bytes) {
+			err = -ERANGE;
+			goto corrupted_portion;
+		}
+
+		mempool_pax_to_rows(payload, rows, portion->records,
+				    container->granularity,
+				    container->record_capacity);
+
+		dst->data = rows;
+	} else {
+		dst->data = payload;
+	}
+
+	return 0;
+
+corrupted_portion:
+	if (!is_output) {
+		MEMPOOL_ERR("input portion is corrupted: portion %d, err %d\n",
+			    index, err);
+		return err;
+	}
+
+	mempool_verify_report(ctx, index, -1, NULL, NULL, 0,
+			      "portion is corrupted");
+
+	return 0;
+}
+
+static
+int mempool_verify_load_input_task(struct mempool_verify_context *ctx,
+				   int index)
+{
+	return mempool_verify_load_portion(ctx, &ctx->input, index,
+					   MEMPOOL_FALSE);
+}
+
+static
+int mempool_verify_load_output_task(struct mempool_verify_context *ctx,
+				    int index)
+{
+	return mempool_verify_load_portion(ctx, &ctx->output, index,
+					   MEMPOOL_TRUE);
+}
+
+/************************************************************************
+ *                  KEY-VALUE, SELECT, TOTAL, CONVERT                   *
+ ************************************************************************/
+
+/*
+ * Expected output portion is built from input portion.
+ * It returns the number of valid bytes in @output.
+ */
+static
+size_t mempool_verify_expected_portion(struct mempool_verify_context *ctx,
+				       struct mempool_verify_portion *input,
+				       unsigned char *output,
+				       unsigned int *records)
+{
+	struct mempool_test_environment *env = ctx->env;
+	size_t record_size = (size_t)env->item.granularity *
+						env->record.capacity;
+	const unsigned char *record;
+	unsigned long long key;
+	size_t written = 0;
+	unsigned int i;
+
+	*records = 0;
+
+	switch (env->algorithm.id) {
+	case MEMPOOL_KEY_VALUE_ALGORITHM:
+		for (i = 0; i < input->records; i++) {
+			record = input->data + i * record_size;
+			written += mempool_ref_key_value(env, record,
+							 output + written);
+		}
+
+		*records = input->records;
+		break;
+
+	case MEMPOOL_SELECT_ALGORITHM:
+		for (i = 0; i < input->records; i++) {
+			record = input->data + i * record_size;
+			key = mempool_ref_key(env, record);
+
+			if (env->condition.min <= key &&
+			    key < env->condition.max) {
+				written += mempool_ref_key_value(env, record,
+							output + written);
+				(*records)++;
+			}
+		}
+		break;
+
+	case MEMPOOL_TOTAL_ALGORITHM:
+		written = env->record.capacity * sizeof(unsigned long long);
+		memset(output, 0, written);
+
+		for (i = 0; i < input->records; i++) {
+			record = input->data + i * record_size;
+			mempool_ref_total(env, record,
+					  (unsigned long long *)output);
+		}
+
+		*records = 1;
+		break;
+
+	case MEMPOOL_CONVERT_ALGORITHM:
+		written = input->records * record_size;
+		memcpy(output, input->data, written);
+		*records = input->records;
+		break;
+	}
+
+	return written;
+}
+
+static
+int mempool_verify_portion_task(struct mempool_verify_context *ctx,
+				int index)
+{
+	struct mempool_test_environment *env = ctx->env;
+	struct mempool_verify_portion *input = &ctx->input.portions[index];
+	struct mempool_verify_portion *output = &ctx->output.portions[index];
+	unsigned char *expected;
+	size_t buffer_size;
+	size_t bytes;
+	unsigned int records;
+	char reason[128];
+
+	buffer_size = env->threads.portion_size;
+	if (buffer_size < env->record.capacity * sizeof(unsigned long long))
+		buffer_size = env->record.capacity * sizeof(unsigned long long);
+
+	expected = malloc(buffer_size);
+	if (!expected) {
+		MEMPOOL_ERR("fail to allocate buffer: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	bytes = mempool_verify_expected_portion(ctx, input, expected,
+						&records);
+
+	/* corrupted portion has been reported already */
+	if (!output->data)
+		goto finish_portion_check;
+
+	if (ctx->output.container.portions) {
+		if (output->records != records || output->bytes != bytes) {
+			snprintf(reason, sizeof(reason),
+				 "records %u, bytes %llu, expected "
+				 "records %u, bytes %zu",
+				 output->records, output->bytes,
+				 records, bytes);
+			mempool_verify_report(ctx, index, -1, NULL, NULL, 0,
+					      reason);
+		}
+
+		if (bytes > output->bytes)
+			bytes = output->bytes;
+	}
+
+	mempool_verify_compare(ctx, index, expected, output->data, bytes,
+			       ctx->record_size);
+
+	if (!ctx->output.container.portions) {
+		mempool_verify_clean_tail(ctx, index, output->data,
+					  bytes, output->bytes);
+	}
+
+finish_portion_check:
+	free(expected);
+
+	return 0;
+}
+
+/************************************************************************
+ *                                SORT                                  *
+ ************************************************************************/
+
+static
+int mempool_verify_sort_task(struct mempool_verify_context *ctx, int index)
+{
+	struct mempool_test_environment *env = ctx->env;
+	struct mempool_verify_portion *input = &ctx->input.portions[index];
+	struct mempool_verify_portion *output = &ctx->output.portions[index];
+	size_t record_size = ctx->record_size;
+	unsigned long long prev_key;
+	unsigned long long key;
+	unsigned int i;
+	char reason[128];
+
+	mempool_ref_summarize(env, input->data, input->records,
+			      &ctx->summaries[index]);
+
+	if (!output->data)
+		return 0;
+
+	/* every portion keeps the number of records */
+	if (output->records != input->records) {
+		snprintf(reason, sizeof(reason),
+			 "records %u, expected %u",
+			 output->records, input->records);
+		mempool_verify_report(ctx, index, -1, NULL, NULL, 0, reason);
+		return 0;
+	}
+
+	mempool_ref_summarize(env, output->data, output->records,
+			      &ctx->output_summaries[index]);
+
+	for (i = 1; i < output->records; i++) {
+		prev_key = mempool_ref_key(env,
+				output->data + (i - 1) * record_size);
+		key = mempool_ref_key(env, output->data + i * record_size);
+
+		if (prev_key > key) {
+			snprintf(reason, sizeof(reason),
+				 "order is broken: key %llu after key %llu",
+				 key, prev_key);
+			mempool_verify_report(ctx, index, i,
+					      NULL, output->data +
+							i * record_size,
+					      record_size, reason);
+			break;
+		}
+	}
+
+	return 0;
+}
+
+static
+int mempool_verify_sort(struct mempool_verify_context *ctx)
+{
+	struct mempool_verify_summary *summary;
+	unsigned long long input_hash = 0, output_hash = 0;
+	unsigned long long input_mix = 0, output_mix = 0;
+	unsigned long long last_key = 0;
+	int last = -1;
+	int count = ctx->input.portions_count;
+	char reason[128];
+	int i;
+	int err;
+
+	ctx->summaries = calloc(count,
+				sizeof(struct mempool_verify_summary));
+	ctx->output_summaries = calloc(count,
+				sizeof(struct mempool_verify_summary));
+	if (!ctx->summaries || !ctx->output_summaries) {
+		MEMPOOL_ERR("fail to allocate summaries: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	err = mempool_verify_run(ctx, mempool_verify_sort_task, count);
+	if (err)
+		return err;
+
+	/* order has to be kept on boundaries of portions */
+	for (i = 0; i < count; i++) {
+		summary = &ctx->output_summaries[i];
+
+		if (summary->records == 0)
+			continue;
+
+		if (last >= 0 && last_key > summary->first_key) {
+			snprintf(reason, sizeof(reason),
+				 "order is broken between portions: "
+				 "key %llu of portion %d after key %llu",
+				 summary->first_key, last, last_key);
+			mempool_verify_report(ctx, i, 0, NULL, NULL, 0,
+					      reason);
+		}
+
+		last = i;
+		last_key = summary->last_key;
+	}
+
+	/* output has to be a permutation of input */
+	for (i = 0; i < count; i++) {
+		input_hash += ctx->summaries[i].hash_sum;
+		input_mix += ctx->summaries[i].mix_sum;
+		output_hash += ctx->output_summaries[i].hash_sum;
+		output_mix += ctx->output_summaries[i].mix_sum;
+	}
+
+	if (input_hash != output_hash || input_mix != output_mix) {
+		mempool_verify_report(ctx, -1, -1, NULL, NULL, 0,
+				      "records of output are not "
+				      "a permutation of input records");
+	}
+
+	return 0;
+}
+
+/************************************************************************
+ *                                TOPK                                  *
+ ************************************************************************/
+
+static
+int mempool_verify_topk_task(struct mempool_verify_context *ctx, int index)
+{
+	struct mempool_verify_portion *input = &ctx->input.portions[index];
+	int count;
+
+	count = mempool_ref_best_keys(ctx->env, input->data, input->records,
+				ctx->candidates +
+					(size_t)index * ctx->candidates_stride,
+				ctx->candidates_stride);
+	if (count < 0)
+		return count;
+
+	ctx->candidates_count[index] = count;
+
+	return 0;
+}
+
+static
+int mempool_verify_topk(struct mempool_verify_context *ctx)
+{
+	struct mempool_test_environment *env = ctx->env;
+	struct mempool_verify_portion *output = &ctx->output.portions[0];
+	size_t record_size = ctx->record_size;
+	unsigned long long total = 0;
+	unsigned long long key;
+	int count = ctx->input.portions_count;
+	char reason[128];
+	int records;
+	int i;
+	int err;
+
+	ctx->candidates_stride = env->limit.count;
+	if (ctx->candidates_stride > env->portion.capacity)
+		ctx->candidates_stride = env->portion.capacity;
+
+	ctx->candidates = malloc((size_t)count * ctx->candidates_stride *
+				 sizeof(unsigned long long) + 1);
+	ctx->candidates_count = calloc(count, sizeof(int));
+	if (!ctx->candidates || !ctx->candidates_count) {
+		MEMPOOL_ERR("fail to allocate candidates: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	err = mempool_verify_run(ctx, mempool_verify_topk_task, count);
+	if (err)
+		return err;
+
+	/* candidates are gathered in the beginning of array */
+	for (i = 0; i < count; i++) {
+		memmove(ctx->candidates + total,
+			ctx->candidates + (size_t)i * ctx->candidates_stride,
+			ctx->candidates_count[i] *
+					sizeof(unsigned long long));
+		total += ctx->candidates_count[i];
+	}
+
+	mempool_ref_sort_keys(ctx->candidates, total, env->limit.order);
+
+	ctx->keys = ctx->candidates;
+	ctx->keys_count = total < env->limit.count ? total : env->limit.count;
+
+	records = output->records;
+	if (records != ctx->keys_count) {
+		snprintf(reason, sizeof(reason),
+			 "records %d, expected %d",
+			 records, ctx->keys_count);
+		mempool_verify_report(ctx, 0, -1, NULL, NULL, 0, reason);
+	}
+
+	if (!output->data)
+		return 0;
+
+	if (records > ctx->keys_count)
+		records = ctx->keys_count;
+
+	for (i = 0; i < records; i++) {
+		key = mempool_ref_key(env, output->data + i * record_size);
+		if (key == ctx->keys[i])
+			continue;
+
+		snprintf(reason, sizeof(reason),
+			 "key %llu, expected key %llu",
+			 key, ctx->keys[i]);
+		mempool_verify_report(ctx, 0, i, NULL,
+				      output->data + i * record_size,
+				      record_size, reason);
+	}
+
+	return 0;
+}
+
+/************************************************************************
+ *                              DISTINCT                                *
+ ************************************************************************/
+
+static
+int mempool_verify_distinct_set_task(struct mempool_verify_context *ctx,
+				     int index)
+{
+	struct mempool_verify_portion *input = &ctx->input.portions[index];
+
+	return mempool_ref_distinct_set(ctx->env, input->data, input->records,
+					index, &ctx->sets[index]);
+}
+
+static
+int mempool_verify_distinct_task(struct mempool_verify_context *ctx,
+				 int index)
+{
+	struct mempool_test_environment *env = ctx->env;
+	struct mempool_verify_portion *output = &ctx->output.portions[0];
+	struct mempool_verify_entry *entry;
+	size_t input_record_size = (size_t)env->item.granularity *
+						env->record.capacity;
+	const unsigned char *record;
+	const unsigned char *actual;
+	unsigned char *expected;
+	int start = index * MEMPOOL_VERIFY_BLOCK_RECORDS;
+	int end = start + MEMPOOL_VERIFY_BLOCK_RECORDS;
+	size_t bytes;
+	int i;
+
+	if (end > ctx->result.count)
+		end = ctx->result.count;
+	if (end > (int)output->records)
+		end = output->records;
+
+	expected = malloc(ctx->record_size);
+	if (!expected) {
+		MEMPOOL_ERR("fail to allocate buffer: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	for (i = start; i < end; i++) {
+		entry = &ctx->result.entries[i];
+
+		record = ctx->input.portions[entry->portion].data;
+		record += (size_t)entry->index * input_record_size;
+
+		bytes = mempool_ref_distinct_record(env, entry, record,
+						    expected);
+		actual = output->data + (size_t)i * ctx->record_size;
+
+		if (memcmp(expected, actual, bytes) != 0) {
+			mempool_verify_report(ctx, 0, i, expected, actual,
+					      bytes, "records differ");
+		}
+	}
+
+	free(expected);
+
+	return 0;
+}
+
+static
+int mempool_verify_distinct(struct mempool_verify_context *ctx)
+{
+	struct mempool_verify_portion *output = &ctx->output.portions[0];
+	int count = ctx->input.portions_count;
+	char reason[128];
+	int records;
+	int tasks;
+	int err;
+
+	ctx->sets = calloc(count, sizeof(struct mempool_verify_set));
+	if (!ctx->sets) {
+		MEMPOOL_ERR("fail to allocate sets: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	err = mempool_verify_run(ctx, mempool_verify_distinct_set_task,
+				 count);
+	if (err)
+		return err;
+
+	err = mempool_ref_merge_sets(ctx->sets, count, &ctx->result);
+	if (err)
+		return err;
+
+	MEMPOOL_INFO("Unique records: %d\n", ctx->result.count);
+
+	records = output->records;
+	if (records != ctx->result.count) {
+		snprintf(reason, sizeof(reason),
+			 "records %d, expected %d",
+			 records, ctx->result.count);
+		mempool_verify_report(ctx, 0, -1, NULL, NULL, 0, reason);
+	}
+
+	if (!output->data)
+		return 0;
+
+	tasks = (ctx->result.count + MEMPOOL_VERIFY_BLOCK_RECORDS - 1) /
+					MEMPOOL_VERIFY_BLOCK_RECORDS;
+
+	return mempool_verify_run(ctx, mempool_verify_distinct_task, tasks);
+}
+
+/************************************************************************
+ *                           Output geometry                            *
+ ************************************************************************/
+
+/*
+ * Every algorithm defines the size of output record
+ * (see mempool_prepare_output_container() of host-test).
+ */
+static
+size_t mempool_verify_record_size(struct mempool_test_environment *env)
+{
+	size_t key_bytes = mempool_ref_items_bytes(env, env->key.mask);
+	size_t value_bytes = mempool_ref_items_bytes(env, env->value.mask);
+
+	switch (env->algorithm.id) {
+	case MEMPOOL_KEY_VALUE_ALGORITHM:
+	case MEMPOOL_SELECT_ALGORITHM:
+		return key_bytes + value_bytes;
+
+	case MEMPOOL_TOTAL_ALGORITHM:
+		return env->record.capacity * sizeof(unsigned long long);
+
+	case MEMPOOL_DISTINCT_ALGORITHM:
+		switch (env->distinct.output) {
+		case MEMPOOL_DISTINCT_FIRST_VALUE_OUTPUT:
+			return key_bytes + value_bytes;
+
+		case MEMPOOL_DISTINCT_COUNT_OUTPUT:
+			return key_bytes + sizeof(unsigned long long);
+		}
+
+		return key_bytes;
+	}
+
+	return (size_t)env->item.granularity * env->record.capacity;
+}
+
+static inline
+int mempool_verify_single_portion(struct mempool_test_environment *env)
+{
+	return env->algorithm.id == MEMPOOL_TOPK_ALGORITHM ||
+		env->algorithm.id == MEMPOOL_DISTINCT_ALGORITHM;
+}
+
+/*
+ * Describe portions of output: container describes itself, raw
+ * output keeps portions in place of input portions or the whole
+ * result of TOPK and DISTINCT.
+ */
+static
+int mempool_verify_describe_output(struct mempool_verify_context *ctx)
+{
+	struct mempool_test_environment *env = ctx->env;
+	struct mempool_verify_dataset *output = &ctx->output;
+	struct mempool_container *container = &output->container;
+	int expected_count = env->threads.count;
+	size_t record_size;
+	int i;
+	int err;
+
+	if (mempool_verify_single_portion(env))
+		expected_count = 1;
+
+	if (container->portions) {
+		record_size = (size_t)container->granularity *
+					container->record_capacity;
+
+		if (container->portions_count != expected_count ||
+		    record_size != ctx->record_size) {
+			MEMPOOL_ERR("output geometry is unexpected: "
+				    "portions %d, record_size %zu, "
+				    "expected portions %d, record_size %zu\n",
+				    container->portions_count, record_size,
+				    expected_count, ctx->record_size);
+			return -EBADMSG;
+		}
+
+		return mempool_verify_describe(output, 0, 0, 0);
+	}
+
+	if (mempool_verify_single_portion(env)) {
+		err = mempool_verify_describe(output, 1, output->size, 0);
+		if (err)
+			return err;
+
+		output->portions[0].records = output->size / ctx->record_size;
+
+		if (output->size % ctx->record_size) {
+			MEMPOOL_ERR("output size is unexpected: "
+				    "size %zu, record_size %zu\n",
+				    output->size, ctx->record_size);
+			return -EBADMSG;
+		}
+
+		return 0;
+	}
+
+	err = mempool_verify_describe(output, env->threads.count,
+				      env->threads.portion_size, 0);
+	if (err)
+		return err;
+
+	/* raw output keeps the number of records of input portions */
+	for (i = 0; i < env->threads.count; i++) {
+		output->portions[i].records =
+				ctx->input.portions[i].records;
+	}
+
+	return 0;
+}
+
+static
+int mempool_verify_algorithm(struct mempool_verify_context *ctx)
+{
+	switch (ctx->env->algorithm.id) {
+	case MEMPOOL_KEY_VALUE_ALGORITHM:
+	case MEMPOOL_SELECT_ALGORITHM:
+	case MEMPOOL_TOTAL_ALGORITHM:
+	case MEMPOOL_CONVERT_ALGORITHM:
+		return mempool_verify_run(ctx, mempool_verify_portion_task,
+					  ctx->input.portions_count);
+
+	case MEMPOOL_SORT_ALGORITHM:
+		return mempool_verify_sort(ctx);
+
+	case MEMPOOL_TOPK_ALGORITHM:
+		return mempool_verify_topk(ctx);
+
+	case MEMPOOL_DISTINCT_ALGORITHM:
+		return mempool_verify_distinct(ctx);
+	}
+
+	MEMPOOL_ERR("unknown algorithm: %#x\n", ctx->env->algorithm.id);
+
+	return -EOPNOTSUPP;
+}
+
+static
+void mempool_verify_destroy(struct mempool_verify_context *ctx)
+{
+	int i;
+
+	if (ctx->summaries)
+		free(ctx->summaries);
+
+	if (ctx->output_summaries)
+		free(ctx->output_summaries);
+
+	if (ctx->candidates)
+		free(ctx->candidates);
+
+	if (ctx->candidates_count)
+		free(ctx->candidates_count);
+
+	if (ctx->sets) {
+		for (i = 0; i < ctx->input.portions_count; i++)
+			free(ctx->sets[i].entries);
+
+		free(ctx->sets);
+	}
+
+	if (ctx->result.entries)
+		free(ctx->result.entries);
+
+	mempool_verify_close(&ctx->input);
+	mempool_verify_close(&ctx->output);
+
+	pthread_mutex_destroy(&ctx->lock);
+}
+
+/*
+ * host-test writes manifest of checksums next to output file
+ * (see mempool_write_manifest()). The crc32c of the whole file
+ * and of every portion are compared with the manifest.
+ */
+static
+int mempool_verify_manifest(struct mempool_verify_context *ctx,
+			    uint32_t checksum)
+{
+	struct mempool_verify_dataset *output = &ctx->output;
+	unsigned long long portion_size = 0;
+	unsigned long long offset;
+	unsigned long long bytes;
+	unsigned long long value;
+	unsigned int records;
+	unsigned int crc;
+	char line[256];
+	FILE *stream;
+	char *name;
+	int portions = 0;
+	int index;
+	int err = 0;
+
+	/* directory of container keeps crc32c of portions */
+	if (output->container.portions)
+		return 0;
+
+	name = malloc(strlen(output->name) +
+			sizeof(MEMPOOL_CHECKSUM_MANIFEST_SUFFIX));
+	if (!name) {
+		MEMPOOL_ERR("fail to allocate manifest name: %s\n",
+			    strerror(errno));
+		return -ENOMEM;
+	}
+
+	sprintf(name, "%s%s", output->name, MEMPOOL_CHECKSUM_MANIFEST_SUFFIX);
+
+	stream = fopen(name, "r");
+	if (!stream) {
+		/* manifest is optional */
+		if (errno != ENOENT) {
+			err = -errno;
+			MEMPOOL_ERR("fail to open manifest %s: %s\n",
+				    name, strerror(errno));
+		}
+		goto free_name;
+	}
+
+	while (fgets(line, sizeof(line), stream)) {
+		if (sscanf(line, "file_size %llu", &value) == 1) {
+			if (value != output->size) {
+				mempool_verify_report(ctx, -1, -1, NULL, NULL, 0,
+					"file size differs from manifest");
+			}
+		} else if (sscanf(line, "file_crc32c %x", &crc) == 1) {
+			if (crc != checksum) {
+				mempool_verify_report(ctx, -1, -1, NULL, NULL, 0,
+					"file crc32c differs from manifest");
+			}
+		} else if (sscanf(line, "portion_size %llu", &value) == 1) {
+			portion_size = value;
+		} else if (sscanf(line, "portion %d offset %llu records %u "
+					"bytes %llu crc32c %x",
+				  &index, &offset, &records,
+				  &bytes, &crc) == 5) {
+			portions++;
+
+			if (offset + portion_size > output->size) {
+				mempool_verify_report(ctx, index, -1, NULL, NULL,
+					0, "portion of manifest is out of file");
+				continue;
+			}
+
+			if ((crc32c(~0U, (unsigned char *)output->addr + offset,
+				    portion_size) ^ ~0U) != crc) {
+				mempool_verify_report(ctx, index, -1, NULL, NULL,
+					0, "portion crc32c differs from manifest");
+			}
+		}
+	}
+
+	if (ferror(stream)) {
+		err = -EIO;
+		MEMPOOL_ERR("fail to read manifest %s\n", name);
+	} else {
+		MEMPOOL_INFO("Manifest %s: portions %d\n", name, portions);
+	}
+
+	fclose(stream);
+
+free_name:
+	free(name);
+
+	return err;
+}
+
+int main(int argc, char *argv[])
+{
+	struct mempool_test_environment environment;
+	struct mempool_verify_context ctx;
+	struct timespec start_time, finish_time;
+	unsigned long long checked_bytes;
+	long long portion_size;
+	uint32_t checksum;
+	double seconds;
+	long cpus;
+	int err = 0;
+
+	memset(&environment, 0, sizeof(environment));
+	memset(&ctx, 0, sizeof(ctx));
+
+	environment.item.granularity = 1;
+	environment.record.capacity = 1;
+	environment.condition.min = 0;
+	environment.condition.max = ULLONG_MAX;
+	environment.limit.order = MEMPOOL_ASCENDING_ORDER;
+	environment.distinct.output = MEMPOOL_DISTINCT_KEY_OUTPUT;
+	environment.encoding.input = MEMPOOL_PLAIN_ENCODING;
+	environment.layout.input = MEMPOOL_ROW_LAYOUT;
+	environment.algorithm.id = MEMPOOL_UNKNOWN_ALGORITHM;
+	environment.show_debug = MEMPOOL_FALSE;
+
+	ctx.env = &environment;
+	ctx.input.fd = -1;
+	ctx.output.fd = -1;
+	pthread_mutex_init(&ctx.lock, NULL);
+
+	parse_options(argc, argv, &environment);
+
+	MEMPOOL_DBG(environment.show_debug,
+		    "options have been parsed\n");
+
+	if (!environment.input_file.name || !environment.output_file.name) {
+		err = -EINVAL;
+		MEMPOOL_ERR("input and output files have to be defined\n");
+		goto finish_execution;
+	}
+
+	if (environment.algorithm.id == MEMPOOL_UNKNOWN_ALGORITHM) {
+		err = -EINVAL;
+		MEMPOOL_ERR("algorithm has to be defined\n");
+		goto finish_execution;
+	}
+
+	ctx.input.name = environment.input_file.name;
+	ctx.output.name = environment.output_file.name;
+
+	err = mempool_verify_open(&ctx.input);
+	if (err)
+		goto finish_execution;
+
+	/* container defines geometry of dataset instead of options */
+	if (ctx.input.container.portions) {
+		err = mempool_container_load_geometry(&ctx.input.container,
+						      &environment);
+		if (err) {
+			MEMPOOL_ERR("fail to load geometry: err %d\n", err);
+			goto finish_execution;
+		}
+	}
+
+	if (environment.threads.count <= 0) {
+		MEMPOOL_INFO("Nothing can be done: "
+			     "threads.count %d\n",
+			     environment.threads.count);
+		goto finish_execution;
+	}
+
+	portion_size = (long long)environment.item.granularity *
+			environment.record.capacity;
+	portion_size *= environment.portion.capacity;
+
+	if (portion_size != environment.threads.portion_size ||
+	    environment.portion.count > environment.portion.capacity) {
+		err = -ERANGE;
+		MEMPOOL_ERR("invalid request: "
+			    "portion_size %lld, granularity %d, "
+			    "record_capacity %d, portion_capacity %d, "
+			    "portion_count %d\n",
+			    environment.threads.portion_size,
+			    environment.item.granularity,
+			    environment.record.capacity,
+			    environment.portion.capacity,
+			    environment.portion.count);
+		goto finish_execution;
+	}
+
+	if (environment.algorithm.id == MEMPOOL_TOPK_ALGORITHM &&
+	    environment.limit.count <= 0) {
+		err = -EINVAL;
+		MEMPOOL_ERR("invalid limit: count %d\n",
+			    environment.limit.count);
+		goto finish_execution;
+	}
+
+	if (environment.workers.count == 0) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		environment.workers.count = cpus > 0 ? (int)cpus : 1;
+	}
+
+	err = mempool_verify_open(&ctx.output);
+	if (err)
+		goto finish_execution;
+
+	ctx.record_size = mempool_verify_record_size(&environment);
+	if (ctx.record_size == 0) {
+		err = -EINVAL;
+		MEMPOOL_ERR("output record is empty: "
+			    "key mask %#llx, value mask %#llx\n",
+			    environment.key.mask, environment.value.mask);
+		goto finish_execution;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start_time);
+
+	MEMPOOL_INFO("Load portions: portions %d, threads %d...\n",
+		     environment.threads.count, environment.workers.count);
+
+	err = mempool_verify_describe(&ctx.input, environment.threads.count,
+				      environment.threads.portion_size,
+				      environment.portion.count);
+	if (err)
+		goto finish_execution;
+
+	if (ctx.input.container.portions) {
+		err = mempool_verify_run(&ctx, mempool_verify_load_input_task,
+					 ctx.input.portions_count);
+		if (err)
+			goto finish_execution;
+	}
+
+	err = mempool_verify_describe_output(&ctx);
+	if (err == -EBADMSG) {
+		/* output cannot be compared with expected result */
+		mempool_verify_report(&ctx, -1, -1, NULL, NULL, 0,
+				      "output geometry is unexpected");
+		err = 0;
+		goto report_result;
+	} else if (err) {
+		goto finish_execution;
+	}
+
+	if (ctx.output.container.portions) {
+		err = mempool_verify_run(&ctx, mempool_verify_load_output_task,
+					 ctx.output.portions_count);
+		if (err)
+			goto finish_execution;
+	}
+
+	MEMPOOL_INFO("Verify output...\n");
+
+	err = mempool_verify_algorithm(&ctx);
+	if (err) {
+		MEMPOOL_ERR("fail to verify output: err %d\n", err);
+		goto finish_execution;
+	}
+
+report_result:
+	clock_gettime(CLOCK_MONOTONIC, &finish_time);
+
+	seconds = (finish_time.tv_sec - start_time.tv_sec) +
+			(finish_time.tv_nsec - start_time.tv_nsec) / 1e9;
+	checked_bytes = ctx.input.size + ctx.output.size;
+
+	MEMPOOL_INFO("Checked: bytes %llu, time %.3f seconds, "
+		     "throughput %.1f MB/s\n",
+		     checked_bytes, seconds,
+		     seconds > 0 ? checked_bytes / seconds / (1024 * 1024) : 0);
+
+	/* checksum of the whole file is combined by checksums of parts */
+	err = crc32c_file(ctx.output.fd, 0, ctx.output.size,
+			  environment.workers.count, &checksum);
+	if (err) {
+		MEMPOOL_ERR("fail to checksum output: err %d\n", err);
+		goto finish_execution;
+	}
+
+	MEMPOOL_INFO("Output crc32c: %#x\n", checksum);
+
+	err = mempool_verify_manifest(&ctx, checksum);
+	if (err)
+		goto finish_execution;
+
+	if (ctx.mismatches) {
+		err = -EBADMSG;
+		MEMPOOL_INFO("Verification: FAILED, mismatches %llu\n",
+			     ctx.mismatches);
+	} else {
+		MEMPOOL_INFO("Verification: OK\n");
+	}
+
+finish_execution:
+	mempool_verify_destroy(&ctx);
+
+	exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -0,0 +1,214 @@
+//SPDX-License-Identifier: BSD-3-Clause-Clear
+/*
+ * memory-pool-tools -- memory pool testing utilities.
+ *
+ * sbin/verify.h - output verifier declarations.
+ *
+ * Copyright (c) 2021-2022 Viacheslav Dubeyko <slava@dubeyko.com>
+ *                         Igor Kauranen <aatx12@gmail.com>
+ *                         Evgenii Bushtyrev <eugene@bushtyrev.com>
+ * All rights reserved.
+ *
+ * Authors: Vyacheslav Dubeyko <slava@dubeyko.com>
+ *          Igor Kauranen <aatx12@gmail.com>
+ *          Evgenii Bushtyrev <eugene@bushtyrev.com>
+ */
+
+#ifndef _VERIFY_TOOL_H
+#define _VERIFY_TOOL_H
+
+#ifdef verify_fmt
+#undef verify_fmt
+#endif
+
+#include "version.h"
+
+#define verify_fmt(fmt) "verify: " MEMPOOL_TOOLS_VERSION ": " fmt
+
+#include <pthread.h>
+
+#include "memory_pool_constants.h"
+#include "memory_pool_tools.h"
+#include "memory_pool_container.h"
+
+#define VERIFY_INFO(show, fmt, ...) \
+	do { \
+		if (show) { \
+			fprintf(stdout, verify_fmt(fmt), ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+/* number of mismatches that are reported in details */
+#define MEMPOOL_VERIFY_MAX_REPORTS		(10)
+
+/* number of record bytes that are shown by report */
+#define MEMPOOL_VERIFY_DUMP_BYTES		(32)
+
+/* number of DISTINCT records that are checked by one task */
+#define MEMPOOL_VERIFY_BLOCK_RECORDS		(64 * 1024)
+
+/*
+ * struct mempool_verify_portion - portion of dataset
+ * @data: records of portion in ROW layout
+ * @records: number of records in portion
+ * @bytes: number of valid bytes in portion
+ */
+struct mempool_verify_portion {
+	const unsigned char *data;
+	unsigned int records;
+	unsigned long long bytes;
+};
+
+/*
+ * struct mempool_verify_dataset - mapped dataset
+ * @name: file name
+ * @fd: file descriptor
+ * @addr: mapping of file
+ * @size: size of file in bytes
+ * @buffer: decoded or converted portions
+ * @buffer_size: size of buffer in bytes
+ * @container: directory of container (portions is NULL for raw file)
+ * @portions: portions of dataset
+ * @portions_count: number of portions
+ */
+struct mempool_verify_dataset {
+	const char *name;
+	int fd;
+	void *addr;
+	size_t size;
+	void *buffer;
+	size_t buffer_size;
+	struct mempool_container container;
+	struct mempool_verify_portion *portions;
+	int portions_count;
+};
+
+/*
+ * struct mempool_verify_summary - summary of portion's records
+ * @first_key: key of the first record
+ * @last_key: key of the last record
+ * @hash_sum: sum of hashes of records
+ * @mix_sum: sum of mixed hashes of records
+ * @records: number of records
+ */
+struct mempool_verify_summary {
+	unsigned long long first_key;
+	unsigned long long last_key;
+	unsigned long long hash_sum;
+	unsigned long long mix_sum;
+	unsigned int records;
+};
+
+/*
+ * struct mempool_verify_entry - record of DISTINCT reference
+ * @key: key of record
+ * @portion: portion of the first record with the key
+ * @index: index of the first record in portion
+ * @count: number of records with the key
+ */
+struct mempool_verify_entry {
+	unsigned long long key;
+	int portion;
+	int index;
+	unsigned long long count;
+};
+
+/*
+ * struct mempool_verify_set - sorted set of DISTINCT entries
+ * @entries: array of entries
+ * @count: number of entries
+ */
+struct mempool_verify_set {
+	struct mempool_verify_entry *entries;
+	int count;
+};
+
+struct mempool_verify_context;
+
+typedef int (*mempool_verify_func)(struct mempool_verify_context *ctx,
+				   int index);
+
+/*
+ * struct mempool_verify_context - state of verification
+ * @env: verifier's environment
+ * @input: input dataset
+ * @output: output dataset
+ * @record_size: size of output record in bytes
+ * @summaries: summaries of input portions (SORT)
+ * @output_summaries: summaries of output portions (SORT)
+ * @candidates: the best keys of every input portion (TOPK)
+ * @candidates_count: number of candidates of every input portion (TOPK)
+ * @candidates_stride: maximum number of candidates of portion (TOPK)
+ * @keys: expected keys of output records (TOPK)
+ * @keys_count: number of expected keys (TOPK)
+ * @sets: unique keys of every input portion (DISTINCT)
+ * @result: merged unique keys of dataset (DISTINCT)
+ * @func: function of the current phase
+ * @tasks: number of tasks of the current phase
+ * @next_task: index of the next task
+ * @lock: lock of reports
+ * @mismatches: number of found mismatches
+ * @err: the first error of tasks
+ */
+struct mempool_verify_context {
+	struct mempool_test_environment *env;
+	struct mempool_verify_dataset input;
+	struct mempool_verify_dataset output;
+	size_t record_size;
+	struct mempool_verify_summary *summaries;
+	struct mempool_verify_summary *output_summaries;
+	unsigned long long *candidates;
+	int *candidates_count;
+	int candidates_stride;
+	unsigned long long *keys;
+	int keys_count;
+	struct mempool_verify_set *sets;
+	struct mempool_verify_set result;
+	mempool_verify_func func;
+	int tasks;
+	int next_task;
+	pthread_mutex_t lock;
+	unsigned long long mismatches;
+	int err;
+};
+
+/* options.c */
+void print_version(void);
+void print_usage(void);
+void parse_options(int argc, char *argv[],
+		   struct mempool_test_environment *env);
+
+/* reference.c */
+int mempool_ref_is_bit_set(unsigned long long mask, int bit, int capacity);
+size_t mempool_ref_items_bytes(struct mempool_test_environment *env,
+				unsigned long long mask);
+unsigned long long mempool_ref_key(struct mempool_test_environment *env,
+				   const unsigned char *record);
+size_t mempool_ref_copy_items(struct mempool_test_environment *env,
+			      unsigned long long mask,
+			      const unsigned char *record,
+			      unsigned char *output);
+size_t mempool_ref_key_value(struct mempool_test_environment *env,
+			     const unsigned char *record,
+			     unsigned char *output);
+void mempool_ref_total(struct mempool_test_environment *env,
+		       const unsigned char *record,
+		       unsigned long long *sums);
+void mempool_ref_summarize(struct mempool_test_environment *env,
+			   const unsigned char *records, unsigned int count,
+			   struct mempool_verify_summary *summary);
+int mempool_ref_best_keys(struct mempool_test_environment *env,
+			  const unsigned char *records, unsigned int count,
+			  unsigned long long *keys, int limit);
+int mempool_ref_sort_keys(unsigned long long *keys, int count, int order);
+int mempool_ref_distinct_set(struct mempool_test_environment *env,
+			     const unsigned char *records, unsigned int count,
+			     int portion, struct mempool_verify_set *set);
+int mempool_ref_merge_sets(struct mempool_verify_set *sets, int count,
+			   struct mempool_verify_set *result);
+size_t mempool_ref_distinct_record(struct mempool_test_environment *env,
+				   struct mempool_verify_entry *entry,
+				   const unsigned char *record,
+				   unsigned char *output);
+
+#endif /* _VERIFY_TOOL_H */
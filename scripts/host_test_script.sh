@@ -8,11 +8,16 @@ fi
 
 if [[ ! -e $1 ]]
 then
-    echo "$1 does not exist"
-    exit 1
+    echo "$1 does not exist: generate it"
+    ./data-gen -o $1 -t number=10,portion-size=4096 -I granularity=1 -r capacity=4 -p capacity=1024,count=1024 -k mask=8 -v mask=7 -D type=uniform,seed=1 || exit 1
 fi
 
 ./host-test -i $1 -o ./output1.txt -t number=10,portion-size=4096 -I granularity=1 -r capacity=4 -p capacity=1024,count=1024 -k mask=8 -v mask=7 -a KEY-VALUE
+./verify -i $1 -o ./output1.txt -t number=10,portion-size=4096 -I granularity=1 -r capacity=4 -p capacity=1024,count=1024 -k mask=8 -v mask=7 -a KEY-VALUE || exit 1
 #./host-test -i ./output1.txt -o ./output2.txt -t number=10,portion-size=4096 -I granularity=1 -r capacity=4 -p capacity=1024,count=1024 -k mask=8 -v mask=7 -c min=5,max=60 -a SELECT
 ./host-test -i ./output1.txt -o ./output2.txt -t number=10,portion-size=4096 -I granularity=1 -r capacity=4 -p capacity=1024,count=1024 -k mask=8 -v mask=7 -a SORT
+./verify -i ./output1.txt -o ./output2.txt -t number=10,portion-size=4096 -I granularity=1 -r capacity=4 -p capacity=1024,count=1024 -k mask=8 -v mask=7 -a SORT || exit 1
 ./host-test -i ./output2.txt -o ./output3.txt -t number=10,portion-size=4096 -I granularity=1 -r capacity=4 -p capacity=1024,count=1024 -k mask=8 -v mask=7 -a TOTAL
+./verify -i ./output2.txt -o ./output3.txt -t number=10,portion-size=4096 -I granularity=1 -r capacity=4 -p capacity=1024,count=1024 -k mask=8 -v mask=7 -a TOTAL || exit 1
+#./host-test -i ./output1.txt -o ./output4.txt -t number=10,portion-size=4096 -I granularity=1 -r capacity=4 -p capacity=1024,count=1024 -k mask=8 -v mask=7 -l count=16,order=asc -a TOPK
+#./host-test -i ./output1.txt -o ./output5.txt -t number=10,portion-size=4096 -I granularity=1 -r capacity=4 -p capacity=1024,count=1024 -k mask=8 -v mask=7 -u output=count -a DISTINCT